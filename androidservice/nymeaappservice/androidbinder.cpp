@@ -62,12 +62,12 @@ bool AndroidBinder::onTransact(int code, const QAndroidParcel &data, const QAndr
             thingMap.insert("interfaces", thing->thingClass()->interfaces());
             QVariantList states;
             for (int j = 0; j < thing->states()->rowCount(); j++) {
-                State *state = thing->states()->get(j);
+                QUuid stateTypeId = thing->states()->stateTypeIdAt(j);
                 QVariantMap stateMap;
-                stateMap.insert("stateTypeId", state->stateTypeId());
-                stateMap.insert("name", thing->thingClass()->stateTypes()->getStateType(state->stateTypeId())->name());
-                stateMap.insert("displayName", thing->thingClass()->stateTypes()->getStateType(state->stateTypeId())->displayName());
-                stateMap.insert("value", state->value());
+                stateMap.insert("stateTypeId", stateTypeId);
+                stateMap.insert("name", thing->thingClass()->stateTypes()->getStateType(stateTypeId)->name());
+                stateMap.insert("displayName", thing->thingClass()->stateTypes()->getStateType(stateTypeId)->displayName());
+                stateMap.insert("value", thing->states()->valueAt(j));
                 states.append(stateMap);
             }
             thingMap.insert("states", states);
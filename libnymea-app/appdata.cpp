@@ -135,6 +135,11 @@ void AppData::appDataReceived(int commandId, const QVariantMap &params)
 {
     if (m_readRequests.contains(commandId)) {
         QString propName = m_readRequests.take(commandId);
+        if (JsonRpcClient::isLost(params)) {
+            // Keep the value we have instead of overwriting it with an empty one
+            qCWarning(dcAppData()) << "Loading app data failed for" << propName;
+            return;
+        }
         for (int i = metaObject()->propertyOffset(); i < metaObject()->propertyCount(); i++) {
             QMetaProperty prop = metaObject()->property(i);
             if (prop.name() == propName) {
@@ -218,6 +218,10 @@ void NetworkManager::getStatusResponse(int /*commandId*/, const QVariantMap &par
     m_loading = false;
     emit loadingChanged();
 
+    if (JsonRpcClient::isLost(params)) {
+        // Doesn't tell whether it's available
+        return;
+    }
     if (params.value("networkManagerError").toString() != "NetworkManagerErrorNoError") {
         qWarning() << "NetworkManager error:" << qUtf8Printable(QJsonDocument::fromVariant(params).toJson(QJsonDocument::Indented));
         m_available = false;
@@ -300,6 +304,9 @@ void NetworkManager::getAccessPointsResponse(int commandId, const QVariantMap &p
         qWarning() << "NetworkManager received wifi list for" << interface << "but device disappeared";
         return;
     }
+    if (JsonRpcClient::isLost(params)) {
+        return;
+    }
 
     dev->accessPoints()->clearModel();
 
@@ -284,6 +284,9 @@ void NymeaConfiguration::getConfigurationsResponse(int commandId, const QVariant
 {
     Q_UNUSED(commandId)
     qCDebug(dcNymeaConfiguration) << "GetConfigurations response" << qUtf8Printable(QJsonDocument::fromVariant(params).toJson());
+    if (JsonRpcClient::isLost(params)) {
+        return;
+    }
     QVariantMap basicConfig = params.value("basicConfiguration").toMap();
     m_debugServerEnabled = basicConfig.value("debugServerEnabled").toBool();
     emit debugServerEnabledChanged();
@@ -390,6 +393,9 @@ void NymeaConfiguration::deleteTunnelProxyServerConfigReply(int commandId, const
 void NymeaConfiguration::getMqttServerConfigsReply(int commandId, const QVariantMap &params)
 {
     Q_UNUSED(commandId)
+    if (JsonRpcClient::isLost(params)) {
+        return;
+    }
     m_mqttServerConfigurations->clear();
     foreach (const QVariant &mqttServerVariant, params.value("mqttServerConfigurations").toList()) {
         QVariantMap mqttConfigMap = mqttServerVariant.toMap();
@@ -412,6 +418,9 @@ void NymeaConfiguration::getMqttPoliciesReply(int commandId, const QVariantMap &
 {
     Q_UNUSED(commandId)
 //    qCDebug(dcNymeaConfiguration) << "Mqtt polices:" << params;
+    if (JsonRpcClient::isLost(params)) {
+        return;
+    }
     m_mqttPolicies->clear();
     foreach (const QVariant &policyVariant, params.value("mqttPolicies").toList()) {
         QVariantMap policyMap = policyVariant.toMap();
@@ -0,0 +1,135 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU General Public License as published by the Free Software
+* Foundation, GNU version 3. This project is distributed in the hope that it
+* will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+* Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "connectionstats.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QSettings>
+
+// Bump when changing the record layout, older records are dropped
+static const quint8 recordVersion = 1;
+
+static int smooth(int average, int value)
+{
+    // A single outlier shouldn't throw away the history
+    return average < 0 ? value : (3 * average + value) / 4;
+}
+
+void ConnectionStats::addSuccess(int handshakeTime)
+{
+    this->handshakeTime = smooth(this->handshakeTime, handshakeTime);
+    successCount++;
+    failureStreak = 0;
+    lastSuccess = QDateTime::currentDateTime();
+}
+
+void ConnectionStats::addFailure()
+{
+    failureCount++;
+    failureStreak++;
+    lastFailure = QDateTime::currentDateTime();
+}
+
+void ConnectionStats::addTimeToFirstByte(int timeToFirstByte)
+{
+    this->timeToFirstByte = smooth(this->timeToFirstByte, timeToFirstByte);
+}
+
+void ConnectionStats::addRoundTripTime(int roundTripTime)
+{
+    m_roundTrips.add(roundTripTime);
+}
+
+int ConnectionStats::roundTripCount() const
+{
+    return m_roundTrips.count();
+}
+
+int ConnectionStats::roundTripPercentile(qreal share) const
+{
+    return m_roundTrips.percentile(share);
+}
+
+ConnectionStats ConnectionStats::load(const QUrl &url)
+{
+    QSettings settings;
+    settings.beginGroup("ConnectionStats");
+    QString key = QCryptographicHash::hash(url.toEncoded(), QCryptographicHash::Sha1).toHex();
+    return fromByteArray(settings.value(key).toByteArray());
+}
+
+void ConnectionStats::save(const QUrl &url) const
+{
+    QSettings settings;
+    settings.beginGroup("ConnectionStats");
+    QString key = QCryptographicHash::hash(url.toEncoded(), QCryptographicHash::Sha1).toHex();
+    settings.setValue(key, toByteArray());
+}
+
+QByteArray ConnectionStats::toByteArray() const
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream << recordVersion;
+    stream << static_cast<qint32>(handshakeTime) << static_cast<qint32>(timeToFirstByte);
+    stream << static_cast<qint32>(successCount) << static_cast<qint32>(failureCount) << static_cast<qint32>(failureStreak);
+    stream << (lastSuccess.isValid() ? lastSuccess.toMSecsSinceEpoch() : Q_INT64_C(0));
+    stream << (lastFailure.isValid() ? lastFailure.toMSecsSinceEpoch() : Q_INT64_C(0));
+    stream << m_roundTrips.buckets();
+    return data;
+}
+
+ConnectionStats ConnectionStats::fromByteArray(const QByteArray &data)
+{
+    ConnectionStats stats;
+    QDataStream stream(data);
+    quint8 version = 0;
+    stream >> version;
+    if (version != recordVersion) {
+        return stats;
+    }
+    qint32 handshakeTime, timeToFirstByte, successCount, failureCount, failureStreak;
+    qint64 lastSuccess, lastFailure;
+    QVector<quint32> roundTrips;
+    stream >> handshakeTime >> timeToFirstByte >> successCount >> failureCount >> failureStreak >> lastSuccess >> lastFailure >> roundTrips;
+    if (stream.status() != QDataStream::Ok) {
+        return stats;
+    }
+    stats.handshakeTime = handshakeTime;
+    stats.timeToFirstByte = timeToFirstByte;
+    stats.successCount = successCount;
+    stats.failureCount = failureCount;
+    stats.failureStreak = failureStreak;
+    stats.lastSuccess = lastSuccess > 0 ? QDateTime::fromMSecsSinceEpoch(lastSuccess) : QDateTime();
+    stats.lastFailure = lastFailure > 0 ? QDateTime::fromMSecsSinceEpoch(lastFailure) : QDateTime();
+    stats.m_roundTrips.setBuckets(roundTrips);
+    return stats;
+}
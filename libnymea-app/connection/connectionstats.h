@@ -0,0 +1,79 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU General Public License as published by the Free Software
+* Foundation, GNU version 3. This project is distributed in the hope that it
+* will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+* Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef CONNECTIONSTATS_H
+#define CONNECTIONSTATS_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QUrl>
+
+#include "latencyhistogram.h"
+
+// Connection quality as seen by this client. Kept across restarts, so the next connect can
+// pick the endpoint which has been fast and reliable.
+class ConnectionStats
+{
+public:
+    // Smoothed times in ms, -1 if unknown
+    // From starting to connect until the transport is up
+    int handshakeTime = -1;
+    // From starting to connect until the first data arrived
+    int timeToFirstByte = -1;
+
+    int successCount = 0;
+    int failureCount = 0;
+    // Failed connects since the last successful one
+    int failureStreak = 0;
+    QDateTime lastSuccess;
+    QDateTime lastFailure;
+
+    void addSuccess(int handshakeTime);
+    void addFailure();
+    void addTimeToFirstByte(int timeToFirstByte);
+
+    // JSON-RPC round trips
+    void addRoundTripTime(int roundTripTime);
+    int roundTripCount() const;
+    // Time in ms within which the given share (0 - 1) of the round trips completed, -1 if there are none
+    int roundTripPercentile(qreal share) const;
+
+    // Stored in the settings, one compact record per url
+    static ConnectionStats load(const QUrl &url);
+    void save(const QUrl &url) const;
+
+private:
+    QByteArray toByteArray() const;
+    static ConnectionStats fromByteArray(const QByteArray &data);
+
+    LatencyHistogram m_roundTrips;
+};
+
+#endif // CONNECTIONSTATS_H
@@ -0,0 +1,111 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU General Public License as published by the Free Software
+* Foundation, GNU version 3. This project is distributed in the hope that it
+* will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+* Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "latencyhistogram.h"
+
+#include <QtMath>
+
+static const int bucketCount = 34;
+// Halving all buckets when exceeding this keeps the histogram biased towards recent samples
+static const quint32 maxSamples = 4096;
+
+void LatencyHistogram::add(int time)
+{
+    if (m_buckets.isEmpty()) {
+        m_buckets.fill(0, bucketCount);
+    }
+    m_buckets[bucket(time)]++;
+    if (count() > static_cast<int>(maxSamples)) {
+        for (int i = 0; i < m_buckets.count(); i++) {
+            m_buckets[i] /= 2;
+        }
+    }
+}
+
+void LatencyHistogram::clear()
+{
+    m_buckets.clear();
+}
+
+int LatencyHistogram::count() const
+{
+    int count = 0;
+    foreach (quint32 bucketCount, m_buckets) {
+        count += static_cast<int>(bucketCount);
+    }
+    return count;
+}
+
+int LatencyHistogram::percentile(qreal share) const
+{
+    int count = this->count();
+    if (count == 0) {
+        return -1;
+    }
+    qreal rank = qBound(0.0, share, 1.0) * count;
+    qreal seen = 0;
+    for (int i = 0; i < m_buckets.count(); i++) {
+        if (m_buckets.at(i) == 0) {
+            continue;
+        }
+        if (seen + m_buckets.at(i) >= rank) {
+            // Interpolate within the bucket
+            qreal fraction = (rank - seen) / m_buckets.at(i);
+            return qRound(bucketStart(i) + fraction * (bucketStart(i + 1) - bucketStart(i)));
+        }
+        seen += m_buckets.at(i);
+    }
+    return qRound(bucketStart(m_buckets.count()));
+}
+
+QVector<quint32> LatencyHistogram::buckets() const
+{
+    return m_buckets;
+}
+
+void LatencyHistogram::setBuckets(const QVector<quint32> &buckets)
+{
+    if (buckets.isEmpty() || buckets.count() == bucketCount) {
+        m_buckets = buckets;
+    }
+}
+
+int LatencyHistogram::bucket(int time)
+{
+    if (time <= 1) {
+        return 0;
+    }
+    return qMin(bucketCount - 1, static_cast<int>(2 * std::log2(time)));
+}
+
+qreal LatencyHistogram::bucketStart(int bucket)
+{
+    return bucket == 0 ? 0 : qPow(2, bucket / 2.0);
+}
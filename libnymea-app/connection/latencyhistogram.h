@@ -0,0 +1,61 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU General Public License as published by the Free Software
+* Foundation, GNU version 3. This project is distributed in the hope that it
+* will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+* Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef LATENCYHISTOGRAM_H
+#define LATENCYHISTOGRAM_H
+
+#include <QVector>
+
+// Histogram of times in ms with two buckets per power of two, from 1 ms to about 90 s.
+// Small enough to keep one per connection or per method, and percentiles are within
+// a few percent of the exact ones.
+class LatencyHistogram
+{
+public:
+    void add(int time);
+    void clear();
+
+    int count() const;
+    // Time in ms within which the given share (0 - 1) of the samples fall, -1 if there are none
+    int percentile(qreal share) const;
+
+    // The raw bucket counts, empty if there are no samples
+    QVector<quint32> buckets() const;
+    // Ignored if they don't have the expected layout
+    void setBuckets(const QVector<quint32> &buckets);
+
+private:
+    static int bucket(int time);
+    static qreal bucketStart(int bucket);
+
+    QVector<quint32> m_buckets;
+};
+
+#endif // LATENCYHISTOGRAM_H
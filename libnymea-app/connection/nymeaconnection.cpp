@@ -43,6 +43,8 @@
 #include <QTimer>
 #include <QGuiApplication>
 
+#include <algorithm>
+
 #include "networkreachabilitymonitor.h"
 #include "nymeatransportinterface.h"
 #include "logging.h"
@@ -54,6 +56,11 @@ NymeaConnection::NymeaConnection(QObject *parent) : QObject(parent)
     m_networkReachabilityMonitor = new NetworkReachabilityMonitor(this);
     connect(m_networkReachabilityMonitor, &NetworkReachabilityMonitor::availableBearerTypesChanged, this, &NymeaConnection::availableBearerTypesChanged);
     connect(m_networkReachabilityMonitor, &NetworkReachabilityMonitor::availableBearerTypesUpdated, this, &NymeaConnection::onAvailableBearerTypesUpdated);
+    connect(m_networkReachabilityMonitor, &NetworkReachabilityMonitor::availableBearerTypesChanged, this, [this](){
+        // What failed on the previous network may work on this one
+        qCDebug(dcNymeaConnection()) << "Network changed. Resetting reconnect backoff.";
+        m_reconnectScheduler.reset();
+    });
 
 #ifdef Q_OS_IOS
     connect(m_networkReachabilityMonitor, &NetworkReachabilityMonitor::availableBearerTypesChanged, this, [this](){
@@ -76,16 +83,27 @@ NymeaConnection::NymeaConnection(QObject *parent) : QObject(parent)
         // or so. So it happens that the device is woken up and the app would try to reconnect, but there are still ongoing
         // connection attempts on all the transports. In order to not wait for them time out, let's abort all the currently
         // pending attempts so we try again immediately, now that wifi should be up again.
+        // Backoff from failures while in the background is forgotten too, the user is looking at the app now.
         if (app->applicationState() == Qt::ApplicationActive) {
             foreach (NymeaTransportInterface *transport, m_transportCandidates.keys()) {
                 if (transport != m_currentTransport) {
-                    transport->disconnect();
+                    dropCandidate(transport);
                 }
             }
+            m_reconnectScheduler.reset();
+            if (m_currentTransport) {
+                tryUpgrade();
+            } else if (m_currentHost && m_connectionStatus != ConnectionStatusSslUntrusted) {
+                m_reconnectTimer.start(0);
+            }
         }
     });
 
-    m_reconnectTimer.setInterval(500);
+    m_clock.start();
+
+    m_candidateTimer.setSingleShot(true);
+    connect(&m_candidateTimer, &QTimer::timeout, this, &NymeaConnection::startNextCandidate);
+
     m_reconnectTimer.setSingleShot(true);
     connect(&m_reconnectTimer, &QTimer::timeout, this, [this](){
         if (m_currentHost && !m_currentTransport) {
@@ -153,10 +171,12 @@ void NymeaConnection::setCurrentHost(NymeaHost *host)
         emit connectedChanged(false);
     }
 
+    m_pendingCandidates.clear();
+    m_candidateTimer.stop();
+    m_reconnectTimer.stop();
+    m_reconnectScheduler.reset();
     while (!m_transportCandidates.isEmpty()) {
-        NymeaTransportInterface *transport = m_transportCandidates.keys().first();
-        m_transportCandidates.remove(transport);
-        transport->deleteLater();
+        dropCandidate(m_transportCandidates.keys().first());
     }
     if (m_currentHost) {
         disconnect(m_currentHost, &NymeaHost::connectionChanged, this, &NymeaConnection::hostConnectionsUpdated);
@@ -190,6 +210,24 @@ Connection *NymeaConnection::currentConnection() const
     return m_transportCandidates.value(m_currentTransport);
 }
 
+bool NymeaConnection::upgradeHeld() const
+{
+    return m_upgradeHeld;
+}
+
+void NymeaConnection::setUpgradeHeld(bool upgradeHeld)
+{
+    m_upgradeHeld = upgradeHeld;
+    if (!m_upgradeHeld && m_heldUpgrade) {
+        // Released while handling a reply. Don't pull the transport away under the JSON-RPC layer's feet.
+        QTimer::singleShot(0, this, [this](){
+            if (!m_upgradeHeld && m_heldUpgrade && m_currentTransport) {
+                upgradeTo(m_heldUpgrade);
+            }
+        });
+    }
+}
+
 void NymeaConnection::sendData(const QByteArray &data)
 {
     if (connected()) {
@@ -268,19 +306,31 @@ void NymeaConnection::onError(QAbstractSocket::SocketError error)
         return;
     }
 
-    if (!m_currentTransport) {
+    if (m_currentTransport) {
+        // An upgrade attempt failed, we'll stay on the current connection
+        if (m_transportCandidates.contains(transport)) {
+            qCInfo(dcNymeaConnection()) << "Upgrade attempt to" << transport->url() << "failed:" << error;
+            m_transportCandidates.value(transport)->addFailure();
+            m_reconnectScheduler.failed(m_transportCandidates.value(transport)->bearerType(), m_clock.elapsed());
+            dropCandidate(transport);
+        }
+    } else {
         // We're trying to connect and one of the transports failed...
         if (m_transportCandidates.contains(transport)) {
-            m_transportCandidates.remove(transport);
-            transport->deleteLater();
+            m_transportCandidates.value(transport)->addFailure();
+            m_reconnectScheduler.failed(m_transportCandidates.value(transport)->bearerType(), m_clock.elapsed());
+            dropCandidate(transport);
         }
         qCWarning(dcNymeaConnection()) << "A transport error happened for" << transport->url() << error << "(Still trying on" << m_transportCandidates.count() << "connections)";
         foreach (Connection *c, m_transportCandidates) {
             qCDebug(dcNymeaConnection()) << "Connection candidate:" << c->url();
         }
 
-        if (m_connectionStatus != ConnectionStatusSslUntrusted && !m_reconnectTimer.isActive()) {
-            m_reconnectTimer.start();
+        if (!m_pendingCandidates.isEmpty()) {
+            // No need to wait for the next one's turn
+            startNextCandidate();
+        } else if (m_connectionStatus != ConnectionStatusSslUntrusted) {
+            scheduleReconnect();
         }
 
         if (m_transportCandidates.isEmpty()) {
@@ -293,9 +343,17 @@ void NymeaConnection::onError(QAbstractSocket::SocketError error)
 void NymeaConnection::onConnected()
 {
     NymeaTransportInterface* newTransport = qobject_cast<NymeaTransportInterface*>(sender());
+    Connection *newConnection = m_transportCandidates.value(newTransport);
+    if (newConnection && m_connectStartTimes.contains(newTransport)) {
+        newConnection->addSuccess(static_cast<int>(m_clock.elapsed() - m_connectStartTimes.value(newTransport)));
+    }
+    if (newConnection) {
+        m_reconnectScheduler.connected(newConnection->bearerType(), m_clock.elapsed());
+    }
     if (!m_currentTransport) {
         m_currentTransport = newTransport;
         qCInfo(dcNymeaConnection()) << "Connected to" << m_currentHost->name() << "via" << m_currentTransport->url() << m_currentTransport->isEncrypted();
+        cancelCandidates();
 #ifdef Q_OS_IOS
         // We can't know for sure which transport we're actually using, but let's assume the OS picked from the available ones in the order LAN, WiFi, MobileData
         if (m_networkReachabilityMonitor->availableBearerTypes().testFlag(NymeaConnection::BearerTypeEthernet)) {
@@ -313,27 +371,22 @@ void NymeaConnection::onConnected()
     }
 
     if (m_currentTransport != newTransport) {
+        Connection *currentConnection = m_transportCandidates.value(m_currentTransport);
+        if (isUpgrade(newConnection, currentConnection)) {
+            if (m_upgradeHeld) {
+                qCInfo(dcNymeaConnection()) << "Connection to" << newConnection->url() << "is up. Waiting for pending requests before upgrading to it.";
+                m_heldUpgrade = newTransport;
+                return;
+            }
+            upgradeTo(newTransport);
+            return;
+        }
+
         // In theory, we could roam from one connection to another.
         // However, in practice it turns out there are too many issues for this to be reliable
         // So lets just tear down any alternative connection that comes up again.
-
         qCInfo(dcNymeaConnection()) << "Dropping successfully established alternative connection to" << newTransport->url() << "again...";
-        m_transportCandidates.remove(newTransport);
-        newTransport->deleteLater();
-
-
-//        Connection *existingConnection = m_transportCandidates.value(m_currentTransport);
-//        Connection *alternativeConnection = m_transportCandidates.value(newTransport);
-//        if (alternativeConnection->priority() > existingConnection->priority()) {
-//            qDebug() << "New connection has higher priority! Roaming from" << existingConnection->url() << existingConnection->priority() << "to" << alternativeConnection->url() << alternativeConnection->priority();
-//            m_transportCandidates.remove(m_currentTransport);
-//            m_currentTransport->deleteLater();
-//            m_currentTransport = newTransport;
-//        } else {
-//            qDebug() << "Connection" << alternativeConnection->url() << alternativeConnection->priority() << "has lower priority than existing" << existingConnection->url() << existingConnection->priority();
-//            m_transportCandidates.remove(newTransport);
-//            newTransport->deleteLater();
-//        }
+        dropCandidate(newTransport);
         return;
     }
 }
@@ -344,25 +397,27 @@ void NymeaConnection::onDisconnected()
     qCInfo(dcNymeaConnection()) << "Disconnected from" << t->url().toString();
     if (m_currentTransport != t) {
         qCDebug(dcNymeaConnection()) << "An inactive transport for url" << t->url() << "disconnected... Cleaning up...";
+        // Some transports give up on connecting without an error
         if (m_transportCandidates.contains(t)) {
-            m_transportCandidates.remove(t);
+            m_reconnectScheduler.failed(m_transportCandidates.value(t)->bearerType(), m_clock.elapsed());
         }
-        t->deleteLater();
+        dropCandidate(t);
 
         qCDebug(dcNymeaConnection()) << "Current transport:" << m_currentTransport << "Remaining connections:" << m_transportCandidates.count() << "Current host:" << m_currentHost;
 
-        if (!m_currentTransport && m_transportCandidates.isEmpty()) {
+        if (!m_currentTransport && !m_pendingCandidates.isEmpty()) {
+            startNextCandidate();
+        } else if (!m_currentTransport && m_transportCandidates.isEmpty()) {
             qCInfo(dcNymeaConnection()) << "Last connection dropped.";
-            if (!m_reconnectTimer.isActive()) {
-                m_reconnectTimer.start();
-            }
+            scheduleReconnect();
         }
 
         return;
     }
-    m_transportCandidates.remove(m_currentTransport);
-    m_currentTransport->deleteLater();
+    m_reconnectScheduler.disconnected(m_transportCandidates.value(t)->bearerType(), m_clock.elapsed());
+    dropCandidate(m_currentTransport);
     m_currentTransport = nullptr;
+    m_heldUpgrade = nullptr;
 
     foreach (NymeaTransportInterface *candidate, m_transportCandidates.keys()) {
         if (candidate->connectionState() == NymeaTransportInterface::ConnectionStateConnected) {
@@ -377,6 +432,9 @@ void NymeaConnection::onDisconnected()
     if (!m_currentTransport) {
         qCInfo(dcNymeaConnection()) << "Disconnected.";
         emit connectedChanged(false);
+    } else {
+        // The handshake needs to be done again on the new transport
+        emit connectedChanged(true);
     }
 
 
@@ -385,15 +443,23 @@ void NymeaConnection::onDisconnected()
     }
 
     // Try to reconnect, only if we're not waiting for SSL certs to be trusted.
-    if (m_connectionStatus != ConnectionStatusSslUntrusted && !m_reconnectTimer.isActive()) {
+    if (m_connectionStatus != ConnectionStatusSslUntrusted) {
         qCInfo(dcNymeaConnection()) << "Trying to reconnect after disconnect...";
-        m_reconnectTimer.start();
+        scheduleReconnect();
     }
 }
 
 void NymeaConnection::onDataAvailable(const QByteArray &data)
 {
     NymeaTransportInterface *t = static_cast<NymeaTransportInterface*>(sender());
+    if (m_connectStartTimes.contains(t)) {
+        int timeToFirstByte = static_cast<int>(m_clock.elapsed() - m_connectStartTimes.take(t));
+        Connection *connection = m_transportCandidates.value(t);
+        if (connection) {
+            qCDebug(dcNymeaConnection()) << "Time to first byte for" << connection->url() << timeToFirstByte << "ms";
+            connection->addTimeToFirstByte(timeToFirstByte);
+        }
+    }
     if (t == m_currentTransport) {
 //        qCDebug(dcNymeaConnection()) << "Data available";
         emit dataAvailable(data);
@@ -418,11 +484,15 @@ void NymeaConnection::onAvailableBearerTypesUpdated()
     //   fail as long as the mobile data isn't shut down by the OS.
     // Those issues prevent roaming from working properly, so let's just not do anything at
     // this point if there already is a connected channel, try reconnecting otherwise.
+    // The exception is a cloud connection while a LAN one is reachable. That one is only
+    // switched over to once it's up, so a failing attempt doesn't hurt.
 
     if (!m_currentTransport) {
         // There's a host but no connection. Try connecting now...
         qCInfo(dcNymeaConnection()) << "There's a host but no connection. Trying to connect now...";
         connectInternal(m_currentHost);
+    } else {
+        tryUpgrade();
     }
 }
 
@@ -431,6 +501,8 @@ void NymeaConnection::hostConnectionsUpdated()
     if (!m_currentTransport) {
         qCInfo(dcNymeaConnection()) << "Possible connections for host" << m_currentHost->name() << "updated.";
         connectInternal(m_currentHost);
+    } else {
+        tryUpgrade();
     }
 }
 
@@ -456,6 +528,12 @@ void NymeaConnection::connectInternal(NymeaHost *host)
 {
     if (m_preferredConnection) {
         if (isConnectionBearerAvailable(m_preferredConnection->bearerType())) {
+            qint64 backoff = m_reconnectScheduler.timeUntilReady(m_preferredConnection->bearerType(), m_clock.elapsed());
+            if (backoff > 0) {
+                qCInfo(dcNymeaConnection()) << "Preferred connection is set. Retrying" << m_preferredConnection->url() << "in" << backoff << "ms";
+                m_reconnectTimer.start(static_cast<int>(backoff));
+                return;
+            }
             qCInfo(dcNymeaConnection()) << "Preferred connection is set. Using" << m_preferredConnection->url();
             connectInternal(m_preferredConnection);
             return;
@@ -463,17 +541,18 @@ void NymeaConnection::connectInternal(NymeaHost *host)
         qCWarning(dcNymeaConnection()) << "Preferred connection set but no bearer available for it.";
     }
 
+    QList<Connection*> candidates;
     Connection *loopbackConnection = host->connections()->bestMatch(Connection::BearerTypeLoopback);
     if (loopbackConnection) {
         qCDebug(dcNymeaConnection()) << "Best candidate Loopback connection:" << loopbackConnection->url();
-        connectInternal(loopbackConnection);
+        candidates.append(loopbackConnection);
 
     } else if (m_networkReachabilityMonitor->availableBearerTypes().testFlag(NymeaConnection::BearerTypeWiFi)
             || m_networkReachabilityMonitor->availableBearerTypes().testFlag(NymeaConnection::BearerTypeEthernet)) {
         Connection* lanConnection = host->connections()->bestMatch(Connection::BearerTypeLan | Connection::BearerTypeWan);
         if (lanConnection) {
             qCDebug(dcNymeaConnection()) << "Best candidate LAN/WAN connection:" << lanConnection->url();
-            connectInternal(lanConnection);
+            candidates.append(lanConnection);
         } else {
             qCDebug(dcNymeaConnection()) << "No available LAN/WAN connection to" << host->name();
         }
@@ -482,7 +561,7 @@ void NymeaConnection::connectInternal(NymeaHost *host)
         Connection* wanConnection = host->connections()->bestMatch(Connection::BearerTypeWan);
         if (wanConnection) {
             qCDebug(dcNymeaConnection()) << "Best candidate WAN connection:" << wanConnection->url();
-            connectInternal(wanConnection);
+            candidates.append(wanConnection);
         } else {
             qCDebug(dcNymeaConnection()) << "No available WAN connection to" << host->name();
         }
@@ -491,11 +570,46 @@ void NymeaConnection::connectInternal(NymeaHost *host)
     Connection* cloudConnection = host->connections()->bestMatch(Connection::BearerTypeCloud);
     if (cloudConnection) {
         qCDebug(dcNymeaConnection()) << "Best candidate Cloud connection:" << cloudConnection->url();
-        connectInternal(cloudConnection);
+        candidates.append(cloudConnection);
     } else {
         qCDebug(dcNymeaConnection()) << "No available Cloud connection to" << host->name();
     }
 
+    // Reachable ones first, those which keep failing last, and otherwise the ones which answered the fastest last time
+    std::stable_sort(candidates.begin(), candidates.end(), [](Connection *left, Connection *right) {
+        if (left->online() != right->online()) {
+            return left->online();
+        }
+        bool leftFailing = left->failureStreak() >= 3;
+        bool rightFailing = right->failureStreak() >= 3;
+        if (leftFailing != rightFailing) {
+            return rightFailing;
+        }
+        return expectedTimeToFirstByte(left) < expectedTimeToFirstByte(right);
+    });
+    // Bearers which failed recently sit out until their backoff expired, the others go ahead right away
+    qint64 now = m_clock.elapsed();
+    qint64 backoff = -1;
+    m_pendingCandidates.clear();
+    foreach (Connection *connection, candidates) {
+        qint64 timeUntilReady = m_reconnectScheduler.timeUntilReady(connection->bearerType(), now);
+        if (timeUntilReady > 0) {
+            qCDebug(dcNymeaConnection()) << "Backing off from" << connection->url() << "for" << timeUntilReady << "ms";
+            backoff = backoff < 0 ? timeUntilReady : qMin(backoff, timeUntilReady);
+            continue;
+        }
+        m_pendingCandidates.append(connection);
+    }
+    if (backoff >= 0) {
+        m_reconnectTimer.start(static_cast<int>(backoff));
+    }
+    startNextCandidate();
+
+    if (m_transportCandidates.isEmpty() && backoff >= 0) {
+        // Keep the status of the last failure until the next attempt
+        qCInfo(dcNymeaConnection()) << "All connections to" << host->name() << "failed recently. Retrying in" << backoff << "ms";
+        return;
+    }
     if (m_transportCandidates.isEmpty()) {
         qCWarning(dcNymeaConnection()) << "No available bearers available for host:" << host->name() << host->uuid();
         m_connectionStatus = ConnectionStatusNoBearerAvailable;
@@ -526,10 +640,108 @@ bool NymeaConnection::connectInternal(Connection *connection)
     QObject::connect(newTransport, &NymeaTransportInterface::dataReady, this, &NymeaConnection::onDataAvailable, Qt::QueuedConnection);
 
     m_transportCandidates.insert(newTransport, connection);
+    m_connectStartTimes.insert(newTransport, m_clock.elapsed());
     qCInfo(dcNymeaConnection()) << "Connecting to:" << connection->url() << newTransport << m_transportCandidates.value(newTransport);
     return newTransport->connect(connection->url());
 }
 
+void NymeaConnection::startNextCandidate()
+{
+    m_candidateTimer.stop();
+    if (m_currentTransport) {
+        m_pendingCandidates.clear();
+        return;
+    }
+
+    while (!m_pendingCandidates.isEmpty()) {
+        Connection *connection = m_pendingCandidates.takeFirst();
+        if (!connection) {
+            // Removed from the host in the meantime
+            continue;
+        }
+        if (connectInternal(connection)) {
+            if (!m_pendingCandidates.isEmpty()) {
+                // Give it about twice the time it took last time before racing the next one against it
+                m_candidateTimer.start(qBound(250, 2 * expectedTimeToFirstByte(connection), 2000));
+            }
+            return;
+        }
+    }
+}
+
+void NymeaConnection::dropCandidate(NymeaTransportInterface *transport)
+{
+    if (m_heldUpgrade == transport) {
+        m_heldUpgrade = nullptr;
+    }
+    m_transportCandidates.remove(transport);
+    m_connectStartTimes.remove(transport);
+    QObject::disconnect(transport, nullptr, this, nullptr);
+    transport->deleteLater();
+}
+
+void NymeaConnection::cancelCandidates()
+{
+    m_candidateTimer.stop();
+    m_pendingCandidates.clear();
+
+    Connection *current = m_transportCandidates.value(m_currentTransport);
+    foreach (NymeaTransportInterface *transport, m_transportCandidates.keys()) {
+        if (transport == m_currentTransport) {
+            continue;
+        }
+        // Attempts which would be an upgrade over the winner may go on, we'll switch over once they're up
+        if (isUpgrade(m_transportCandidates.value(transport), current)) {
+            qCInfo(dcNymeaConnection()) << "Keeping connection attempt to" << transport->url() << "to upgrade to it later";
+            continue;
+        }
+        qCDebug(dcNymeaConnection()) << "Cancelling connection attempt to" << transport->url();
+        dropCandidate(transport);
+    }
+}
+
+void NymeaConnection::tryUpgrade()
+{
+    Connection *current = currentConnection();
+    if (!current || m_preferredConnection) {
+        return;
+    }
+    if (!isConnectionBearerAvailable(Connection::BearerTypeLan)) {
+        return;
+    }
+    Connection *localConnection = m_currentHost->connections()->bestMatch(Connection::BearerTypeLoopback | Connection::BearerTypeLan);
+    // Only once the discovery has seen it, a stale address would just time out
+    if (!localConnection || !localConnection->online() || !isUpgrade(localConnection, current)) {
+        return;
+    }
+    if (m_transportCandidates.values().contains(localConnection)) {
+        return;
+    }
+    if (!m_reconnectScheduler.isReady(localConnection->bearerType(), m_clock.elapsed())) {
+        return;
+    }
+    qCInfo(dcNymeaConnection()) << "Local connection" << localConnection->url() << "is reachable while connected via" << current->url() << "Trying to upgrade.";
+    connectInternal(localConnection);
+}
+
+void NymeaConnection::upgradeTo(NymeaTransportInterface *transport)
+{
+    qCInfo(dcNymeaConnection()) << "Upgrading connection from" << m_currentTransport->url() << "to" << transport->url();
+    NymeaTransportInterface *previousTransport = m_currentTransport;
+    m_currentTransport = transport;
+    m_heldUpgrade = nullptr;
+    dropCandidate(previousTransport);
+    emit currentConnectionChanged();
+    // The session lives in the transport, the JSON-RPC layer needs to do the handshake again
+    emit connectedChanged(true);
+}
+
+void NymeaConnection::scheduleReconnect()
+{
+    // Not waiting for the timer to fire: connectInternal() knows which bearer is due when and rearms it
+    m_reconnectTimer.start(0);
+}
+
 bool NymeaConnection::isConnectionBearerAvailable(Connection::BearerType connectionBearerType) const
 {
     switch (connectionBearerType) {
@@ -553,6 +765,37 @@ bool NymeaConnection::isConnectionBearerAvailable(Connection::BearerType connect
     return false;
 }
 
+int NymeaConnection::expectedTimeToFirstByte(Connection *connection)
+{
+    if (connection->timeToFirstByte() >= 0) {
+        return connection->timeToFirstByte();
+    }
+    // Never connected before, guess by the bearer
+    switch (connection->bearerType()) {
+    case Connection::BearerTypeLoopback:
+        return 0;
+    case Connection::BearerTypeLan:
+        return 100;
+    case Connection::BearerTypeWan:
+        return 300;
+    case Connection::BearerTypeCloud:
+        return 600;
+    case Connection::BearerTypeBluetooth:
+        return 2000;
+    default:
+        return 1000;
+    }
+}
+
+bool NymeaConnection::isUpgrade(Connection *connection, Connection *current)
+{
+    // Only switching from the cloud to a local connection is worth the trouble
+    if (!connection || !current || current->bearerType() != Connection::BearerTypeCloud) {
+        return false;
+    }
+    return connection->bearerType() == Connection::BearerTypeLan || connection->bearerType() == Connection::BearerTypeLoopback;
+}
+
 void NymeaConnection::disconnectFromHost()
 {
     setCurrentHost(nullptr);
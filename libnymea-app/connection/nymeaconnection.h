@@ -38,8 +38,11 @@
 #include <QUrl>
 #include <QNetworkConfigurationManager>
 #include <QTimer>
+#include <QElapsedTimer>
+#include <QPointer>
 
 #include "nymeahost.h"
+#include "reconnectscheduler.h"
 
 class NymeaTransportInterface;
 class NymeaTransportInterfaceFactory;
@@ -103,6 +106,10 @@ public:
 
     Connection* currentConnection() const;
 
+    // While held, a connection which would be an upgrade is kept up but not switched to. Switching loses
+    // whatever is on the way on the current one, so the JSON-RPC layer holds it while that's not safe.
+    bool upgradeHeld() const;
+    void setUpgradeHeld(bool upgradeHeld);
 
     void sendData(const QByteArray &data);
 
@@ -124,11 +131,19 @@ private slots:
 
     void onAvailableBearerTypesUpdated();
     void hostConnectionsUpdated();
+    void startNextCandidate();
 private:
     void connectInternal(NymeaHost *host);
     bool connectInternal(Connection *connection);
+    void dropCandidate(NymeaTransportInterface *transport);
+    void cancelCandidates();
+    void tryUpgrade();
+    void upgradeTo(NymeaTransportInterface *transport);
+    void scheduleReconnect();
 
     bool isConnectionBearerAvailable(Connection::BearerType connectionBearerType) const;
+    static int expectedTimeToFirstByte(Connection *connection);
+    static bool isUpgrade(Connection *connection, Connection *current);
 
 private:
     ConnectionStatus m_connectionStatus = ConnectionStatusUnconnected;
@@ -139,8 +154,21 @@ private:
     NymeaTransportInterface *m_currentTransport = nullptr;
     NymeaHost *m_currentHost = nullptr;
     Connection *m_preferredConnection = nullptr;
-
+    bool m_upgradeHeld = false;
+    // Connected, waiting for the hold to be released
+    NymeaTransportInterface *m_heldUpgrade = nullptr;
+
+    // Candidates are raced: the best ranked one is started first, the next one if it fails or
+    // hasn't connected within its expected time, and so on. The first one connected wins.
+    QList<QPointer<Connection>> m_pendingCandidates;
+    QTimer m_candidateTimer;
+    // Connect start times of transports which haven't received anything yet
+    QHash<NymeaTransportInterface*, qint64> m_connectStartTimes;
+    QElapsedTimer m_clock;
+
+    // Fires when the next connection is due to be retried
     QTimer m_reconnectTimer;
+    ReconnectScheduler m_reconnectScheduler;
 
 #ifdef Q_OS_IOS
     NymeaConnection::BearerType m_usedBearerType;
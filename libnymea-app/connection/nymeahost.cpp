@@ -225,13 +225,39 @@ Connection *Connections::bestMatch(Connection::BearerTypes bearerTypes) const
             best = c;
             continue;
         }
+        // Endpoints which keep failing lose against the ones which have been working
+        bool failing = c->failureStreak() >= 3;
+        bool bestFailing = best->failureStreak() >= 3;
+        if (failing != bestFailing) {
+            if (!failing) {
+                best = c;
+            }
+            continue;
+        }
         if (c->priority() > best->priority()) {
             best = c;
+            continue;
+        }
+        // Out of equally good ones, take the one which has been faster
+        if (c->priority() == best->priority() && isFaster(c, best)) {
+            best = c;
         }
     }
     return best;
 }
 
+bool Connections::isFaster(Connection *connection, Connection *other)
+{
+    int roundTripTime = connection->roundTripTimeP50();
+    int otherRoundTripTime = other->roundTripTimeP50();
+    if (roundTripTime >= 0 && otherRoundTripTime >= 0) {
+        return roundTripTime < otherRoundTripTime;
+    }
+    int handshakeTime = connection->handshakeTime();
+    int otherHandshakeTime = other->handshakeTime();
+    return handshakeTime >= 0 && (otherHandshakeTime < 0 || handshakeTime < otherHandshakeTime);
+}
+
 void Connections::addConnection(const QUrl &url, Connection::BearerType bearerType, bool secure, const QString &displayName, bool manual)
 {
     Connection *connection = new Connection(url, bearerType, secure, displayName);
@@ -255,13 +281,23 @@ Connection::Connection(const QUrl &url, Connection::BearerType bearerType, bool
     m_url(url),
     m_bearerType(bearerType),
     m_secure(secure),
-    m_displayName(note)
+    m_displayName(note),
+    m_stats(ConnectionStats::load(url))
 {
     qRegisterMetaType<Connection::BearerType>("Connection.BearerType");
+
+    m_saveStatsTimer.setInterval(10000);
+    m_saveStatsTimer.setSingleShot(true);
+    connect(&m_saveStatsTimer, &QTimer::timeout, this, [this](){
+        m_stats.save(m_url);
+    });
 }
 
 Connection::~Connection()
 {
+    if (m_saveStatsTimer.isActive()) {
+        m_stats.save(m_url);
+    }
     qDebug() << "Deleting Connection" << this << parent() << parent()->parent();
 }
 
@@ -359,3 +395,78 @@ int Connection::priority() const
     }
     return prio;
 }
+
+int Connection::handshakeTime() const
+{
+    return m_stats.handshakeTime;
+}
+
+int Connection::timeToFirstByte() const
+{
+    return m_stats.timeToFirstByte;
+}
+
+int Connection::roundTripTimeP50() const
+{
+    return m_stats.roundTripPercentile(0.5);
+}
+
+int Connection::roundTripTimeP95() const
+{
+    return m_stats.roundTripPercentile(0.95);
+}
+
+int Connection::roundTripTimeP99() const
+{
+    return m_stats.roundTripPercentile(0.99);
+}
+
+int Connection::successCount() const
+{
+    return m_stats.successCount;
+}
+
+int Connection::failureCount() const
+{
+    return m_stats.failureCount;
+}
+
+int Connection::failureStreak() const
+{
+    return m_stats.failureStreak;
+}
+
+QDateTime Connection::lastSuccess() const
+{
+    return m_stats.lastSuccess;
+}
+
+void Connection::addSuccess(int handshakeTime)
+{
+    m_stats.addSuccess(handshakeTime);
+    m_stats.save(m_url);
+    emit statsChanged();
+}
+
+void Connection::addFailure()
+{
+    m_stats.addFailure();
+    m_stats.save(m_url);
+    emit statsChanged();
+}
+
+void Connection::addTimeToFirstByte(int timeToFirstByte)
+{
+    m_stats.addTimeToFirstByte(timeToFirstByte);
+    m_stats.save(m_url);
+    emit statsChanged();
+}
+
+void Connection::addRoundTripTime(int roundTripTime)
+{
+    m_stats.addRoundTripTime(roundTripTime);
+    if (!m_saveStatsTimer.isActive()) {
+        m_saveStatsTimer.start();
+    }
+    emit statsChanged();
+}
@@ -38,6 +38,9 @@
 #include <QObject>
 #include <QAbstractListModel>
 #include <QDateTime>
+#include <QTimer>
+
+#include "connectionstats.h"
 
 class Connection: public QObject {
     Q_OBJECT
@@ -50,6 +53,16 @@ class Connection: public QObject {
     Q_PROPERTY(bool online READ online NOTIFY onlineChanged)
     Q_PROPERTY(int priority READ priority NOTIFY priorityChanged)
 
+    // Connection quality statistics, times in ms and -1 if unknown
+    Q_PROPERTY(int handshakeTime READ handshakeTime NOTIFY statsChanged)
+    Q_PROPERTY(int timeToFirstByte READ timeToFirstByte NOTIFY statsChanged)
+    Q_PROPERTY(int roundTripTimeP50 READ roundTripTimeP50 NOTIFY statsChanged)
+    Q_PROPERTY(int roundTripTimeP95 READ roundTripTimeP95 NOTIFY statsChanged)
+    Q_PROPERTY(int roundTripTimeP99 READ roundTripTimeP99 NOTIFY statsChanged)
+    Q_PROPERTY(int successCount READ successCount NOTIFY statsChanged)
+    Q_PROPERTY(int failureCount READ failureCount NOTIFY statsChanged)
+    Q_PROPERTY(QDateTime lastSuccess READ lastSuccess NOTIFY statsChanged)
+
 public:
     enum BearerType {
         BearerTypeNone = 0x00,
@@ -79,9 +92,25 @@ public:
     void setManual(bool manual);
     int priority() const;
 
+    int handshakeTime() const;
+    int timeToFirstByte() const;
+    int roundTripTimeP50() const;
+    int roundTripTimeP95() const;
+    int roundTripTimeP99() const;
+    int successCount() const;
+    int failureCount() const;
+    int failureStreak() const;
+    QDateTime lastSuccess() const;
+
+    void addSuccess(int handshakeTime);
+    void addFailure();
+    void addTimeToFirstByte(int timeToFirstByte);
+    void addRoundTripTime(int roundTripTime);
+
 signals:
     void onlineChanged();
     void priorityChanged();
+    void statsChanged();
 
 private:
     QUrl m_url;
@@ -91,6 +120,10 @@ private:
     bool m_online = false;
     bool m_manual = false;
     QDateTime m_lastSeen;
+
+    ConnectionStats m_stats;
+    // Round trips are frequent, they're written out in batches
+    QTimer m_saveStatsTimer;
 };
 
 class Connections: public QAbstractListModel
@@ -130,6 +163,8 @@ protected:
     QHash<int, QByteArray> roleNames() const override;
 
 private:
+    static bool isFaster(Connection *connection, Connection *other);
+
     QList<Connection*> m_connections;
 };
 Q_DECLARE_OPERATORS_FOR_FLAGS(Connection::BearerTypes)
@@ -0,0 +1,110 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU General Public License as published by the Free Software
+* Foundation, GNU version 3. This project is distributed in the hope that it
+* will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+* Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "reconnectscheduler.h"
+
+ReconnectScheduler::ReconnectScheduler(quint32 seed):
+    m_random(seed)
+{
+
+}
+
+void ReconnectScheduler::setBaseDelay(int baseDelay)
+{
+    m_baseDelay = baseDelay;
+}
+
+void ReconnectScheduler::setMaximumDelay(int maximumDelay)
+{
+    m_maximumDelay = maximumDelay;
+}
+
+void ReconnectScheduler::setStableTime(int stableTime)
+{
+    m_stableTime = stableTime;
+}
+
+void ReconnectScheduler::connected(Connection::BearerType bearerType, qint64 now)
+{
+    // Don't forget the failures yet, a server which accepts and drops right away would be hammered otherwise
+    m_states[bearerType].connectedSince = now;
+}
+
+void ReconnectScheduler::disconnected(Connection::BearerType bearerType, qint64 now)
+{
+    State &state = m_states[bearerType];
+    if (state.connectedSince >= 0 && now - state.connectedSince >= m_stableTime) {
+        m_states.remove(bearerType);
+        return;
+    }
+    failed(bearerType, now);
+}
+
+void ReconnectScheduler::failed(Connection::BearerType bearerType, qint64 now)
+{
+    State &state = m_states[bearerType];
+    if (state.connectedSince >= 0 && now - state.connectedSince >= m_stableTime) {
+        state.failureCount = 0;
+    }
+    state.connectedSince = -1;
+    state.failureCount++;
+    state.nextAttempt = now + delay(state.failureCount);
+}
+
+void ReconnectScheduler::reset()
+{
+    m_states.clear();
+}
+
+int ReconnectScheduler::failureCount(Connection::BearerType bearerType) const
+{
+    return m_states.value(bearerType).failureCount;
+}
+
+bool ReconnectScheduler::isReady(Connection::BearerType bearerType, qint64 now) const
+{
+    return timeUntilReady(bearerType, now) == 0;
+}
+
+qint64 ReconnectScheduler::timeUntilReady(Connection::BearerType bearerType, qint64 now) const
+{
+    return qMax(Q_INT64_C(0), m_states.value(bearerType).nextAttempt - now);
+}
+
+int ReconnectScheduler::delay(int failureCount)
+{
+    // Equal jitter: half of the backoff is fixed, the other half random
+    qint64 backoff = m_baseDelay;
+    for (int i = 1; i < failureCount && backoff < m_maximumDelay; i++) {
+        backoff *= 2;
+    }
+    int cappedBackoff = static_cast<int>(qMin(backoff, static_cast<qint64>(m_maximumDelay)));
+    return cappedBackoff / 2 + static_cast<int>(m_random.bounded(cappedBackoff / 2 + 1));
+}
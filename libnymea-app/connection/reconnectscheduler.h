@@ -0,0 +1,82 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU General Public License as published by the Free Software
+* Foundation, GNU version 3. This project is distributed in the hope that it
+* will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+* Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef RECONNECTSCHEDULER_H
+#define RECONNECTSCHEDULER_H
+
+#include <QMap>
+#include <QRandomGenerator>
+
+#include "nymeahost.h"
+
+// Decides when a bearer may be tried again after failing. Each bearer backs off on its own with a
+// capped exponential delay and jitter, so a dead LAN endpoint doesn't hold back the cloud and a
+// fleet of clients doesn't retry in lockstep.
+// It doesn't read any clock itself. All times are msecs of a monotonic clock passed in by the caller.
+class ReconnectScheduler
+{
+public:
+    explicit ReconnectScheduler(quint32 seed = QRandomGenerator::global()->generate());
+
+    // The first retry waits at least half of the base delay, every further one doubles it up to the maximum
+    void setBaseDelay(int baseDelay);
+    void setMaximumDelay(int maximumDelay);
+    // Connections which drop earlier than that after being established count as failed
+    void setStableTime(int stableTime);
+
+    void connected(Connection::BearerType bearerType, qint64 now);
+    void disconnected(Connection::BearerType bearerType, qint64 now);
+    void failed(Connection::BearerType bearerType, qint64 now);
+    // Forget about all failures, e.g. because the network changed
+    void reset();
+
+    int failureCount(Connection::BearerType bearerType) const;
+    bool isReady(Connection::BearerType bearerType, qint64 now) const;
+    // 0 if it may be tried right away
+    qint64 timeUntilReady(Connection::BearerType bearerType, qint64 now) const;
+
+private:
+    struct State {
+        int failureCount = 0;
+        qint64 nextAttempt = 0;
+        // -1 if not connected
+        qint64 connectedSince = -1;
+    };
+
+    int delay(int failureCount);
+
+    QMap<Connection::BearerType, State> m_states;
+    QRandomGenerator m_random;
+    int m_baseDelay = 1000;
+    int m_maximumDelay = 60000;
+    int m_stableTime = 30000;
+};
+
+#endif // RECONNECTSCHEDULER_H
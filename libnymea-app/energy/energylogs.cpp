@@ -1,7 +1,11 @@
 #include "energylogs.h"
+#include "energylogspyramid.h"
 
 #include <QMetaEnum>
+#include <QMetaMethod>
 #include <QJsonDocument>
+#include <QElapsedTimer>
+#include <QtNumeric>
 
 #include "logging.h"
 NYMEA_LOGGING_CATEGORY(dcEnergyLogs, "EnergyLogs")
@@ -25,16 +29,13 @@ QDateTime EnergyLogEntry::timestamp() const
 
 EnergyLogs::EnergyLogs(QObject *parent) : QAbstractListModel(parent)
 {
-    // Workaround for older Qt versions (5.12 and older) which can't deal with the QList<EnergyLogEntry*> argument
-    connect(this, &EnergyLogs::entriesAdded, this, [this](int index, const QList<EnergyLogEntry*> &entries){
-        emit entriesAddedIdx(index, entries.count());
-    });
 }
 
 EnergyLogs::~EnergyLogs()
 {
-    if (m_engine) {
-        m_engine->jsonRpcClient()->unregisterNotificationHandler(this);
+    detachFromPyramid();
+    if (m_router) {
+        m_router->unsubscribe(this);
     }
 }
 
@@ -49,6 +50,8 @@ void EnergyLogs::setEngine(Engine *engine)
         m_engine = engine;
         emit engineChanged();
 
+        updateSubscription();
+
         if (!m_engine) {
             return;
         }
@@ -60,13 +63,9 @@ void EnergyLogs::setEngine(Engine *engine)
             }
         });
 
-        if (m_engine->jsonRpcClient()->experiences().value("Energy").toString() >= "1.0") {
-            m_engine->jsonRpcClient()->registerNotificationHandler(this, "Energy", "notificationReceivedInternal");
-
-//            if (m_ready && !m_loadingInhibited) {
-//                fetchLogs();
-//            }
-        }
+//        if (m_ready && !m_loadingInhibited) {
+//            fetchLogs();
+//        }
     }
 }
 
@@ -81,6 +80,7 @@ void EnergyLogs::setSampleRate(SampleRate sampleRate)
         m_sampleRate = sampleRate;
         emit sampleRateChanged();
         clear();
+        updateSubscription();
     }
 }
 
@@ -94,6 +94,8 @@ void EnergyLogs::setStartTime(const QDateTime &startTime)
     if (m_startTime != startTime) {
         m_startTime = startTime;
         emit startTimeChanged();
+        updateMinMax();
+        cancelStaleFetch();
     }
 }
 
@@ -107,6 +109,8 @@ void EnergyLogs::setEndTime(const QDateTime &endTime)
     if (m_endTime != endTime) {
         m_endTime = endTime;
         emit endTimeChanged();
+        updateMinMax();
+        cancelStaleFetch();
     }
 }
 
@@ -159,7 +163,7 @@ void EnergyLogs::componentComplete()
 int EnergyLogs::rowCount(const QModelIndex &parent) const
 {
     Q_UNUSED(parent)
-    return m_list.count();
+    return m_store.count();
 }
 
 QVariant EnergyLogs::data(const QModelIndex &index, int role) const
@@ -179,100 +183,311 @@ double EnergyLogs::maxValue() const
     return m_maxValue;
 }
 
+QDateTime EnergyLogs::windowStart() const
+{
+    return m_windowStart;
+}
+
+void EnergyLogs::setWindowStart(const QDateTime &windowStart)
+{
+    if (m_windowStart != windowStart) {
+        m_windowStart = windowStart;
+        emit windowStartChanged();
+        updateMinMax();
+    }
+}
+
+QDateTime EnergyLogs::windowEnd() const
+{
+    return m_windowEnd;
+}
+
+void EnergyLogs::setWindowEnd(const QDateTime &windowEnd)
+{
+    if (m_windowEnd != windowEnd) {
+        m_windowEnd = windowEnd;
+        emit windowEndChanged();
+        updateMinMax();
+    }
+}
+
+double EnergyLogs::windowMinValue() const
+{
+    return m_windowMinValue;
+}
+
+double EnergyLogs::windowMaxValue() const
+{
+    return m_windowMaxValue;
+}
+
+double EnergyLogs::minValueInRange(const QDateTime &from, const QDateTime &to) const
+{
+    QPair<int, int> range = indexRange(from, to);
+    double minValue, maxValue;
+    valueRange(range.first, range.second, &minValue, &maxValue);
+    return minValue;
+}
+
+double EnergyLogs::maxValueInRange(const QDateTime &from, const QDateTime &to) const
+{
+    QPair<int, int> range = indexRange(from, to);
+    double minValue, maxValue;
+    valueRange(range.first, range.second, &minValue, &maxValue);
+    return maxValue;
+}
+
+double EnergyLogs::sumInRange(const QDateTime &from, const QDateTime &to, int column) const
+{
+    QPair<int, int> range = indexRange(from, to);
+    return aggregate(column, range.first, range.second).sum;
+}
+
+double EnergyLogs::averageInRange(const QDateTime &from, const QDateTime &to, int column) const
+{
+    QPair<int, int> range = indexRange(from, to);
+    return aggregate(column, range.first, range.second).average();
+}
+
 EnergyLogEntry *EnergyLogs::get(int index) const
 {
-    if (index < 0 || index >= m_list.count()) {
+    if (index < 0 || index >= m_store.count()) {
         return nullptr;
     }
-    return m_list.at(index);
+    EnergyLogEntry *entry = m_entries.value(index);
+    if (!entry) {
+        entry = createEntry(index);
+        entry->setParent(const_cast<EnergyLogs*>(this));
+        m_entries.insert(index, entry);
+    }
+    return entry;
 }
 
 int EnergyLogs::indexOf(const QDateTime &timestamp)
 {
-    if (m_list.isEmpty()) {
+    qint64 secs = timestamp.toSecsSinceEpoch();
+    int index = m_store.nearestIndex(secs);
+    if (index < 0) {
         return -1;
     }
-    QDateTime first = m_list.first()->timestamp();
 
-    int index = qRound(1.0 * first.secsTo(timestamp) / (m_sampleRate * 60));
-    if (index < 0 || index >= m_list.count()) {
-        qCDebug(dcEnergyLogs()) << "finding:" << timestamp << index << first.toString() << "NOT FOUND" << m_list.last()->timestamp() << m_list.count();
+    // Timestamps are sorted, so the binary search lands on the closest sample even if the user changed
+    // the timezone during the lifetime or NTP made us pass the same time twice. Anything further away
+    // than half a sample isn't loaded.
+    if (qAbs(m_store.timestampAt(index) - secs) * 2 > m_sampleRate * 60) {
+        qCDebug(dcEnergyLogs()) << "finding:" << timestamp << "NOT FOUND" << QDateTime::fromSecsSinceEpoch(m_store.firstTimestamp()).toString() << "-" << QDateTime::fromSecsSinceEpoch(m_store.lastTimestamp()).toString() << m_store.count();
         return -1;
     }
-    qCDebug(dcEnergyLogs()) << "finding:" << timestamp << index << first.toString() << m_list.at(index)->timestamp();
+    return index;
+}
+
+EnergyLogEntry *EnergyLogs::find(const QDateTime &timestamp)
+{
+    return get(indexOf(timestamp));
+}
+
+QList<EnergyLogEntry *> EnergyLogs::entries() const
+{
+    QList<EnergyLogEntry*> ret;
+    ret.reserve(m_store.count());
+    for (int i = 0; i < m_store.count(); i++) {
+        ret.append(get(i));
+    }
+    return ret;
+}
 
+const EnergyLogStore &EnergyLogs::store() const
+{
+    return m_store;
+}
 
-    // Normally, if the DB is in a consistent state, we can rely that the above finds the correct entry.
-    // However, if the user changes the timezone, during the lifetime, or other woes may appear like NTP
-    // changing time which may cause inconsistent entries like passing the same time twice, we could end up
-    // off by one. In order to compensate for that, we'll see if the next or previous entries may be closer
-    // In theory we could even be off by some more samples in very rare circumstances, but unlikely enough
-    // to not bother with that at this point.
-    QDateTime found = m_list.at(index)->timestamp();
-    QDateTime previous = index > 0 ? m_list.at(index-1)->timestamp() : found;
-    QDateTime next = index < m_list.count() - 1 ? m_list.at(index+1)->timestamp() : found;
+void EnergyLogs::appendEntries(const EnergyLogStore &entries)
+{
+    if (entries.isEmpty()) {
+        return;
+    }
+    mergeEntries(entries);
+    cacheEntries(entries, entries.firstTimestamp(), entries.lastTimestamp());
+}
 
-    int diffToFound = qAbs(timestamp.secsTo(found));
-    int diffToPrevious = qAbs(timestamp.secsTo(previous));
-    int diffToNext = qAbs(timestamp.secsTo(next));
-    if (diffToPrevious < diffToFound && diffToPrevious < diffToNext) {
-//        qWarning() << "Correcting to previous" << index << m_list.count() << found << previous << diffToPrevious << diffToFound;
-        return index - 1;
+QVector<EnergyLogRanges::Range> EnergyLogs::missingRanges() const
+{
+    if (m_startTime.isNull() || m_endTime.isNull()) {
+        return QVector<EnergyLogRanges::Range>();
     }
-    if (diffToNext < diffToFound) {
-//        qWarning() << "Correcting to next" << index << m_list.count() << found << next << diffToNext << diffToFound;
-        return index + 1;
+    qint64 from = m_startTime.toSecsSinceEpoch();
+    qint64 to = m_endTime.toSecsSinceEpoch();
+    // Locally aggregated samples are only a preview, fetch the whole range for them
+    if (m_provisional) {
+        return {qMakePair(from, to)};
     }
-    return index;
+    return m_ranges.gaps(from, to);
 }
 
-EnergyLogEntry *EnergyLogs::find(const QDateTime &timestamp)
+EnergyLogsDiskCache EnergyLogs::diskCache() const
 {
-    int index = indexOf(timestamp);
-    if (index < 0) {
-        return nullptr;
+    return EnergyLogsDiskCache(m_engine->jsonRpcClient()->serverUuid(), logsName(), m_subscriptionThingId, m_sampleRate);
+}
+
+void EnergyLogs::cacheEntries(const EnergyLogStore &entries, qint64 from, qint64 to)
+{
+    if (m_provisional) {
+        return;
     }
-    return m_list.at(index);
+    m_ranges.add(from, to);
+
+    if (!m_subscribed || !m_engine) {
+        return;
+    }
+    attachToPyramid();
+
+    // The server may not have produced the samples of the running period yet. Only persist the range
+    // up to there so it is fetched again next time.
+    qint64 settled = QDateTime::currentSecsSinceEpoch() - m_sampleRate * 60;
+    diskCache().append(entries, from, qMin(to, settled));
 }
 
-QList<EnergyLogEntry *> EnergyLogs::entries() const
+void EnergyLogs::mergeEntries(const EnergyLogStore &entries)
 {
-    return m_list;
+    // Split the entries into blocks which go between the same two existing samples. Samples we have
+    // already are skipped. Blocks are inserted starting from the back so the positions stay valid.
+    int end = entries.count();
+    while (end > 0) {
+        qint64 timestamp = entries.timestampAt(end - 1);
+        int position = m_store.lowerBound(timestamp);
+        if (position < m_store.count() && m_store.timestampAt(position) == timestamp) {
+            end--;
+            continue;
+        }
+        int start = end - 1;
+        while (start > 0) {
+            qint64 previous = entries.timestampAt(start - 1);
+            if (m_store.lowerBound(previous) != position || (position > 0 && m_store.timestampAt(position - 1) == previous)) {
+                break;
+            }
+            start--;
+        }
+        insertEntries(position, entries.mid(start, end - start));
+        emitEntriesAdded(position, end - start);
+        end = start;
+    }
 }
 
-void EnergyLogs::appendEntry(EnergyLogEntry *entry, double minValue, double maxValue)
+void EnergyLogs::insertEntries(int index, const EnergyLogStore &entries)
 {
-    entry->setParent(this);
-    int index = m_list.count();
-    beginInsertRows(QModelIndex(), index, index);
-    m_list.append(entry);
+    beginInsertRows(QModelIndex(), index, index + entries.count() - 1);
+    if (index < m_store.count()) {
+        QHash<int, EnergyLogEntry*> shifted;
+        shifted.reserve(m_entries.count());
+        for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it) {
+            shifted.insert(it.key() >= index ? it.key() + entries.count() : it.key(), it.value());
+        }
+        m_entries = shifted;
+    }
+    m_store.insert(index, entries);
+
+    if (m_aggregates.isEmpty()) {
+        QVector<EnergyLogStore::Aggregation> aggregations = columnAggregations();
+        for (int column = 0; column < aggregations.count(); column++) {
+            if (aggregations.at(column) == EnergyLogStore::AggregationAverage) {
+                m_aggregates.insert(column, RangeAggregate());
+            }
+        }
+    }
+    for (auto it = m_aggregates.begin(); it != m_aggregates.end(); ++it) {
+        it.value().invalidate(index);
+    }
+
     endInsertRows();
     emit countChanged();
-    emit entryAdded(index, entry);
-    emit entriesAdded(index, {entry});
-    if (minValue < m_minValue) {
+    updateMinMax();
+}
+
+void EnergyLogs::emitEntriesAdded(int index, int count)
+{
+    // Workaround for older Qt versions (5.12 and older) which can't deal with the QList<EnergyLogEntry*> argument
+    emit entriesAddedIdx(index, count);
+
+    if (isSignalConnected(QMetaMethod::fromSignal(&EnergyLogs::entryAdded))) {
+        for (int i = 0; i < count; i++) {
+            emit entryAdded(index + i, get(index + i));
+        }
+    }
+
+    // Only create wrappers if someone actually listens for them
+    if (isSignalConnected(QMetaMethod::fromSignal(&EnergyLogs::entriesAdded))) {
+        QList<EnergyLogEntry*> entries;
+        entries.reserve(count);
+        for (int i = 0; i < count; i++) {
+            entries.append(get(index + i));
+        }
+        emit entriesAdded(index, entries);
+    }
+}
+
+QPair<int, int> EnergyLogs::indexRange(const QDateTime &from, const QDateTime &to) const
+{
+    int first = from.isNull() ? 0 : m_store.lowerBound(from.toSecsSinceEpoch());
+    int last = to.isNull() ? m_store.count() : m_store.lowerBound(to.toSecsSinceEpoch() + 1);
+    return qMakePair(first, last);
+}
+
+RangeAggregate::Result EnergyLogs::aggregate(int column, int first, int last) const
+{
+    // Not value(), that would copy the sums and throw away the update
+    QHash<int, RangeAggregate>::const_iterator it = m_aggregates.constFind(column);
+    if (it == m_aggregates.constEnd()) {
+        return RangeAggregate::Result();
+    }
+    return it.value().query(m_store.column(column), first, last);
+}
+
+void EnergyLogs::valueRange(int first, int last, double *minValue, double *maxValue) const
+{
+    *minValue = qInf();
+    *maxValue = -qInf();
+    for (auto it = m_aggregates.constBegin(); it != m_aggregates.constEnd(); ++it) {
+        RangeAggregate::Result result = it.value().query(m_store.column(it.key()), first, last);
+        if (!result.isEmpty()) {
+            *minValue = qMin(*minValue, result.minValue);
+            *maxValue = qMax(*maxValue, result.maxValue);
+        }
+    }
+    if (*minValue > *maxValue) {
+        *minValue = 0;
+        *maxValue = 0;
+    }
+}
+
+void EnergyLogs::updateMinMax()
+{
+    // 0 is always part of the range so charts keep their baseline
+    double minValue, maxValue;
+    valueRange(0, m_store.count(), &minValue, &maxValue);
+    minValue = qMin(minValue, 0.0);
+    maxValue = qMax(maxValue, 0.0);
+    if (m_minValue != minValue) {
         m_minValue = minValue;
         emit minValueChanged();
     }
-    if (maxValue > m_maxValue) {
+    if (m_maxValue != maxValue) {
         m_maxValue = maxValue;
         emit maxValueChanged();
     }
-}
 
-void EnergyLogs::appendEntries(const QList<EnergyLogEntry *> &entries)
-{
-    int index = m_list.count();
-    beginInsertRows(QModelIndex(), index, index + entries.count());
-    for (int i = 0; i < entries.count(); i++) {
-        EnergyLogEntry* entry = entries.at(i);
-        entry->setParent(this);
-        m_list.append(entry);
-        emit entryAdded(index + i, entry);
+    QPair<int, int> window = indexRange(m_windowStart.isNull() ? m_startTime : m_windowStart,
+                                        m_windowEnd.isNull() ? m_endTime : m_windowEnd);
+    valueRange(window.first, window.second, &minValue, &maxValue);
+    minValue = qMin(minValue, 0.0);
+    maxValue = qMax(maxValue, 0.0);
+    if (m_windowMinValue != minValue) {
+        m_windowMinValue = minValue;
+        emit windowMinValueChanged();
+    }
+    if (m_windowMaxValue != maxValue) {
+        m_windowMaxValue = maxValue;
+        emit windowMaxValueChanged();
     }
-    endInsertRows();
-    emit entriesAdded(index, entries);
-    emit countChanged();
 }
 
 QVariantMap EnergyLogs::fetchParams() const
@@ -282,131 +497,218 @@ QVariantMap EnergyLogs::fetchParams() const
 
 void EnergyLogs::getLogsResponse(int commandId, const QVariantMap &params)
 {
-    Q_UNUSED(commandId)
-
-    double minValue = 0, maxValue = 0;
-    qCDebug(dcEnergyLogs()) << "Logs response:" << qUtf8Printable(QJsonDocument::fromVariant(params).toJson());
-    QList<EnergyLogEntry*> entries = unpackEntries(params, &minValue, &maxValue);
-    qCDebug(dcEnergyLogs()) << "Energy logs received" << entries.count();
-
-    if (!entries.isEmpty()) {
-        if (m_list.isEmpty()) {
-//            qCDebug(dcEnergyLogs()) << "Energy logs received" << qUtf8Printable(QJsonDocument::fromVariant(params).toJson());
-            beginInsertRows(QModelIndex(), 0, entries.count());
-            m_list.append(entries);
-            endInsertRows();
-            emit entriesAdded(0, entries);
-            m_minValue = minValue;
-            emit minValueChanged();
-            m_maxValue = maxValue;
-            emit maxValueChanged();
-
-        } else if (entries.first()->timestamp() < m_list.first()->timestamp()) {
-
-            if (entries.last()->timestamp().addSecs(m_sampleRate * 60) == m_list.first()->timestamp()) {
-                beginInsertRows(QModelIndex(), 0, entries.count());
-                m_list = entries + m_list;
-                endInsertRows();
-                emit entriesAdded(0, entries);
-                if (minValue < m_minValue) {
-                    m_minValue = minValue;
-                    emit minValueChanged();
-                }
-                if (maxValue > m_maxValue) {
-                    m_maxValue = maxValue;
-                    emit maxValueChanged();
-                }
-            } else {
-                // End of fetched entries does not line up with start of existing entries. Discarding existing entries
-                qCDebug(dcEnergyLogs()) << "End of fetched entrie does not line up with start of existing entries. Discarding existing entries" << entries.last()->timestamp().addSecs(m_sampleRate * 60).toString() << " - " << m_list.first()->timestamp().toString();
-                clear();
-
-                // If the mismatch is in the visible area, we'll discard everything and fetch again
-                // Else if the mismatch is outside the visible area, we'll just discard the old data and work with what we received
-                if (entries.first()->timestamp() <= m_startTime && entries.last()->timestamp() >= m_endTime) {
-                    beginInsertRows(QModelIndex(), 0, entries.count());
-                    m_list.append(entries);
-                    endInsertRows();
-                    emit entriesAdded(0, entries);
-                    m_minValue = minValue;
-                    emit minValueChanged();
-                    m_maxValue = maxValue;
-                    emit maxValueChanged();
-                } else {
-                    qDeleteAll(entries);
-                    fetchLogs();
-                }
-            }
+    // Replies for fetches which have been cancelled in the meantime
+    if (commandId != m_pendingCommand) {
+        return;
+    }
+    m_pendingCommand = -1;
 
-        } else if (entries.first()->timestamp().addSecs(-m_sampleRate * 60) == m_list.last()->timestamp()) {
-            int index = m_list.count();
-            beginInsertRows(QModelIndex(), m_list.count(), m_list.count() + entries.count());
-            m_list.append(entries);
-            endInsertRows();
-            emit entriesAdded(index, entries);
-            if (minValue < m_minValue) {
-                m_minValue = minValue;
-                emit minValueChanged();
-            }
-            if (maxValue > m_maxValue) {
-                m_maxValue = maxValue;
-                emit maxValueChanged();
-            }
-        } else {
-            // Start of fetched entries does not line up with end of existing entries. Discarding existing entries
-            clear();
-            beginInsertRows(QModelIndex(), 0, entries.count());
-            m_list.append(entries);
-            endInsertRows();
-            emit entriesAdded(0, entries);
-            m_minValue = minValue;
-            emit minValueChanged();
-            m_maxValue = maxValue;
-            emit maxValueChanged();
-        }
+    bool rangePending = m_rangePending;
+    m_rangePending = false;
+    m_fetchingData = false;
 
+    bool valid = false;
+    if (rangePending && m_pendingGeneration != m_generation) {
+        qCDebug(dcEnergyLogs()) << "Dropping logs response for a request sent before the model has been cleared.";
     } else {
-        qCDebug(dcEnergyLogs()) << "Received empty log entries set.";
+        valid = addFetchedEntries(params, rangePending);
     }
 
-    m_fetchingData = false;
-
-    if (m_fetchAgain) {
+    // Continue with the next gap in the requested time frame, if any. A failed range stays a gap and is
+    // fetched again with the next fetchLogs(), but not right away.
+    if (m_fetchAgain || (valid && rangePending && !missingRanges().isEmpty())) {
         qCDebug(dcEnergyLogs()) << "Fetching again...";
         m_fetchAgain = false;
         fetchLogs();
-    } else {
+    }
+    if (!m_fetchingData) {
         emit fetchingDataChanged();
     }
 }
 
-void EnergyLogs::notificationReceivedInternal(const QVariantMap &data)
+void EnergyLogs::logsFetched(const QVariantMap &params)
 {
+    // Not our own request, so there is no range to remember and a fetch of our own, if any, carries on
+    addFetchedEntries(params, false);
+}
 
-    if (!m_live) {
+bool EnergyLogs::addFetchedEntries(const QVariantMap &params, bool ownRange)
+{
+    qCDebug(dcEnergyLogs()) << "Logs response:" << qUtf8Printable(QJsonDocument::fromVariant(params).toJson());
+    if (!params.contains(entriesKey())) {
+        qCWarning(dcEnergyLogs()) << "Fetching" << logsName() << "failed";
+        return false;
+    }
+
+    EnergyLogStore entries = unpackEntries(params);
+    qCDebug(dcEnergyLogs()) << "Energy logs received" << entries.count();
+
+    if (m_provisional) {
+        // Replace locally aggregated samples with the real ones
+        clear();
+    }
+
+    mergeEntries(entries);
+
+    // Remember what the server has been asked for, even if it had no samples in there
+    if (ownRange) {
+        cacheEntries(entries, m_pendingRange.first, m_pendingRange.second);
+    } else if (!entries.isEmpty()) {
+        cacheEntries(entries, entries.firstTimestamp(), entries.lastTimestamp());
+    }
+    return true;
+}
+
+void EnergyLogs::setSubscription(EnergyLogsRouter::LogType logType, const QUuid &thingId)
+{
+    if (m_subscribed && (m_logType != logType || m_subscriptionThingId != thingId) && !m_store.isEmpty()) {
+        // The samples belong to another series
+        clear();
+    }
+    m_subscribed = true;
+    m_logType = logType;
+    m_subscriptionThingId = thingId;
+    updateSubscription();
+}
+
+void EnergyLogs::updateSubscription()
+{
+    // Engine, sample rate or series may have changed, whatever the pyramid has from us belongs to the old one
+    detachFromPyramid();
+
+    EnergyLogsRouter *router = nullptr;
+    if (m_subscribed && m_engine && m_engine->jsonRpcClient()->experiences().value("Energy").toString() >= "1.0") {
+        router = EnergyLogsRouter::forEngine(m_engine);
+    }
+    if (m_router && m_router != router) {
+        m_router->unsubscribe(this);
+    }
+    m_router = router;
+    if (m_router) {
+        m_router->subscribe(this, m_logType, m_subscriptionThingId, m_sampleRate);
+        restoreCached();
+    }
+}
+
+void EnergyLogs::restoreCached()
+{
+    if (!m_store.isEmpty()) {
+        return;
+    }
+
+    EnergyLogsPyramid *pyramid = EnergyLogsPyramid::forEngine(m_engine);
+    QVector<EnergyLogStore::Aggregation> aggregations = columnAggregations();
+    EnergyLogRanges ranges;
+    EnergyLogStore cached = pyramid->lookup(m_logType, m_subscriptionThingId, m_sampleRate, &ranges);
+
+    if (cached.isEmpty() && ranges.isEmpty()) {
+        QElapsedTimer timer;
+        timer.start();
+        EnergyLogStore loaded(aggregations.count());
+        if (diskCache().load(aggregations.count(), &loaded, &ranges)) {
+            qCDebug(dcEnergyLogs()) << "Loaded" << loaded.count() << "samples from disk cache in" << timer.elapsed() << "ms";
+            cached = loaded;
+            pyramid->update(m_logType, m_subscriptionThingId, m_sampleRate, cached, ranges);
+        }
+    }
+
+    bool aggregated = false;
+    if (cached.isEmpty()) {
+        qint64 from = m_startTime.isNull() ? 0 : m_startTime.toSecsSinceEpoch();
+        qint64 to = m_endTime.isNull() ? 0 : m_endTime.toSecsSinceEpoch();
+        cached = pyramid->aggregate(m_logType, m_subscriptionThingId, m_sampleRate, aggregations, from, to);
+        aggregated = !cached.isEmpty();
+    }
+
+    m_ranges = aggregated ? EnergyLogRanges() : ranges;
+    if (cached.isEmpty()) {
         return;
     }
+    qCDebug(dcEnergyLogs()) << "Restoring" << cached.count() << "cached samples" << (aggregated ? "(aggregated)" : "");
+
+    m_provisional = aggregated;
+    insertEntries(0, cached);
+    emitEntriesAdded(0, cached.count());
+    if (!aggregated) {
+        attachToPyramid();
+    }
+}
 
-    if (!data.value("notification").toString().contains("Log")) {
+void EnergyLogs::attachToPyramid()
+{
+    if (m_provisional || !m_subscribed || !m_engine) {
         return;
     }
+    m_pyramid = EnergyLogsPyramid::forEngine(m_engine);
+    m_pyramid->attach(m_logType, m_subscriptionThingId, m_sampleRate, &m_store, &m_ranges);
+}
 
-    notificationReceived(data);
+void EnergyLogs::detachFromPyramid()
+{
+    if (m_pyramid) {
+        m_pyramid->detach(&m_store);
+    }
+    m_pyramid.clear();
+}
+
+void EnergyLogs::entryReceivedInternal(const EnergyLogStore &entry)
+{
+    if (!m_live) {
+        return;
+    }
+    entryReceived(entry);
 }
 
 void EnergyLogs::clear()
 {
-    int count = m_list.count();
+    detachFromPyramid();
+    int count = m_store.count();
+    m_provisional = false;
+    m_ranges.clear();
+    m_generation++;
     beginResetModel();
-    qDeleteAll(m_list);
-    m_list.clear();
+    qDeleteAll(m_entries);
+    m_entries.clear();
+    m_store.clear();
+    for (auto it = m_aggregates.begin(); it != m_aggregates.end(); ++it) {
+        it.value().clear();
+    }
     endResetModel();
     emit countChanged();
     emit entriesRemoved(0, count);
-    m_minValue = 0;
-    emit minValueChanged();
-    m_maxValue = 0;
-    emit maxValueChanged();
+    updateMinMax();
+    // The response would be dropped anyways
+    cancelFetch();
+}
+
+void EnergyLogs::cancelFetch()
+{
+    if (m_pendingCommand == -1) {
+        return;
+    }
+    if (m_engine) {
+        m_engine->jsonRpcClient()->cancel(m_pendingCommand);
+    }
+    m_pendingCommand = -1;
+    m_rangePending = false;
+    m_fetchingData = false;
+    emit fetchingDataChanged();
+
+    if (m_fetchAgain) {
+        m_fetchAgain = false;
+        fetchLogs();
+    }
+}
+
+void EnergyLogs::cancelStaleFetch()
+{
+    if (!m_rangePending || m_startTime.isNull() || m_endTime.isNull()) {
+        return;
+    }
+    if (m_pendingRange.second < m_startTime.toSecsSinceEpoch() || m_pendingRange.first > m_endTime.toSecsSinceEpoch()) {
+        qCDebug(dcEnergyLogs()) << "Cancelling the fetch for a range which isn't in the time frame any more.";
+        cancelFetch();
+    }
 }
 
 void EnergyLogs::fetchLogs()
@@ -426,40 +728,28 @@ void EnergyLogs::fetchLogs()
     params.insert("sampleRate", metaEnum.valueToKey(m_sampleRate));
 
     if (!m_startTime.isNull() && !m_endTime.isNull()) {
-        QDateTime startTime;
-        QDateTime endTime;
-
-        QDateTime oldestExisting = m_list.count() > 0 ? m_list.first()->timestamp() : QDateTime();
-        QDateTime newestExisting = m_list.count() > 0 ? m_list.last()->timestamp() : QDateTime();
         qCDebug(dcEnergyLogs()) << "request timeframe: " << m_startTime.toString() << " - " << m_endTime.toString();
-        qCDebug(dcEnergyLogs()) << "existing timeframe:" << oldestExisting.toString() << "- " << newestExisting.toString();
-
-        if (oldestExisting.isNull() || newestExisting.isNull()) {
-            startTime = m_startTime;
-            endTime = m_endTime;
-        } else {
-
-            if (m_startTime < oldestExisting) {
-                startTime = m_startTime;
-                endTime = qMin(m_endTime, oldestExisting.addSecs(-m_sampleRate * 60));
-            } else if (newestExisting < m_endTime) {
-                startTime = qMax(m_startTime, newestExisting.addSecs(m_sampleRate * 60));
-                endTime = m_endTime;
-            } else {
-                // Nothing to do...
-                return;
-            }
+        QVector<EnergyLogRanges::Range> gaps = missingRanges();
+        if (gaps.isEmpty()) {
+            // Nothing to do...
+            return;
         }
 
-        params.insert("from", startTime.toSecsSinceEpoch());
-        params.insert("to", endTime.toSecsSinceEpoch());
-        qCDebug(dcEnergyLogs()) << "Fetching from" << startTime.toString() << "to" << endTime.toString() << "with sample rate" << m_sampleRate;
+        // One gap per request, getLogsResponse() continues with the next one. The newest first, as
+        // that's usually what is on screen.
+        m_pendingRange = gaps.last();
+        m_rangePending = true;
+        m_pendingGeneration = m_generation;
+
+        params.insert("from", m_pendingRange.first);
+        params.insert("to", m_pendingRange.second);
+        qCDebug(dcEnergyLogs()) << "Fetching from" << QDateTime::fromSecsSinceEpoch(m_pendingRange.first).toString() << "to" << QDateTime::fromSecsSinceEpoch(m_pendingRange.second).toString() << "with sample rate" << m_sampleRate << "(" << gaps.count() << "gaps)";
     }
 
     m_fetchingData = true;
     fetchingDataChanged();
 
     qCDebug(dcEnergyLogs()) << "Fetching energy logs:" << qUtf8Printable(QJsonDocument::fromVariant(params).toJson());
-    m_engine->jsonRpcClient()->sendCommand("Energy.Get" + logsName(), params, this, "getLogsResponse");
+    m_pendingCommand = m_engine->jsonRpcClient()->sendCommand("Energy.Get" + logsName(), params, this, "getLogsResponse", JsonRpcClient::fetchTimeout);
 }
 
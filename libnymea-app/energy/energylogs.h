@@ -2,11 +2,17 @@
 #define ENERGYLOGS_H
 
 #include "engine.h"
+#include "energylogstore.h"
+#include "energylogsrouter.h"
+#include "energylogsdiskcache.h"
+#include "models/rangeaggregate.h"
 
 #include <QObject>
 #include <QUuid>
 #include <QQmlParserStatus>
+#include <QPointer>
 
+class EnergyLogsPyramid;
 
 class EnergyLogEntry: public QObject
 {
@@ -36,8 +42,14 @@ class EnergyLogs : public QAbstractListModel, public QQmlParserStatus
     Q_PROPERTY(bool loadingInhibited READ loadingInhibited WRITE setLoadingInhibited NOTIFY loadingInhibitedChanged)
     Q_PROPERTY(double minValue READ minValue NOTIFY minValueChanged)
     Q_PROPERTY(double maxValue READ maxValue NOTIFY maxValueChanged)
+    // The part of the time frame which is actually on screen. Defaults to startTime/endTime.
+    Q_PROPERTY(QDateTime windowStart READ windowStart WRITE setWindowStart NOTIFY windowStartChanged)
+    Q_PROPERTY(QDateTime windowEnd READ windowEnd WRITE setWindowEnd NOTIFY windowEndChanged)
+    Q_PROPERTY(double windowMinValue READ windowMinValue NOTIFY windowMinValueChanged)
+    Q_PROPERTY(double windowMaxValue READ windowMaxValue NOTIFY windowMaxValueChanged)
 
     friend class ThingPowerLogs;
+    friend class EnergyLogsRouter;
 
 public:
     enum SampleRate {
@@ -84,6 +96,21 @@ public:
     double minValue() const;
     double maxValue() const;
 
+    QDateTime windowStart() const;
+    void setWindowStart(const QDateTime &windowStart);
+
+    QDateTime windowEnd() const;
+    void setWindowEnd(const QDateTime &windowEnd);
+
+    double windowMinValue() const;
+    double windowMaxValue() const;
+
+    // Aggregates over the power columns of the samples in [from, to], O(log n)
+    Q_INVOKABLE double minValueInRange(const QDateTime &from, const QDateTime &to) const;
+    Q_INVOKABLE double maxValueInRange(const QDateTime &from, const QDateTime &to) const;
+    Q_INVOKABLE double sumInRange(const QDateTime &from, const QDateTime &to, int column) const;
+    Q_INVOKABLE double averageInRange(const QDateTime &from, const QDateTime &to, int column) const;
+
     Q_INVOKABLE EnergyLogEntry* get(int index) const;
     Q_INVOKABLE int indexOf(const QDateTime &timestamp);
     Q_INVOKABLE EnergyLogEntry* find(const QDateTime &timestamp);
@@ -110,19 +137,34 @@ signals:
 
     void minValueChanged();
     void maxValueChanged();
+    void windowStartChanged();
+    void windowEndChanged();
+    void windowMinValueChanged();
+    void windowMaxValueChanged();
 
 protected:
     virtual QString logsName() const = 0;
+    // The key holding the samples in a logs reply. Replies without it have failed.
+    virtual QString entriesKey() const = 0;
     virtual QVariantMap fetchParams() const;
-    virtual QList<EnergyLogEntry*> unpackEntries(const QVariantMap &params, double *minValue, double *maxValue) = 0;
-    virtual void notificationReceived(const QVariantMap &data) = 0;
+    virtual EnergyLogStore unpackEntries(const QVariantMap &params) = 0;
+    // Creates the QML facing wrapper for the sample at index. Only called on demand by get().
+    virtual EnergyLogEntry *createEntry(int index) const = 0;
+    // Called by the EnergyLogsRouter with a single, already unpacked entry matching the subscription
+    virtual void entryReceived(const EnergyLogStore &entry) = 0;
+    // One per column. Average columns are power values and define minValue/maxValue, last columns are counters.
+    virtual QVector<EnergyLogStore::Aggregation> columnAggregations() const = 0;
 
-    void appendEntry(EnergyLogEntry *entry, double minValue, double maxValue);
-    void appendEntries(const QList<EnergyLogEntry *> &entries);
+    void setSubscription(EnergyLogsRouter::LogType logType, const QUuid &thingId = QUuid());
+
+    const EnergyLogStore &store() const;
+    void appendEntries(const EnergyLogStore &entries);
+
+    // For samples fetched by someone else on behalf of this model, e.g. a ThingPowerLogsLoader
+    void logsFetched(const QVariantMap &params);
 
 protected slots:
     void getLogsResponse(int commandId, const QVariantMap &params);
-    void notificationReceivedInternal(const QVariantMap &data);
 
 private:
     Engine *m_engine = nullptr;
@@ -136,10 +178,64 @@ private:
     bool m_ready = false;
     bool m_fetchAgain = false;
 
+    QDateTime m_windowStart;
+    QDateTime m_windowEnd;
+
     double m_minValue = 0;
     double m_maxValue = 0;
-
-    QList<EnergyLogEntry*> m_list;
+    double m_windowMinValue = 0;
+    double m_windowMaxValue = 0;
+    // Column => aggregate over its values in m_store, for the power columns only. Counters aren't aggregated.
+    QHash<int, RangeAggregate> m_aggregates;
+
+    EnergyLogStore m_store;
+    // Wrappers handed out by get(), by index. They stay alive until clear() as QML may hold on to them.
+    mutable QHash<int, EnergyLogEntry*> m_entries;
+
+    bool m_subscribed = false;
+    EnergyLogsRouter::LogType m_logType = EnergyLogsRouter::LogTypePowerBalance;
+    QUuid m_subscriptionThingId;
+    QPointer<EnergyLogsRouter> m_router;
+    // Set while the pyramid reads m_store and m_ranges in place
+    QPointer<EnergyLogsPyramid> m_pyramid;
+
+    // Set while the model shows samples aggregated locally from a finer sample rate. They are
+    // replaced as a whole by the next server response.
+    bool m_provisional = false;
+
+    // The time ranges which have been fetched already, with or without samples in them
+    EnergyLogRanges m_ranges;
+    // The range requested by the fetchLogs() call in flight. Responses for a request sent before
+    // the last clear() are dropped.
+    EnergyLogRanges::Range m_pendingRange;
+    bool m_rangePending = false;
+    int m_generation = 0;
+    int m_pendingGeneration = 0;
+    int m_pendingCommand = -1;
+
+    void updateSubscription();
+    // Drops the request in flight, if any, and continues with a queued up fetch
+    void cancelFetch();
+    // Cancels the request in flight if its range isn't in the time frame any more
+    void cancelStaleFetch();
+    void restoreCached();
+    void attachToPyramid();
+    void detachFromPyramid();
+    // Adds the samples of a logs reply. With ownRange, the range of the fetch in flight is remembered as fetched.
+    // Returns false if the reply has no samples key, e.g. because the request failed or timed out.
+    bool addFetchedEntries(const QVariantMap &params, bool ownRange);
+    void entryReceivedInternal(const EnergyLogStore &entry);
+    QVector<EnergyLogRanges::Range> missingRanges() const;
+    EnergyLogsDiskCache diskCache() const;
+    void cacheEntries(const EnergyLogStore &entries, qint64 from, qint64 to);
+    void mergeEntries(const EnergyLogStore &entries);
+    void insertEntries(int index, const EnergyLogStore &entries);
+    void emitEntriesAdded(int index, int count);
+    // Index range [first, last) of the samples in [from, to], null times are open ends
+    QPair<int, int> indexRange(const QDateTime &from, const QDateTime &to) const;
+    RangeAggregate::Result aggregate(int column, int first, int last) const;
+    void valueRange(int first, int last, double *minValue, double *maxValue) const;
+    void updateMinMax();
 };
 
 #endif // ENERGYLOGS_H
@@ -0,0 +1,228 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU General Public License as published by the Free Software
+* Foundation, GNU version 3. This project is distributed in the hope that it
+* will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+* Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "energylogsdiskcache.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QRegExp>
+#include <QDateTime>
+
+#include <QLoggingCategory>
+Q_DECLARE_LOGGING_CATEGORY(dcEnergyLogs)
+
+// Bump this whenever the layout of the cache files changes
+static const quint32 cacheMagic = 0x6e796d65;
+static const quint32 cacheVersion = 2;
+// Compact the file on load once it has more segments than this
+static const int maxSegments = 16;
+// Samples older than this many sample periods are dropped. Bounds the file size at roughly 1.5 MB.
+static const int maxSamples = 20000;
+// Reload and compact the file when an append makes it bigger than this
+static const qint64 maxFileSize = 4 * 1024 * 1024;
+// All the cache files of a server together
+static const qint64 maxServerCacheSize = 32 * 1024 * 1024;
+// Files which haven't been written for this long belong to things or servers which are gone, most likely
+static const int maxUnusedDays = 90;
+
+EnergyLogsDiskCache::EnergyLogsDiskCache(const QString &serverUuid, const QString &logsName, const QUuid &thingId, int sampleRate):
+    m_sampleRate(sampleRate)
+{
+    QString server = QString(serverUuid).remove(QRegExp("[{}]"));
+    if (server.isEmpty()) {
+        return;
+    }
+    QString thing = thingId.isNull() ? QStringLiteral("all") : thingId.toString().remove(QRegExp("[{}]"));
+    m_fileName = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/energylogs/" + server + "/" + logsName + "-" + thing + "-" + QString::number(sampleRate) + ".cache";
+}
+
+bool EnergyLogsDiskCache::isValid() const
+{
+    return !m_fileName.isEmpty();
+}
+
+bool EnergyLogsDiskCache::load(int columnCount, EnergyLogStore *entries, EnergyLogRanges *ranges)
+{
+    if (!isValid()) {
+        return false;
+    }
+    QFile f(m_fileName);
+    if (!f.exists() || !f.open(QFile::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream stream(&f);
+    stream.setVersion(QDataStream::Qt_5_12);
+    quint32 magic, version;
+    qint32 fileColumnCount;
+    stream >> magic >> version >> fileColumnCount;
+    if (stream.status() != QDataStream::Ok || magic != cacheMagic || version != cacheVersion || fileColumnCount != columnCount) {
+        qCInfo(dcEnergyLogs()) << "Discarding energy log cache file of unsupported format" << m_fileName;
+        f.close();
+        remove();
+        return false;
+    }
+
+    int segments = 0;
+    bool truncated = false;
+    while (!stream.atEnd()) {
+        qint64 from, to;
+        EnergyLogStore segment;
+        stream >> from >> to >> segment;
+        if (stream.status() != QDataStream::Ok || (!segment.isEmpty() && segment.columnCount() != columnCount)) {
+            // Most likely the app was killed while appending. Everything before is still good.
+            qCWarning(dcEnergyLogs()) << "Energy log cache file" << m_fileName << "is truncated after" << segments << "segments";
+            truncated = true;
+            break;
+        }
+        entries->merge(segment);
+        ranges->add(from, to);
+        segments++;
+    }
+    f.close();
+
+    // Allow for a quarter more than that, so the file isn't rewritten on every load
+    qint64 period = static_cast<qint64>(m_sampleRate) * 60;
+    qint64 oldest = QDateTime::currentSecsSinceEpoch() - maxSamples * period;
+    bool expired = !ranges->isEmpty() && ranges->ranges().first().first < oldest - maxSamples / 4 * period;
+    if (expired) {
+        int first = entries->lowerBound(oldest);
+        *entries = entries->mid(first, entries->count() - first);
+        ranges->removeBefore(oldest);
+    }
+
+    if (truncated || expired || segments > maxSegments) {
+        compact(*entries, *ranges);
+    }
+    evict();
+    qCDebug(dcEnergyLogs()) << "Loaded" << entries->count() << "samples in" << ranges->ranges().count() << "ranges from" << m_fileName;
+    return true;
+}
+
+void EnergyLogsDiskCache::append(const EnergyLogStore &entries, qint64 from, qint64 to)
+{
+    if (!isValid() || from > to) {
+        return;
+    }
+    QDir().mkpath(QFileInfo(m_fileName).absolutePath());
+    QFile f(m_fileName);
+    bool isNew = !f.exists() || f.size() == 0;
+    if (!f.open(QFile::WriteOnly | QFile::Append)) {
+        qCWarning(dcEnergyLogs()) << "Unable to open energy log cache file for writing:" << m_fileName << f.errorString();
+        return;
+    }
+    QDataStream stream(&f);
+    stream.setVersion(QDataStream::Qt_5_12);
+    if (isNew) {
+        writeHeader(stream, entries.columnCount());
+    }
+    stream << from << to << entries;
+    qint64 size = f.size();
+    f.close();
+
+    if (size > maxFileSize) {
+        // Loading drops expired samples and compacts the rest
+        EnergyLogStore loaded(entries.columnCount());
+        EnergyLogRanges ranges;
+        load(entries.columnCount(), &loaded, &ranges);
+    }
+}
+
+void EnergyLogsDiskCache::remove()
+{
+    if (isValid()) {
+        QFile::remove(m_fileName);
+    }
+}
+
+bool EnergyLogsDiskCache::writeHeader(QDataStream &stream, int columnCount)
+{
+    stream << cacheMagic << cacheVersion << static_cast<qint32>(columnCount);
+    return stream.status() == QDataStream::Ok;
+}
+
+void EnergyLogsDiskCache::compact(const EnergyLogStore &entries, const EnergyLogRanges &ranges)
+{
+    // Write to a temporary file first so a crash never leaves us without a cache
+    QFile f(m_fileName + ".tmp");
+    if (!f.open(QFile::WriteOnly | QFile::Truncate)) {
+        qCWarning(dcEnergyLogs()) << "Unable to compact energy log cache file" << m_fileName << f.errorString();
+        return;
+    }
+    QDataStream stream(&f);
+    stream.setVersion(QDataStream::Qt_5_12);
+    writeHeader(stream, entries.columnCount());
+    foreach (const EnergyLogRanges::Range &range, ranges.ranges()) {
+        int first = entries.lowerBound(range.first);
+        int last = entries.lowerBound(range.second + 1);
+        stream << range.first << range.second << entries.mid(first, last - first);
+    }
+    f.close();
+
+    QFile::remove(m_fileName);
+    if (!QFile::rename(f.fileName(), m_fileName)) {
+        qCWarning(dcEnergyLogs()) << "Unable to replace energy log cache file" << m_fileName;
+        return;
+    }
+    qCDebug(dcEnergyLogs()) << "Compacted energy log cache file" << m_fileName << "to" << ranges.ranges().count() << "segments";
+}
+
+void EnergyLogsDiskCache::evict()
+{
+    QFileInfo fileInfo(m_fileName);
+    QDir serverDir = fileInfo.absoluteDir();
+    QDir cacheDir = serverDir;
+    cacheDir.cdUp();
+    QDateTime unusedSince = QDateTime::currentDateTime().addDays(-maxUnusedDays);
+
+    foreach (const QFileInfo &server, cacheDir.entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+        QDir dir(server.absoluteFilePath());
+        qint64 size = 0;
+        // Newest first
+        foreach (const QFileInfo &file, dir.entryInfoList(QStringList("*.cache"), QDir::Files, QDir::Time)) {
+            if (file.absoluteFilePath() == fileInfo.absoluteFilePath()) {
+                size += file.size();
+                continue;
+            }
+            bool tooBig = dir == serverDir && size + file.size() > maxServerCacheSize;
+            if (tooBig || file.lastModified() < unusedSince) {
+                qCDebug(dcEnergyLogs()) << "Evicting energy log cache file" << file.absoluteFilePath();
+                QFile::remove(file.absoluteFilePath());
+                continue;
+            }
+            size += file.size();
+        }
+        if (dir != serverDir && dir.entryList(QDir::Files | QDir::NoDotAndDotDot).isEmpty()) {
+            cacheDir.rmdir(server.fileName());
+        }
+    }
+}
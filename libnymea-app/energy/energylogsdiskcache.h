@@ -0,0 +1,65 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU General Public License as published by the Free Software
+* Foundation, GNU version 3. This project is distributed in the hope that it
+* will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+* Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef ENERGYLOGSDISKCACHE_H
+#define ENERGYLOGSDISKCACHE_H
+
+#include <QString>
+#include <QUuid>
+
+#include "energylogstore.h"
+
+// Persistent per server cache for one energy log series (logs name, thing and sample rate).
+// The file is append-only: every fetch appends a segment with the covered range and the
+// received samples. Segments are compacted when the file is loaded or has grown too big.
+// Only the most recent samples are kept, and the cache files of a server are evicted, least
+// recently written first, once they take up too much space.
+class EnergyLogsDiskCache
+{
+public:
+    EnergyLogsDiskCache(const QString &serverUuid, const QString &logsName, const QUuid &thingId, int sampleRate);
+
+    bool isValid() const;
+
+    bool load(int columnCount, EnergyLogStore *entries, EnergyLogRanges *ranges);
+    void append(const EnergyLogStore &entries, qint64 from, qint64 to);
+    void remove();
+
+private:
+    bool writeHeader(QDataStream &stream, int columnCount);
+    void compact(const EnergyLogStore &entries, const EnergyLogRanges &ranges);
+    // Removes files which haven't been written for long, and the oldest ones of this server while over the size limit
+    void evict();
+
+    QString m_fileName;
+    int m_sampleRate = 0;
+};
+
+#endif // ENERGYLOGSDISKCACHE_H
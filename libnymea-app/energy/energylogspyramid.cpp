@@ -0,0 +1,343 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU General Public License as published by the Free Software
+* Foundation, GNU version 3. This project is distributed in the hope that it
+* will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+* Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "energylogspyramid.h"
+
+#include "engine.h"
+#include "energylogs.h"
+
+#include <QDateTime>
+
+#include <QLoggingCategory>
+Q_DECLARE_LOGGING_CATEGORY(dcEnergyLogs)
+
+EnergyLogsPyramid *EnergyLogsPyramid::forEngine(Engine *engine)
+{
+    EnergyLogsPyramid *pyramid = engine->findChild<EnergyLogsPyramid*>(QString(), Qt::FindDirectChildrenOnly);
+    if (!pyramid) {
+        pyramid = new EnergyLogsPyramid(engine);
+    }
+    return pyramid;
+}
+
+EnergyLogsPyramid::EnergyLogsPyramid(Engine *engine):
+    QObject(engine)
+{
+    // Cached samples belong to the server they were fetched from
+    connect(engine->jsonRpcClient(), &JsonRpcClient::currentHostChanged, this, &EnergyLogsPyramid::clear);
+}
+
+void EnergyLogsPyramid::update(EnergyLogsRouter::LogType logType, const QUuid &thingId, int sampleRate, const EnergyLogStore &entries, const EnergyLogRanges &ranges)
+{
+    Level &level = m_levels[qMakePair(static_cast<int>(logType), thingId)][sampleRate];
+    if (level.liveEntries) {
+        return;
+    }
+    level.entries = entries;
+    level.ranges = ranges;
+    level.lastUsed = ++m_useCounter;
+    evict();
+}
+
+void EnergyLogsPyramid::attach(EnergyLogsRouter::LogType logType, const QUuid &thingId, int sampleRate, const EnergyLogStore *entries, const EnergyLogRanges *ranges)
+{
+    Level &level = m_levels[qMakePair(static_cast<int>(logType), thingId)][sampleRate];
+    level.liveEntries = entries;
+    level.liveRanges = ranges;
+    // A copy held here would make the model detach with every sample it receives
+    level.entries = EnergyLogStore();
+    level.ranges = EnergyLogRanges();
+    level.lastUsed = ++m_useCounter;
+}
+
+void EnergyLogsPyramid::detach(const EnergyLogStore *entries)
+{
+    for (auto it = m_levels.begin(); it != m_levels.end(); ++it) {
+        for (auto levelIt = it.value().begin(); levelIt != it.value().end(); ++levelIt) {
+            Level &level = levelIt.value();
+            if (level.liveEntries != entries) {
+                continue;
+            }
+            level.entries = *level.liveEntries;
+            level.ranges = *level.liveRanges;
+            level.liveEntries = nullptr;
+            level.liveRanges = nullptr;
+            level.lastUsed = ++m_useCounter;
+            evict();
+            return;
+        }
+    }
+}
+
+EnergyLogStore EnergyLogsPyramid::lookup(EnergyLogsRouter::LogType logType, const QUuid &thingId, int sampleRate, EnergyLogRanges *ranges)
+{
+    auto it = m_levels.find(qMakePair(static_cast<int>(logType), thingId));
+    if (it == m_levels.end() || !it.value().contains(sampleRate)) {
+        return EnergyLogStore();
+    }
+    Level &level = it.value()[sampleRate];
+    level.lastUsed = ++m_useCounter;
+    *ranges = level.currentRanges();
+    return level.currentEntries();
+}
+
+EnergyLogStore EnergyLogsPyramid::aggregate(EnergyLogsRouter::LogType logType, const QUuid &thingId, int sampleRate, const QVector<EnergyLogStore::Aggregation> &aggregations, qint64 from, qint64 to)
+{
+    auto levelsIt = m_levels.find(qMakePair(static_cast<int>(logType), thingId));
+    if (levelsIt == m_levels.end()) {
+        return EnergyLogStore();
+    }
+    QMap<int, Level> &levels = levelsIt.value();
+
+    // Try the coarsest finer level first, it is the cheapest to aggregate and typically covers the widest range
+    QMap<int, Level>::iterator it = levels.lowerBound(sampleRate);
+    while (it != levels.begin()) {
+        --it;
+        if (!canDownsample(it.key(), sampleRate)) {
+            continue;
+        }
+        const EnergyLogStore &entries = it.value().currentEntries();
+        EnergyLogStore ret = downsample(entries, it.value().currentRanges(), it.key(), sampleRate, aggregations);
+        if (!ret.isEmpty()) {
+            it.value().lastUsed = ++m_useCounter;
+            qCDebug(dcEnergyLogs()) << "Aggregated" << entries.count() << "samples of sample rate" << it.key() << "into" << ret.count() << "samples of sample rate" << sampleRate;
+            return ret;
+        }
+    }
+
+    // Zooming in: show the nearest coarser level until the finer samples arrive
+    for (it = levels.upperBound(sampleRate); it != levels.end(); ++it) {
+        if (!canDownsample(sampleRate, it.key())) {
+            continue;
+        }
+        const EnergyLogStore &entries = it.value().currentEntries();
+        EnergyLogStore ret = upsample(entries, it.key(), sampleRate, aggregations, from, to);
+        if (!ret.isEmpty()) {
+            it.value().lastUsed = ++m_useCounter;
+            qCDebug(dcEnergyLogs()) << "Spread" << entries.count() << "samples of sample rate" << it.key() << "over" << ret.count() << "samples of sample rate" << sampleRate;
+            return ret;
+        }
+    }
+    return EnergyLogStore();
+}
+
+int EnergyLogsPyramid::levelCount() const
+{
+    int count = 0;
+    for (auto it = m_levels.constBegin(); it != m_levels.constEnd(); ++it) {
+        count += it.value().count();
+    }
+    return count;
+}
+
+qint64 EnergyLogsPyramid::cachedBytes() const
+{
+    // Only the copies, the live levels belong to their models
+    qint64 bytes = 0;
+    for (auto it = m_levels.constBegin(); it != m_levels.constEnd(); ++it) {
+        for (auto levelIt = it.value().constBegin(); levelIt != it.value().constEnd(); ++levelIt) {
+            if (!levelIt.value().liveEntries) {
+                bytes += size(levelIt.value().entries);
+            }
+        }
+    }
+    return bytes;
+}
+
+void EnergyLogsPyramid::clear()
+{
+    m_levels.clear();
+}
+
+qint64 EnergyLogsPyramid::size(const EnergyLogStore &entries)
+{
+    return static_cast<qint64>(entries.count()) * (sizeof(qint64) + sizeof(double) * entries.columnCount());
+}
+
+void EnergyLogsPyramid::evict()
+{
+    qint64 bytes = cachedBytes();
+    while (bytes > MaxCachedBytes) {
+        QHash<QPair<int, QUuid>, QMap<int, Level>>::iterator oldest = m_levels.end();
+        int oldestSampleRate = 0;
+        quint64 oldestUse = 0;
+        for (auto it = m_levels.begin(); it != m_levels.end(); ++it) {
+            for (auto levelIt = it.value().constBegin(); levelIt != it.value().constEnd(); ++levelIt) {
+                if (!levelIt.value().liveEntries && (oldest == m_levels.end() || levelIt.value().lastUsed < oldestUse)) {
+                    oldest = it;
+                    oldestSampleRate = levelIt.key();
+                    oldestUse = levelIt.value().lastUsed;
+                }
+            }
+        }
+        if (oldest == m_levels.end()) {
+            return;
+        }
+        qCDebug(dcEnergyLogs()) << "Dropping cached level of sample rate" << oldestSampleRate << "with" << oldest.value().value(oldestSampleRate).entries.count() << "samples";
+        bytes -= size(oldest.value().value(oldestSampleRate).entries);
+        oldest.value().remove(oldestSampleRate);
+        if (oldest.value().isEmpty()) {
+            m_levels.erase(oldest);
+        }
+    }
+}
+
+qint64 EnergyLogsPyramid::bucketStart(qint64 timestamp, int sampleRate)
+{
+    // Buckets are aligned in local time, like the sample rates in the energy views
+    QDateTime dateTime = QDateTime::fromSecsSinceEpoch(timestamp);
+    QDate date = dateTime.date();
+    switch (sampleRate) {
+    case EnergyLogs::SampleRate1Day:
+        return QDateTime(date, QTime(0, 0)).toSecsSinceEpoch();
+    case EnergyLogs::SampleRate1Week:
+        return QDateTime(date.addDays(1 - date.dayOfWeek()), QTime(0, 0)).toSecsSinceEpoch();
+    case EnergyLogs::SampleRate1Month:
+        return QDateTime(QDate(date.year(), date.month(), 1), QTime(0, 0)).toSecsSinceEpoch();
+    case EnergyLogs::SampleRate1Year:
+        return QDateTime(QDate(date.year(), 1, 1), QTime(0, 0)).toSecsSinceEpoch();
+    default: {
+        int minutes = dateTime.time().hour() * 60 + dateTime.time().minute();
+        minutes -= minutes % sampleRate;
+        return QDateTime(date, QTime(minutes / 60, minutes % 60)).toSecsSinceEpoch();
+    }
+    }
+}
+
+qint64 EnergyLogsPyramid::nextBucketStart(qint64 bucketStart, int sampleRate)
+{
+    QDateTime dateTime = QDateTime::fromSecsSinceEpoch(bucketStart);
+    switch (sampleRate) {
+    case EnergyLogs::SampleRate1Day:
+        return dateTime.addDays(1).toSecsSinceEpoch();
+    case EnergyLogs::SampleRate1Week:
+        return dateTime.addDays(7).toSecsSinceEpoch();
+    case EnergyLogs::SampleRate1Month:
+        return dateTime.addMonths(1).toSecsSinceEpoch();
+    case EnergyLogs::SampleRate1Year:
+        return dateTime.addYears(1).toSecsSinceEpoch();
+    default:
+        return bucketStart + sampleRate * 60;
+    }
+}
+
+EnergyLogStore EnergyLogsPyramid::downsample(const EnergyLogStore &entries, const EnergyLogRanges &ranges, int fromSampleRate, int toSampleRate, const QVector<EnergyLogStore::Aggregation> &aggregations)
+{
+    Q_ASSERT_X(aggregations.count() == entries.columnCount(), "EnergyLogsPyramid", "Column count mismatch");
+
+    EnergyLogStore ret(entries.columnCount());
+    QVector<double> values(entries.columnCount());
+    int index = 0;
+    while (index < entries.count()) {
+        qint64 bucket = bucketStart(entries.timestampAt(index), toSampleRate);
+        qint64 nextBucket = nextBucketStart(bucket, toSampleRate);
+        int first = index;
+        while (index < entries.count() && entries.timestampAt(index) < nextBucket) {
+            index++;
+        }
+        int last = index - 1;
+
+        // Buckets only partially fetched, at the edges or around a gap in the middle, would show wrong values
+        if (!ranges.gaps(bucket, bucketStart(nextBucket - 1, fromSampleRate)).isEmpty()) {
+            continue;
+        }
+        // The running bucket, the server hasn't produced all of its samples yet
+        if (index == entries.count() && nextBucketStart(entries.timestampAt(last), fromSampleRate) < nextBucket) {
+            continue;
+        }
+
+        for (int column = 0; column < entries.columnCount(); column++) {
+            if (aggregations.at(column) == EnergyLogStore::AggregationLast) {
+                values[column] = entries.valueAt(last, column);
+            } else {
+                double sum = 0;
+                for (int i = first; i <= last; i++) {
+                    sum += entries.valueAt(i, column);
+                }
+                values[column] = sum / (last - first + 1);
+            }
+        }
+        ret.append(bucket, values);
+    }
+    return ret;
+}
+
+EnergyLogStore EnergyLogsPyramid::upsample(const EnergyLogStore &entries, int fromSampleRate, int toSampleRate, const QVector<EnergyLogStore::Aggregation> &aggregations, qint64 from, qint64 to)
+{
+    Q_ASSERT_X(aggregations.count() == entries.columnCount(), "EnergyLogsPyramid", "Column count mismatch");
+
+    EnergyLogStore ret(entries.columnCount());
+    QVector<double> values(entries.columnCount());
+    int index = from > 0 ? entries.lowerBound(bucketStart(from, fromSampleRate)) : 0;
+    for (; index < entries.count(); index++) {
+        qint64 bucket = entries.timestampAt(index);
+        if (to > 0 && bucket > to) {
+            break;
+        }
+        qint64 nextBucket = nextBucketStart(bucket, fromSampleRate);
+
+        QVector<qint64> timestamps;
+        for (qint64 timestamp = bucket; timestamp < nextBucket; timestamp = nextBucketStart(timestamp, toSampleRate)) {
+            timestamps.append(timestamp);
+        }
+        if (ret.count() + timestamps.count() > MaxPreviewSamples) {
+            break;
+        }
+
+        // Counters grow from the previous sample's value, if that is the bucket right before
+        bool contiguous = index > 0 && nextBucketStart(entries.timestampAt(index - 1), fromSampleRate) == bucket;
+        for (int step = 0; step < timestamps.count(); step++) {
+            for (int column = 0; column < entries.columnCount(); column++) {
+                double value = entries.valueAt(index, column);
+                if (aggregations.at(column) == EnergyLogStore::AggregationLast && contiguous) {
+                    double previous = entries.valueAt(index - 1, column);
+                    value = previous + (value - previous) * (step + 1) / timestamps.count();
+                }
+                values[column] = value;
+            }
+            ret.append(timestamps.at(step), values);
+        }
+    }
+    return ret;
+}
+
+bool EnergyLogsPyramid::canDownsample(int fromSampleRate, int toSampleRate)
+{
+    if (fromSampleRate >= toSampleRate) {
+        return false;
+    }
+    // Up to weeks, buckets are a fixed number of finer samples
+    if (toSampleRate <= EnergyLogs::SampleRate1Week) {
+        return toSampleRate % fromSampleRate == 0;
+    }
+    // Months and years are calendar based. Weeks don't line up with them, days and months do.
+    return fromSampleRate <= EnergyLogs::SampleRate1Day
+            || (fromSampleRate == EnergyLogs::SampleRate1Month && toSampleRate == EnergyLogs::SampleRate1Year);
+}
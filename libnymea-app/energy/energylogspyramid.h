@@ -0,0 +1,115 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU General Public License as published by the Free Software
+* Foundation, GNU version 3. This project is distributed in the hope that it
+* will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+* Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef ENERGYLOGSPYRAMID_H
+#define ENERGYLOGSPYRAMID_H
+
+#include <QObject>
+#include <QUuid>
+#include <QHash>
+#include <QMap>
+
+#include "energylogstore.h"
+#include "energylogsrouter.h"
+
+class Engine;
+
+// Client side level of detail cache for energy logs. Keeps the samples fetched for every
+// log type, thing and sample rate, so switching between sample rates doesn't need a round
+// trip for data we already hold. If a sample rate hasn't been fetched yet, a finer one is
+// aggregated into it locally, or a coarser one is spread over it as a preview until the
+// real samples arrive.
+// Levels shown by a model are read from the model's store in place. Only when the model lets
+// go of them they are copied in, and the least recently used copies are dropped above a size limit.
+class EnergyLogsPyramid : public QObject
+{
+    Q_OBJECT
+public:
+    // Above this, the least recently used levels no model is showing are dropped
+    static const qint64 MaxCachedBytes = 16 * 1024 * 1024;
+    // Spreading a coarse level over a fine sample rate stops after this many samples
+    static const int MaxPreviewSamples = 20000;
+
+    // Returns the pyramid for the given engine, creating it on first use
+    static EnergyLogsPyramid *forEngine(Engine *engine);
+
+    // Stores a copy of the samples, e.g. loaded from the disk cache. Ignored while a model shows the level.
+    void update(EnergyLogsRouter::LogType logType, const QUuid &thingId, int sampleRate, const EnergyLogStore &entries, const EnergyLogRanges &ranges);
+    // A model shows this level. Its store and ranges are read in place until detach() is called, which the
+    // model must do before it clears them or goes away.
+    void attach(EnergyLogsRouter::LogType logType, const QUuid &thingId, int sampleRate, const EnergyLogStore *entries, const EnergyLogRanges *ranges);
+    // Keeps a copy of what the model showed
+    void detach(const EnergyLogStore *entries);
+
+    // Returns the cached samples for the sample rate and the ranges they cover, an empty store if there are none
+    EnergyLogStore lookup(EnergyLogsRouter::LogType logType, const QUuid &thingId, int sampleRate, EnergyLogRanges *ranges);
+    // Aggregates the samples of a finer sample rate into the given one. If there is no finer one, spreads a coarser
+    // one over the buckets of the given sample rate in [from, to], 0 meaning open ends. Returns an empty store if
+    // there are none.
+    EnergyLogStore aggregate(EnergyLogsRouter::LogType logType, const QUuid &thingId, int sampleRate, const QVector<EnergyLogStore::Aggregation> &aggregations, qint64 from = 0, qint64 to = 0);
+
+    int levelCount() const;
+    qint64 cachedBytes() const;
+    void clear();
+
+    static qint64 bucketStart(qint64 timestamp, int sampleRate);
+    static qint64 nextBucketStart(qint64 bucketStart, int sampleRate);
+    // Buckets which aren't fully covered by ranges are left out
+    static EnergyLogStore downsample(const EnergyLogStore &entries, const EnergyLogRanges &ranges, int fromSampleRate, int toSampleRate, const QVector<EnergyLogStore::Aggregation> &aggregations);
+    // Power values are repeated for every finer bucket, counters interpolated between the coarse samples
+    static EnergyLogStore upsample(const EnergyLogStore &entries, int fromSampleRate, int toSampleRate, const QVector<EnergyLogStore::Aggregation> &aggregations, qint64 from = 0, qint64 to = 0);
+
+private:
+    explicit EnergyLogsPyramid(Engine *engine);
+
+    static bool canDownsample(int fromSampleRate, int toSampleRate);
+
+    struct Level {
+        // Set while a model shows the level
+        const EnergyLogStore *liveEntries = nullptr;
+        const EnergyLogRanges *liveRanges = nullptr;
+        // Copy otherwise
+        EnergyLogStore entries;
+        EnergyLogRanges ranges;
+        quint64 lastUsed = 0;
+
+        const EnergyLogStore &currentEntries() const { return liveEntries ? *liveEntries : entries; }
+        const EnergyLogRanges &currentRanges() const { return liveRanges ? *liveRanges : ranges; }
+    };
+
+    static qint64 size(const EnergyLogStore &entries);
+    void evict();
+
+    // (logType, thingId) => sampleRate => samples
+    QHash<QPair<int, QUuid>, QMap<int, Level>> m_levels;
+    quint64 m_useCounter = 0;
+};
+
+#endif // ENERGYLOGSPYRAMID_H
@@ -0,0 +1,129 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU General Public License as published by the Free Software
+* Foundation, GNU version 3. This project is distributed in the hope that it
+* will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+* Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "energylogsrouter.h"
+
+#include "engine.h"
+#include "energylogs.h"
+#include "powerbalancelogs.h"
+#include "thingpowerlogs.h"
+
+#include <QLoggingCategory>
+Q_DECLARE_LOGGING_CATEGORY(dcEnergyLogs)
+
+EnergyLogsRouter *EnergyLogsRouter::forEngine(Engine *engine)
+{
+    EnergyLogsRouter *router = engine->findChild<EnergyLogsRouter*>(QString(), Qt::FindDirectChildrenOnly);
+    if (!router) {
+        router = new EnergyLogsRouter(engine);
+    }
+    return router;
+}
+
+EnergyLogsRouter::EnergyLogsRouter(Engine *engine):
+    QObject(engine),
+    m_engine(engine),
+    m_sampleRateEnum(QMetaEnum::fromType<EnergyLogs::SampleRate>())
+{
+}
+
+void EnergyLogsRouter::subscribe(EnergyLogs *logs, LogType logType, const QUuid &thingId, int sampleRate)
+{
+    Key key = {logType, thingId, sampleRate};
+    if (m_subscriptions.contains(logs)) {
+        if (m_subscriptions.value(logs) == key) {
+            return;
+        }
+        unsubscribe(logs);
+    }
+
+    if (m_subscriptions.isEmpty()) {
+        m_engine->jsonRpcClient()->registerNotificationHandler(this, "Energy", "notificationReceived");
+    }
+    m_subscriptions.insert(logs, key);
+    m_subscribers[key].append(logs);
+}
+
+void EnergyLogsRouter::unsubscribe(EnergyLogs *logs)
+{
+    if (!m_subscriptions.contains(logs)) {
+        return;
+    }
+    Key key = m_subscriptions.take(logs);
+    QList<EnergyLogs*> &subscribers = m_subscribers[key];
+    subscribers.removeAll(logs);
+    if (subscribers.isEmpty()) {
+        m_subscribers.remove(key);
+    }
+
+    if (m_subscriptions.isEmpty()) {
+        m_engine->jsonRpcClient()->unregisterNotificationHandler(this);
+    }
+}
+
+void EnergyLogsRouter::notificationReceived(const QVariantMap &data)
+{
+    QString notification = data.value("notification").toString();
+    QVariantMap params = data.value("params").toMap();
+
+    if (notification == "Energy.ThingPowerLogEntryAdded") {
+        QVariantMap entry = params.value("thingPowerLogEntry").toMap();
+        int sampleRate = m_sampleRateEnum.keyToValue(params.value("sampleRate").toByteArray());
+        deliver({LogTypeThingPower, entry.value("thingId").toUuid(), sampleRate}, entry);
+
+    } else if (notification == "Energy.PowerBalanceLogEntryAdded") {
+        QVariantMap entry = params.value("powerBalanceLogEntry").toMap();
+        int sampleRate = m_sampleRateEnum.keyToValue(params.value("sampleRate").toByteArray());
+        deliver({LogTypePowerBalance, QUuid(), sampleRate}, entry);
+    }
+}
+
+void EnergyLogsRouter::deliver(const Key &key, const QVariantMap &entry)
+{
+    if (!m_subscribers.contains(key)) {
+        return;
+    }
+
+    EnergyLogStore store;
+    if (key.logType == LogTypeThingPower) {
+        store = EnergyLogStore(ThingPowerLogs::ColumnCount);
+        ThingPowerLogs::unpackEntry(entry, &store);
+    } else {
+        store = EnergyLogStore(PowerBalanceLogs::ColumnCount);
+        PowerBalanceLogs::unpackEntry(entry, &store);
+    }
+
+    // Subscribers may resubscribe while handling the entry, so work on a copy
+    QList<EnergyLogs*> subscribers = m_subscribers.value(key);
+    qCDebug(dcEnergyLogs()) << "Routing log entry for" << key.thingId << key.sampleRate << "to" << subscribers.count() << "subscribers";
+    foreach (EnergyLogs *logs, subscribers) {
+        logs->entryReceivedInternal(store);
+    }
+}
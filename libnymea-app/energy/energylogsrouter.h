@@ -0,0 +1,86 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU General Public License as published by the Free Software
+* Foundation, GNU version 3. This project is distributed in the hope that it
+* will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+* Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef ENERGYLOGSROUTER_H
+#define ENERGYLOGSROUTER_H
+
+#include <QObject>
+#include <QUuid>
+#include <QHash>
+#include <QMetaEnum>
+
+class Engine;
+class EnergyLogs;
+
+// Receives the Energy log notifications once per engine and hands the parsed entry to the EnergyLogs
+// models which subscribed for that log type, thing and sample rate. Without it, every EnergyLogs
+// instance would register as notification handler and parse every notification itself.
+class EnergyLogsRouter : public QObject
+{
+    Q_OBJECT
+public:
+    enum LogType {
+        LogTypePowerBalance,
+        LogTypeThingPower
+    };
+
+    // Returns the router for the given engine, creating it on first use
+    static EnergyLogsRouter *forEngine(Engine *engine);
+
+    // A logs object has at most one subscription. Subscribing again replaces the previous one.
+    void subscribe(EnergyLogs *logs, LogType logType, const QUuid &thingId, int sampleRate);
+    void unsubscribe(EnergyLogs *logs);
+
+private:
+    explicit EnergyLogsRouter(Engine *engine);
+
+    Q_INVOKABLE void notificationReceived(const QVariantMap &data);
+
+    struct Key {
+        LogType logType;
+        QUuid thingId;
+        int sampleRate;
+        bool operator==(const Key &other) const {
+            return logType == other.logType && sampleRate == other.sampleRate && thingId == other.thingId;
+        }
+    };
+    friend uint qHash(const Key &key, uint seed) {
+        return qHash(key.thingId, seed) ^ (static_cast<uint>(key.logType) << 24) ^ static_cast<uint>(key.sampleRate);
+    }
+
+    void deliver(const Key &key, const QVariantMap &entry);
+
+    Engine *m_engine = nullptr;
+    QMetaEnum m_sampleRateEnum;
+    QHash<Key, QList<EnergyLogs*>> m_subscribers;
+    QHash<EnergyLogs*, Key> m_subscriptions;
+};
+
+#endif // ENERGYLOGSROUTER_H
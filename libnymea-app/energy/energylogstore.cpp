@@ -0,0 +1,306 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU General Public License as published by the Free Software
+* Foundation, GNU version 3. This project is distributed in the hope that it
+* will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+* Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "energylogstore.h"
+
+#include <algorithm>
+
+EnergyLogStore::EnergyLogStore(int columnCount):
+    m_columns(columnCount)
+{
+
+}
+
+int EnergyLogStore::columnCount() const
+{
+    return m_columns.count();
+}
+
+int EnergyLogStore::count() const
+{
+    return m_timestamps.count();
+}
+
+bool EnergyLogStore::isEmpty() const
+{
+    return m_timestamps.isEmpty();
+}
+
+void EnergyLogStore::reserve(int size)
+{
+    m_timestamps.reserve(size);
+    for (int i = 0; i < m_columns.count(); i++) {
+        m_columns[i].reserve(size);
+    }
+}
+
+void EnergyLogStore::clear()
+{
+    m_timestamps.clear();
+    for (int i = 0; i < m_columns.count(); i++) {
+        m_columns[i].clear();
+    }
+}
+
+qint64 EnergyLogStore::timestampAt(int index) const
+{
+    return m_timestamps.at(index);
+}
+
+qint64 EnergyLogStore::firstTimestamp() const
+{
+    return m_timestamps.first();
+}
+
+qint64 EnergyLogStore::lastTimestamp() const
+{
+    return m_timestamps.last();
+}
+
+double EnergyLogStore::valueAt(int index, int column) const
+{
+    return m_columns.at(column).at(index);
+}
+
+const QVector<qint64> &EnergyLogStore::timestamps() const
+{
+    return m_timestamps;
+}
+
+const QVector<double> &EnergyLogStore::column(int column) const
+{
+    return m_columns.at(column);
+}
+
+EnergyLogStore EnergyLogStore::mid(int index, int count) const
+{
+    EnergyLogStore ret(m_columns.count());
+    ret.m_timestamps = m_timestamps.mid(index, count);
+    for (int i = 0; i < m_columns.count(); i++) {
+        ret.m_columns[i] = m_columns.at(i).mid(index, count);
+    }
+    return ret;
+}
+
+void EnergyLogStore::append(qint64 timestamp, std::initializer_list<double> values)
+{
+    Q_ASSERT_X(static_cast<int>(values.size()) == m_columns.count(), "EnergyLogStore", "Column count mismatch");
+    m_timestamps.append(timestamp);
+    int column = 0;
+    for (double value : values) {
+        m_columns[column++].append(value);
+    }
+}
+
+void EnergyLogStore::append(qint64 timestamp, const QVector<double> &values)
+{
+    Q_ASSERT_X(values.count() == m_columns.count(), "EnergyLogStore", "Column count mismatch");
+    m_timestamps.append(timestamp);
+    for (int i = 0; i < m_columns.count(); i++) {
+        m_columns[i].append(values.at(i));
+    }
+}
+
+void EnergyLogStore::append(const EnergyLogStore &other)
+{
+    if (m_timestamps.isEmpty() && m_columns.isEmpty()) {
+        *this = other;
+        return;
+    }
+    Q_ASSERT_X(other.m_columns.count() == m_columns.count(), "EnergyLogStore", "Column count mismatch");
+    m_timestamps.append(other.m_timestamps);
+    for (int i = 0; i < m_columns.count(); i++) {
+        m_columns[i].append(other.m_columns.at(i));
+    }
+}
+
+void EnergyLogStore::insert(int index, const EnergyLogStore &other)
+{
+    if (m_timestamps.isEmpty()) {
+        *this = other;
+        return;
+    }
+    Q_ASSERT_X(other.m_columns.count() == m_columns.count(), "EnergyLogStore", "Column count mismatch");
+    // One block insert per array instead of rebuilding a list of pointers
+    m_timestamps.insert(index, other.m_timestamps.count(), 0);
+    std::copy(other.m_timestamps.constBegin(), other.m_timestamps.constEnd(), m_timestamps.begin() + index);
+    for (int i = 0; i < m_columns.count(); i++) {
+        QVector<double> &column = m_columns[i];
+        const QVector<double> &otherColumn = other.m_columns.at(i);
+        column.insert(index, otherColumn.count(), 0);
+        std::copy(otherColumn.constBegin(), otherColumn.constEnd(), column.begin() + index);
+    }
+}
+
+void EnergyLogStore::merge(const EnergyLogStore &other)
+{
+    if (other.isEmpty()) {
+        return;
+    }
+    if (m_timestamps.isEmpty()) {
+        *this = other;
+        return;
+    }
+    if (other.firstTimestamp() > lastTimestamp()) {
+        append(other);
+        return;
+    }
+
+    EnergyLogStore ret(m_columns.count());
+    ret.reserve(count() + other.count());
+    int i = 0, j = 0;
+    while (i < count() || j < other.count()) {
+        const EnergyLogStore *source;
+        int index;
+        if (j == other.count() || (i < count() && m_timestamps.at(i) <= other.m_timestamps.at(j))) {
+            if (j < other.count() && m_timestamps.at(i) == other.m_timestamps.at(j)) {
+                j++;
+            }
+            source = this;
+            index = i++;
+        } else {
+            source = &other;
+            index = j++;
+        }
+        ret.m_timestamps.append(source->m_timestamps.at(index));
+        for (int column = 0; column < m_columns.count(); column++) {
+            ret.m_columns[column].append(source->m_columns.at(column).at(index));
+        }
+    }
+    *this = ret;
+}
+
+int EnergyLogStore::lowerBound(qint64 timestamp) const
+{
+    return static_cast<int>(std::lower_bound(m_timestamps.constBegin(), m_timestamps.constEnd(), timestamp) - m_timestamps.constBegin());
+}
+
+int EnergyLogStore::nearestIndex(qint64 timestamp) const
+{
+    if (m_timestamps.isEmpty()) {
+        return -1;
+    }
+    int index = lowerBound(timestamp);
+    if (index == m_timestamps.count()) {
+        return index - 1;
+    }
+    if (index > 0 && timestamp - m_timestamps.at(index - 1) < m_timestamps.at(index) - timestamp) {
+        return index - 1;
+    }
+    return index;
+}
+
+QDataStream &operator<<(QDataStream &stream, const EnergyLogStore &store)
+{
+    stream << store.m_timestamps << store.m_columns;
+    return stream;
+}
+
+QDataStream &operator>>(QDataStream &stream, EnergyLogStore &store)
+{
+    stream >> store.m_timestamps >> store.m_columns;
+    bool consistent = true;
+    for (int i = 0; i < store.m_columns.count(); i++) {
+        consistent &= store.m_columns.at(i).count() == store.m_timestamps.count();
+    }
+    if (!consistent) {
+        stream.setStatus(QDataStream::ReadCorruptData);
+    }
+    return stream;
+}
+
+bool EnergyLogRanges::isEmpty() const
+{
+    return m_ranges.isEmpty();
+}
+
+void EnergyLogRanges::clear()
+{
+    m_ranges.clear();
+}
+
+const QVector<EnergyLogRanges::Range> &EnergyLogRanges::ranges() const
+{
+    return m_ranges;
+}
+
+void EnergyLogRanges::add(qint64 from, qint64 to)
+{
+    if (from > to) {
+        return;
+    }
+    // First range which ends at or after from - 1, i.e. overlaps or touches the new one
+    int first = 0;
+    while (first < m_ranges.count() && m_ranges.at(first).second < from - 1) {
+        first++;
+    }
+    int last = first;
+    while (last < m_ranges.count() && m_ranges.at(last).first <= to + 1) {
+        from = qMin(from, m_ranges.at(last).first);
+        to = qMax(to, m_ranges.at(last).second);
+        last++;
+    }
+    m_ranges.remove(first, last - first);
+    m_ranges.insert(first, qMakePair(from, to));
+}
+
+QVector<EnergyLogRanges::Range> EnergyLogRanges::gaps(qint64 from, qint64 to) const
+{
+    QVector<Range> ret;
+    qint64 position = from;
+    foreach (const Range &range, m_ranges) {
+        if (range.second < position) {
+            continue;
+        }
+        if (range.first > to) {
+            break;
+        }
+        if (range.first > position) {
+            ret.append(qMakePair(position, range.first - 1));
+        }
+        position = range.second + 1;
+    }
+    if (position <= to) {
+        ret.append(qMakePair(position, to));
+    }
+    return ret;
+}
+
+void EnergyLogRanges::removeBefore(qint64 timestamp)
+{
+    int count = 0;
+    while (count < m_ranges.count() && m_ranges.at(count).second < timestamp) {
+        count++;
+    }
+    m_ranges.remove(0, count);
+    if (!m_ranges.isEmpty() && m_ranges.first().first < timestamp) {
+        m_ranges.first().first = timestamp;
+    }
+}
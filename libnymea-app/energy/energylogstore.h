@@ -0,0 +1,114 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU General Public License as published by the Free Software
+* Foundation, GNU version 3. This project is distributed in the hope that it
+* will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+* Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef ENERGYLOGSTORE_H
+#define ENERGYLOGSTORE_H
+
+#include <QVector>
+#include <QPair>
+#include <QDataStream>
+
+#include <initializer_list>
+
+// Columnar storage for energy log samples. Timestamps (seconds since epoch, ascending)
+// and every value column are kept in their own contiguous array so that a year worth
+// of samples doesn't cost one QObject per sample.
+class EnergyLogStore
+{
+public:
+    // How a column is combined when samples are aggregated into a coarser sample rate
+    enum Aggregation {
+        AggregationAverage, // Power values
+        AggregationLast     // Cumulative counters like totalConsumption
+    };
+
+    explicit EnergyLogStore(int columnCount = 0);
+
+    int columnCount() const;
+    int count() const;
+    bool isEmpty() const;
+
+    void reserve(int size);
+    void clear();
+
+    qint64 timestampAt(int index) const;
+    qint64 firstTimestamp() const;
+    qint64 lastTimestamp() const;
+    double valueAt(int index, int column) const;
+    const QVector<qint64> &timestamps() const;
+    const QVector<double> &column(int column) const;
+    EnergyLogStore mid(int index, int count) const;
+
+    void append(qint64 timestamp, std::initializer_list<double> values);
+    void append(qint64 timestamp, const QVector<double> &values);
+    void append(const EnergyLogStore &other);
+    void insert(int index, const EnergyLogStore &other);
+    // Merges the samples of other in, keeping the existing ones for timestamps present in both
+    void merge(const EnergyLogStore &other);
+
+    // Index of the first sample with a timestamp >= timestamp, count() if there is none
+    int lowerBound(qint64 timestamp) const;
+    // Index of the sample closest to timestamp, -1 if the store is empty
+    int nearestIndex(qint64 timestamp) const;
+
+private:
+    QVector<qint64> m_timestamps;
+    QVector<QVector<double>> m_columns;
+
+    friend QDataStream &operator<<(QDataStream &stream, const EnergyLogStore &store);
+    friend QDataStream &operator>>(QDataStream &stream, EnergyLogStore &store);
+};
+
+QDataStream &operator<<(QDataStream &stream, const EnergyLogStore &store);
+QDataStream &operator>>(QDataStream &stream, EnergyLogStore &store);
+
+// Set of closed timestamp intervals which have been fetched from the server, regardless of
+// whether the server had samples in there. Used to only request what is still missing.
+class EnergyLogRanges
+{
+public:
+    typedef QPair<qint64, qint64> Range;
+
+    bool isEmpty() const;
+    void clear();
+    const QVector<Range> &ranges() const;
+
+    void add(qint64 from, qint64 to);
+    // The parts of [from, to] which are not covered yet, in ascending order
+    QVector<Range> gaps(qint64 from, qint64 to) const;
+    // Forgets everything before timestamp
+    void removeBefore(qint64 timestamp);
+
+private:
+    // Sorted, neither overlapping nor adjacent
+    QVector<Range> m_ranges;
+};
+
+#endif // ENERGYLOGSTORE_H
@@ -117,9 +117,9 @@ void EnergyManager::notificationReceived(const QVariantMap &data)
         emit powerBalanceChanged();
 
     } else if (notification == "Energy.PowerBalanceLogEntryAdded") {
-        // Handled in EnergyLogs
+        // Handled in EnergyLogsRouter
     } else if (notification == "Energy.ThingPowerLogEntryAdded") {
-        // Handled in EnergyLogs
+        // Handled in EnergyLogsRouter
 
     } else {
         qCDebug(dcEnergyExperience()) << "Unhandled energy notification received" << data;
@@ -130,6 +130,9 @@ void EnergyManager::getRootMeterResponse(int commandId, const QVariantMap &param
 {
     Q_UNUSED(commandId)
     qCDebug(dcEnergyExperience) << "RootMeter response:" << params;
+    if (JsonRpcClient::isLost(params)) {
+        return;
+    }
     m_rootMeterId = params.value("rootMeterThingId").toUuid();
     emit rootMeterIdChanged();
 }
@@ -138,6 +141,10 @@ void EnergyManager::getPowerBalanceResponse(int commandId, const QVariantMap &pa
 {
     Q_UNUSED(commandId)
     qCDebug(dcEnergyExperience()) << "Power balance response:" << params;
+    if (JsonRpcClient::isLost(params)) {
+        // Notifications keep it up to date once connected again
+        return;
+    }
     m_currentPowerConsumption = params.value("currentPowerConsumption").toDouble();
     m_currentPowerProduction = params.value("currentPowerProduction").toDouble();
     m_currentPowerAcquisition = params.value("currentPowerAcquisition").toDouble();
@@ -1,7 +1,5 @@
 #include "powerbalancelogs.h"
 
-#include <QMetaEnum>
-
 PowerBalanceLogEntry::PowerBalanceLogEntry(QObject *parent): EnergyLogEntry(parent)
 {
 
@@ -63,7 +61,21 @@ double PowerBalanceLogEntry::totalReturn() const
 
 PowerBalanceLogs::PowerBalanceLogs(QObject *parent) : EnergyLogs(parent)
 {
+    setSubscription(EnergyLogsRouter::LogTypePowerBalance);
+}
 
+void PowerBalanceLogs::unpackEntry(const QVariantMap &map, EnergyLogStore *store)
+{
+    qint64 timestamp = map.value("timestamp").toLongLong();
+    double consumption = map.value("consumption").toDouble();
+    double production = map.value("production").toDouble();
+    double acquisition = map.value("acquisition").toDouble();
+    double storage = map.value("storage").toDouble();
+    double totalConsumption = map.value("totalConsumption").toDouble();
+    double totalProduction = map.value("totalProduction").toDouble();
+    double totalAcquisition = map.value("totalAcquisition").toDouble();
+    double totalReturn = map.value("totalReturn").toDouble();
+    store->append(timestamp, {consumption, production, acquisition, storage, totalConsumption, totalProduction, totalAcquisition, totalReturn});
 }
 
 QString PowerBalanceLogs::logsName() const
@@ -71,58 +83,50 @@ QString PowerBalanceLogs::logsName() const
     return "PowerBalanceLogs";
 }
 
-QList<EnergyLogEntry *> PowerBalanceLogs::unpackEntries(const QVariantMap &params, double *minValue, double *maxValue)
+QString PowerBalanceLogs::entriesKey() const
 {
-    QList<EnergyLogEntry*> ret;
-    foreach (const QVariant &variant, params.value("powerBalanceLogEntries").toList()) {
-        QVariantMap map = variant.toMap();
-        QDateTime timestamp = QDateTime::fromSecsSinceEpoch(map.value("timestamp").toLongLong());
-        double consumption = map.value("consumption").toDouble();
-        double production = map.value("production").toDouble();
-        double acquisition = map.value("acquisition").toDouble();
-        double storage = map.value("storage").toDouble();
-        double totalConsumption = map.value("totalConsumption").toDouble();
-        double totalProduction = map.value("totalProduction").toDouble();
-        double totalAcquisition = map.value("totalAcquisition").toDouble();
-        double totalReturn = map.value("totalReturn").toDouble();
-        PowerBalanceLogEntry *entry = new PowerBalanceLogEntry(timestamp, consumption, production, acquisition, storage, totalConsumption, totalProduction, totalAcquisition, totalReturn, this);
-
-        *minValue = qMin(qMin(qMin(qMin(*minValue, consumption), production), acquisition), storage);
-        *maxValue = qMax(qMax(qMax(qMax(*maxValue, consumption), production), acquisition), storage);
+    return "powerBalanceLogEntries";
+}
 
-        ret.append(entry);
+EnergyLogStore PowerBalanceLogs::unpackEntries(const QVariantMap &params)
+{
+    QVariantList entries = params.value("powerBalanceLogEntries").toList();
+    EnergyLogStore ret(ColumnCount);
+    ret.reserve(entries.count());
+    foreach (const QVariant &variant, entries) {
+        unpackEntry(variant.toMap(), &ret);
     }
     return ret;
 }
 
-void PowerBalanceLogs::notificationReceived(const QVariantMap &data)
+EnergyLogEntry *PowerBalanceLogs::createEntry(int index) const
 {
-    QString notification = data.value("notification").toString();
-    QVariantMap params = data.value("params").toMap();
-
-    QMetaEnum sampleRateEnum = QMetaEnum::fromType<EnergyLogs::SampleRate>();
-    SampleRate sampleRate = static_cast<SampleRate>(sampleRateEnum.keyToValue(data.value("params").toMap().value("sampleRate").toByteArray()));
+    const EnergyLogStore &s = store();
+    return new PowerBalanceLogEntry(QDateTime::fromSecsSinceEpoch(s.timestampAt(index)),
+                                    s.valueAt(index, ColumnConsumption),
+                                    s.valueAt(index, ColumnProduction),
+                                    s.valueAt(index, ColumnAcquisition),
+                                    s.valueAt(index, ColumnStorage),
+                                    s.valueAt(index, ColumnTotalConsumption),
+                                    s.valueAt(index, ColumnTotalProduction),
+                                    s.valueAt(index, ColumnTotalAcquisition),
+                                    s.valueAt(index, ColumnTotalReturn),
+                                    nullptr);
+}
 
-    if (sampleRate != this->sampleRate()) {
-        return;
-    }
+void PowerBalanceLogs::entryReceived(const EnergyLogStore &entry)
+{
+    appendEntries(entry);
+}
 
-    if (notification == "Energy.PowerBalanceLogEntryAdded") {
-        QVariantMap map = params.value("powerBalanceLogEntry").toMap();
-        QDateTime timestamp = QDateTime::fromSecsSinceEpoch(map.value("timestamp").toLongLong());
-        double consumption = map.value("consumption").toDouble();
-        double production = map.value("production").toDouble();
-        double acquisition = map.value("acquisition").toDouble();
-        double storage = map.value("storage").toDouble();
-        double totalConsumption = map.value("totalConsumption").toDouble();
-        double totalProduction = map.value("totalProduction").toDouble();
-        double totalAcquisition = map.value("totalAcquisition").toDouble();
-        double totalReturn = map.value("totalReturn").toDouble();
-        PowerBalanceLogEntry *entry = new PowerBalanceLogEntry(timestamp, consumption, production, acquisition, storage, totalConsumption, totalProduction, totalAcquisition, totalReturn, this);
-        double minValue = qMin(qMin(qMin(consumption, production), acquisition), storage);
-        double maxValue = qMax(qMax(qMax(consumption, production), acquisition), storage);
-        appendEntry(entry, minValue, maxValue);
-    }
+QVector<EnergyLogStore::Aggregation> PowerBalanceLogs::columnAggregations() const
+{
+    QVector<EnergyLogStore::Aggregation> ret(ColumnCount, EnergyLogStore::AggregationLast);
+    ret[ColumnConsumption] = EnergyLogStore::AggregationAverage;
+    ret[ColumnProduction] = EnergyLogStore::AggregationAverage;
+    ret[ColumnAcquisition] = EnergyLogStore::AggregationAverage;
+    ret[ColumnStorage] = EnergyLogStore::AggregationAverage;
+    return ret;
 }
 
 PowerBalanceLogs *PowerBalanceLogsProxy::powerBalanceLogs() const
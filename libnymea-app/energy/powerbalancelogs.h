@@ -47,12 +47,30 @@ class PowerBalanceLogs : public EnergyLogs
 {
     Q_OBJECT
 public:
+    enum Column {
+        ColumnConsumption,
+        ColumnProduction,
+        ColumnAcquisition,
+        ColumnStorage,
+        ColumnTotalConsumption,
+        ColumnTotalProduction,
+        ColumnTotalAcquisition,
+        ColumnTotalReturn,
+        ColumnCount
+    };
+    Q_ENUM(Column)
+
     explicit PowerBalanceLogs(QObject *parent = nullptr);
 
+    static void unpackEntry(const QVariantMap &map, EnergyLogStore *store);
+
 protected:
     QString logsName() const override;
-    QList<EnergyLogEntry*> unpackEntries(const QVariantMap &params, double *minValue, double *maxValue) override;
-    void notificationReceived(const QVariantMap &data) override;
+    QString entriesKey() const override;
+    EnergyLogStore unpackEntries(const QVariantMap &params) override;
+    EnergyLogEntry *createEntry(int index) const override;
+    void entryReceived(const EnergyLogStore &entry) override;
+    QVector<EnergyLogStore::Aggregation> columnAggregations() const override;
 };
 
 
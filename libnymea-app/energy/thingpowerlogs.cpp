@@ -42,6 +42,7 @@ double ThingPowerLogEntry::totalProduction() const
 
 ThingPowerLogs::ThingPowerLogs(QObject *parent) : EnergyLogs(parent)
 {
+    setSubscription(EnergyLogsRouter::LogTypeThingPower, m_thingId);
 }
 
 QUuid ThingPowerLogs::thingId() const
@@ -54,6 +55,7 @@ void ThingPowerLogs::setThingId(const QUuid &thingId)
     if (m_thingId != thingId) {
         m_thingId = thingId;
         emit thingIdChanged();
+        setSubscription(EnergyLogsRouter::LogTypeThingPower, m_thingId);
         if (m_loader) {
             m_loader->addThingId(thingId);
         }
@@ -72,9 +74,9 @@ void ThingPowerLogs::setLoader(ThingPowerLogsLoader *loader)
         emit loaderChanged();
 
         loader->addThingId(m_thingId);
-        connect(loader, &ThingPowerLogsLoader::fetched, this, [=](int commandId, const QVariantMap &params){
+        connect(loader, &ThingPowerLogsLoader::fetched, this, [=](int /*commandId*/, const QVariantMap &params){
             qCDebug(dcEnergyLogs()) << "Loader fetched data.";
-            getLogsResponse(commandId, params);
+            logsFetched(params);
         });
     }
 }
@@ -84,15 +86,6 @@ ThingPowerLogEntry *ThingPowerLogs::liveEntry()
     return m_liveEntry;
 }
 
-void ThingPowerLogs::addEntries(const QList<ThingPowerLogEntry *> &entries)
-{
-    QList<EnergyLogEntry*> energyLogEntries;
-    foreach (ThingPowerLogEntry* entry, entries) {
-        energyLogEntries.append(entry);
-    }
-    appendEntries(energyLogEntries);
-}
-
 ThingPowerLogEntry *ThingPowerLogs::unpack(const QVariantMap &map)
 {
     QDateTime timestamp = QDateTime::fromSecsSinceEpoch(map.value("timestamp").toLongLong());
@@ -103,11 +96,25 @@ ThingPowerLogEntry *ThingPowerLogs::unpack(const QVariantMap &map)
     return new ThingPowerLogEntry(timestamp, thingId, currentPower, totalConsumption, totalProduction, this);
 }
 
+void ThingPowerLogs::unpackEntry(const QVariantMap &map, EnergyLogStore *store)
+{
+    qint64 timestamp = map.value("timestamp").toLongLong();
+    double currentPower = map.value("currentPower").toDouble();
+    double totalConsumption = map.value("totalConsumption").toDouble();
+    double totalProduction = map.value("totalProduction").toDouble();
+    store->append(timestamp, {currentPower, totalConsumption, totalProduction});
+}
+
 QString ThingPowerLogs::logsName() const
 {
     return "ThingPowerLogs";
 }
 
+QString ThingPowerLogs::entriesKey() const
+{
+    return "thingPowerLogEntries";
+}
+
 QVariantMap ThingPowerLogs::fetchParams() const
 {
     QVariantMap ret;
@@ -116,7 +123,7 @@ QVariantMap ThingPowerLogs::fetchParams() const
     return ret;
 }
 
-QList<EnergyLogEntry *> ThingPowerLogs::unpackEntries(const QVariantMap &params, double *minValue, double *maxValue)
+EnergyLogStore ThingPowerLogs::unpackEntries(const QVariantMap &params)
 {
     foreach (const QVariant &variant, params.value("currentEntries").toList()) {
         QVariantMap map = variant.toMap();
@@ -131,70 +138,55 @@ QList<EnergyLogEntry *> ThingPowerLogs::unpackEntries(const QVariantMap &params,
         break;
     }
 
-    QList<EnergyLogEntry*> ret;
-    foreach (const QVariant &variant, params.value("thingPowerLogEntries").toList()) {
+    QVariantList entries = params.value("thingPowerLogEntries").toList();
+    EnergyLogStore ret(ColumnCount);
+    ret.reserve(entries.count());
+    foreach (const QVariant &variant, entries) {
         QVariantMap map = variant.toMap();
         if (map.value("thingId").toUuid() != m_thingId) {
             continue;
         }
-        QDateTime timestamp = QDateTime::fromSecsSinceEpoch(map.value("timestamp").toLongLong());
-        QUuid thingId = map.value("thingId").toUuid();
-        double currentPower = map.value("currentPower").toDouble();
-        double totalConsumption = map.value("totalConsumption").toDouble();
-        double totalProduction = map.value("totalProduction").toDouble();
-        ThingPowerLogEntry *entry = new ThingPowerLogEntry(timestamp, thingId, currentPower, totalConsumption, totalProduction, this);
-//        qWarning() << "Adding entry:" << entry->thingId() << entry->timestamp().toString() << entry->totalConsumption();
-
-        *minValue = qMin(*minValue, currentPower);
-        *maxValue = qMax(*maxValue, currentPower);
-
-        ret.append(entry);
+        unpackEntry(map, &ret);
     }
 
     return ret;
 }
 
-void ThingPowerLogs::notificationReceived(const QVariantMap &data)
+EnergyLogEntry *ThingPowerLogs::createEntry(int index) const
 {
-    QString notification = data.value("notification").toString();
-    QVariantMap params = data.value("params").toMap();
-
-    QMetaEnum sampleRateEnum = QMetaEnum::fromType<EnergyLogs::SampleRate>();
-    SampleRate sampleRate = static_cast<SampleRate>(sampleRateEnum.keyToValue(data.value("params").toMap().value("sampleRate").toByteArray()));
-    QVariantMap entryMap = params.value("thingPowerLogEntry").toMap();
-    QUuid thingId = entryMap.value("thingId").toUuid();
-
-    if (m_thingId != thingId) {
-        // Not watching this thing...
-        return;
-    }
-
-    if (sampleRate != this->sampleRate()) {
-        return;
-    }
+    const EnergyLogStore &s = store();
+    return new ThingPowerLogEntry(QDateTime::fromSecsSinceEpoch(s.timestampAt(index)),
+                                  m_thingId,
+                                  s.valueAt(index, ColumnCurrentPower),
+                                  s.valueAt(index, ColumnTotalConsumption),
+                                  s.valueAt(index, ColumnTotalProduction));
+}
 
+void ThingPowerLogs::entryReceived(const EnergyLogStore &entry)
+{
     // We'll use 1 Min samples in any case for the live value
-    if (sampleRate == EnergyLogs::SampleRate1Min) {
-        ThingPowerLogEntry *liveEntry = unpack(params.value("thingPowerLogEntry").toMap());
+    if (sampleRate() == EnergyLogs::SampleRate1Min) {
         if (m_liveEntry) {
             m_liveEntry->deleteLater();
         }
-        m_liveEntry = liveEntry;
-        emit liveEntryChanged(liveEntry);
+        m_liveEntry = new ThingPowerLogEntry(QDateTime::fromSecsSinceEpoch(entry.timestampAt(0)),
+                                             m_thingId,
+                                             entry.valueAt(0, ColumnCurrentPower),
+                                             entry.valueAt(0, ColumnTotalConsumption),
+                                             entry.valueAt(0, ColumnTotalProduction),
+                                             this);
+        emit liveEntryChanged(m_liveEntry);
     }
 
-    if (notification == "Energy.ThingPowerLogEntryAdded") {
-        QVariantMap map = params.value("thingPowerLogEntry").toMap();
-        QDateTime timestamp = QDateTime::fromSecsSinceEpoch(map.value("timestamp").toLongLong());
-        QUuid thingId = map.value("thingId").toUuid();
-        double currentPower = map.value("currentPower").toDouble();
-        double totalConsumption = map.value("totalConsumption").toDouble();
-        double totalProduction = map.value("totalProduction").toDouble();
-        ThingPowerLogEntry *entry = new ThingPowerLogEntry(timestamp, thingId, currentPower, totalConsumption, totalProduction, this);
-        appendEntry(entry, currentPower, currentPower);
-    }
+    appendEntries(entry);
 }
 
+QVector<EnergyLogStore::Aggregation> ThingPowerLogs::columnAggregations() const
+{
+    QVector<EnergyLogStore::Aggregation> ret(ColumnCount, EnergyLogStore::AggregationLast);
+    ret[ColumnCurrentPower] = EnergyLogStore::AggregationAverage;
+    return ret;
+}
 
 ThingPowerLogsLoader::ThingPowerLogsLoader(QObject *parent):
     QObject(parent)
@@ -47,6 +47,16 @@ public:
 
     Q_INVOKABLE ThingPowerLogEntry *liveEntry();
 
+    enum Column {
+        ColumnCurrentPower,
+        ColumnTotalConsumption,
+        ColumnTotalProduction,
+        ColumnCount
+    };
+    Q_ENUM(Column)
+
+    static void unpackEntry(const QVariantMap &map, EnergyLogStore *store);
+
 signals:
     void thingIdChanged();
     void loaderChanged();
@@ -54,13 +64,14 @@ signals:
 
 protected:
     QString logsName() const override;
+    QString entriesKey() const override;
     QVariantMap fetchParams() const override;
-    QList<EnergyLogEntry*> unpackEntries(const QVariantMap &params, double *minValue, double *maxValue) override;
-    void notificationReceived(const QVariantMap &data) override;
+    EnergyLogStore unpackEntries(const QVariantMap &params) override;
+    EnergyLogEntry *createEntry(int index) const override;
+    void entryReceived(const EnergyLogStore &entry) override;
+    QVector<EnergyLogStore::Aggregation> columnAggregations() const override;
 
 private:
-    void addEntries(const QList<ThingPowerLogEntry *> &entries);
-
     ThingPowerLogEntry *unpack(const QVariantMap &map);
 
     QUuid m_thingId;
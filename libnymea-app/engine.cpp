@@ -51,8 +51,9 @@ Engine::Engine(QObject *parent) :
 {
 
     connect(m_jsonRpcClient, &JsonRpcClient::connectedChanged, this, &Engine::onConnectedChanged);
+    connect(m_jsonRpcClient, &JsonRpcClient::transportSwitched, this, &Engine::onTransportSwitched);
 
-    connect(m_thingManager, &ThingManager::fetchingDataChanged, this, &Engine::onThingManagerFetchingChanged);
+    connect(m_tagsManager->tags(), &Tags::thingTagsChanged, m_thingManager->things(), &Things::notifyTagsChanged);
 
     connect(m_jsonRpcClient, &JsonRpcClient::connectedChanged, this, [this]() {
         qDebug() << "JSONRpc connected changed:" << m_jsonRpcClient->connected();
@@ -108,18 +109,21 @@ void Engine::onConnectedChanged()
     if (m_jsonRpcClient->connected()) {
         qDebug() << "Engine: inital setup required:" << m_jsonRpcClient->initialSetupRequired() << "auth required:" << m_jsonRpcClient->authenticationRequired();
         if (!m_jsonRpcClient->initialSetupRequired() && !m_jsonRpcClient->authenticationRequired()) {
+            // The managers don't depend on each other's data, so fetch everything in parallel
+            // instead of waiting for the thing manager to finish first.
             m_thingManager->init();
+            m_tagsManager->init();
+            m_ruleManager->init();
+            m_scriptManager->init();
+            m_nymeaConfiguration->init();
+            m_systemController->init();
         }
     }
 }
 
-void Engine::onThingManagerFetchingChanged()
+void Engine::onTransportSwitched()
 {
-    if (!m_thingManager->fetchingData()) {
-        m_tagsManager->init();
-        m_ruleManager->init();
-        m_scriptManager->init();
-        m_nymeaConfiguration->init();
-        m_systemController->init();
-    }
+    // State changes notified while switching over are lost. Everything else stays, the UI keeps its references.
+    qDebug() << "Engine: transport switched. Refreshing things.";
+    m_thingManager->refreshThings();
 }
@@ -80,7 +80,7 @@ private:
 
 private slots:
     void onConnectedChanged();
-    void onThingManagerFetchingChanged();
+    void onTransportSwitched();
 
 };
 
@@ -160,22 +160,27 @@ void InterfacesModel::syncInterfaces()
         }
     }
 
+    InterfaceBits shownInterfaces = InterfaceBits::fromNames(m_shownInterfaces);
     QStringList interfacesInSource;
+    InterfaceBits interfacesInSourceBits;
     foreach (ThingClass *dc, thingClasses) {
 //        qDebug() << "thing" <<dc->name() << "has interfaces" << dc->interfaces();
 
         bool isInShownIfaces = false;
         foreach (const QString &interface, dc->interfaces()) {
-            if (!m_shownInterfaces.isEmpty() && !m_shownInterfaces.contains(interface)) {
+            int interfaceId = InterfaceBits::idOf(interface);
+            if (!m_shownInterfaces.isEmpty() && !shownInterfaces.testBit(interfaceId)) {
                 continue;
             }
 
-            if (!interfacesInSource.contains(interface)) {
+            if (!interfacesInSourceBits.testBit(interfaceId)) {
+                interfacesInSourceBits.setBit(interfaceId);
                 interfacesInSource.append(interface);
             }
             isInShownIfaces = true;
         }
-        if (m_showUncategorized && !isInShownIfaces && !interfacesInSource.contains("uncategorized")) {
+        if (m_showUncategorized && !isInShownIfaces && !interfacesInSourceBits.testBit(InterfaceBits::idOf("uncategorized"))) {
+            interfacesInSourceBits.setBit(InterfaceBits::idOf("uncategorized"));
             interfacesInSource.append("uncategorized");
         }
     }
@@ -183,7 +188,7 @@ void InterfacesModel::syncInterfaces()
     QStringList interfacesToRemove;
 
     foreach (const QString &interface, m_interfaces) {
-        if (!interfacesInSource.contains(interface)) {
+        if (!interfacesInSourceBits.testBit(InterfaceBits::idOf(interface))) {
             interfacesToRemove.append(interface);
         }
         interfacesToAdd.removeAll(interface);
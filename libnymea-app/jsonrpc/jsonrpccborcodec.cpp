@@ -0,0 +1,171 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU General Public License as published by the Free Software
+* Foundation, GNU version 3. This project is distributed in the hope that it
+* will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+* Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "jsonrpccborcodec.h"
+
+#include <QCborMap>
+#include <QCborArray>
+#include <QUuid>
+#include <QtEndian>
+
+#include "logging.h"
+Q_DECLARE_LOGGING_CATEGORY(dcJsonRpc)
+
+JsonRpcCborCodec::JsonRpcCborCodec()
+{
+}
+
+void JsonRpcCborCodec::setKeyDictionary(const QStringList &keys)
+{
+    m_keys = keys;
+    m_keyIndexes.clear();
+    for (int i = 0; i < m_keys.count(); i++) {
+        m_keyIndexes.insert(m_keys.at(i), i);
+    }
+}
+
+void JsonRpcCborCodec::clear()
+{
+    m_keys.clear();
+    m_keyIndexes.clear();
+}
+
+QByteArray JsonRpcCborCodec::encode(const QVariantMap &message) const
+{
+    QByteArray payload = toCbor(message).toCbor();
+    QByteArray frame(4, 0);
+    qToBigEndian<quint32>(static_cast<quint32>(payload.length()), reinterpret_cast<uchar*>(frame.data()));
+    frame.append(payload);
+    return frame;
+}
+
+QVariantMap JsonRpcCborCodec::decode(const QByteArray &frame, bool *ok) const
+{
+    QCborParserError error;
+    QCborValue value = QCborValue::fromCbor(frame, &error);
+    if (error.error != QCborError::NoError || !value.isMap()) {
+        qCWarning(dcJsonRpc()) << "Could not parse CBOR data from nymea:" << error.errorString() << "at offset" << error.offset;
+        if (ok) {
+            *ok = false;
+        }
+        return QVariantMap();
+    }
+    if (ok) {
+        *ok = true;
+    }
+    return fromCbor(value).toMap();
+}
+
+bool JsonRpcCborCodec::isUuidKey(const QString &key)
+{
+    // Objects carry their own id in "id", references to others are "thingId", "stateTypeIds" and so on.
+    // The top level "id" is the request id, an integer, and not affected.
+    return key == QLatin1String("id") || key.endsWith(QLatin1String("Id")) || key.endsWith(QLatin1String("Ids"));
+}
+
+QCborValue JsonRpcCborCodec::toCbor(const QVariant &value, bool uuidKey) const
+{
+    switch (value.type()) {
+    case QVariant::Map: {
+        QCborMap map;
+        QVariantMap variantMap = value.toMap();
+        for (QVariantMap::const_iterator it = variantMap.constBegin(); it != variantMap.constEnd(); ++it) {
+            QHash<QString, int>::const_iterator keyIndex = m_keyIndexes.find(it.key());
+            if (keyIndex != m_keyIndexes.constEnd()) {
+                map.insert(keyIndex.value(), toCbor(it.value(), isUuidKey(it.key())));
+            } else {
+                map.insert(it.key(), toCbor(it.value(), isUuidKey(it.key())));
+            }
+        }
+        return map;
+    }
+    case QVariant::List:
+    case QVariant::StringList: {
+        QCborArray array;
+        foreach (const QVariant &entry, value.toList()) {
+            array.append(toCbor(entry, uuidKey));
+        }
+        return array;
+    }
+    case QVariant::String: {
+        // Ids are transferred as strings in braces. Send them as binary instead. Only for id keys though, any
+        // other string would come back lowercased if it happened to parse as UUID.
+        QString string = value.toString();
+        if (uuidKey && string.length() == 38 && string.startsWith('{')) {
+            QUuid uuid(string);
+            if (!uuid.isNull()) {
+                return QCborValue(uuid);
+            }
+        }
+        return string;
+    }
+    case QVariant::Uuid:
+        return QCborValue(value.toUuid());
+    case QVariant::ByteArray:
+        // Byte arrays (e.g. the token) are strings in the JSON representation too
+        return QString::fromUtf8(value.toByteArray());
+    default:
+        return QCborValue::fromVariant(value);
+    }
+}
+
+QVariant JsonRpcCborCodec::fromCbor(const QCborValue &value) const
+{
+    switch (value.type()) {
+    case QCborValue::Map: {
+        QVariantMap variantMap;
+        const QCborMap map = value.toMap();
+        for (QCborMap::ConstIterator it = map.constBegin(); it != map.constEnd(); ++it) {
+            QString key;
+            if (it.key().isInteger()) {
+                int index = static_cast<int>(it.key().toInteger());
+                key = index >= 0 && index < m_keys.count() ? m_keys.at(index) : QString::number(index);
+            } else {
+                key = it.key().toString();
+            }
+            variantMap.insert(key, fromCbor(it.value()));
+        }
+        return variantMap;
+    }
+    case QCborValue::Array: {
+        QVariantList list;
+        const QCborArray array = value.toArray();
+        for (int i = 0; i < array.size(); i++) {
+            list.append(fromCbor(array.at(i)));
+        }
+        return list;
+    }
+    case QCborValue::Uuid:
+        // Keep the same representation as in JSON so consumers don't need to care
+        return value.toUuid().toString();
+    default:
+        return value.toVariant();
+    }
+}
@@ -0,0 +1,64 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU General Public License as published by the Free Software
+* Foundation, GNU version 3. This project is distributed in the hope that it
+* will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+* Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef JSONRPCCBORCODEC_H
+#define JSONRPCCBORCODEC_H
+
+#include <QByteArray>
+#include <QVariantMap>
+#include <QStringList>
+#include <QHash>
+#include <QCborValue>
+
+// Compact wire encoding for JSON-RPC messages, negotiated with JSONRPC.SetEncoding.
+// Messages are encoded as CBOR. UUIDs in id fields are transferred as 16 byte binary values and map keys
+// contained in the per session key dictionary are replaced by their index in that dictionary.
+class JsonRpcCborCodec
+{
+public:
+    JsonRpcCborCodec();
+
+    void setKeyDictionary(const QStringList &keys);
+    void clear();
+
+    // Returns a complete frame, including the length prefix expected by JsonRpcFramer
+    QByteArray encode(const QVariantMap &message) const;
+    QVariantMap decode(const QByteArray &frame, bool *ok = nullptr) const;
+
+private:
+    static bool isUuidKey(const QString &key);
+    QCborValue toCbor(const QVariant &value, bool uuidKey = false) const;
+    QVariant fromCbor(const QCborValue &value) const;
+
+    QStringList m_keys;
+    QHash<QString, int> m_keyIndexes;
+};
+
+#endif // JSONRPCCBORCODEC_H
@@ -49,6 +49,9 @@
 #include <QDir>
 #include <QStandardPaths>
 
+#include <algorithm>
+#include <functional>
+
 #include "logging.h"
 NYMEA_LOGGING_CATEGORY(dcJsonRpc, "JsonRpc")
 
@@ -72,6 +75,12 @@ JsonRpcClient::JsonRpcClient(QObject *parent) :
     connect(m_connection, &NymeaConnection::dataAvailable, this, &JsonRpcClient::dataReceived, Qt::QueuedConnection);
 
     registerNotificationHandler(this, QStringLiteral("JSONRPC"), "notificationReceived");
+
+    m_diagnostics = new JsonRpcDiagnostics(this);
+
+    // Deadlines are checked coarsely, there's no need for a timer per request
+    m_timeoutTimer.setInterval(1000);
+    connect(&m_timeoutTimer, &QTimer::timeout, this, &JsonRpcClient::checkTimeouts);
 }
 
 void JsonRpcClient::registerNotificationHandler(QObject *handler, const QString &nameSpace, const QString &method)
@@ -94,11 +103,36 @@ void JsonRpcClient::unregisterNotificationHandler(QObject *handler)
     setNotificationsEnabled();
 }
 
-int JsonRpcClient::sendCommand(const QString &method, const QVariantMap &params, QObject *caller, const QString &callbackMethod)
+int JsonRpcClient::sendCommand(const QString &method, const QVariantMap &params, QObject *caller, const QString &callbackMethod, int timeout)
 {
 
     JsonRpcReply *reply = createReply(method, params, caller, callbackMethod);
+    reply->setTimeout(timeout);
+    return send(reply);
+}
+
+int JsonRpcClient::sendCommand(const QString &method, QObject *caller, const QString &callbackMethod)
+{
 
+    return sendCommand(method, QVariantMap(), caller, callbackMethod);
+}
+
+bool JsonRpcClient::isLost(const QVariantMap &params)
+{
+    return params.value("error").toString() == "lost";
+}
+
+int JsonRpcClient::sendReplaceableCommand(const QString &method, const QVariantMap &params, const QString &replaceKey, QObject *caller, const QString &callbackMethod)
+{
+    JsonRpcReply *reply = createReply(method, params, caller, callbackMethod);
+    reply->setReplaceKey(replaceKey);
+    return send(reply);
+}
+
+int JsonRpcClient::send(JsonRpcReply *reply)
+{
+    QString method = reply->nameSpace() + '.' + reply->method();
+    QVariantMap params = reply->params();
     if (m_cacheHashes.contains(method)) {
         QString hash = m_cacheHashes.value(method);
         QString callSignature = method + '-' + QJsonDocument::fromVariant(params).toJson() + '-' + QLocale().name();
@@ -122,14 +156,23 @@ int JsonRpcClient::sendCommand(const QString &method, const QVariantMap &params,
     }
 
     m_replies.insert(reply->commandId(), reply);
-    sendRequest(reply->requestMap());
-    return reply->commandId();
-}
 
-int JsonRpcClient::sendCommand(const QString &method, QObject *caller, const QString &callbackMethod)
-{
+    if (reply->timeout() == 0 && isReadOnly(method)) {
+        reply->setTimeout(readTimeout);
+    }
+    if (reply->timeout() > 0 && !m_timeoutTimer.isActive()) {
+        m_timeoutTimer.start();
+    }
 
-    return sendCommand(method, QVariantMap(), caller, callbackMethod);
+    // The handshake must not wait behind anything, and without a connection there's nothing to wait for
+    if (reply->nameSpace() == "JSONRPC" || !m_connection->connected()) {
+        reply->setSent();
+        sendRequest(reply->requestMap());
+        return reply->commandId();
+    }
+
+    enqueue(reply);
+    return reply->commandId();
 }
 
 NymeaConnection::BearerTypes JsonRpcClient::availableBearerTypes() const
@@ -182,11 +225,18 @@ void JsonRpcClient::addToken(const QString &serverUuid, const QByteArray &token)
 
 void JsonRpcClient::setNotificationsEnabledResponse(int commandId, const QVariantMap &params)
 {
+    if (isLost(params)) {
+        // The handshake is redone on the next transport
+        return;
+    }
     qCDebug(dcJsonRpc()) << "Notification configuration response:" << commandId << qUtf8Printable(QJsonDocument::fromVariant(params).toJson());
 
     if (!m_connected) {
         m_connected = true;
         emit connectedChanged(true);
+    } else if (m_transportSwitched) {
+        m_transportSwitched = false;
+        emit transportSwitched();
     }
 }
 
@@ -217,6 +267,7 @@ void JsonRpcClient::notificationReceived(const QVariantMap &data)
             emit permissionsChanged();
 
             setNotificationsEnabled();
+            openSendQueue();
         } else {
             emit pushButtonAuthFailed();
         }
@@ -226,8 +277,35 @@ void JsonRpcClient::notificationReceived(const QVariantMap &data)
     qCWarning(dcJsonRpc()) << "JsonRpcClient: Unhandled notification received" << data;
 }
 
+void JsonRpcClient::setEncodingReply(int /*commandId*/, const QVariantMap &data)
+{
+    if (isLost(data)) {
+        // The handshake is redone on the next transport
+        return;
+    }
+    // The server sends this reply in the old encoding and switches right after it.
+    if (data.value("success").toBool()) {
+        m_framer.setEncoding(JsonRpcFramer::EncodingCbor);
+        m_cborCodec.setKeyDictionary(data.value("keys").toStringList());
+        qCInfo(dcJsonRpc()) << "Switched to CBOR encoding. Key dictionary size:" << data.value("keys").toList().count();
+    } else {
+        qCWarning(dcJsonRpc()) << "Server refused to switch encoding. Staying with JSON.";
+    }
+
+    m_encodingSwitchPending = false;
+    QList<QVariantMap> pendingMessages = m_pendingMessages;
+    m_pendingMessages.clear();
+    foreach (const QVariantMap &message, pendingMessages) {
+        sendMessage(message);
+    }
+}
+
 void JsonRpcClient::getVersionsReply(int /*commandId*/, const QVariantMap &data)
 {
+    if (isLost(data)) {
+        // Asked again with the next handshake
+        return;
+    }
     m_serverQtVersion = data.value("qtVersion").toString();
     m_serverQtBuildVersion = data.value("qtBuildVersion").toString();
     if (!m_serverQtVersion.isEmpty()) {
@@ -342,6 +420,75 @@ QVariantMap JsonRpcClient::experiences() const
     return m_experiences;
 }
 
+int JsonRpcClient::sendWindow() const
+{
+    return m_sendWindow;
+}
+
+void JsonRpcClient::setSendWindow(int sendWindow)
+{
+    sendWindow = qMax(1, sendWindow);
+    if (m_sendWindow != sendWindow) {
+        m_sendWindow = sendWindow;
+        emit sendWindowChanged();
+        sendQueued();
+    }
+}
+
+int JsonRpcClient::queueDepth() const
+{
+    int depth = 0;
+    foreach (const QList<JsonRpcReply*> &queue, m_sendQueue) {
+        depth += queue.count();
+    }
+    return depth;
+}
+
+int JsonRpcClient::inFlightCount() const
+{
+    return m_inFlight.count();
+}
+
+int JsonRpcClient::queueTime() const
+{
+    return m_queueTime;
+}
+
+JsonRpcDiagnostics *JsonRpcClient::diagnostics() const
+{
+    return m_diagnostics;
+}
+
+void JsonRpcClient::cancel(int commandId)
+{
+    JsonRpcReply *reply = m_replies.value(commandId);
+    if (!reply) {
+        // Might have been replaced by a newer request
+        for (auto it = m_superseded.begin(); it != m_superseded.end(); ++it) {
+            for (int i = 0; i < it.value().count(); i++) {
+                if (it.value().at(i)->commandId() == commandId) {
+                    JsonRpcReply *superseded = it.value().takeAt(i);
+                    m_diagnostics->addCancellation(superseded->nameSpace() + '.' + superseded->method());
+                    superseded->deleteLater();
+                    return;
+                }
+            }
+        }
+        return;
+    }
+
+    qCDebug(dcJsonRpc()) << "Cancelling request" << commandId << reply->nameSpace() + '.' + reply->method();
+    m_diagnostics->addCancellation(reply->nameSpace() + '.' + reply->method());
+    removeReply(reply);
+    // Requests it replaced were waiting for the same result
+    foreach (JsonRpcReply *superseded, m_superseded.take(commandId)) {
+        superseded->deleteLater();
+    }
+    reply->deleteLater();
+    sendQueued();
+    emit sendQueueChanged();
+}
+
 int JsonRpcClient::createUser(const QString &username, const QString &password, const QString &displayName, const QString &email)
 {
     QVariantMap params;
@@ -353,7 +500,7 @@ int JsonRpcClient::createUser(const QString &username, const QString &password,
     }
     JsonRpcReply* reply = createReply("JSONRPC.CreateUser", params, this, "processCreateUser");
     m_replies.insert(reply->commandId(), reply);
-    m_connection->sendData(QJsonDocument::fromVariant(reply->requestMap()).toJson());
+    sendMessage(reply->requestMap());
     return reply->commandId();
 }
 
@@ -366,7 +513,7 @@ int JsonRpcClient::authenticate(const QString &username, const QString &password
     qDebug() << "Authenticating:" << username << password << deviceName;
     JsonRpcReply* reply = createReply("JSONRPC.Authenticate", params, this, "processAuthenticate");
     m_replies.insert(reply->commandId(), reply);
-    m_connection->sendData(QJsonDocument::fromVariant(reply->requestMap()).toJson());
+    sendMessage(reply->requestMap());
     return reply->commandId();
 }
 
@@ -377,7 +524,7 @@ int JsonRpcClient::requestPushButtonAuth(const QString &deviceName)
     params.insert("deviceName", deviceName);
     JsonRpcReply *reply = createReply("JSONRPC.RequestPushButtonAuth", params, this, "processRequestPushButtonAuth");
     m_replies.insert(reply->commandId(), reply);
-    m_connection->sendData(QJsonDocument::fromVariant(reply->requestMap()).toJson());
+    sendMessage(reply->requestMap());
     return reply->commandId();
 }
 
@@ -388,6 +535,10 @@ bool JsonRpcClient::ensureServerVersion(const QString &jsonRpcVersion)
 
 void JsonRpcClient::processAuthenticate(int /*commandId*/, const QVariantMap &data)
 {
+    if (isLost(data)) {
+        // Not a wrong password, the connection went away
+        return;
+    }
     if (data.value("success").toBool()) {
         qCInfo(dcJsonRpc()) << "authentication successful";
         m_token = data.value("token").toByteArray();
@@ -408,6 +559,7 @@ void JsonRpcClient::processAuthenticate(int /*commandId*/, const QVariantMap &da
         emit authenticatedChanged();
 
         setNotificationsEnabled();
+        openSendQueue();
     } else {
         qCWarning(dcJsonRpc()) << "Authentication failed" << data;
         emit authenticationFailed();
@@ -416,6 +568,10 @@ void JsonRpcClient::processAuthenticate(int /*commandId*/, const QVariantMap &da
 
 void JsonRpcClient::processCreateUser(int /*commandId*/, const QVariantMap &data)
 {
+    if (isLost(data)) {
+        // The server might have created the user, it will tell with the next handshake
+        return;
+    }
     qDebug() << "create user response:" << data;
     if (data.value("error").toString() == "UserErrorNoError") {
         emit createUserSucceeded();
@@ -429,6 +585,10 @@ void JsonRpcClient::processCreateUser(int /*commandId*/, const QVariantMap &data
 
 void JsonRpcClient::processRequestPushButtonAuth(int /*commandId*/, const QVariantMap &data)
 {
+    if (isLost(data)) {
+        // The connection went away, the UI starts over with it
+        return;
+    }
     qDebug() << "requestPushButtonAuth response" << data;
     if (data.value("success").toBool()) {
         m_pendingPushButtonTransaction = data.value("transactionId").toInt();
@@ -448,6 +608,201 @@ JsonRpcReply *JsonRpcClient::createReply(const QString &method, const QVariantMa
     return new JsonRpcReply(m_id, callParts.first(), callParts.last(), params, caller, callback);
 }
 
+void JsonRpcClient::enqueue(JsonRpcReply *reply)
+{
+    Priority priority = priorityForMethod(reply->nameSpace() + '.' + reply->method());
+    QList<JsonRpcReply*> &queue = m_sendQueue[priority];
+
+    QString key = reply->replaceKey();
+    if (!key.isEmpty()) {
+        for (int i = 0; i < queue.count(); i++) {
+            if (queue.at(i)->replaceKey() == key) {
+                JsonRpcReply *superseded = queue.takeAt(i);
+                qCDebug(dcJsonRpc()) << "Request" << superseded->commandId() << "superseded by" << reply->commandId();
+                m_replies.remove(superseded->commandId());
+                QList<JsonRpcReply*> replaced = m_superseded.take(superseded->commandId());
+                replaced.append(superseded);
+                m_superseded.insert(reply->commandId(), replaced);
+                break;
+            }
+        }
+    }
+
+    queue.append(reply);
+    sendQueued();
+    emit sendQueueChanged();
+}
+
+void JsonRpcClient::openSendQueue()
+{
+    // Hello and authentication are through. If the encoding switch is still waiting for its reply,
+    // sendMessage() holds everything back until then, so it goes out in the new encoding.
+    m_sendQueueOpen = true;
+    sendQueued();
+}
+
+void JsonRpcClient::sendQueued()
+{
+    if (!m_sendQueueOpen) {
+        return;
+    }
+    bool sent = false;
+    while (m_inFlight.count() < m_sendWindow) {
+        JsonRpcReply *reply = nullptr;
+        Priority priority = PriorityDefault;
+        for (auto it = m_sendQueue.begin(); it != m_sendQueue.end(); ++it) {
+            if (it.value().isEmpty()) {
+                continue;
+            }
+            // Background fetches get half of the window at most, so there's always room for what the user is waiting for
+            if (it.key() == PriorityBackground && inFlightCount(PriorityBackground) >= qMax(1, m_sendWindow / 2)) {
+                break;
+            }
+            priority = it.key();
+            reply = it.value().takeFirst();
+            break;
+        }
+        if (!reply) {
+            break;
+        }
+
+        int queueTime = static_cast<int>(reply->setSent());
+        m_queueTime = m_queueTime < 0 ? queueTime : (3 * m_queueTime + queueTime) / 4;
+        m_inFlight.insert(reply->commandId(), priority);
+        sendRequest(reply->requestMap());
+        sent = true;
+    }
+    if (sent) {
+        updateUpgradeHold();
+        emit sendQueueChanged();
+    }
+}
+
+void JsonRpcClient::dropQueued()
+{
+    for (auto it = m_sendQueue.begin(); it != m_sendQueue.end(); ++it) {
+        foreach (JsonRpcReply *reply, it.value()) {
+            m_replies.remove(reply->commandId());
+            notifyLost(reply);
+        }
+        it.value().clear();
+    }
+}
+
+void JsonRpcClient::dropInFlight()
+{
+    // Replies for anything sent won't arrive on this transport
+    foreach (JsonRpcReply *reply, m_replies.values()) {
+        if (!reply->isSent()) {
+            continue;
+        }
+        m_replies.remove(reply->commandId());
+        notifyLost(reply);
+    }
+    m_inFlight.clear();
+    updateUpgradeHold();
+}
+
+void JsonRpcClient::notifyLost(JsonRpcReply *reply)
+{
+    // Queued, so callers can't send new requests while the queues are being torn down
+    QVariantMap params;
+    params.insert("error", "lost");
+    QList<JsonRpcReply*> replies = m_superseded.take(reply->commandId());
+    replies.prepend(reply);
+    foreach (JsonRpcReply *lost, replies) {
+        if (!lost->caller().isNull() && !lost->callback().isEmpty()) {
+            QMetaObject::invokeMethod(lost->caller(), lost->callback().toLatin1().data(), Qt::QueuedConnection, Q_ARG(int, lost->commandId()), Q_ARG(QVariantMap, params));
+        }
+        QMetaObject::invokeMethod(this, "responseReceived", Qt::QueuedConnection, Q_ARG(int, lost->commandId()), Q_ARG(QVariantMap, params));
+        delete lost;
+    }
+}
+
+void JsonRpcClient::requeueInFlight()
+{
+    // In the order they were sent, ahead of everything that's been waiting
+    QList<int> commandIds = m_inFlight.keys();
+    std::sort(commandIds.begin(), commandIds.end(), std::greater<int>());
+    foreach (int commandId, commandIds) {
+        JsonRpcReply *reply = m_replies.value(commandId);
+        if (!reply || !isReadOnly(reply->nameSpace() + '.' + reply->method())) {
+            continue;
+        }
+        qCDebug(dcJsonRpc()) << "Sending request" << commandId << reply->nameSpace() + '.' + reply->method() << "again on the new transport";
+        reply->setQueued();
+        m_sendQueue[m_inFlight.take(commandId)].prepend(reply);
+    }
+}
+
+void JsonRpcClient::updateUpgradeHold()
+{
+    // Reads can be sent again on the new transport, anything else must be answered first
+    bool held = false;
+    for (auto it = m_inFlight.constBegin(); it != m_inFlight.constEnd(); ++it) {
+        JsonRpcReply *reply = m_replies.value(it.key());
+        if (reply && !isReadOnly(reply->nameSpace() + '.' + reply->method())) {
+            held = true;
+            break;
+        }
+    }
+    m_connection->setUpgradeHeld(held);
+}
+
+void JsonRpcClient::removeReply(JsonRpcReply *reply)
+{
+    // The server might still reply, but nobody's waiting for it any more
+    m_replies.remove(reply->commandId());
+    m_inFlight.remove(reply->commandId());
+    for (auto it = m_sendQueue.begin(); it != m_sendQueue.end(); ++it) {
+        it.value().removeOne(reply);
+    }
+    updateUpgradeHold();
+}
+
+int JsonRpcClient::inFlightCount(Priority priority) const
+{
+    int count = 0;
+    foreach (Priority inFlightPriority, m_inFlight) {
+        if (inFlightPriority == priority) {
+            count++;
+        }
+    }
+    return count;
+}
+
+JsonRpcClient::Priority JsonRpcClient::priorityForMethod(const QString &method)
+{
+    static const QStringList interactiveMethods = {
+        "Integrations.ExecuteAction",
+        "Integrations.ExecuteBrowserItem",
+        "Integrations.ExecuteBrowserItemAction",
+        "Rules.ExecuteActions"
+    };
+    static const QStringList backgroundMethods = {
+        "Logging.GetLogEntries",
+        "Energy.GetPowerBalanceLogs",
+        "Energy.GetThingPowerLogs"
+    };
+    if (interactiveMethods.contains(method)) {
+        return PriorityInteractive;
+    }
+    if (backgroundMethods.contains(method)) {
+        return PriorityBackground;
+    }
+    return PriorityDefault;
+}
+
+bool JsonRpcClient::isReadOnly(const QString &method)
+{
+    static const QStringList readOnlyMethods = {
+        "AppData.Load",
+        "Integrations.BrowseThing",
+        "ZWave.IsZWaveAvailable"
+    };
+    return method.section('.', 1).startsWith("Get") || readOnlyMethods.contains(method);
+}
+
 void JsonRpcClient::setNotificationsEnabled()
 {
     QStringList namespaces;
@@ -482,7 +837,23 @@ void JsonRpcClient::sendRequest(const QVariantMap &request)
     QVariantMap newRequest = request;
     newRequest.insert("token", m_token);
     //    qDebug() << "Sending request" << qUtf8Printable(QJsonDocument::fromVariant(newRequest).toJson());
-    m_connection->sendData(QJsonDocument::fromVariant(newRequest).toJson(QJsonDocument::Compact) + "\n");
+    sendMessage(newRequest);
+}
+
+void JsonRpcClient::sendMessage(const QVariantMap &message)
+{
+    if (m_encodingSwitchPending) {
+        m_pendingMessages.append(message);
+        return;
+    }
+    QByteArray data;
+    if (m_framer.encoding() == JsonRpcFramer::EncodingCbor) {
+        data = m_cborCodec.encode(message);
+    } else {
+        data = QJsonDocument::fromVariant(message).toJson(QJsonDocument::Compact) + "\n";
+    }
+    m_diagnostics->addRequest(message.value("method").toString(), data.size());
+    m_connection->sendData(data);
 }
 
 bool JsonRpcClient::loadPem(const QUuid &serverUud, QByteArray &pem)
@@ -515,12 +886,22 @@ bool JsonRpcClient::storePem(const QUuid &serverUuid, const QByteArray &pem)
 void JsonRpcClient::onInterfaceConnectedChanged(bool connected)
 {
 
+    // Nothing goes out until the handshake on the new transport is done
+    m_sendQueueOpen = false;
+
     if (!connected) {
         qCInfo(dcJsonRpc()) << "JsonRpcClient: Transport disconnected.";
         m_initialSetupRequired = false;
         m_authenticationRequired = false;
         m_authenticated = false;
-        m_receiveBuffer.clear();
+        m_framer.clear();
+        m_cborCodec.clear();
+        m_encodingSwitchPending = false;
+        m_pendingMessages.clear();
+        m_transportSwitched = false;
+        dropQueued();
+        dropInFlight();
+        emit sendQueueChanged();
         m_serverQtVersion.clear();
         m_serverQtBuildVersion.clear();
         if (m_connected) {
@@ -528,9 +909,24 @@ void JsonRpcClient::onInterfaceConnectedChanged(bool connected)
             emit connectedChanged(false);
         }
     } else {
-        qCInfo(dcJsonRpc()) << "JsonRpcClient: Transport connected. Starting handshake.";
+        if (m_connected) {
+            // The connection switched over to another transport. The session stays up for the rest
+            // of the app, but the server needs to see the handshake on the new transport.
+            qCInfo(dcJsonRpc()) << "JsonRpcClient: Transport switched. Redoing handshake.";
+            m_transportSwitched = true;
+            requeueInFlight();
+        } else {
+            qCInfo(dcJsonRpc()) << "JsonRpcClient: Transport connected. Starting handshake.";
+        }
         // Clear anything that might be left in the buffer from a previous connection.
-        m_receiveBuffer.clear();
+        m_framer.clear();
+        m_cborCodec.clear();
+        m_encodingSwitchPending = false;
+        m_pendingMessages.clear();
+        // Whatever else was in flight on the previous transport is lost, but what's still queued can go out on
+        // this one once the handshake is done
+        dropInFlight();
+        emit sendQueueChanged();
 
         // Load token for this host
         QSettings settings;
@@ -545,6 +941,48 @@ void JsonRpcClient::onInterfaceConnectedChanged(bool connected)
     }
 }
 
+void JsonRpcClient::checkTimeouts()
+{
+    QList<JsonRpcReply*> expired;
+    foreach (JsonRpcReply *reply, m_replies) {
+        // Requests waiting in the queue can't be late yet
+        if (reply->timeout() > 0 && reply->isSent() && reply->elapsed() >= reply->timeout()) {
+            expired.append(reply);
+        }
+    }
+
+    foreach (JsonRpcReply *reply, expired) {
+        // A callback might have cancelled it in the meantime
+        if (m_replies.value(reply->commandId()) != reply) {
+            continue;
+        }
+        QString method = reply->nameSpace() + '.' + reply->method();
+        qCWarning(dcJsonRpc()) << "Request" << reply->commandId() << method << "timed out after" << reply->elapsed() << "ms";
+        m_diagnostics->addTimeout(method);
+        removeReply(reply);
+
+        QVariantMap params;
+        params.insert("error", "lost");
+        QList<JsonRpcReply*> replies = m_superseded.take(reply->commandId());
+        replies.prepend(reply);
+        foreach (JsonRpcReply *timedOut, replies) {
+            if (!timedOut->caller().isNull() && !timedOut->callback().isEmpty()) {
+                QMetaObject::invokeMethod(timedOut->caller(), timedOut->callback().toLatin1().data(), Q_ARG(int, timedOut->commandId()), Q_ARG(QVariantMap, params));
+            }
+            emit responseReceived(timedOut->commandId(), params);
+            timedOut->deleteLater();
+        }
+    }
+
+    if (!expired.isEmpty()) {
+        sendQueued();
+        emit sendQueueChanged();
+    }
+    if (m_replies.isEmpty()) {
+        m_timeoutTimer.stop();
+    }
+}
+
 void JsonRpcClient::dataReceived(const QByteArray &data)
 {
     if (!m_connection->connected()) {
@@ -553,29 +991,48 @@ void JsonRpcClient::dataReceived(const QByteArray &data)
         return;
     }
     //    qDebug() << "JsonRpcClient: received data:" << qUtf8Printable(data);
-    m_receiveBuffer.append(data);
-
-    int splitIndex = m_receiveBuffer.indexOf("}\n{") + 1;
-    if (splitIndex <= 0) {
-        splitIndex = m_receiveBuffer.length();
-    }
-    QJsonParseError error;
-    QJsonDocument jsonDoc = QJsonDocument::fromJson(m_receiveBuffer.left(splitIndex), &error);
-    if (error.error != QJsonParseError::NoError) {
-        //        qWarning() << "Could not parse json data from nymea" << m_receiveBuffer.left(splitIndex) << error.errorString();
-        return;
+    m_framer.append(data);
+
+    // Process everything that is complete right away. A handler might cause a disconnect,
+    // in which case the framer has been cleared and remaining frames are dropped.
+    // Frames are taken one by one as the encoding may change in between two messages.
+    while (m_connection->connected()) {
+        QByteArray frame = m_framer.takeFrame();
+        if (frame.isNull()) {
+            break;
+        }
+        processMessage(frame);
     }
-    //    qDebug() << "received response" << qUtf8Printable(jsonDoc.toJson(QJsonDocument::Indented));
-    m_receiveBuffer = m_receiveBuffer.right(m_receiveBuffer.length() - splitIndex - 1);
-    if (!m_receiveBuffer.isEmpty()) {
-        staticMetaObject.invokeMethod(this, "dataReceived", Qt::QueuedConnection, Q_ARG(QByteArray, QByteArray()));
+
+    if (m_framer.broken()) {
+        qCWarning(dcJsonRpc()) << "Received data can't be split into messages any more. Dropping the connection.";
+        m_connection->disconnectFromHost();
     }
+}
 
-    QVariantMap dataMap = jsonDoc.toVariant().toMap();
+void JsonRpcClient::processMessage(const QByteArray &message)
+{
+    QVariantMap dataMap;
+    if (m_framer.encoding() == JsonRpcFramer::EncodingCbor) {
+        bool ok;
+        dataMap = m_cborCodec.decode(message, &ok);
+        if (!ok) {
+            return;
+        }
+    } else {
+        QJsonParseError error;
+        QJsonDocument jsonDoc = QJsonDocument::fromJson(message, &error);
+        if (error.error != QJsonParseError::NoError) {
+            qCWarning(dcJsonRpc()) << "Could not parse json data from nymea:" << error.errorString() << "at offset" << error.offset;
+            return;
+        }
+        //    qDebug() << "received response" << qUtf8Printable(jsonDoc.toJson(QJsonDocument::Indented));
+        dataMap = jsonDoc.toVariant().toMap();
+    }
 
     // check if this is a notification
     if (dataMap.contains("notification")) {
-        qCDebug(dcJsonRpc()) << "Incoming notification:" << qUtf8Printable(jsonDoc.toJson());
+        qCDebug(dcJsonRpc()) << "Incoming notification:" << qUtf8Printable(QJsonDocument::fromVariant(dataMap).toJson());
         // Check if our permissions changed
         if (dataMap.value("notification").toString() == "Users.UserChanged") {
             QVariantMap userMap = dataMap.value("params").toMap().value("userInfo").toMap();
@@ -598,6 +1055,15 @@ void JsonRpcClient::dataReceived(const QByteArray &data)
     JsonRpcReply *reply = m_replies.take(commandId);
     if (reply) {
         reply->deleteLater();
+        if (m_connection->currentConnection()) {
+            m_connection->currentConnection()->addRoundTripTime(static_cast<int>(reply->elapsed()));
+        }
+        m_diagnostics->addReply(reply->nameSpace() + '.' + reply->method(), static_cast<int>(reply->elapsed()), message.size());
+        if (m_inFlight.remove(commandId) > 0) {
+            updateUpgradeHold();
+            sendQueued();
+            emit sendQueueChanged();
+        }
 //        qWarning() << QString("JsonRpc: got response for %1.%2: %3").arg(reply->nameSpace(), reply->method(), QString::fromUtf8(jsonDoc.toJson(QJsonDocument::Indented))) << reply->callback() << reply->callback();
 
         if (dataMap.value("status").toString() == "unauthorized") {
@@ -632,6 +1098,14 @@ void JsonRpcClient::dataReceived(const QByteArray &data)
 
         emit responseReceived(reply->commandId(), dataMap.value("params").toMap());
 
+        foreach (JsonRpcReply *superseded, m_superseded.take(commandId)) {
+            if (!superseded->caller().isNull() && !superseded->callback().isEmpty()) {
+                QMetaObject::invokeMethod(superseded->caller(), superseded->callback().toLatin1().data(), Q_ARG(int, superseded->commandId()), Q_ARG(QVariantMap, dataMap.value("params").toMap()));
+            }
+            emit responseReceived(superseded->commandId(), dataMap.value("params").toMap());
+            superseded->deleteLater();
+        }
+
 
         // If the server supports cache hashes, cache stuff locally
         QString fullMethod = reply->nameSpace() + '.' + reply->method();
@@ -652,6 +1126,10 @@ void JsonRpcClient::dataReceived(const QByteArray &data)
 
 void JsonRpcClient::helloReply(int /*commandId*/, const QVariantMap &params)
 {
+    if (isLost(params)) {
+        // The handshake is redone on the next transport
+        return;
+    }
     m_initialSetupRequired = params.value("initialSetupRequired").toBool();
     m_authenticationRequired = params.value("authenticationRequired").toBool();
     m_pushButtonAuthAvailable = params.value("pushButtonAuthAvailable").toBool();
@@ -742,6 +1220,20 @@ void JsonRpcClient::helloReply(int /*commandId*/, const QVariantMap &params)
     }
 //    qDebug() << "Caches:" << m_cacheHashes;
 
+    // Servers supporting a more compact wire encoding announce it in the hello reply. Older ones won't, in which
+    // case we just stay with JSON. Everything we send until the server confirmed the switch is held back.
+    if (params.value("encodings").toStringList().contains("cbor") && m_framer.encoding() == JsonRpcFramer::EncodingJson && !m_encodingSwitchPending) {
+        qCInfo(dcJsonRpc()) << "Server supports CBOR encoding. Switching encoding.";
+        QVariantMap encodingParams;
+        encodingParams.insert("encoding", "cbor");
+        JsonRpcReply *reply = createReply("JSONRPC.SetEncoding", encodingParams, this, "setEncodingReply");
+        m_replies.insert(reply->commandId(), reply);
+        QVariantMap request = reply->requestMap();
+        request.insert("token", m_token);
+        sendMessage(request);
+        m_encodingSwitchPending = true;
+    }
+
     if (m_jsonRpcVersion.majorVersion() >= 6 && m_authenticationRequired) {
         if (!params.value("authenticated").toBool()) {
             qCWarning(dcJsonRpc) << "Seems our token is not valid!";
@@ -789,6 +1281,7 @@ void JsonRpcClient::helloReply(int /*commandId*/, const QVariantMap &params)
     }
 
     setNotificationsEnabled();
+    openSendQueue();
 }
 
 JsonRpcReply::JsonRpcReply(int commandId, QString nameSpace, QString method, QVariantMap params, QPointer<QObject> caller, const QString &callback):
@@ -799,6 +1292,7 @@ JsonRpcReply::JsonRpcReply(int commandId, QString nameSpace, QString method, QVa
     m_caller(caller),
     m_callback(callback)
 {
+    m_timer.start();
 }
 
 JsonRpcReply::~JsonRpcReply()
@@ -836,6 +1330,48 @@ QVariantMap JsonRpcReply::requestMap()
     return request;
 }
 
+QString JsonRpcReply::replaceKey() const
+{
+    return m_replaceKey;
+}
+
+void JsonRpcReply::setReplaceKey(const QString &replaceKey)
+{
+    m_replaceKey = replaceKey;
+}
+
+int JsonRpcReply::timeout() const
+{
+    return m_timeout;
+}
+
+void JsonRpcReply::setTimeout(int timeout)
+{
+    m_timeout = timeout;
+}
+
+qint64 JsonRpcReply::setSent()
+{
+    m_sentAt = m_timer.elapsed();
+    return m_sentAt;
+}
+
+bool JsonRpcReply::isSent() const
+{
+    return m_sentAt >= 0;
+}
+
+void JsonRpcReply::setQueued()
+{
+    m_timer.start();
+    m_sentAt = -1;
+}
+
+qint64 JsonRpcReply::elapsed() const
+{
+    return m_timer.elapsed() - qMax(Q_INT64_C(0), m_sentAt);
+}
+
 QPointer<QObject> JsonRpcReply::caller() const
 {
     return m_caller;
@@ -35,9 +35,14 @@
 #include <QVariantMap>
 #include <QPointer>
 #include <QVersionNumber>
+#include <QElapsedTimer>
+#include <QTimer>
 
 #include "connection/nymeaconnection.h"
+#include "jsonrpc/jsonrpcframer.h"
+#include "jsonrpc/jsonrpccborcodec.h"
 #include "types/userinfo.h"
+#include "jsonrpc/jsonrpcdiagnostics.h"
 
 class JsonRpcReply;
 class Param;
@@ -64,15 +69,41 @@ class JsonRpcClient : public QObject
     Q_PROPERTY(QVariantMap certificateIssuerInfo READ certificateIssuerInfo NOTIFY currentConnectionChanged)
     Q_PROPERTY(QVariantMap experiences READ experiences NOTIFY currentConnectionChanged)
     Q_PROPERTY(UserInfo::PermissionScopes permissions READ permissions NOTIFY permissionsChanged)
+    Q_PROPERTY(int sendWindow READ sendWindow WRITE setSendWindow NOTIFY sendWindowChanged)
+    Q_PROPERTY(int queueDepth READ queueDepth NOTIFY sendQueueChanged)
+    Q_PROPERTY(int inFlightCount READ inFlightCount NOTIFY sendQueueChanged)
+    Q_PROPERTY(int queueTime READ queueTime NOTIFY sendQueueChanged)
+    Q_PROPERTY(JsonRpcDiagnostics* diagnostics READ diagnostics CONSTANT)
 
 public:
+    // Requests are sent in this order. Within the same priority, they're sent in the order they were issued.
+    enum Priority {
+        PriorityInteractive, // Actions the user is waiting for
+        PriorityDefault, // Fetching what the UI shows
+        PriorityBackground // Bulk log and energy fetches
+    };
+    Q_ENUM(Priority)
+
     explicit JsonRpcClient(QObject *parent = nullptr);
 
     void registerNotificationHandler(QObject *handler, const QString &nameSpace, const QString &method);
     void unregisterNotificationHandler(QObject *handler);
 
-    int sendCommand(const QString &method, const QVariantMap &params, QObject *caller = nullptr, const QString &callbackMethod = QString());
+    // Deadline for bulk fetches which are fine to give up on and retry later, like log pages
+    static const int fetchTimeout = 30000;
+    // Deadline for read-only requests which don't set one themselves
+    static const int readTimeout = 60000;
+
+    // If there's no reply within timeout ms after sending the request, or the connection goes away before
+    // the reply arrives, the callback is called with {"error": "lost"} as params. Callbacks check isLost()
+    // and keep what they have. A timeout of 0 waits forever for writes and readTimeout for reads.
+    int sendCommand(const QString &method, const QVariantMap &params, QObject *caller = nullptr, const QString &callbackMethod = QString(), int timeout = 0);
     int sendCommand(const QString &method, QObject *caller = nullptr, const QString &callbackMethod = QString());
+    static bool isLost(const QVariantMap &params);
+    // Like sendCommand(), but if a request with the same replaceKey is still waiting in the send queue, this one
+    // takes its place and its caller gets the reply of this one. Only for requests which make any earlier one
+    // with the same key obsolete, like setting the absolute value of a state while dragging a slider.
+    int sendReplaceableCommand(const QString &method, const QVariantMap &params, const QString &replaceKey, QObject *caller = nullptr, const QString &callbackMethod = QString());
 
     NymeaConnection::BearerTypes availableBearerTypes() const;
     NymeaConnection::ConnectionStatus connectionStatus() const;
@@ -97,6 +128,20 @@ public:
     QString serverQtBuildVersion();
     QVariantMap experiences() const;
 
+    // Maximum number of requests sent but not replied yet. Everything else waits in the send queue.
+    int sendWindow() const;
+    void setSendWindow(int sendWindow);
+    // Requests waiting to be sent
+    int queueDepth() const;
+    int inFlightCount() const;
+    // Smoothed time in ms requests waited in the send queue, -1 if none has been sent yet
+    int queueTime() const;
+
+    JsonRpcDiagnostics *diagnostics() const;
+
+    // The callback won't be called for this request. If it hasn't been sent yet, it won't be sent at all.
+    Q_INVOKABLE void cancel(int commandId);
+
     // ui methods
     Q_INVOKABLE void connectToHost(NymeaHost *host, Connection *connection = nullptr);
     Q_INVOKABLE void disconnectFromHost();
@@ -135,6 +180,10 @@ signals:
     void serverQtVersionChanged();
     void serverNameChanged();
     void permissionsChanged();
+    void sendWindowChanged();
+    void sendQueueChanged();
+    // The handshake on a new transport is done. Notifications sent while switching over went nowhere.
+    void transportSwitched();
 
     void responseReceived(const int &commandId, const QVariantMap &response);
 
@@ -143,6 +192,7 @@ private slots:
     void dataReceived(const QByteArray &data);
 
     void helloReply(int commandId, const QVariantMap &params);
+    void checkTimeouts();
 
 private:
     int m_id;
@@ -153,8 +203,40 @@ private:
     NymeaConnection *m_connection = nullptr;
 
     JsonRpcReply *createReply(const QString &method, const QVariantMap &params, QObject *caller, const QString &callback);
+    int send(JsonRpcReply *reply);
+
+    void enqueue(JsonRpcReply *reply);
+    // Starts sending the queue once the session on the current transport is set up
+    void openSendQueue();
+    void sendQueued();
+    void dropQueued();
+    void dropInFlight();
+    // Calls back a request and everyone waiting on it with {"error": "lost"} and deletes them
+    void notifyLost(JsonRpcReply *reply);
+    // Read-only requests which were on the way go out again on the new transport
+    void requeueInFlight();
+    // Holds off switching transports while requests are on the way which can't be sent again
+    void updateUpgradeHold();
+    void removeReply(JsonRpcReply *reply);
+    int inFlightCount(Priority priority) const;
+    static Priority priorityForMethod(const QString &method);
+    static bool isReadOnly(const QString &method);
+
+    QMap<Priority, QList<JsonRpcReply*>> m_sendQueue;
+    // Priorities of the requests sent through the queue, by command id
+    QHash<int, Priority> m_inFlight;
+    // Requests which have been replaced before they were sent, by the command id replacing them.
+    // They get the reply of the request which replaced them.
+    QHash<int, QList<JsonRpcReply*>> m_superseded;
+    bool m_sendQueueOpen = false;
+    int m_sendWindow = 8;
+    int m_queueTime = -1;
+
+    QTimer m_timeoutTimer;
+    JsonRpcDiagnostics *m_diagnostics = nullptr;
 
     bool m_connected = false;
+    bool m_transportSwitched = false;
     bool m_initialSetupRequired = false;
     bool m_authenticationRequired = false;
     bool m_pushButtonAuthAvailable = false;
@@ -165,7 +247,11 @@ private:
     QString m_serverQtVersion;
     QString m_serverQtBuildVersion;
     QByteArray m_token;
-    QByteArray m_receiveBuffer;
+    JsonRpcFramer m_framer;
+    JsonRpcCborCodec m_cborCodec;
+    // While switching the encoding, outgoing messages are held back until the server confirmed the switch
+    bool m_encodingSwitchPending = false;
+    QList<QVariantMap> m_pendingMessages;
     QHash<QString, QString> m_cacheHashes;
     QVariantMap m_experiences;
     UserInfo::PermissionScopes m_permissionScopes = UserInfo::PermissionScopeNone;
@@ -181,8 +267,11 @@ private:
     Q_INVOKABLE void setNotificationsEnabledResponse(int commandId, const QVariantMap &params);
     Q_INVOKABLE void notificationReceived(const QVariantMap &data);
     Q_INVOKABLE void getVersionsReply(int commandId, const QVariantMap &data);
+    Q_INVOKABLE void setEncodingReply(int commandId, const QVariantMap &data);
 
     void sendRequest(const QVariantMap &request);
+    void sendMessage(const QVariantMap &message);
+    void processMessage(const QByteArray &message);
 
     bool loadPem(const QUuid &serverUud, QByteArray &pem);
     bool storePem(const QUuid &serverUuid, const QByteArray &pem);
@@ -206,6 +295,22 @@ public:
     QPointer<QObject> caller() const;
     QString callback() const;
 
+    // Queued requests with the same key are replaced by the latest one. Empty if the request can't be replaced.
+    QString replaceKey() const;
+    void setReplaceKey(const QString &replaceKey);
+
+    // 0 if there is no deadline
+    int timeout() const;
+    void setTimeout(int timeout);
+
+    // Called when the request goes out. Returns the time in ms since the request has been created.
+    qint64 setSent();
+    bool isSent() const;
+    // Puts a request which has been sent back to the state before, to send it again
+    void setQueued();
+    // Milliseconds since the request has been sent
+    qint64 elapsed() const;
+
 private:
     int m_commandId;
     QString m_nameSpace;
@@ -214,6 +319,11 @@ private:
 
     QPointer<QObject> m_caller;
     QString m_callback;
+
+    QString m_replaceKey;
+    int m_timeout = 0;
+    QElapsedTimer m_timer;
+    qint64 m_sentAt = -1;
 };
 
 
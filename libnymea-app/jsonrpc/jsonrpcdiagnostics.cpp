@@ -0,0 +1,143 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU General Public License as published by the Free Software
+* Foundation, GNU version 3. This project is distributed in the hope that it
+* will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+* Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "jsonrpcdiagnostics.h"
+
+JsonRpcDiagnostics::JsonRpcDiagnostics(QObject *parent)
+    : QAbstractListModel{parent}
+{
+
+}
+
+int JsonRpcDiagnostics::rowCount(const QModelIndex &parent) const
+{
+    Q_UNUSED(parent)
+    return m_stats.count();
+}
+
+QVariant JsonRpcDiagnostics::data(const QModelIndex &index, int role) const
+{
+    const MethodStats &stats = m_stats.at(index.row());
+    switch (role) {
+    case RoleMethod:
+        return stats.method;
+    case RoleRequests:
+        return stats.requests;
+    case RoleTimeouts:
+        return stats.timeouts;
+    case RoleCancellations:
+        return stats.cancellations;
+    case RoleLatencyP50:
+        return stats.latencies.percentile(0.5);
+    case RoleLatencyP95:
+        return stats.latencies.percentile(0.95);
+    case RoleLatencyP99:
+        return stats.latencies.percentile(0.99);
+    case RoleBytesIn:
+        return stats.bytesIn;
+    case RoleBytesOut:
+        return stats.bytesOut;
+    }
+    return QVariant();
+}
+
+QHash<int, QByteArray> JsonRpcDiagnostics::roleNames() const
+{
+    QHash<int, QByteArray> roles;
+    roles.insert(RoleMethod, "method");
+    roles.insert(RoleRequests, "requests");
+    roles.insert(RoleTimeouts, "timeouts");
+    roles.insert(RoleCancellations, "cancellations");
+    roles.insert(RoleLatencyP50, "latencyP50");
+    roles.insert(RoleLatencyP95, "latencyP95");
+    roles.insert(RoleLatencyP99, "latencyP99");
+    roles.insert(RoleBytesIn, "bytesIn");
+    roles.insert(RoleBytesOut, "bytesOut");
+    return roles;
+}
+
+void JsonRpcDiagnostics::addRequest(const QString &method, int bytes)
+{
+    MethodStats &methodStats = stats(method);
+    methodStats.requests++;
+    methodStats.bytesOut += bytes;
+    notifyChanged(method);
+}
+
+void JsonRpcDiagnostics::addReply(const QString &method, int latency, int bytes)
+{
+    MethodStats &methodStats = stats(method);
+    methodStats.latencies.add(latency);
+    methodStats.bytesIn += bytes;
+    notifyChanged(method);
+}
+
+void JsonRpcDiagnostics::addTimeout(const QString &method)
+{
+    stats(method).timeouts++;
+    notifyChanged(method);
+}
+
+void JsonRpcDiagnostics::addCancellation(const QString &method)
+{
+    stats(method).cancellations++;
+    notifyChanged(method);
+}
+
+void JsonRpcDiagnostics::clear()
+{
+    beginResetModel();
+    m_stats.clear();
+    m_indexes.clear();
+    endResetModel();
+    emit countChanged();
+}
+
+JsonRpcDiagnostics::MethodStats &JsonRpcDiagnostics::stats(const QString &method)
+{
+    int index = m_indexes.value(method, -1);
+    if (index < 0) {
+        index = m_stats.count();
+        beginInsertRows(QModelIndex(), index, index);
+        MethodStats methodStats;
+        methodStats.method = method;
+        m_stats.append(methodStats);
+        m_indexes.insert(method, index);
+        endInsertRows();
+        emit countChanged();
+    }
+    return m_stats[index];
+}
+
+void JsonRpcDiagnostics::notifyChanged(const QString &method)
+{
+    QModelIndex modelIndex = index(m_indexes.value(method));
+    emit dataChanged(modelIndex, modelIndex);
+}
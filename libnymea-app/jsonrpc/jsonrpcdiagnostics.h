@@ -0,0 +1,95 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU General Public License as published by the Free Software
+* Foundation, GNU version 3. This project is distributed in the hope that it
+* will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+* Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef JSONRPCDIAGNOSTICS_H
+#define JSONRPCDIAGNOSTICS_H
+
+#include <QAbstractListModel>
+#include <QHash>
+
+#include "connection/latencyhistogram.h"
+
+// Per method statistics about the requests sent by the JsonRpcClient, one row per method.
+// Kept for the lifetime of the client, so slow calls can be spotted on the device.
+class JsonRpcDiagnostics : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(int count READ rowCount NOTIFY countChanged)
+public:
+    enum Roles {
+        RoleMethod,
+        RoleRequests,
+        RoleTimeouts,
+        RoleCancellations,
+        RoleLatencyP50,
+        RoleLatencyP95,
+        RoleLatencyP99,
+        RoleBytesIn,
+        RoleBytesOut
+    };
+    Q_ENUM(Roles)
+
+    explicit JsonRpcDiagnostics(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    void addRequest(const QString &method, int bytes);
+    void addReply(const QString &method, int latency, int bytes);
+    void addTimeout(const QString &method);
+    void addCancellation(const QString &method);
+
+    Q_INVOKABLE void clear();
+
+signals:
+    void countChanged();
+
+protected:
+    QHash<int, QByteArray> roleNames() const override;
+
+private:
+    struct MethodStats {
+        QString method;
+        int requests = 0;
+        int timeouts = 0;
+        int cancellations = 0;
+        qint64 bytesIn = 0;
+        qint64 bytesOut = 0;
+        LatencyHistogram latencies;
+    };
+
+    MethodStats &stats(const QString &method);
+    void notifyChanged(const QString &method);
+
+    QList<MethodStats> m_stats;
+    QHash<QString, int> m_indexes;
+};
+
+#endif // JSONRPCDIAGNOSTICS_H
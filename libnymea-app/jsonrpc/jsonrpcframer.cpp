@@ -0,0 +1,222 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU General Public License as published by the Free Software
+* Foundation, GNU version 3. This project is distributed in the hope that it
+* will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+* Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "jsonrpcframer.h"
+
+#include <QtEndian>
+
+#include "logging.h"
+Q_DECLARE_LOGGING_CATEGORY(dcJsonRpc)
+
+JsonRpcFramer::JsonRpcFramer()
+{
+}
+
+JsonRpcFramer::Encoding JsonRpcFramer::encoding() const
+{
+    return m_encoding;
+}
+
+void JsonRpcFramer::setEncoding(Encoding encoding)
+{
+    reportSkippedBytes();
+    m_encoding = encoding;
+    resetScanState();
+}
+
+void JsonRpcFramer::append(const QByteArray &data)
+{
+    if (m_broken) {
+        return;
+    }
+    // Drop what has been taken already before growing the buffer
+    if (m_readPosition > 0) {
+        m_buffer.remove(0, m_readPosition);
+        m_scanPosition -= m_readPosition;
+        if (m_frameStart >= 0) {
+            m_frameStart -= m_readPosition;
+        }
+        m_readPosition = 0;
+    }
+    m_buffer.append(data);
+}
+
+void JsonRpcFramer::clear()
+{
+    reportSkippedBytes();
+    m_encoding = EncodingJson;
+    m_buffer.clear();
+    m_readPosition = 0;
+    m_skipLineBreak = false;
+    m_broken = false;
+    resetScanState();
+}
+
+QByteArray JsonRpcFramer::takeFrame()
+{
+    if (m_encoding == EncodingCbor) {
+        return takeCborFrame();
+    }
+    return takeJsonFrame();
+}
+
+int JsonRpcFramer::bufferedBytes() const
+{
+    return m_buffer.length() - m_readPosition;
+}
+
+bool JsonRpcFramer::broken() const
+{
+    return m_broken;
+}
+
+QByteArray JsonRpcFramer::takeJsonFrame()
+{
+    const char *raw = m_buffer.constData();
+    const int length = m_buffer.length();
+
+    for (int i = m_scanPosition; i < length; i++) {
+        const char c = raw[i];
+
+        if (m_inString) {
+            if (m_escaped) {
+                m_escaped = false;
+            } else if (c == '\\') {
+                m_escaped = true;
+            } else if (c == '"') {
+                m_inString = false;
+            }
+            continue;
+        }
+
+        if (m_depth == 0) {
+            if (c == '{') {
+                reportSkippedBytes();
+                m_frameStart = i;
+                m_depth = 1;
+                m_skipLineBreak = false;
+            } else if (c != '\n' && c != '\r' && c != ' ' && c != '\t') {
+                m_skippedBytes++;
+            }
+            if (m_frameStart < 0) {
+                m_readPosition = i + 1;
+            }
+            continue;
+        }
+
+        switch (c) {
+        case '"':
+            m_inString = true;
+            break;
+        case '{':
+        case '[':
+            m_depth++;
+            break;
+        case '}':
+        case ']':
+            m_depth--;
+            if (m_depth == 0) {
+                QByteArray frame = m_buffer.mid(m_frameStart, i - m_frameStart + 1);
+                m_frameStart = -1;
+                m_scanPosition = i + 1;
+                m_readPosition = i + 1;
+                m_skipLineBreak = true;
+                return frame;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    // No complete frame yet. Continue where we left off once more data arrives.
+    m_scanPosition = length;
+    return QByteArray();
+}
+
+QByteArray JsonRpcFramer::takeCborFrame()
+{
+    // nymea terminates JSON messages with a line break. If the encoding has been switched right after a JSON
+    // message, that line break ends up in front of the first CBOR frame.
+    while (m_skipLineBreak && m_readPosition < m_buffer.length()) {
+        const char c = m_buffer.at(m_readPosition);
+        if (c == '\r') {
+            m_readPosition++;
+        } else if (c == '\n') {
+            m_readPosition++;
+            m_skipLineBreak = false;
+        } else {
+            m_skipLineBreak = false;
+        }
+    }
+
+    const int available = m_buffer.length() - m_readPosition;
+    if (available < 4) {
+        return QByteArray();
+    }
+    const quint32 frameLength = qFromBigEndian<quint32>(reinterpret_cast<const uchar*>(m_buffer.constData() + m_readPosition));
+    if (frameLength > MaxCborFrameSize) {
+        qCWarning(dcJsonRpc()) << "Rejecting CBOR frame of" << frameLength << "bytes. Maximum is" << MaxCborFrameSize;
+        m_broken = true;
+        m_buffer.clear();
+        m_readPosition = 0;
+        resetScanState();
+        return QByteArray();
+    }
+    if (static_cast<quint32>(available - 4) < frameLength) {
+        return QByteArray();
+    }
+    QByteArray frame = m_buffer.mid(m_readPosition + 4, static_cast<int>(frameLength));
+    m_readPosition += 4 + static_cast<int>(frameLength);
+    m_scanPosition = m_readPosition;
+    if (frame.isEmpty()) {
+        // Skip empty frames instead of signalling "nothing available"
+        return takeCborFrame();
+    }
+    return frame;
+}
+
+void JsonRpcFramer::reportSkippedBytes()
+{
+    // Once per run of garbage, not per byte
+    if (m_skippedBytes > 0) {
+        qCWarning(dcJsonRpc()) << "Discarded" << m_skippedBytes << "bytes of unexpected data between JSON frames";
+        m_skippedBytes = 0;
+    }
+}
+
+void JsonRpcFramer::resetScanState()
+{
+    m_scanPosition = m_readPosition;
+    m_frameStart = -1;
+    m_depth = 0;
+    m_inString = false;
+    m_escaped = false;
+}
@@ -0,0 +1,92 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU General Public License as published by the Free Software
+* Foundation, GNU version 3. This project is distributed in the hope that it
+* will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+* Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef JSONRPCFRAMER_H
+#define JSONRPCFRAMER_H
+
+#include <QByteArray>
+
+// Splits the incoming byte stream into individual messages.
+// In JSON mode the stream consists of concatenated JSON objects. The scan position and nesting state are kept
+// across calls so that every received byte is only looked at once, regardless of how many chunks a large message
+// arrives in. In CBOR mode each message is prefixed with its length as 32 bit big endian integer.
+// Frames are only cut when they are taken, so the encoding can be switched in between two messages. The line break
+// terminating the last JSON message is dropped even if it only arrives after the switch.
+class JsonRpcFramer
+{
+public:
+    enum Encoding {
+        EncodingJson,
+        EncodingCbor
+    };
+
+    // Far more than the largest reply, GetThingClasses on a big setup is a few MB. A length prefix above
+    // this means the stream is corrupt and would otherwise make us buffer up to 4 GB.
+    static const quint32 MaxCborFrameSize = 64 * 1024 * 1024;
+
+    JsonRpcFramer();
+
+    Encoding encoding() const;
+    void setEncoding(Encoding encoding);
+
+    void append(const QByteArray &data);
+    void clear();
+
+    // Returns a null QByteArray if there is no complete frame in the buffer
+    QByteArray takeFrame();
+
+    int bufferedBytes() const;
+
+    // Set when a CBOR frame exceeded MaxCborFrameSize. The stream can't be split any more and all data is
+    // dropped until clear() is called.
+    bool broken() const;
+
+private:
+    QByteArray takeJsonFrame();
+    QByteArray takeCborFrame();
+    void reportSkippedBytes();
+    void resetScanState();
+
+    Encoding m_encoding = EncodingJson;
+    QByteArray m_buffer;
+    int m_readPosition = 0;
+
+    int m_scanPosition = 0;
+    int m_frameStart = -1;
+    int m_depth = 0;
+    bool m_inString = false;
+    bool m_escaped = false;
+    bool m_skipLineBreak = false;
+    bool m_broken = false;
+    // Unexpected bytes between JSON frames since the last frame started
+    int m_skippedBytes = 0;
+};
+
+#endif // JSONRPCFRAMER_H
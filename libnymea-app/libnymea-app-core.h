@@ -69,6 +69,8 @@
 #include "models/xyseriesadapter.h"
 #include "models/boolseriesadapter.h"
 #include "models/newlogsmodel.h"
+#include "models/sampledlogs.h"
+#include "models/sampledseriesadapter.h"
 #include "models/interfacesproxy.h"
 #include "configuration/nymeaconfiguration.h"
 #include "configuration/serverconfiguration.h"
@@ -180,6 +182,7 @@ void registerQmlTypes() {
 
     qmlRegisterUncreatableType<ThingManager>(uri, 1, 0, "ThingManager", "Can't create this in QML. Get it from the Engine.");
     qmlRegisterUncreatableType<JsonRpcClient>(uri, 1, 0, "JsonRpcClient", "Can't create this in QML. Get it from the Engine.");
+    qmlRegisterUncreatableType<JsonRpcDiagnostics>(uri, 1, 0, "JsonRpcDiagnostics", "Can't create this in QML. Get it from the JsonRpcClient.");
     qmlRegisterUncreatableType<NymeaConnection>(uri, 1, 0, "NymeaConnection", "Can't create this in QML. Get it from the Engine.");
 
     // libnymea-common
@@ -281,6 +284,8 @@ void registerQmlTypes() {
 
     qmlRegisterType<NewLogsModel>(uri, 1, 0, "NewLogsModel");
     qmlRegisterUncreatableType<NewLogEntry>(uri, 1, 0, "NewLogEntry", "Get them from NewLogsModel");
+    qmlRegisterType<SampledLogs>(uri, 1, 0, "SampledLogs");
+    qmlRegisterType<SampledSeriesAdapter>(uri, 1, 0, "SampledSeriesAdapter");
 
     qmlRegisterUncreatableType<TagsManager>(uri, 1, 0, "TagsManager", "Get it from Engine");
     qmlRegisterUncreatableType<Tags>(uri, 1, 0, "Tags", "Get it from TagsManager");
@@ -23,13 +23,20 @@ SOURCES += \
     $$PWD/appdata.cpp \
     $$PWD/connection/networkreachabilitymonitor.cpp \
     $$PWD/energy/energylogs.cpp \
+    $$PWD/energy/energylogsdiskcache.cpp \
+    $$PWD/energy/energylogspyramid.cpp \
+    $$PWD/energy/energylogsrouter.cpp \
+    $$PWD/energy/energylogstore.cpp \
     $$PWD/energy/energymanager.cpp \
     $$PWD/energy/powerbalancelogs.cpp \
     $$PWD/energy/thingpowerlogs.cpp \
     $$PWD/connection/tunnelproxytransport.cpp \
     $$PWD/models/boolseriesadapter.cpp \
+    $$PWD/models/logentrystore.cpp \
     $$PWD/models/newlogentry.cpp \
     $$PWD/models/newlogsmodel.cpp \
+    $$PWD/models/sampledlogs.cpp \
+    $$PWD/models/sampledseriesadapter.cpp \
     $$PWD/models/scriptsproxymodel.cpp \
     $$PWD/pluginconfigmanager.cpp \
     $$PWD/tagwatcher.cpp \
@@ -53,6 +60,8 @@ SOURCES += \
     $${PWD}/models/barseriesadapter.cpp \
     $${PWD}/models/sortfilterproxymodel.cpp \
     $${PWD}/models/xyseriesadapter.cpp \
+    $${PWD}/models/rangeaggregate.cpp \
+    $${PWD}/models/seriesdecimator.cpp \
     $${PWD}/ruletemplates/calendaritemtemplate.cpp \
     $${PWD}/ruletemplates/timedescriptortemplate.cpp \
     $${PWD}/ruletemplates/timeeventitemtemplate.cpp \
@@ -103,6 +112,7 @@ SOURCES += \
     $${PWD}/types/paramdescriptor.cpp \
     $${PWD}/types/paramdescriptors.cpp \
     $${PWD}/types/interface.cpp \
+    $${PWD}/types/interfacebits.cpp \
     $${PWD}/types/interfaces.cpp \
     $${PWD}/types/timedescriptor.cpp \
     $${PWD}/types/timeeventitem.cpp \
@@ -120,9 +130,12 @@ SOURCES += \
     $${PWD}/types/ioconnection.cpp \
     $${PWD}/types/ioconnections.cpp \
     $${PWD}/types/ioconnectionwatcher.cpp \
+    $${PWD}/connection/connectionstats.cpp \
+    $${PWD}/connection/latencyhistogram.cpp \
     $${PWD}/connection/nymeahost.cpp \
     $${PWD}/connection/nymeahosts.cpp  \
     $${PWD}/connection/nymeaconnection.cpp \
+    $${PWD}/connection/reconnectscheduler.cpp \
     $${PWD}/connection/nymeatransportinterface.cpp \
     $${PWD}/connection/websockettransport.cpp \
     $${PWD}/connection/tcpsockettransport.cpp \
@@ -133,6 +146,9 @@ SOURCES += \
     $${PWD}/connection/discovery/bluetoothservicediscovery.cpp \
     $${PWD}/thingmanager.cpp \
     $${PWD}/jsonrpc/jsonrpcclient.cpp \
+    $${PWD}/jsonrpc/jsonrpcframer.cpp \
+    $${PWD}/jsonrpc/jsonrpccborcodec.cpp \
+    $${PWD}/jsonrpc/jsonrpcdiagnostics.cpp \
     $${PWD}/things.cpp \
     $${PWD}/thingsproxy.cpp \
     $${PWD}/thingclasses.cpp \
@@ -189,13 +205,20 @@ HEADERS += \
     $$PWD/appdata.h \
     $$PWD/connection/networkreachabilitymonitor.h \
     $$PWD/energy/energylogs.h \
+    $$PWD/energy/energylogsdiskcache.h \
+    $$PWD/energy/energylogspyramid.h \
+    $$PWD/energy/energylogsrouter.h \
+    $$PWD/energy/energylogstore.h \
     $$PWD/energy/energymanager.h \
     $$PWD/energy/powerbalancelogs.h \
     $$PWD/energy/thingpowerlogs.h \
     $$PWD/connection/tunnelproxytransport.h \
     $$PWD/models/boolseriesadapter.h \
+    $$PWD/models/logentrystore.h \
     $$PWD/models/newlogentry.h \
     $$PWD/models/newlogsmodel.h \
+    $$PWD/models/sampledlogs.h \
+    $$PWD/models/sampledseriesadapter.h \
     $$PWD/models/scriptsproxymodel.h \
     $$PWD/pluginconfigmanager.h \
     $$PWD/tagwatcher.h \
@@ -219,6 +242,8 @@ HEADERS += \
     $${PWD}/models/barseriesadapter.h \
     $${PWD}/models/sortfilterproxymodel.h \
     $${PWD}/models/xyseriesadapter.h \
+    $${PWD}/models/rangeaggregate.h \
+    $${PWD}/models/seriesdecimator.h \
     $${PWD}/ruletemplates/calendaritemtemplate.h \
     $${PWD}/ruletemplates/timedescriptortemplate.h \
     $${PWD}/ruletemplates/timeeventitemtemplate.h \
@@ -269,6 +294,7 @@ HEADERS += \
     $${PWD}/types/paramdescriptor.h \
     $${PWD}/types/paramdescriptors.h \
     $${PWD}/types/interface.h \
+    $${PWD}/types/interfacebits.h \
     $${PWD}/types/interfaces.h \
     $${PWD}/types/timedescriptor.h \
     $${PWD}/types/timeeventitem.h \
@@ -286,9 +312,12 @@ HEADERS += \
     $${PWD}/types/ioconnection.h \
     $${PWD}/types/ioconnections.h \
     $${PWD}/types/ioconnectionwatcher.h \
+    $${PWD}/connection/connectionstats.h \
+    $${PWD}/connection/latencyhistogram.h \
     $${PWD}/connection/nymeahost.h \
     $${PWD}/connection/nymeahosts.h \
     $${PWD}/connection/nymeaconnection.h \
+    $${PWD}/connection/reconnectscheduler.h \
     $${PWD}/connection/nymeatransportinterface.h \
     $${PWD}/connection/websockettransport.h \
     $${PWD}/connection/tcpsockettransport.h \
@@ -299,6 +328,9 @@ HEADERS += \
     $${PWD}/connection/discovery/bluetoothservicediscovery.h \
     $${PWD}/thingmanager.h \
     $${PWD}/jsonrpc/jsonrpcclient.h \
+    $${PWD}/jsonrpc/jsonrpcframer.h \
+    $${PWD}/jsonrpc/jsonrpccborcodec.h \
+    $${PWD}/jsonrpc/jsonrpcdiagnostics.h \
     $${PWD}/things.h \
     $${PWD}/thingsproxy.h \
     $${PWD}/thingclasses.h \
@@ -209,6 +209,9 @@ void ModbusRtuManager::notificationReceived(const QVariantMap &notification)
 void ModbusRtuManager::getSerialPortsResponse(int commandId, const QVariantMap &params)
 {
     qDebug() << "Get serial ports response" << commandId << params;
+    if (JsonRpcClient::isLost(params)) {
+        return;
+    }
     m_serialPorts->clear();
 
     foreach (const QVariant &serialPortVariant, params.value("serialPorts").toList()) {
@@ -1,9 +1,13 @@
 #include "boolseriesadapter.h"
 
+#include <algorithm>
+
 BoolSeriesAdapter::BoolSeriesAdapter(QObject *parent)
     : QObject{parent}
 {
-
+    m_flushTimer.setSingleShot(true);
+    m_flushTimer.setInterval(16);
+    connect(&m_flushTimer, &QTimer::timeout, this, &BoolSeriesAdapter::flush);
 }
 
 LogsModel *BoolSeriesAdapter::logsModel() const
@@ -14,10 +18,15 @@ LogsModel *BoolSeriesAdapter::logsModel() const
 void BoolSeriesAdapter::setLogsModel(LogsModel *logsModel)
 {
     if (m_model != logsModel) {
+        if (m_model) {
+            disconnect(m_model, &LogsModel::entriesAdded, this, &BoolSeriesAdapter::entriesAdded);
+        }
         m_model = logsModel;
         emit logsModelChanged();
-//        update();
-        connect(logsModel, &LogsModel::logEntryAdded, this, &BoolSeriesAdapter::logEntryAdded);
+        if (m_model) {
+            connect(m_model, &LogsModel::entriesAdded, this, &BoolSeriesAdapter::entriesAdded);
+        }
+        reload();
     }
 
 }
@@ -32,11 +41,7 @@ void BoolSeriesAdapter::setXySeries(QtCharts::QXYSeries *series)
     if (m_series != series) {
         m_series = series;
         emit xySeriesChanged();
-
-        m_series->clear();
-        m_series->append(QDateTime::currentDateTime().addYears(1).toMSecsSinceEpoch(), 0);
-        m_series->append(0, 0);
-        qWarning() << "Initialized series" << m_series->count();
+        scheduleFlush();
     }
 }
 
@@ -50,97 +55,207 @@ void BoolSeriesAdapter::setInverted(bool inverted)
     if (m_inverted != inverted) {
         m_inverted = inverted;
         emit invertedChanged();
+        scheduleFlush();
     }
 }
 
-void BoolSeriesAdapter::logEntryAdded(LogEntry *entry)
+QDateTime BoolSeriesAdapter::windowStart() const
 {
-    if (!m_series) {
-        return;
+    return m_windowStart;
+}
+
+void BoolSeriesAdapter::setWindowStart(const QDateTime &windowStart)
+{
+    if (m_windowStart != windowStart) {
+        m_windowStart = windowStart;
+        emit windowStartChanged();
+        scheduleFlush();
     }
+}
 
-    int idx = findIndex(entry->timestamp().toMSecsSinceEpoch());
-    qreal value = entry->value().toBool() != m_inverted ? 1 : 0;
+QDateTime BoolSeriesAdapter::windowEnd() const
+{
+    return m_windowEnd;
+}
 
-    if (m_series->count() >= 2000) {
-        qCWarning(dcLogEngine()) << "Thing logs too excessively. Discarding entry.";
-        return;
+void BoolSeriesAdapter::setWindowEnd(const QDateTime &windowEnd)
+{
+    if (m_windowEnd != windowEnd) {
+        m_windowEnd = windowEnd;
+        emit windowEndChanged();
+        scheduleFlush();
     }
+}
+
+int BoolSeriesAdapter::plotWidth() const
+{
+    return m_plotWidth;
+}
 
-//    QDebug dbg = qWarning();
-//    dbg << "List before insert:\n";
-//    for (int i = 0; i < m_series->count(); i++) {
-//        dbg << i << QDateTime::fromMSecsSinceEpoch(m_series->at(i).x()) << m_series->at(i).y() << "\n";
-//    }
+void BoolSeriesAdapter::setPlotWidth(int plotWidth)
+{
+    if (m_plotWidth != plotWidth) {
+        m_plotWidth = plotWidth;
+        emit plotWidthChanged();
+        scheduleFlush();
+    }
+}
 
-//    qWarning() << "Inserting" << entry->timestamp() << entry->value() << "real value:" << value << "at" << idx << "total:" << m_series->count();
-    // We're keeping a fake entry at the beginning (timestamp 0) with a static value of 0
-    // and on in the beginning (+1 year from now) for which we'll update the value according to
-    // the newest real entry to continue painting the last value.
+bool BoolSeriesAdapter::exact() const
+{
+    return m_exact;
+}
 
-    // Update the future value if this is the new newest real entry
-    if (idx == 1) {
-        m_series->replace(0, QDateTime::currentDateTime().addYears(1).toMSecsSinceEpoch(), value);
+void BoolSeriesAdapter::setExact(bool exact)
+{
+    if (m_exact != exact) {
+        m_exact = exact;
+        emit exactChanged();
+        scheduleFlush();
     }
-    // If the next older entry is different than this, first insert the other value right before this one
-    if (qFuzzyIsNull(m_series->at(idx).y()) != qFuzzyIsNull(value)) {
-        m_series->insert(idx, QPointF(entry->timestamp().toMSecsSinceEpoch() - 1, !value));
+}
+
+void BoolSeriesAdapter::entriesAdded(int index, int count)
+{
+    const LogEntryStore &store = m_model->store();
+    int column = store.column("value");
+    for (int i = index; i < index + count; i++) {
+        m_pending.append(qMakePair(store.timestampAt(i), store.valueAt(i, column).toBool()));
     }
+    scheduleFlush();
+}
 
-    m_series->insert(idx, QPointF(entry->timestamp().toMSecsSinceEpoch(), value));
+void BoolSeriesAdapter::flush()
+{
+    mergePending();
+    if (!m_series) {
+        return;
+    }
+    if (m_exact || m_plotWidth <= 0) {
+        m_series->replace(exactPoints());
+    } else {
+        m_series->replace(decimatedPoints());
+    }
+}
 
-    // If the next newer entry is differnt than this, also insert this value right before the next one
-    if (qFuzzyIsNull(m_series->at(idx-1).y()) != qFuzzyIsNull(value)) {
-        m_series->insert(idx, QPointF(m_series->at(idx-1).x() - 1, value));
+void BoolSeriesAdapter::reload()
+{
+    m_timestamps.clear();
+    m_states.clear();
+    m_trueCounts.clear();
+    m_pending.clear();
+    if (m_model) {
+        entriesAdded(0, m_model->rowCount());
     }
+    scheduleFlush();
+}
 
-//    qWarning() << "***** series count" << m_series->count();
-//    dbg << "List after insert:\n";
-//    for (int i = 0; i < m_series->count(); i++) {
-//        dbg << i << QDateTime::fromMSecsSinceEpoch(m_series->at(i).x()) << m_series->at(i).y() << "\n";
-//    }
+void BoolSeriesAdapter::scheduleFlush()
+{
+    if (!m_flushTimer.isActive()) {
+        m_flushTimer.start();
+    }
 }
 
-quint64 BoolSeriesAdapter::findIndex(qulonglong timestamp)
+void BoolSeriesAdapter::mergePending()
 {
-    if (m_series->count() == 2) {
-        return 1;
+    if (m_pending.isEmpty()) {
+        return;
     }
 
-    // In 99.9% of the cases we'll be prepending (adding live entries) or appending (fetching history)
-    if (timestamp < m_series->at(m_series->count() - 2).x()) {
-        return m_series->count() - 1;
+    // Live entries are appended and history is prepended, so merge the whole batch in one go
+    // instead of inserting every single entry into the middle of the arrays.
+    std::stable_sort(m_pending.begin(), m_pending.end(), [](const QPair<qint64, bool> &a, const QPair<qint64, bool> &b) {
+        return a.first < b.first;
+    });
+    QVector<qint64> timestamps;
+    QVector<bool> states;
+    timestamps.reserve(m_timestamps.count() + m_pending.count());
+    states.reserve(m_timestamps.count() + m_pending.count());
+    int i = 0, j = 0;
+    while (i < m_timestamps.count() || j < m_pending.count()) {
+        if (j == m_pending.count() || (i < m_timestamps.count() && m_timestamps.at(i) <= m_pending.at(j).first)) {
+            timestamps.append(m_timestamps.at(i));
+            states.append(m_states.at(i));
+            i++;
+        } else {
+            timestamps.append(m_pending.at(j).first);
+            states.append(m_pending.at(j).second);
+            j++;
+        }
     }
-    if (timestamp > m_series->at(1).x()) {
-        return 1;
+    m_timestamps = timestamps;
+    m_states = states;
+    m_pending.clear();
+
+    m_trueCounts.resize(m_states.count() + 1);
+    m_trueCounts[0] = 0;
+    for (int k = 0; k < m_states.count(); k++) {
+        m_trueCounts[k + 1] = m_trueCounts.at(k) + (m_states.at(k) ? 1 : 0);
     }
+}
 
-    // If for any reason a entry in the middle is added (can't think of one but hey), a binary search will probably do.
-    int idx = m_series->count() / 2;
-    int range = idx;
-    int i = 0;
-    while (true) {
-//        qWarning() << "CNT:" << m_series->count()
-//                   << "first:" << QDateTime::fromMSecsSinceEpoch(m_series->at(1).x())
-//                   << "last:" << QDateTime::fromMSecsSinceEpoch(m_series->at(m_series->count()- 2).x())
-//                   << "current:" << idx << QDateTime::fromMSecsSinceEpoch(m_series->at(idx).x())
-//                   << "search:" << QDateTime::fromMSecsSinceEpoch(timestamp);
-        if (timestamp >= m_series->at(idx).x() && timestamp < m_series->at(idx-1).x()) {
-            return idx;
-        }
-        if (timestamp <= m_series->at(idx).x() && timestamp > m_series->at(idx+1).x()) {
-            return idx+1;
+QVector<QPointF> BoolSeriesAdapter::exactPoints() const
+{
+    // We're keeping a fake entry at the beginning (timestamp 0) with a static value of 0 and one
+    // at the end (+1 year from now) with the newest value to continue painting it.
+    QVector<QPointF> ret;
+    ret.reserve(2 * m_states.count() + 2);
+    ret.append(QPointF(0, 0));
+    bool previous = false;
+    for (int i = 0; i < m_states.count(); i++) {
+        bool value = m_states.at(i) != m_inverted;
+        // Keep the previous value up to right before a change, the series is a step function
+        if (value != previous) {
+            ret.append(QPointF(m_timestamps.at(i) - 1, previous ? 1 : 0));
         }
-        range = qMax(1, range / 2);
-        if (timestamp > m_series->at(idx).x()) {
-            idx = idx - range;
-        } else {
-            idx = idx + range;
+        ret.append(QPointF(m_timestamps.at(i), value ? 1 : 0));
+        previous = value;
+    }
+    ret.append(QPointF(QDateTime::currentDateTime().addYears(1).toMSecsSinceEpoch(), previous ? 1 : 0));
+    return ret;
+}
+
+QVector<QPointF> BoolSeriesAdapter::decimatedPoints() const
+{
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    qint64 start = m_windowStart.isValid() ? m_windowStart.toMSecsSinceEpoch() : (m_timestamps.isEmpty() ? now : m_timestamps.first());
+    qint64 end = m_windowEnd.isValid() ? m_windowEnd.toMSecsSinceEpoch() : now;
+    if (end <= start) {
+        return exactPoints();
+    }
+
+    // One slice per pixel which is true if the value has been true at any time in it, so short
+    // pulses don't vanish. Only changes between slices produce points.
+    QVector<QPointF> ret;
+    ret.reserve(2 * m_plotWidth + 1);
+    bool previous = false;
+    for (int pixel = 0; pixel < m_plotWidth; pixel++) {
+        qint64 sliceStart = start + (end - start) * pixel / m_plotWidth;
+        qint64 sliceEnd = start + (end - start) * (pixel + 1) / m_plotWidth;
+        int first = lowerBound(sliceStart);
+        int last = lowerBound(sliceEnd);
+
+        // The state the slice starts with, 0 before the first entry
+        bool value = first > 0 && m_states.at(first - 1) != m_inverted;
+        if (!value && last > first) {
+            int trueCount = m_trueCounts.at(last) - m_trueCounts.at(first);
+            value = m_inverted ? trueCount < last - first : trueCount > 0;
         }
 
-        if (i++ > 2000) {
-            break;
+        if (pixel == 0) {
+            ret.append(QPointF(sliceStart, value ? 1 : 0));
+        } else if (value != previous) {
+            ret.append(QPointF(sliceStart - 1, previous ? 1 : 0));
+            ret.append(QPointF(sliceStart, value ? 1 : 0));
         }
+        previous = value;
     }
-    return 1;
+    ret.append(QPointF(end, previous ? 1 : 0));
+    return ret;
+}
+
+int BoolSeriesAdapter::lowerBound(qint64 timestamp) const
+{
+    return static_cast<int>(std::lower_bound(m_timestamps.constBegin(), m_timestamps.constEnd(), timestamp) - m_timestamps.constBegin());
 }
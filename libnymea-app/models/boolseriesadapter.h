@@ -4,6 +4,7 @@
 #include "logsmodel.h"
 
 #include <QObject>
+#include <QTimer>
 #include <QXYSeries>
 
 class BoolSeriesAdapter : public QObject
@@ -14,6 +15,14 @@ class BoolSeriesAdapter : public QObject
 
     Q_PROPERTY(bool inverted READ inverted WRITE setInverted NOTIFY invertedChanged)
 
+    // The part of the series which is on screen
+    Q_PROPERTY(QDateTime windowStart READ windowStart WRITE setWindowStart NOTIFY windowStartChanged)
+    Q_PROPERTY(QDateTime windowEnd READ windowEnd WRITE setWindowEnd NOTIFY windowEndChanged)
+    // Width of the plot area in pixels. If set, and not exact, every pixel shows whether the value
+    // has been true at any time within it, instead of every single change.
+    Q_PROPERTY(int plotWidth READ plotWidth WRITE setPlotWidth NOTIFY plotWidthChanged)
+    Q_PROPERTY(bool exact READ exact WRITE setExact NOTIFY exactChanged)
+
 public:
     explicit BoolSeriesAdapter(QObject *parent = nullptr);
 
@@ -26,24 +35,58 @@ public:
     bool inverted() const;
     void setInverted(bool inverted);
 
+    QDateTime windowStart() const;
+    void setWindowStart(const QDateTime &windowStart);
+
+    QDateTime windowEnd() const;
+    void setWindowEnd(const QDateTime &windowEnd);
+
+    int plotWidth() const;
+    void setPlotWidth(int plotWidth);
+
+    bool exact() const;
+    void setExact(bool exact);
+
 signals:
     void xySeriesChanged();
     void logsModelChanged();
     void invertedChanged();
+    void windowStartChanged();
+    void windowEndChanged();
+    void plotWidthChanged();
+    void exactChanged();
 
 private slots:
-    void logEntryAdded(LogEntry *entry);
+    void entriesAdded(int index, int count);
+    void flush();
 
 private:
-    qreal calculateSampleValue(int index);
-
-    quint64 findIndex(qulonglong timestamp);
+    void reload();
+    void scheduleFlush();
+    void mergePending();
+    QVector<QPointF> exactPoints() const;
+    QVector<QPointF> decimatedPoints() const;
+    int lowerBound(qint64 timestamp) const;
 
 private:
     LogsModel* m_model = nullptr;
     QtCharts::QXYSeries* m_series = nullptr;
     bool m_inverted = false;
+    QDateTime m_windowStart;
+    QDateTime m_windowEnd;
+    int m_plotWidth = 0;
+    bool m_exact = false;
+
+    // All changes, oldest first. Timestamps in msecs since epoch.
+    QVector<qint64> m_timestamps;
+    QVector<bool> m_states;
+    // Number of true states before each index, to tell if a time range contains any in O(1)
+    QVector<int> m_trueCounts;
 
+    // Entries received since the last flush, merged in as a whole
+    QVector<QPair<qint64, bool>> m_pending;
+    // Coalesces updates into one series update per frame
+    QTimer m_flushTimer;
 };
 
 #endif // BOOLSERIESADAPTER_H
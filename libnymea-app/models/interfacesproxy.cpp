@@ -43,6 +43,24 @@ InterfacesProxy::InterfacesProxy(QObject *parent): QSortFilterProxyModel(parent)
     setSourceModel(m_interfaces);
 }
 
+void InterfacesProxy::setThingsFilter(Things *things)
+{
+    watchThings(m_thingsFilter, things);
+    m_thingsFilter = things;
+    m_thingsInterfacesValid = false;
+    emit thingsFilterChanged();
+    invalidateFilter();
+}
+
+void InterfacesProxy::setThingsProxyFilter(ThingsProxy *thingsProxy)
+{
+    watchThings(m_thingsProxyFilter, thingsProxy);
+    m_thingsProxyFilter = thingsProxy;
+    m_thingsInterfacesValid = false;
+    emit thingsProxyFilterChanged();
+    invalidateFilter();
+}
+
 bool InterfacesProxy::showEvents() const
 {
     return m_showEvents;
@@ -53,6 +71,7 @@ void InterfacesProxy::setShowEvents(bool showEvents)
     if (m_showEvents != showEvents) {
         m_showEvents = showEvents;
         emit showEventsChanged();
+        m_thingsInterfacesValid = false;
         invalidateFilter();
         void countChanged();
     }
@@ -68,6 +87,7 @@ void InterfacesProxy::setShowActions(bool showActions)
     if (m_showActions != showActions) {
         m_showActions = showActions;
         emit showActionsChanged();
+        m_thingsInterfacesValid = false;
         invalidateFilter();
         void countChanged();
     }
@@ -83,6 +103,7 @@ void InterfacesProxy::setShowStates(bool showStates)
     if (m_showStates != showStates) {
         m_showStates = showStates;
         emit showStatesChanged();
+        m_thingsInterfacesValid = false;
         invalidateFilter();
         void countChanged();
     }
@@ -92,45 +113,21 @@ bool InterfacesProxy::filterAcceptsRow(int source_row, const QModelIndex &source
 {
     Q_UNUSED(source_parent)
     QString interfaceName = m_interfaces->get(source_row)->name();
+    int interfaceId = InterfaceBits::idOf(interfaceName);
     if (!m_shownInterfaces.isEmpty()) {
-        if (!m_shownInterfaces.contains(interfaceName)) {
+        if (!m_shownInterfaceBits.testBit(interfaceId)) {
             return false;
         }
     }
 
-    if (m_thingsFilter != nullptr) {
-        // TODO: This could be improved *a lot* by caching interfaces in the devices model...
-        bool found = false;
-        for (int i = 0; i < m_thingsFilter->rowCount(); i++) {
-            Thing *d = m_thingsFilter->get(i);
-            if (!d->thingClass()) {
-                qWarning() << "Cannot find ThingClass for thing:" << d->id() << d->name();
-                return false;
-            }
-            if (d->thingClass()->interfaces().contains(interfaceName)) {
-                found = true;
-                break;
-            }
+    if (m_thingsFilter != nullptr || m_thingsProxyFilter != nullptr) {
+        if (!m_thingsInterfacesValid) {
+            updateThingsInterfaces();
         }
-        if (!found) {
+        if (m_thingsFilter != nullptr && !m_thingsFilterInterfaces.testBit(interfaceId)) {
             return false;
         }
-    }
-    if (m_thingsProxyFilter != nullptr) {
-        // TODO: This could be improved *a lot* by caching interfaces in the devices model...
-        bool found = false;
-        for (int i = 0; i < m_thingsProxyFilter->rowCount(); i++) {
-            Thing *d = m_thingsProxyFilter->get(i);
-            if (!d->thingClass()) {
-                qWarning() << "Cannot find ThingClass for thing:" << d->id() << d->name();
-                return false;
-            }
-            if (d->thingClass()->interfaces().contains(interfaceName)) {
-                found = true;
-                break;
-            }
-        }
-        if (!found) {
+        if (m_thingsProxyFilter != nullptr && !m_thingsProxyFilterInterfaces.testBit(interfaceId)) {
             return false;
         }
     }
@@ -156,6 +153,56 @@ bool InterfacesProxy::filterAcceptsRow(int source_row, const QModelIndex &source
     return false;
 }
 
+void InterfacesProxy::watchThings(QAbstractItemModel *oldModel, QAbstractItemModel *newModel)
+{
+    if (oldModel == newModel) {
+        return;
+    }
+    if (oldModel) {
+        disconnect(oldModel, nullptr, this, nullptr);
+    }
+    if (newModel) {
+        // The cached interfaces are only good as long as the set of things stays the same
+        connect(newModel, &QAbstractItemModel::rowsInserted, this, &InterfacesProxy::thingsChanged);
+        connect(newModel, &QAbstractItemModel::rowsRemoved, this, &InterfacesProxy::thingsChanged);
+        connect(newModel, &QAbstractItemModel::modelReset, this, &InterfacesProxy::thingsChanged);
+    }
+}
+
+void InterfacesProxy::thingsChanged()
+{
+    m_thingsInterfacesValid = false;
+    invalidateFilter();
+    emit countChanged();
+}
+
+void InterfacesProxy::updateThingsInterfaces() const
+{
+    m_thingsFilterInterfaces = InterfaceBits();
+    m_thingsProxyFilterInterfaces = InterfaceBits();
+    if (m_thingsFilter != nullptr) {
+        for (int i = 0; i < m_thingsFilter->rowCount(); i++) {
+            Thing *d = m_thingsFilter->get(i);
+            if (!d->thingClass()) {
+                qWarning() << "Cannot find ThingClass for thing:" << d->id() << d->name();
+                continue;
+            }
+            m_thingsFilterInterfaces |= d->thingClass()->interfaceBits();
+        }
+    }
+    if (m_thingsProxyFilter != nullptr) {
+        for (int i = 0; i < m_thingsProxyFilter->rowCount(); i++) {
+            Thing *d = m_thingsProxyFilter->get(i);
+            if (!d->thingClass()) {
+                qWarning() << "Cannot find ThingClass for thing:" << d->id() << d->name();
+                continue;
+            }
+            m_thingsProxyFilterInterfaces |= d->thingClass()->interfaceBits();
+        }
+    }
+    m_thingsInterfacesValid = true;
+}
+
 Interface *InterfacesProxy::get(int index) const
 {
     return m_interfaces->get(mapToSource(this->index(index, 0)).row());
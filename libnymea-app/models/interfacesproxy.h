@@ -33,6 +33,8 @@
 
 #include <QSortFilterProxyModel>
 
+#include "types/interfacebits.h"
+
 class Things;
 class ThingsProxy;
 class Interface;
@@ -54,13 +56,13 @@ public:
     InterfacesProxy(QObject *parent = nullptr);
 
     QStringList shownInterfaces() const { return m_shownInterfaces; }
-    void setShownInterfaces(const QStringList &shownInterfaces) { m_shownInterfaces = shownInterfaces; emit shownInterfacesChanged(); invalidateFilter(); }
+    void setShownInterfaces(const QStringList &shownInterfaces) { m_shownInterfaces = shownInterfaces; m_shownInterfaceBits = InterfaceBits::fromNames(shownInterfaces); m_thingsInterfacesValid = false; emit shownInterfacesChanged(); invalidateFilter(); }
 
     Things* thingsFilter() const { return m_thingsFilter; }
-    void setThingsFilter(Things *things) { m_thingsFilter = things; emit thingsFilterChanged(); invalidateFilter(); }
+    void setThingsFilter(Things *things);
 
     ThingsProxy* thingsProxyFilter() const { return m_thingsProxyFilter; }
-    void setThingsProxyFilter(ThingsProxy *thingsProxy) { m_thingsProxyFilter = thingsProxy; emit thingsProxyFilterChanged(); invalidateFilter(); }
+    void setThingsProxyFilter(ThingsProxy *thingsProxy);
 
     bool showEvents() const;
     void setShowEvents(bool showEvents);
@@ -87,13 +89,23 @@ signals:
     void countChanged();
 
 private:
+    void watchThings(QAbstractItemModel *oldModel, QAbstractItemModel *newModel);
+    void thingsChanged();
+    void updateThingsInterfaces() const;
+
     Interfaces *m_interfaces = nullptr;
     QStringList m_shownInterfaces;
+    InterfaceBits m_shownInterfaceBits;
     Things* m_thingsFilter = nullptr;
     ThingsProxy* m_thingsProxyFilter = nullptr;
     bool m_showEvents = false;
     bool m_showActions = false;
     bool m_showStates = false;
+
+    // Union of the interfaces of all things in thingsFilter/thingsProxyFilter, collected once per filter pass
+    mutable InterfaceBits m_thingsFilterInterfaces;
+    mutable InterfaceBits m_thingsProxyFilterInterfaces;
+    mutable bool m_thingsInterfacesValid = false;
 };
 
 #endif // INTERFACESPROXY_H
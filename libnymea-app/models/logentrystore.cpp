@@ -0,0 +1,484 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU General Public License as published by the Free Software
+* Foundation, GNU version 3. This project is distributed in the hope that it
+* will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+* Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "logentrystore.h"
+
+#include <QtNumeric>
+
+#include <algorithm>
+
+namespace {
+
+struct StringPool {
+    QHash<QString, int> ids;
+    QVector<QString> strings;
+};
+
+}
+
+Q_GLOBAL_STATIC(StringPool, s_stringPool)
+
+int LogEntryStore::count() const
+{
+    return m_timestamps.count();
+}
+
+bool LogEntryStore::isEmpty() const
+{
+    return m_timestamps.isEmpty();
+}
+
+void LogEntryStore::reserve(int size)
+{
+    m_timestamps.reserve(size);
+    m_sources.reserve(size);
+}
+
+void LogEntryStore::clear()
+{
+    m_timestamps.clear();
+    m_sources.clear();
+    m_columnNames.clear();
+    m_columnIndexes.clear();
+    m_columns.clear();
+}
+
+qint64 LogEntryStore::timestampAt(int index) const
+{
+    return m_timestamps.at(index);
+}
+
+int LogEntryStore::sourceIdAt(int index) const
+{
+    return m_sources.at(index);
+}
+
+QString LogEntryStore::sourceAt(int index) const
+{
+    return string(m_sources.at(index));
+}
+
+QStringList LogEntryStore::columnNames() const
+{
+    return m_columnNames;
+}
+
+int LogEntryStore::column(const QString &name) const
+{
+    return m_columnIndexes.value(name, -1);
+}
+
+QVariant LogEntryStore::valueAt(int index, int column) const
+{
+    if (column < 0 || column >= m_columns.count()) {
+        return QVariant();
+    }
+    return m_columns.at(column).at(index);
+}
+
+QVariant LogEntryStore::valueAt(int index, const QString &column) const
+{
+    return valueAt(index, this->column(column));
+}
+
+QVariantMap LogEntryStore::valuesAt(int index) const
+{
+    QVariantMap ret;
+    for (int i = 0; i < m_columns.count(); i++) {
+        QVariant value = m_columns.at(i).at(index);
+        if (value.isValid()) {
+            ret.insert(m_columnNames.at(i), value);
+        }
+    }
+    return ret;
+}
+
+void LogEntryStore::append(qint64 timestamp, const QString &source, const QVariantMap &values)
+{
+    for (auto it = values.constBegin(); it != values.constEnd(); ++it) {
+        if (!m_columnIndexes.contains(it.key())) {
+            addColumn(it.key());
+        }
+    }
+
+    int index = m_timestamps.count();
+    m_timestamps.append(timestamp);
+    m_sources.append(intern(source));
+    for (int i = 0; i < m_columns.count(); i++) {
+        m_columns[i].insertMissing(index, 1);
+    }
+    for (auto it = values.constBegin(); it != values.constEnd(); ++it) {
+        m_columns[m_columnIndexes.value(it.key())].set(index, it.value());
+    }
+}
+
+void LogEntryStore::insert(int index, const LogEntryStore &other)
+{
+    if (other.isEmpty()) {
+        return;
+    }
+    foreach (const QString &name, other.m_columnNames) {
+        if (!m_columnIndexes.contains(name)) {
+            addColumn(name);
+        }
+    }
+
+    m_timestamps.insert(index, other.count(), 0);
+    std::copy(other.m_timestamps.constBegin(), other.m_timestamps.constEnd(), m_timestamps.begin() + index);
+    m_sources.insert(index, other.count(), 0);
+    std::copy(other.m_sources.constBegin(), other.m_sources.constEnd(), m_sources.begin() + index);
+
+    for (int i = 0; i < m_columns.count(); i++) {
+        int otherColumn = other.column(m_columnNames.at(i));
+        if (otherColumn < 0) {
+            m_columns[i].insertMissing(index, other.count());
+        } else {
+            m_columns[i].insert(index, other.m_columns.at(otherColumn));
+        }
+    }
+}
+
+void LogEntryStore::append(const LogEntryStore &other, int index)
+{
+    foreach (const QString &name, other.m_columnNames) {
+        if (!m_columnIndexes.contains(name)) {
+            addColumn(name);
+        }
+    }
+
+    int row = m_timestamps.count();
+    m_timestamps.append(other.m_timestamps.at(index));
+    m_sources.append(other.m_sources.at(index));
+    for (int i = 0; i < m_columns.count(); i++) {
+        m_columns[i].insertMissing(row, 1);
+    }
+    for (int i = 0; i < other.m_columns.count(); i++) {
+        m_columns[m_columnIndexes.value(other.m_columnNames.at(i))].set(row, other.m_columns.at(i).at(index));
+    }
+}
+
+LogEntryStore LogEntryStore::mid(int index, int count) const
+{
+    if (count < 0 || index + count > m_timestamps.count()) {
+        count = m_timestamps.count() - index;
+    }
+    LogEntryStore ret;
+    ret.m_timestamps = m_timestamps.mid(index, count);
+    ret.m_sources = m_sources.mid(index, count);
+    ret.m_columnNames = m_columnNames;
+    ret.m_columnIndexes = m_columnIndexes;
+    ret.m_columns.reserve(m_columns.count());
+    foreach (const Column &column, m_columns) {
+        ret.m_columns.append(column.mid(index, count));
+    }
+    return ret;
+}
+
+int LogEntryStore::intern(const QString &string)
+{
+    QHash<QString, int>::const_iterator it = s_stringPool->ids.constFind(string);
+    if (it != s_stringPool->ids.constEnd()) {
+        return it.value();
+    }
+    int id = s_stringPool->strings.count();
+    s_stringPool->ids.insert(string, id);
+    s_stringPool->strings.append(string);
+    return id;
+}
+
+QString LogEntryStore::string(int id)
+{
+    if (id < 0 || id >= s_stringPool->strings.count()) {
+        return QString();
+    }
+    return s_stringPool->strings.at(id);
+}
+
+bool LogEntryStore::isIdColumn(const QString &name)
+{
+    // thingId, typeId, ...
+    return name == QLatin1String("id") || name.endsWith(QLatin1String("Id"));
+}
+
+int LogEntryStore::addColumn(const QString &name)
+{
+    int index = m_columns.count();
+    Column column(isIdColumn(name));
+    column.insertMissing(0, m_timestamps.count());
+    m_columns.append(column);
+    m_columnNames.append(name);
+    m_columnIndexes.insert(name, index);
+    return index;
+}
+
+LogEntryStore::Column::Column(bool pooled):
+    m_pooled(pooled)
+{
+
+}
+
+int LogEntryStore::Column::count() const
+{
+    return m_count;
+}
+
+QVariant LogEntryStore::Column::at(int index) const
+{
+    switch (m_type) {
+    case TypeNone:
+        return QVariant();
+    case TypeNumber: {
+        double value = m_numbers.at(index);
+        if (qIsNaN(value)) {
+            return QVariant();
+        }
+        switch (m_metaType) {
+        case QMetaType::Bool:
+            return value != 0;
+        case QMetaType::Int:
+            return static_cast<int>(value);
+        case QMetaType::UInt:
+            return static_cast<uint>(value);
+        case QMetaType::LongLong:
+            return static_cast<qlonglong>(value);
+        case QMetaType::ULongLong:
+            return static_cast<qulonglong>(value);
+        case QMetaType::Float:
+            return static_cast<float>(value);
+        }
+        return value;
+    }
+    case TypeString: {
+        int id = m_strings.at(index);
+        return id < 0 ? QVariant() : QVariant(string(id));
+    }
+    case TypeVariant:
+        return m_variants.at(index);
+    }
+    return QVariant();
+}
+
+void LogEntryStore::Column::set(int index, const QVariant &value)
+{
+    if (!value.isValid()) {
+        return;
+    }
+
+    Type type = typeOf(value);
+    if (m_type == TypeNone) {
+        retype(type, value.userType());
+    } else if (m_type == TypeNumber && type == TypeNumber && m_metaType != value.userType()) {
+        // Mixed numbers are handed out as double, but bools mixed with numbers stay what they are
+        if (m_metaType == QMetaType::Bool || value.userType() == QMetaType::Bool) {
+            retype(TypeVariant, QMetaType::UnknownType);
+        } else {
+            m_metaType = QMetaType::Double;
+        }
+    } else if (m_type != type && m_type != TypeVariant) {
+        retype(TypeVariant, QMetaType::UnknownType);
+    }
+
+    switch (m_type) {
+    case TypeNone:
+        break;
+    case TypeNumber:
+        m_numbers[index] = value.toDouble();
+        break;
+    case TypeString:
+        m_strings[index] = internString(value.toString());
+        break;
+    case TypeVariant:
+        m_variants[index] = value;
+        break;
+    }
+}
+
+void LogEntryStore::Column::insertMissing(int index, int count)
+{
+    switch (m_type) {
+    case TypeNone:
+        break;
+    case TypeNumber:
+        m_numbers.insert(index, count, qQNaN());
+        break;
+    case TypeString:
+        m_strings.insert(index, count, -1);
+        break;
+    case TypeVariant:
+        m_variants.insert(index, count, QVariant());
+        break;
+    }
+    m_count += count;
+}
+
+void LogEntryStore::Column::insert(int index, const Column &other)
+{
+    if (other.m_type == TypeNone) {
+        insertMissing(index, other.m_count);
+        return;
+    }
+    if (m_type == TypeNone) {
+        retype(other.m_type, other.m_metaType);
+    }
+
+    if (m_type != other.m_type || m_metaType != other.m_metaType) {
+        // Different types, take the slow path converting value by value
+        insertMissing(index, other.m_count);
+        for (int i = 0; i < other.m_count; i++) {
+            set(index + i, other.at(i));
+        }
+        return;
+    }
+
+    switch (m_type) {
+    case TypeNone:
+        break;
+    case TypeNumber:
+        m_numbers.insert(index, other.m_count, 0);
+        std::copy(other.m_numbers.constBegin(), other.m_numbers.constEnd(), m_numbers.begin() + index);
+        break;
+    case TypeString:
+        m_strings.insert(index, other.m_count, 0);
+        if (m_pooled || other.m_stringTable.constData() == m_stringTable.constData()) {
+            std::copy(other.m_strings.constBegin(), other.m_strings.constEnd(), m_strings.begin() + index);
+        } else {
+            // Another table, translate the ids. Each string is looked up once.
+            QVector<int> ids(other.m_stringTable.count());
+            for (int i = 0; i < ids.count(); i++) {
+                ids[i] = internString(other.m_stringTable.at(i));
+            }
+            for (int i = 0; i < other.m_count; i++) {
+                int id = other.m_strings.at(i);
+                m_strings[index + i] = id < 0 ? -1 : ids.at(id);
+            }
+        }
+        break;
+    case TypeVariant:
+        m_variants.insert(index, other.m_count, QVariant());
+        std::copy(other.m_variants.constBegin(), other.m_variants.constEnd(), m_variants.begin() + index);
+        break;
+    }
+    m_count += other.m_count;
+}
+
+LogEntryStore::Column LogEntryStore::Column::mid(int index, int count) const
+{
+    Column ret(m_pooled);
+    ret.m_type = m_type;
+    ret.m_metaType = m_metaType;
+    ret.m_count = count;
+    ret.m_numbers = m_numbers.mid(index, m_type == TypeNumber ? count : 0);
+    ret.m_strings = m_strings.mid(index, m_type == TypeString ? count : 0);
+    ret.m_variants = m_variants.mid(index, m_type == TypeVariant ? count : 0);
+    // Shared until either one adds a string
+    ret.m_stringTable = m_stringTable;
+    ret.m_stringIds = m_stringIds;
+    return ret;
+}
+
+LogEntryStore::Column::Type LogEntryStore::Column::typeOf(const QVariant &value)
+{
+    switch (value.userType()) {
+    case QMetaType::Bool:
+    case QMetaType::Int:
+    case QMetaType::UInt:
+    case QMetaType::Float:
+    case QMetaType::Double:
+        return TypeNumber;
+    case QMetaType::LongLong:
+        // Only if it survives the round trip through double
+        return qAbs(value.toLongLong()) <= (Q_INT64_C(1) << 53) ? TypeNumber : TypeVariant;
+    case QMetaType::ULongLong:
+        return value.toULongLong() <= (Q_UINT64_C(1) << 53) ? TypeNumber : TypeVariant;
+    case QMetaType::QString:
+        return TypeString;
+    }
+    return TypeVariant;
+}
+
+void LogEntryStore::Column::retype(Type type, int metaType)
+{
+    QVector<QVariant> values;
+    if (type == TypeVariant && m_type != TypeNone) {
+        values.reserve(m_count);
+        for (int i = 0; i < m_count; i++) {
+            values.append(at(i));
+        }
+    }
+
+    m_numbers.clear();
+    m_strings.clear();
+    m_stringTable.clear();
+    m_stringIds.clear();
+    m_variants.clear();
+    m_type = type;
+    m_metaType = type == TypeNumber ? metaType : QMetaType::UnknownType;
+
+    switch (type) {
+    case TypeNone:
+        break;
+    case TypeNumber:
+        m_numbers.fill(qQNaN(), m_count);
+        break;
+    case TypeString:
+        m_strings.fill(-1, m_count);
+        break;
+    case TypeVariant:
+        if (values.isEmpty()) {
+            m_variants.fill(QVariant(), m_count);
+        } else {
+            m_variants = values;
+        }
+        break;
+    }
+}
+
+int LogEntryStore::Column::internString(const QString &string)
+{
+    if (m_pooled) {
+        return LogEntryStore::intern(string);
+    }
+    QHash<QString, int>::const_iterator it = m_stringIds.constFind(string);
+    if (it != m_stringIds.constEnd()) {
+        return it.value();
+    }
+    int id = m_stringTable.count();
+    m_stringIds.insert(string, id);
+    m_stringTable.append(string);
+    return id;
+}
+
+QString LogEntryStore::Column::string(int id) const
+{
+    if (m_pooled) {
+        return LogEntryStore::string(id);
+    }
+    return m_stringTable.value(id);
+}
@@ -0,0 +1,132 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU General Public License as published by the Free Software
+* Foundation, GNU version 3. This project is distributed in the hope that it
+* will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+* Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef LOGENTRYSTORE_H
+#define LOGENTRYSTORE_H
+
+#include <QVector>
+#include <QHash>
+#include <QVariant>
+#include <QStringList>
+
+// Columnar storage for log entries, shared by the log models. Timestamps, sources and every
+// value column are kept in their own contiguous array, so a long history doesn't cost a QObject
+// and a QVariantMap per entry. Values keep their type: numbers and bools are stored as doubles,
+// strings as ids into a string table and anything else as QVariant. Sources and id columns use a
+// process wide pool, all other strings a table per column which goes away with the store.
+class LogEntryStore
+{
+public:
+    int count() const;
+    bool isEmpty() const;
+
+    void reserve(int size);
+    void clear();
+
+    // Timestamps in msecs since epoch
+    qint64 timestampAt(int index) const;
+    int sourceIdAt(int index) const;
+    QString sourceAt(int index) const;
+
+    QStringList columnNames() const;
+    // Index of the value column with the given name, -1 if there is none
+    int column(const QString &name) const;
+    // Invalid if the entry has no value in that column
+    QVariant valueAt(int index, int column) const;
+    QVariant valueAt(int index, const QString &column) const;
+    QVariantMap valuesAt(int index) const;
+
+    void append(qint64 timestamp, const QString &source, const QVariantMap &values);
+    // Appends a copy of the entry at index in other
+    void append(const LogEntryStore &other, int index);
+    void insert(int index, const LogEntryStore &other);
+    // count -1 means up to the end
+    LogEntryStore mid(int index, int count = -1) const;
+
+    // Sources and ids repeat all over the logs and across models, they're stored only once.
+    // There's one per thing, state or event type, so the pool isn't pruned and ids are valid
+    // for the lifetime of the application. Free form values don't go in here.
+    static int intern(const QString &string);
+    static QString string(int id);
+
+private:
+    class Column
+    {
+    public:
+        // Pooled columns keep their strings in the process wide pool, the others in their own table
+        explicit Column(bool pooled = false);
+
+        enum Type {
+            TypeNone, // No values yet
+            TypeNumber,
+            TypeString,
+            TypeVariant
+        };
+
+        int count() const;
+        QVariant at(int index) const;
+        void set(int index, const QVariant &value);
+        void insertMissing(int index, int count);
+        void insert(int index, const Column &other);
+        Column mid(int index, int count) const;
+
+    private:
+        static Type typeOf(const QVariant &value);
+        void retype(Type type, int metaType);
+        int internString(const QString &string);
+        QString string(int id) const;
+
+        Type m_type = TypeNone;
+        // The type numbers are handed out as. Double if the column contains mixed number types.
+        int m_metaType = QMetaType::UnknownType;
+        int m_count = 0;
+        // NaN for missing values, JSON can't carry NaN
+        QVector<double> m_numbers;
+        // -1 for missing values
+        QVector<int> m_strings;
+        bool m_pooled = false;
+        // String table of columns which aren't pooled
+        QVector<QString> m_stringTable;
+        QHash<QString, int> m_stringIds;
+        // Invalid for missing values
+        QVector<QVariant> m_variants;
+    };
+
+    static bool isIdColumn(const QString &name);
+    int addColumn(const QString &name);
+
+    QVector<qint64> m_timestamps;
+    QVector<int> m_sources;
+    QStringList m_columnNames;
+    QHash<QString, int> m_columnIndexes;
+    QVector<Column> m_columns;
+};
+
+#endif // LOGENTRYSTORE_H
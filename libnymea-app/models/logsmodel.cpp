@@ -32,6 +32,7 @@
 #include <QDateTime>
 #include <QDebug>
 #include <QMetaEnum>
+#include <QMetaMethod>
 #include <QJsonDocument>
 
 #include "engine.h"
@@ -68,26 +69,26 @@ void LogsModel::setEngine(Engine *engine)
 int LogsModel::rowCount(const QModelIndex &parent) const
 {
     Q_UNUSED(parent)
-    return m_list.count();
+    return m_store.count();
 }
 
 QVariant LogsModel::data(const QModelIndex &index, int role) const
 {
     switch (role) {
     case RoleTimestamp:
-        return m_list.at(index.row())->timestamp();
+        return QDateTime::fromMSecsSinceEpoch(m_store.timestampAt(index.row()));
     case RoleValue:
-        return m_list.at(index.row())->value();
+        return m_store.valueAt(index.row(), "value");
     case RoleThingId:
-        return m_list.at(index.row())->thingId();
+        return QUuid(m_store.sourceAt(index.row()));
     case RoleTypeId:
-        return m_list.at(index.row())->typeId();
+        return QUuid(m_store.valueAt(index.row(), "typeId").toString());
     case RoleSource:
-        return m_list.at(index.row())->source();
+        return m_store.valueAt(index.row(), "loggingSource").toInt();
     case RoleLoggingEventType:
-        return m_list.at(index.row())->loggingEventType();
+        return m_store.valueAt(index.row(), "loggingEventType").toInt();
     case RoleErrorCode:
-        return m_list.at(index.row())->errorCode();
+        return m_store.valueAt(index.row(), "errorCode").toString();
     }
     return QVariant();
 }
@@ -156,8 +157,9 @@ void LogsModel::setTypeIds(const QStringList &typeIds)
         emit typeIdsChanged();
         qCDebug(dcLogEngine()) << "Resetting model because type ids changed";
         beginResetModel();
-        qDeleteAll(m_list);
-        m_list.clear();
+        qDeleteAll(m_entries);
+        m_entries.clear();
+        m_store.clear();
         m_generatedEntries = 0;
         endResetModel();
         fetchMore();
@@ -200,7 +202,7 @@ void LogsModel::setViewStartTime(const QDateTime &viewStartTime)
     if (m_viewStartTime != viewStartTime) {
         m_viewStartTime = viewStartTime;
         emit viewStartTimeChanged();
-        if (m_list.count() == 0 || m_list.last()->timestamp() > m_viewStartTime) {
+        if (m_store.isEmpty() || m_store.timestampAt(m_store.count() - 1) > m_viewStartTime.toMSecsSinceEpoch()) {
             if (m_canFetchMore) {                
                 fetchMore();
             }
@@ -236,75 +238,129 @@ void LogsModel::setFetchBlockSize(int fetchBlockSize)
 
 LogEntry *LogsModel::get(int index) const
 {
-    if (index >= 0 && index < m_list.count()) {
-        return m_list.at(index);
+    if (index < 0 || index >= m_store.count()) {
+        return nullptr;
     }
-    return nullptr;
+    LogEntry *entry = m_entries.value(index);
+    if (!entry) {
+        entry = createEntry(m_store, index, const_cast<LogsModel*>(this));
+        m_entries.insert(index, entry);
+    }
+    return entry;
 }
 
 LogEntry *LogsModel::findClosest(const QDateTime &dateTime)
 {
-//    qWarning() << "********************Finding closest for:" << dateTime.toString();
-//    foreach (LogEntry *entry, m_list) {
-//        qWarning() << "List entry:" << entry->timestamp().toString();
-//    }
-    if (m_list.isEmpty()) {
-//        qWarning() << "No entries here...";
+    if (m_store.isEmpty()) {
         return nullptr;
     }
+    // Entries are newest first
+    qint64 searched = dateTime.toMSecsSinceEpoch();
     int newest = 0;
-    int oldest = m_list.count() - 1;
-    LogEntry *entry = nullptr;
+    int oldest = m_store.count() - 1;
     int step = 0;
 
-    LogEntry *allTimeOldestEntry = m_list.at(oldest);
-    if (dateTime < allTimeOldestEntry->timestamp()) {
-//        qWarning() << "All time oldest is newer than searched";
+    if (searched < m_store.timestampAt(oldest)) {
         return nullptr;
     }
-//    qWarning() << "Oldest:" << oldest << "newest:" << newest << "step" << step << "count" << m_list.count();
-    while (oldest >= newest && step < m_list.count()) {
-        LogEntry *oldestEntry = m_list.at(oldest);
-        LogEntry *newestEntry = m_list.at(newest);
+    while (oldest >= newest && step < m_store.count()) {
         int middle = (oldest - newest) / 2 + newest;
-        LogEntry *middleEntry = m_list.at(middle);
-//        qWarning() << "Oldest:" << oldest << oldestEntry->timestamp().toString() << oldestEntry->value() << "Middle:" << middle << middleEntry->timestamp().toString() << middleEntry->value() << "Newest:" << newest << newestEntry->timestamp().toString() << newestEntry->value() << ":" << (oldest - newest);
-        if (dateTime <= oldestEntry->timestamp()) {
-//            qWarning() << "Returning oldest";
-            return oldestEntry;
+        if (searched <= m_store.timestampAt(oldest)) {
+            return get(oldest);
         }
-        if (dateTime >= newestEntry->timestamp()) {
-//            qWarning() << "Returning newest";
-            return newestEntry;
+        if (searched >= m_store.timestampAt(newest)) {
+            return get(newest);
         }
-
-        if (dateTime == middleEntry->timestamp()) {
-//            qWarning() << "Returning middle";
-            return middleEntry;
+        if (searched == m_store.timestampAt(middle)) {
+            return get(middle);
         }
 
-        if (dateTime < middleEntry->timestamp()) {
+        if (searched < m_store.timestampAt(middle)) {
             newest = middle;
         } else {
             oldest = middle;
         }
 
         if (oldest - newest == 1) {
-            if (oldest > middle) {
-//                qWarning() << "EOL. Returning oldest";
-                return oldestEntry;
-            } else {
-//                qWarning() << "EOL. Returning middle";
-                return middleEntry;
-            }
+            return oldest > middle ? get(oldest) : get(middle);
         }
         step++;
     }
-    return entry;
+    return nullptr;
+}
+
+const LogEntryStore &LogsModel::store() const
+{
+    return m_store;
+}
+
+void LogsModel::appendEntry(LogEntryStore *store, const QVariantMap &entryMap)
+{
+    QMetaEnum sourceEnum = QMetaEnum::fromType<LogEntry::LoggingSource>();
+    LogEntry::LoggingSource loggingSource = static_cast<LogEntry::LoggingSource>(sourceEnum.keyToValue(entryMap.value("source").toByteArray()));
+    QMetaEnum loggingEventTypeEnum = QMetaEnum::fromType<LogEntry::LoggingEventType>();
+    LogEntry::LoggingEventType loggingEventType = static_cast<LogEntry::LoggingEventType>(loggingEventTypeEnum.keyToValue(entryMap.value("eventType").toByteArray()));
+
+    QVariantMap values;
+    values.insert("value", loggingEventType == LogEntry::LoggingEventTypeActiveChange ? entryMap.value("active").toBool() : entryMap.value("value"));
+    values.insert("typeId", entryMap.value("typeId").toString());
+    values.insert("loggingSource", static_cast<int>(loggingSource));
+    values.insert("loggingEventType", static_cast<int>(loggingEventType));
+    QString errorCode = entryMap.value("errorCode").toString();
+    if (!errorCode.isEmpty()) {
+        values.insert("errorCode", errorCode);
+    }
+    store->append(entryMap.value("timestamp").toLongLong(), entryMap.value("thingId").toString(), values);
+}
+
+LogEntry *LogsModel::createEntry(const LogEntryStore &store, int index, QObject *parent)
+{
+    return new LogEntry(QDateTime::fromMSecsSinceEpoch(store.timestampAt(index)),
+                        store.valueAt(index, "value"),
+                        QUuid(store.sourceAt(index)),
+                        QUuid(store.valueAt(index, "typeId").toString()),
+                        static_cast<LogEntry::LoggingSource>(store.valueAt(index, "loggingSource").toInt()),
+                        static_cast<LogEntry::LoggingEventType>(store.valueAt(index, "loggingEventType").toInt()),
+                        store.valueAt(index, "errorCode").toString(),
+                        parent);
+}
+
+void LogsModel::insertEntries(int index, const LogEntryStore &entries)
+{
+    beginInsertRows(QModelIndex(), index, index + entries.count() - 1);
+    if (index < m_store.count()) {
+        QHash<int, LogEntry*> shifted;
+        shifted.reserve(m_entries.count());
+        for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it) {
+            shifted.insert(it.key() >= index ? it.key() + entries.count() : it.key(), it.value());
+        }
+        m_entries = shifted;
+    }
+    m_store.insert(index, entries);
+    endInsertRows();
+    emit countChanged();
+
+    emit entriesAdded(index, entries.count());
+
+    // Only create wrappers if someone actually listens for them
+    if (isSignalConnected(QMetaMethod::fromSignal(&LogsModel::logEntryAdded))) {
+        for (int i = 0; i < entries.count(); i++) {
+            emit logEntryAdded(get(index + i));
+        }
+    }
 }
 
 void LogsModel::logsReply(int /*commandId*/, const QVariantMap &data)
 {
+    if (JsonRpcClient::isLost(data)) {
+        // Not the end of the logs, the block is fetched again with the next fetchMore()
+        qCWarning(dcLogEngine()) << objectName() << "Fetching logs failed";
+        m_busyInternal = false;
+        m_busy = false;
+        emit busyChanged();
+        return;
+    }
+
     int offset = data.value("offset").toInt() + m_generatedEntries;
     int count = data.value("count").toInt();
 
@@ -313,19 +369,12 @@ void LogsModel::logsReply(int /*commandId*/, const QVariantMap &data)
 
     m_fetchStartTime = QDateTime::currentDateTime();
 
-    QList<LogEntry*> newBlock;
+    LogEntryStore newBlock;
     QList<QVariant> logEntries = data.value("logEntries").toList();
+    newBlock.reserve(logEntries.count());
     foreach (const QVariant &logEntryVariant, logEntries) {
         QVariantMap entryMap = logEntryVariant.toMap();
         QDateTime timeStamp = QDateTime::fromMSecsSinceEpoch(entryMap.value("timestamp").toLongLong());
-        QString thingId = entryMap.value("thingId").toString();
-        QString typeId = entryMap.value("typeId").toString();
-        QMetaEnum sourceEnum = QMetaEnum::fromType<LogEntry::LoggingSource>();
-        LogEntry::LoggingSource loggingSource = static_cast<LogEntry::LoggingSource>(sourceEnum.keyToValue(entryMap.value("source").toByteArray()));
-        QMetaEnum loggingEventTypeEnum = QMetaEnum::fromType<LogEntry::LoggingEventType>();
-        LogEntry::LoggingEventType loggingEventType = static_cast<LogEntry::LoggingEventType>(loggingEventTypeEnum.keyToValue(entryMap.value("eventType").toByteArray()));
-        QVariant value = loggingEventType == LogEntry::LoggingEventTypeActiveChange ? entryMap.value("active").toBool() : entryMap.value("value");
-        QString errorCode = entryMap.value("errorCode").toString();
 
         bool stopProcessing = false;
         if (m_viewStartTime.isValid() && timeStamp.addSecs(-60) < m_viewStartTime) {
@@ -333,8 +382,7 @@ void LogsModel::logsReply(int /*commandId*/, const QVariantMap &data)
             stopProcessing = true;
 //            m_generatedEntries++;
         }
-        LogEntry *entry = new LogEntry(timeStamp, value, thingId, typeId, loggingSource, loggingEventType, errorCode, this);
-        newBlock.append(entry);
+        appendEntry(&newBlock, entryMap);
 //        qCDebug(dcLogEngine()) << objectName() << "adding entry at" << timeStamp << m_viewStartTime;
         if (stopProcessing) {
             break;
@@ -354,23 +402,14 @@ void LogsModel::logsReply(int /*commandId*/, const QVariantMap &data)
         return;
     }
 
-    beginInsertRows(QModelIndex(), offset, offset + newBlock.count() - 1);
-    for (int i = 0; i < newBlock.count(); i++) {
-//        qCDebug(dcLogEngine()) << objectName() << "Inserting: list count" << m_list.count() << "blockSize" << newBlock.count() << "insterting at:" << offset + i;
-        LogEntry *entry = newBlock.at(i);
-        m_list.insert(offset + i, entry);
-        emit logEntryAdded(entry);
-//        qCDebug(dcLogEngine()) << objectName() << "done";
-    }
-    endInsertRows();
-    emit countChanged();
+    insertEntries(qMin(offset, m_store.count()), newBlock);
 
     m_busyInternal = false;
 
     qCInfo(dcLogEngine()) << objectName() << "Logs fetched" << m_fetchStartTime.msecsTo(QDateTime::currentDateTime());
 
-    if (m_viewStartTime.isValid() && m_list.count() > 0 && m_list.last()->timestamp() > m_viewStartTime && m_canFetchMore) {
-        qCInfo(dcLogEngine()) << objectName() << "Fetching more because of viewStartTime" << m_viewStartTime.toString() << "last" << m_list.last()->timestamp().toString();
+    if (m_viewStartTime.isValid() && !m_store.isEmpty() && m_store.timestampAt(m_store.count() - 1) > m_viewStartTime.toMSecsSinceEpoch() && m_canFetchMore) {
+        qCInfo(dcLogEngine()) << objectName() << "Fetching more because of viewStartTime" << m_viewStartTime.toString() << "last" << QDateTime::fromMSecsSinceEpoch(m_store.timestampAt(m_store.count() - 1)).toString();
         fetchMore();
     } else {
         m_busy = false;
@@ -443,9 +482,9 @@ void LogsModel::fetchMore(const QModelIndex &parent)
     }
 
     params.insert("limit", m_blockSize);
-    params.insert("offset", m_list.count() - m_generatedEntries);
+    params.insert("offset", m_store.count() - m_generatedEntries);
 
-    qCInfo(dcLogEngine()) << "Fetching logs from:" << m_list.count() - m_generatedEntries << "max" << m_blockSize;
+    qCInfo(dcLogEngine()) << "Fetching logs from:" << m_store.count() - m_generatedEntries << "max" << m_blockSize;
     qCCritical(dcLogEngine()) << qUtf8Printable(QJsonDocument::fromVariant(params).toJson());
 
     m_engine->jsonRpcClient()->sendCommand("Logging.GetLogEntries", params, this, "logsReply");
@@ -488,18 +527,7 @@ void LogsModel::newLogEntryReceived(const QVariantMap &data)
         return;
     }
 
-    beginInsertRows(QModelIndex(), 0, 0);
-    QDateTime timeStamp = QDateTime::fromMSecsSinceEpoch(entryMap.value("timestamp").toLongLong());
-    QMetaEnum sourceEnum = QMetaEnum::fromType<LogEntry::LoggingSource>();
-    LogEntry::LoggingSource loggingSource = static_cast<LogEntry::LoggingSource>(sourceEnum.keyToValue(entryMap.value("source").toByteArray()));
-    QMetaEnum loggingEventTypeEnum = QMetaEnum::fromType<LogEntry::LoggingEventType>();
-    LogEntry::LoggingEventType loggingEventType = static_cast<LogEntry::LoggingEventType>(loggingEventTypeEnum.keyToValue(entryMap.value("eventType").toByteArray()));
-    QVariant value = loggingEventType == LogEntry::LoggingEventTypeActiveChange ? entryMap.value("active").toBool() : entryMap.value("value");
-    LogEntry *entry = new LogEntry(timeStamp, value, thingId, typeId, loggingSource, loggingEventType, entryMap.value("errorCode").toString(), this);
-    m_list.prepend(entry);
-    endInsertRows();
-    emit countChanged();
-
-    emit logEntryAdded(entry);
-
+    LogEntryStore entry;
+    appendEntry(&entry, entryMap);
+    insertEntries(0, entry);
 }
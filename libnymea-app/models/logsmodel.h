@@ -35,6 +35,7 @@
 #include <QQmlParserStatus>
 
 #include "types/logentry.h"
+#include "logentrystore.h"
 
 #include <QLoggingCategory>
 Q_DECLARE_LOGGING_CATEGORY(dcLogEngine)
@@ -122,6 +123,13 @@ public:
     Q_INVOKABLE LogEntry* get(int index) const;
     Q_INVOKABLE LogEntry* findClosest(const QDateTime &dateTime);
 
+    const LogEntryStore &store() const;
+
+    // Log entries are stored with the thing id as source and value, typeId, loggingSource,
+    // loggingEventType and errorCode columns. Shared with LogsModelNg.
+    static void appendEntry(LogEntryStore *store, const QVariantMap &entryMap);
+    static LogEntry *createEntry(const LogEntryStore &store, int index, QObject *parent);
+
 
 signals:
     void engineChanged();
@@ -137,6 +145,7 @@ signals:
     void fetchBlockSizeChanged();
 
     void logEntryAdded(LogEntry *entry);
+    void entriesAdded(int index, int count);
 
 private slots:
     virtual void logsReply(int commandId, const QVariantMap &data);
@@ -144,7 +153,9 @@ private slots:
 
 protected:
     Engine *m_engine = nullptr;
-    QList<LogEntry*> m_list;
+    LogEntryStore m_store;
+    // Wrappers handed out by get(), by index. They stay alive until the model is reset as QML may hold on to them.
+    mutable QHash<int, LogEntry*> m_entries;
     QUuid m_thingId;
     QList<QUuid> m_typeIds;
     QDateTime m_startTime;
@@ -163,6 +174,8 @@ protected:
     int m_generatedEntries = 0;
 
     QDateTime m_fetchStartTime;
+
+    void insertEntries(int index, const LogEntryStore &entries);
 };
 
 #endif // LOGSMODEL_H
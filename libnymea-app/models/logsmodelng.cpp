@@ -37,6 +37,7 @@
 #include "engine.h"
 #include "types/logentry.h"
 #include "logmanager.h"
+#include "logsmodel.h"
 
 #include "logging.h"
 Q_DECLARE_LOGGING_CATEGORY(dcLogEngine)
@@ -72,24 +73,25 @@ void LogsModelNg::setEngine(Engine *engine)
 int LogsModelNg::rowCount(const QModelIndex &parent) const
 {
     Q_UNUSED(parent)
-    return m_list.count();
+    return m_store.count();
 }
 
 QVariant LogsModelNg::data(const QModelIndex &index, int role) const
 {
+    // Same layout as in LogsModel, see LogsModel::appendEntry()
     switch (role) {
     case RoleTimestamp:
-        return m_list.at(index.row())->timestamp();
+        return QDateTime::fromMSecsSinceEpoch(m_store.timestampAt(index.row()));
     case RoleValue:
-        return m_list.at(index.row())->value();
+        return m_store.valueAt(index.row(), "value");
     case RoleThingId:
-        return m_list.at(index.row())->thingId();
+        return QUuid(m_store.sourceAt(index.row()));
     case RoleTypeId:
-        return m_list.at(index.row())->typeId();
+        return QUuid(m_store.valueAt(index.row(), "typeId").toString());
     case RoleSource:
-        return m_list.at(index.row())->source();
+        return m_store.valueAt(index.row(), "loggingSource").toInt();
     case RoleLoggingEventType:
-        return m_list.at(index.row())->loggingEventType();
+        return m_store.valueAt(index.row(), "loggingEventType").toInt();
     }
     return QVariant();
 }
@@ -167,8 +169,9 @@ void LogsModelNg::setTypeIds(const QStringList &typeIds)
         m_typeIds = fixedTypeIds;
         emit typeIdsChanged();
         beginResetModel();
-        qDeleteAll(m_list);
-        m_list.clear();
+        qDeleteAll(m_entries);
+        m_entries.clear();
+        m_store.clear();
         endResetModel();
         fetchMore();
     }
@@ -220,7 +223,7 @@ void LogsModelNg::setViewStartTime(const QDateTime &viewStartTime)
     if (m_viewStartTime != viewStartTime) {
         m_viewStartTime = viewStartTime;
         emit viewStartTimeChanged();
-        if (m_list.count() == 0 || m_list.last()->timestamp() > m_viewStartTime) {
+        if (m_store.isEmpty() || m_store.timestampAt(m_store.count() - 1) > m_viewStartTime.toMSecsSinceEpoch()) {
             if (canFetchMore()) {
                 fetchMore();
             }
@@ -241,95 +244,77 @@ QVariant LogsModelNg::maxValue() const
 
 LogEntry *LogsModelNg::get(int index) const
 {
-    if (index >= 0 && index < m_list.count()) {
-        return m_list.at(index);
+    if (index < 0 || index >= m_store.count()) {
+        return nullptr;
     }
-    return nullptr;
+    LogEntry *entry = m_entries.value(index);
+    if (!entry) {
+        entry = LogsModel::createEntry(m_store, index, const_cast<LogsModelNg*>(this));
+        m_entries.insert(index, entry);
+    }
+    return entry;
 }
 
 LogEntry *LogsModelNg::findClosest(const QDateTime &dateTime) const
 {
-//    qWarning() << "********************Finding closest for:" << dateTime.toString();
-//    foreach (LogEntry *entry, m_list) {
-//        qWarning() << "List entry:" << entry->timestamp().toString();
-//    }
-    if (m_list.isEmpty()) {
-//        qWarning() << "No entries here...";
+    if (m_store.isEmpty()) {
         return nullptr;
     }
+    // Entries are newest first
+    qint64 searched = dateTime.toMSecsSinceEpoch();
     int newest = 0;
-    int oldest = m_list.count() - 1;
-    LogEntry *entry = nullptr;
+    int oldest = m_store.count() - 1;
     int step = 0;
 
-    LogEntry *allTimeOldestEntry = m_list.at(oldest);
-    if (dateTime < allTimeOldestEntry->timestamp()) {
-//        qWarning() << "All time oldest is newer than searched";
+    if (searched < m_store.timestampAt(oldest)) {
         return nullptr;
     }
-//    qWarning() << "Oldest:" << oldest << "newest:" << newest << "step" << step << "count" << m_list.count();
-    while (oldest >= newest && step < m_list.count()) {
-        LogEntry *oldestEntry = m_list.at(oldest);
-        LogEntry *newestEntry = m_list.at(newest);
+    while (oldest >= newest && step < m_store.count()) {
         int middle = (oldest - newest) / 2 + newest;
-        LogEntry *middleEntry = m_list.at(middle);
-//        qWarning() << "Oldest:" << oldest << oldestEntry->timestamp().toString() << oldestEntry->value() << "Middle:" << middle << middleEntry->timestamp().toString() << middleEntry->value() << "Newest:" << newest << newestEntry->timestamp().toString() << newestEntry->value() << ":" << (oldest - newest);
-        if (dateTime <= oldestEntry->timestamp()) {
-//            qWarning() << "Returning oldest";
-            return oldestEntry;
+        if (searched <= m_store.timestampAt(oldest)) {
+            return get(oldest);
         }
-        if (dateTime >= newestEntry->timestamp()) {
-//            qWarning() << "Returning newest";
-            return newestEntry;
+        if (searched >= m_store.timestampAt(newest)) {
+            return get(newest);
         }
-
-        if (dateTime == middleEntry->timestamp()) {
-//            qWarning() << "Returning middle";
-            return middleEntry;
+        if (searched == m_store.timestampAt(middle)) {
+            return get(middle);
         }
 
-        if (dateTime < middleEntry->timestamp()) {
+        if (searched < m_store.timestampAt(middle)) {
             newest = middle;
         } else {
             oldest = middle;
         }
 
         if (oldest - newest == 1) {
-            if (oldest > middle) {
-//                qWarning() << "EOL. Returning oldest";
-                return oldestEntry;
-            } else {
-//                qWarning() << "EOL. Returning middle";
-                return middleEntry;
-            }
+            return oldest > middle ? get(oldest) : get(middle);
         }
         step++;
     }
-    return entry;
+    return nullptr;
 }
 
 void LogsModelNg::logsReply(int commandId, const QVariantMap &data)
 {
     Q_UNUSED(commandId)
+    if (JsonRpcClient::isLost(data)) {
+        // Not the end of the logs, the block is fetched again with the next fetchMore()
+        m_busy = false;
+        emit busyChanged();
+        return;
+    }
+
     int offset = data.value("offset").toInt();
     int count = data.value("count").toInt();
 
 //    qDebug() << qUtf8Printable(QJsonDocument::fromVariant(data).toJson());
 
-    QList<LogEntry*> newBlock;
+    LogEntryStore newBlock;
     QList<QVariant> logEntries = data.value("logEntries").toList();
+    newBlock.reserve(logEntries.count());
     foreach (const QVariant &logEntryVariant, logEntries) {
-        QVariantMap entryMap = logEntryVariant.toMap();
-        QDateTime timeStamp = QDateTime::fromMSecsSinceEpoch(entryMap.value("timestamp").toLongLong());
-        QString thingId = entryMap.value("thingId").toString();
-        QString typeId = entryMap.value("typeId").toString();
-        QMetaEnum sourceEnum = QMetaEnum::fromType<LogEntry::LoggingSource>();
-        LogEntry::LoggingSource loggingSource = static_cast<LogEntry::LoggingSource>(sourceEnum.keyToValue(entryMap.value("source").toByteArray()));
-        QMetaEnum loggingEventTypeEnum = QMetaEnum::fromType<LogEntry::LoggingEventType>();
-        LogEntry::LoggingEventType loggingEventType = static_cast<LogEntry::LoggingEventType>(loggingEventTypeEnum.keyToValue(entryMap.value("eventType").toByteArray()));
-        QVariant value = loggingEventType == LogEntry::LoggingEventTypeActiveChange ? entryMap.value("active").toBool() : entryMap.value("value");
-        LogEntry *entry = new LogEntry(timeStamp, value, thingId, typeId, loggingSource, loggingEventType, entryMap.value("errorCode").toString(), this);
-        newBlock.append(entry);
+        LogsModel::appendEntry(&newBlock, logEntryVariant.toMap());
     }
 
     qDebug() << "Received logs from" << offset << "to" << offset + count << "Actual count:" << newBlock.count();
@@ -344,21 +329,24 @@ void LogsModelNg::logsReply(int commandId, const QVariantMap &data)
         return;
     }
 
-    beginInsertRows(QModelIndex(), offset, offset + newBlock.count() - 1);
+    insertEntries(qMin(offset, m_store.count()), newBlock);
+
+    int valueColumn = newBlock.column("value");
     QVariant newMin = m_minValue;
     QVariant newMax = m_maxValue;
     for (int i = 0; i < newBlock.count(); i++) {
-        LogEntry *entry = newBlock.at(i);
-        m_list.insert(offset + i, entry);
-        Thing *thing = m_engine->thingManager()->things()->getThing(entry->thingId());
+        QDateTime timestamp = QDateTime::fromMSecsSinceEpoch(newBlock.timestampAt(i));
+        QVariant entryValue = newBlock.valueAt(i, valueColumn);
+        QUuid typeId = QUuid(newBlock.valueAt(i, "typeId").toString());
+        Thing *thing = m_engine->thingManager()->things()->getThing(QUuid(newBlock.sourceAt(i)));
         if (!thing) {
             qWarning() << "Thing not found in system. Cannot add item to graph series.";
             continue;
         }
 
-        StateType *entryStateType = thing->thingClass()->stateTypes()->getStateType(entry->typeId());
+        StateType *entryStateType = thing->thingClass()->stateTypes()->getStateType(typeId);
         if (!entryStateType) {
-            qWarning() << "StateType" << entry->typeId() << "not found on thing" << thing->name();
+            qWarning() << "StateType" << typeId << "not found on thing" << thing->name();
             continue;
         }
 
@@ -367,31 +355,30 @@ void LogsModelNg::logsReply(int commandId, const QVariantMap &data)
 
                 // We don't want bools painting triangles, add a toggle point to keep lines straight
                 if (i > 0) {
-                    LogEntry *newerEntry = newBlock.at(i - 1);
-                    if (newerEntry->value().toBool() != entry->value().toBool()) {
-                        m_graphSeries->append(QPointF(newerEntry->timestamp().addMSecs(-1).toMSecsSinceEpoch(), entry->value().toBool() ? 1 : 0));
+                    if (newBlock.valueAt(i - 1, valueColumn).toBool() != entryValue.toBool()) {
+                        m_graphSeries->append(QPointF(newBlock.timestampAt(i - 1) - 1, entryValue.toBool() ? 1 : 0));
                     }
                 }
 
                 if (m_graphSeries->count() == 0) {
                     // If it's the first one, make sure we add an ending point at 1
                     m_graphSeries->append(QPointF(QDateTime::currentDateTime().addDays(1).toMSecsSinceEpoch(), 1));
-                    m_graphSeries->append(QPointF(QDateTime::currentDateTime().addDays(1).toMSecsSinceEpoch(), entry->value().toBool() ? 1 : 0));
+                    m_graphSeries->append(QPointF(QDateTime::currentDateTime().addDays(1).toMSecsSinceEpoch(), entryValue.toBool() ? 1 : 0));
                 } else if (i == 0) {
                     // Adding a new batch...  remove the last appended 1 from the previous batch
                     m_graphSeries->remove(m_graphSeries->count() - 1);
                 }
-                m_graphSeries->append(QPointF(entry->timestamp().toMSecsSinceEpoch(), entry->value().toBool() ? 1 : 0));
+                m_graphSeries->append(QPointF(timestamp.toMSecsSinceEpoch(), entryValue.toBool() ? 1 : 0));
                 if (i == newBlock.count() - 1) {
                     // End the batch at 1 again
-                    m_graphSeries->append(QPointF(entry->timestamp().addSecs(60).toMSecsSinceEpoch(), 1));
+                    m_graphSeries->append(QPointF(timestamp.addSecs(60).toMSecsSinceEpoch(), 1));
                 }
 
                 // Adjust min/max
-                if (!newMin.isValid() || newMin > entry->value()) {
+                if (!newMin.isValid() || newMin > entryValue) {
                     newMin = 0;
                 }
-                if (!newMax.isValid() || newMax < entry->value()) {
+                if (!newMax.isValid() || newMax < entryValue) {
                     newMax = 1;
                 }
 
@@ -399,12 +386,12 @@ void LogsModelNg::logsReply(int commandId, const QVariantMap &data)
 
                 // Add a point in the future to extend the graph (so it can scroll with time and the graph wouldn't end at the last known value)
                 if (m_graphSeries->count() == 0) {
-                    m_graphSeries->append(QPointF(QDateTime::currentDateTime().addDays(1).toMSecsSinceEpoch(), Types::instance()->toUiValue(entry->value(), entryStateType->unit()).toReal()));
+                    m_graphSeries->append(QPointF(QDateTime::currentDateTime().addDays(1).toMSecsSinceEpoch(), Types::instance()->toUiValue(entryValue, entryStateType->unit()).toReal()));
                 }
 
                 // Add the actual value
-                QVariant value = Types::instance()->toUiValue(entry->value(), entryStateType->unit());
-                m_graphSeries->append(QPointF(entry->timestamp().toMSecsSinceEpoch(), value.toReal()));
+                QVariant value = Types::instance()->toUiValue(entryValue, entryStateType->unit());
+                m_graphSeries->append(QPointF(timestamp.toMSecsSinceEpoch(), value.toReal()));
 
                 // Adjust min/max
                 if (!newMin.isValid() || newMin > value) {
@@ -416,9 +403,6 @@ void LogsModelNg::logsReply(int commandId, const QVariantMap &data)
             }
         }
     }
-    endInsertRows();
-    emit countChanged();
-
     qDebug() << "min" << m_minValue << "max" << m_maxValue << "newMin" << newMin << "newMax" << newMax;
     if (m_minValue != newMin) {
         m_minValue = newMin;
@@ -432,7 +416,7 @@ void LogsModelNg::logsReply(int commandId, const QVariantMap &data)
     m_busy = false;
     emit busyChanged();
 
-    if (m_viewStartTime.isValid() && m_list.count() > 0 && m_list.last()->timestamp() > m_viewStartTime && canFetchMore()) {
+    if (m_viewStartTime.isValid() && !m_store.isEmpty() && m_store.timestampAt(m_store.count() - 1) > m_viewStartTime.toMSecsSinceEpoch() && canFetchMore()) {
         fetchMore();
     }
 }
@@ -483,7 +467,7 @@ void LogsModelNg::fetchMore(const QModelIndex &parent)
     }
 
     params.insert("limit", m_blockSize);
-    params.insert("offset", m_list.count());
+    params.insert("offset", m_store.count());
 
 //    qDebug() << "Fetching logs:" << qUtf8Printable(QJsonDocument::fromVariant(params).toJson());
 
@@ -516,28 +500,23 @@ void LogsModelNg::newLogEntryReceived(const QVariantMap &data)
         return;
     }
 
-    QDateTime timeStamp = QDateTime::fromMSecsSinceEpoch(entryMap.value("timestamp").toLongLong());
-    QMetaEnum sourceEnum = QMetaEnum::fromType<LogEntry::LoggingSource>();
-    LogEntry::LoggingSource loggingSource = static_cast<LogEntry::LoggingSource>(sourceEnum.keyToValue(entryMap.value("source").toByteArray()));
-    QMetaEnum loggingEventTypeEnum = QMetaEnum::fromType<LogEntry::LoggingEventType>();
-    LogEntry::LoggingEventType loggingEventType = static_cast<LogEntry::LoggingEventType>(loggingEventTypeEnum.keyToValue(entryMap.value("eventType").toByteArray()));
-    QVariant value = loggingEventType == LogEntry::LoggingEventTypeActiveChange ? entryMap.value("active").toBool() : entryMap.value("value");
-    LogEntry *entry = new LogEntry(timeStamp, value, thingId, typeId, loggingSource, loggingEventType, entryMap.value("errorCode").toString(), this);
-
-    Thing *dev = m_engine->thingManager()->things()->getThing(entry->thingId());
+    Thing *dev = m_engine->thingManager()->things()->getThing(thingId);
     if (!dev) {
-        delete entry;
         qCWarning(dcLogEngine) << "Received a log entry for a thing we don't know. Discarding.";
         return;
     }
 
-    beginInsertRows(QModelIndex(), 0, 0);
-    m_list.prepend(entry);
+    LogEntryStore entry;
+    LogsModel::appendEntry(&entry, entryMap);
+    QDateTime timestamp = QDateTime::fromMSecsSinceEpoch(entry.timestampAt(0));
+    QVariant entryValue = entry.valueAt(0, "value");
+    insertEntries(0, entry);
+
     if (m_graphSeries) {
 
-        StateType *entryStateType = dev->thingClass()->stateTypes()->getStateType(entry->typeId());
+        StateType *entryStateType = dev->thingClass()->stateTypes()->getStateType(typeId);
 
-        if (dev && dev->thingClass()->stateTypes()->getStateType(entry->typeId())->type().toLower() == "bool") {
+        if (dev && dev->thingClass()->stateTypes()->getStateType(typeId)->type().toLower() == "bool") {
             // First, remove the 2 rightmost (newest on the timeline) values. They're the ones in the future we added to extend the graph and making it end at 1
             if (m_graphSeries->count() > 1) {
                 m_graphSeries->removePoints(0, 2);
@@ -546,15 +525,15 @@ void LogsModelNg::newLogEntryReceived(const QVariantMap &data)
             // Prevent triangles, add a point right before the new one which reflects the old value (if there is one)
             if (m_graphSeries->points().count() > 0) {
                 qreal previousValue = m_graphSeries->points().at(0).y();
-                m_graphSeries->insert(0, QPointF(entry->timestamp().addMSecs(-1).toMSecsSinceEpoch(), previousValue));
+                m_graphSeries->insert(0, QPointF(timestamp.addMSecs(-1).toMSecsSinceEpoch(), previousValue));
             }
 
             // Add the actual value
-            m_graphSeries->insert(0, QPointF(entry->timestamp().toMSecsSinceEpoch(), entry->value().toBool() ? 1 : 0));
+            m_graphSeries->insert(0, QPointF(timestamp.toMSecsSinceEpoch(), entryValue.toBool() ? 1 : 0));
 
             // And add the 2 "future" points again
-            m_graphSeries->insert(0, QPointF(entry->timestamp().addDays(1).toMSecsSinceEpoch(), entry->value().toBool() ? 1 : 0));
-            m_graphSeries->insert(0, QPointF(entry->timestamp().addDays(1).toMSecsSinceEpoch(), 1));
+            m_graphSeries->insert(0, QPointF(timestamp.addDays(1).toMSecsSinceEpoch(), entryValue.toBool() ? 1 : 0));
+            m_graphSeries->insert(0, QPointF(timestamp.addDays(1).toMSecsSinceEpoch(), 1));
 
         } else {
 
@@ -564,26 +543,39 @@ void LogsModelNg::newLogEntryReceived(const QVariantMap &data)
             }
 
             // Add the actual value
-            QVariant value = Types::instance()->toUiValue(entry->value(), entryStateType->unit());
-            m_graphSeries->insert(0, QPointF(entry->timestamp().toMSecsSinceEpoch(), value.toReal()));
+            QVariant value = Types::instance()->toUiValue(entryValue, entryStateType->unit());
+            m_graphSeries->insert(0, QPointF(timestamp.toMSecsSinceEpoch(), value.toReal()));
 
             // And add the "future" point again
-            m_graphSeries->insert(0, QPointF(entry->timestamp().addDays(1).toMSecsSinceEpoch(), value.toReal()));
+            m_graphSeries->insert(0, QPointF(timestamp.addDays(1).toMSecsSinceEpoch(), value.toReal()));
         }
 
 
-        if (m_minValue > entry->value().toReal()) {
-            m_minValue = entry->value().toReal();
+        if (m_minValue > entryValue.toReal()) {
+            m_minValue = entryValue.toReal();
             emit minValueChanged();
         }
-        if (m_maxValue < entry->value().toReal()) {
-            m_maxValue = entry->value().toReal();
+        if (m_maxValue < entryValue.toReal()) {
+            m_maxValue = entryValue.toReal();
             emit maxValueChanged();
         }
     }
+}
+
+void LogsModelNg::insertEntries(int index, const LogEntryStore &entries)
+{
+    beginInsertRows(QModelIndex(), index, index + entries.count() - 1);
+    if (index < m_store.count()) {
+        QHash<int, LogEntry*> shifted;
+        shifted.reserve(m_entries.count());
+        for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it) {
+            shifted.insert(it.key() >= index ? it.key() + entries.count() : it.key(), it.value());
+        }
+        m_entries = shifted;
+    }
+    m_store.insert(index, entries);
     endInsertRows();
     emit countChanged();
-
 }
 
 
@@ -38,6 +38,8 @@
 #include <QUuid>
 #include <QQmlParserStatus>
 
+#include "logentrystore.h"
+
 class LogEntry;
 class Engine;
 
@@ -132,7 +134,9 @@ private slots:
     void logsReply(int commandId, const QVariantMap &data);
 
 private:
-    QList<LogEntry*> m_list;
+    LogEntryStore m_store;
+    // Wrappers handed out by get(), by index. They stay alive until the model is reset as QML may hold on to them.
+    mutable QHash<int, LogEntry*> m_entries;
 
     Engine *m_engine = nullptr;
     bool m_busy = false;
@@ -151,6 +155,8 @@ private:
     QtCharts::QXYSeries *m_graphSeries = nullptr;
 
     QList<QPair<QDateTime, bool> > m_fetchedPeriods;
+
+    void insertEntries(int index, const LogEntryStore &entries);
 };
 
 
@@ -9,32 +9,38 @@ Q_DECLARE_LOGGING_CATEGORY(dcLogEngine)
 
 #include <QJsonDocument>
 #include <QMetaEnum>
+#include <QMetaMethod>
+#include <QTimer>
+#include <QtMath>
+
+#include <algorithm>
+
+// Upper limit for the adaptive page size
+static const int maxPageSize = 1000;
 
 NewLogsModel::NewLogsModel(QObject *parent)
     : QAbstractListModel{parent}
 {
-    // Workaround for older Qt versions (5.12 and older) which can't deal with the QList<EnergyLogEntry*> argument
-    connect(this, &NewLogsModel::entriesAdded, this, [this](int index, const QList<NewLogEntry*> &entries){
-        emit entriesAddedIdx(index, entries.count());
-    });
-
+    m_clock.start();
 }
 
 int NewLogsModel::rowCount(const QModelIndex &parent) const
 {
     Q_UNUSED(parent)
-    return m_list.count();
+    return m_store.count();
 }
 
 QVariant NewLogsModel::data(const QModelIndex &index, int role) const
 {
+    readAhead(index.row());
+
     switch (role) {
     case RoleSource:
-        return m_list.at(index.row())->source();
+        return m_store.sourceAt(index.row());
     case RoleTimestamp:
-        return m_list.at(index.row())->timestamp();
+        return QDateTime::fromMSecsSinceEpoch(m_store.timestampAt(index.row()));
     case RoleValues:
-        return m_list.at(index.row())->values();
+        return m_store.valuesAt(index.row());
     }
 
     return QVariant();
@@ -63,8 +69,18 @@ void NewLogsModel::componentComplete()
 bool NewLogsModel::canFetchMore(const QModelIndex &parent) const
 {
     Q_UNUSED(parent)
-    // Cannot fetchMore when there are multiple sources as paging doesn't really work in that case
-    return m_canFetchMore && (m_sources.count() == 1 || m_list.isEmpty());
+    if (!paging()) {
+        return m_canFetchMore && (m_sources.count() == 1 || m_store.isEmpty());
+    }
+    if (m_cursors.isEmpty()) {
+        return !m_sources.isEmpty();
+    }
+    foreach (const Cursor &cursor, m_cursors) {
+        if (!cursor.exhausted || cursor.position < cursor.pending.count()) {
+            return true;
+        }
+    }
+    return false;
 }
 
 void NewLogsModel::fetchMore(const QModelIndex &parent)
@@ -78,6 +94,8 @@ void NewLogsModel::fetchMore(const QModelIndex &parent)
         return;
     }
 
+    // A view is scrolling through the model, from now on keep a page ahead of it
+    m_viewDriven = true;
     fetchLogs();
 
 }
@@ -243,53 +261,60 @@ void NewLogsModel::setFetchBlockSize(int fetchBlockSize)
 
 NewLogEntry *NewLogsModel::get(int index) const
 {
-    if (index < 0 || index >= m_list.count()) {
+    if (index < 0 || index >= m_store.count()) {
         return nullptr;
     }
-    return m_list.at(index);
+    readAhead(index);
+
+    NewLogEntry *entry = m_entries.value(index);
+    if (!entry) {
+        QDateTime timestamp = QDateTime::fromMSecsSinceEpoch(m_store.timestampAt(index));
+        entry = new NewLogEntry(m_store.sourceAt(index), timestamp, m_store.valuesAt(index), const_cast<NewLogsModel*>(this));
+        m_entries.insert(index, entry);
+    }
+    return entry;
 }
 
 NewLogEntry *NewLogsModel::find(const QDateTime &timestamp) const
 {
 //    qCDebug(dcLogEngine()) << "finding:" << timestamp.toString();
-    if (m_list.isEmpty()) {
+    if (m_store.isEmpty()) {
         return nullptr;
     }
-    int idx = m_list.count() / 2;
-    int jump = m_list.count() / 4;
+    qint64 searched = timestamp.toMSecsSinceEpoch();
+    int idx = m_store.count() / 2;
+    int jump = m_store.count() / 4;
     int stopper = 10;
     while (stopper-- > 0) {
-//        qCDebug(dcLogEngine()) << "idx:" << idx << "cnt:" << m_list.count() << "jmp" << jump;
-        NewLogEntry *entry = m_list.at(idx);
-        if (entry->timestamp() == timestamp) {
+//        qCDebug(dcLogEngine()) << "idx:" << idx << "cnt:" << m_store.count() << "jmp" << jump;
+        qint64 entryTimestamp = m_store.timestampAt(idx);
+        if (entryTimestamp == searched) {
 //            qCDebug(dcLogEngine()) << "found exact";
-            return entry;
+            return get(idx);
         }
-        qint64 diff = timestamp.msecsTo(entry->timestamp());
-        if (entry->timestamp() > timestamp) {
-//            qCDebug(dcLogEngine()) << "entry is newer than searched:" << entry->timestamp().toString() << timestamp.toString();
+        qint64 diff = entryTimestamp - searched;
+        if (entryTimestamp > searched) {
+//            qCDebug(dcLogEngine()) << "entry is newer than searched:" << entryTimestamp << searched;
             if (idx == 0) {
 //                qCDebug(dcLogEngine()) << "Is oldest.";
-                return entry;
+                return get(idx);
             }
-            NewLogEntry *previousEntry = m_list.at(idx-1);
-            if (previousEntry->timestamp() < timestamp) {
-                qint64 previousDiff = timestamp.msecsTo(previousEntry->timestamp());
-//                qCDebug(dcLogEngine()) << "time between this and previous:" << entry->timestamp().toString() << previousEntry->timestamp().toString() << (qAbs(previousDiff) < qAbs(diff) ? "next" : "this");
-                return qAbs(previousDiff) < qAbs(diff) ? previousEntry : entry;
+            qint64 previousTimestamp = m_store.timestampAt(idx - 1);
+            if (previousTimestamp < searched) {
+                qint64 previousDiff = previousTimestamp - searched;
+                return qAbs(previousDiff) < qAbs(diff) ? get(idx - 1) : get(idx);
             }
             idx -= jump;
-        } else if (entry->timestamp() < timestamp) {
-//            qCDebug(dcLogEngine()) << "entry is older than searched:" << entry->timestamp().toString() << timestamp.toString();
-            if (idx == m_list.count() - 1) {
+        } else if (entryTimestamp < searched) {
+//            qCDebug(dcLogEngine()) << "entry is older than searched:" << entryTimestamp << searched;
+            if (idx == m_store.count() - 1) {
 //                qCDebug(dcLogEngine()) << "Is newest.";
-                return entry;
+                return get(idx);
             }
-            NewLogEntry *nextEntry = m_list.at(idx+1);
-            if (nextEntry->timestamp() > timestamp) {
-                qint64 nextDiff = timestamp.msecsTo(nextEntry->timestamp());
-//                qCDebug(dcLogEngine()) << "time between next and this:" << nextEntry->timestamp().toString() << "-" << entry->timestamp().toString()  << (qAbs(nextDiff) > qAbs(diff) ? "prev" : "this");
-                return qAbs(nextDiff) < qAbs(diff) ? nextEntry : entry;
+            qint64 nextTimestamp = m_store.timestampAt(idx + 1);
+            if (nextTimestamp > searched) {
+                qint64 nextDiff = nextTimestamp - searched;
+                return qAbs(nextDiff) < qAbs(diff) ? get(idx + 1) : get(idx);
             }
             idx += jump;
         }
@@ -300,13 +325,31 @@ NewLogEntry *NewLogsModel::find(const QDateTime &timestamp) const
 
 void NewLogsModel::clear()
 {
-    int count = m_list.count();
+    int count = m_store.count();
     beginResetModel();
-    qDeleteAll(m_list);
-    m_list.clear();
+    qDeleteAll(m_entries);
+    m_entries.clear();
+    m_store.clear();
+    m_liveCount = 0;
     m_currentNewest = QDateTime();
-    m_lastOffset = 0;
+    m_cursors.clear();
+    // Whatever is still on the way is for the previous range
+    if (m_engine) {
+        foreach (int commandId, m_pendingPages.keys()) {
+            m_engine->jsonRpcClient()->cancel(commandId);
+        }
+        if (m_pendingFetch != -1) {
+            m_engine->jsonRpcClient()->cancel(m_pendingFetch);
+        }
+    }
+    m_pendingPages.clear();
+    m_pendingFetch = -1;
+    m_pageSize = 0;
+    m_viewedRow = -1;
+    m_scrollVelocity = 0;
+    m_velocityTime = -1;
     endResetModel();
+    updateBusy();
     emit countChanged();
     emit entriesRemoved(0, count);
 }
@@ -316,6 +359,11 @@ void NewLogsModel::fetchLogs()
     if (!m_engine) {
         return;
     }
+    if (paging()) {
+        fetchPages();
+        return;
+    }
+
     QVariantMap params {
         {"sources", m_sources},
         {"columns", m_columns},
@@ -323,23 +371,9 @@ void NewLogsModel::fetchLogs()
     };
 
 
-    if (m_sampleRate == SampleRateAny) { // Discrete logs
-
-        if (!m_startTime.isNull() && !m_endTime.isNull()) { // Either specific time frame
-            params.insert("startTime", m_startTime.toMSecsSinceEpoch());
-            params.insert("endTime", m_endTime.toMSecsSinceEpoch());
-
-        } else {
-            params.insert("limit", m_blockSize);
-            if (m_list.count() > 0) {
-                if (m_currentNewest.isNull()) {
-                    m_currentNewest = QDateTime::currentDateTime();
-                }
-                params.insert("offset", m_lastOffset);
-                params.insert("endTime", m_currentNewest.toMSecsSinceEpoch());
-            }
-            m_lastOffset += m_blockSize;
-        }
+    if (m_sampleRate == SampleRateAny) { // Discrete logs in a specific time frame
+        params.insert("startTime", m_startTime.toMSecsSinceEpoch());
+        params.insert("endTime", m_endTime.toMSecsSinceEpoch());
 
     } else {
         if (!m_startTime.isNull() && !m_endTime.isNull()) {
@@ -357,8 +391,13 @@ void NewLogsModel::fetchLogs()
     QMetaEnum sortOrderEnum = QMetaEnum::fromType<Qt::SortOrder>();
     params.insert("sortOrder", sortOrderEnum.valueToKey(m_sortOrder));
 
+    // A new range replaces whatever has been asked for before
+    if (m_pendingFetch != -1) {
+        m_engine->jsonRpcClient()->cancel(m_pendingFetch);
+    }
+
     qCDebug(dcLogEngine()) << "Fetching logs:" << QJsonDocument::fromVariant(params).toJson();
-    m_engine->jsonRpcClient()->sendCommand("Logging.GetLogEntries", params, this, "logsReply");
+    m_pendingFetch = m_engine->jsonRpcClient()->sendCommand("Logging.GetLogEntries", params, this, "logsReply", JsonRpcClient::fetchTimeout);
 
     m_busy = true;
     emit busyChanged();
@@ -366,75 +405,298 @@ void NewLogsModel::fetchLogs()
 
 void NewLogsModel::logsReply(int commandId, const QVariantMap &data)
 {
-    Q_UNUSED(commandId)
+    if (commandId != m_pendingFetch) {
+        return;
+    }
+    m_pendingFetch = -1;
 
     m_busy = false;
     emit busyChanged();
 
-    QList<NewLogEntry*> entries;
-    foreach (const QVariant &entryVariant, data.value("logEntries").toList()) {
-        QVariantMap map = entryVariant.toMap();
-        QString source = map.value("source").toString();
-        QDateTime timestamp = QDateTime::fromMSecsSinceEpoch(map.value("timestamp").toULongLong());
-        QVariantMap values = map.value("values").toMap();
-        NewLogEntry *entry = new NewLogEntry(source, timestamp, values, this);
-        entries.append(entry);
-
+    if (!data.contains("logEntries")) {
+        qCWarning(dcLogEngine()) << "Fetching logs failed:" << data;
+        return;
     }
 
+    LogEntryStore entries = unpackEntries(data.value("logEntries").toList(), false);
+
     m_canFetchMore = entries.count() >= m_blockSize;
     qCDebug(dcLogEngine()) << "Logs received:" << entries.count();
 
-    if (!m_startTime.isNull() && !m_endTime.isNull()) {
-        beginResetModel();
-        QList<NewLogEntry*> oldEntries = m_list;
-        m_list.clear();
-        endResetModel();
-        emit entriesRemoved(0, oldEntries.count());
-        qDeleteAll(oldEntries);
-
-        if (!entries.isEmpty()) {
-            beginInsertRows(QModelIndex(), 0, entries.count() - 1);
-            m_list = entries;
-            endInsertRows();
-            emit entriesAdded(0, entries);
-        }
-        emit countChanged();
+    int oldCount = m_store.count();
+    beginResetModel();
+    qDeleteAll(m_entries);
+    m_entries.clear();
+    m_store.clear();
+    m_liveCount = 0;
+    endResetModel();
+    emit entriesRemoved(0, oldCount);
 
-    } else {
-        if (!entries.isEmpty()) {
-            beginInsertRows(QModelIndex(), m_list.count(), m_list.count() + entries.count() - 1);
-            qSort(entries.begin(), entries.end(), [](NewLogEntry *left, NewLogEntry *right){
-                return left->timestamp() > right->timestamp();
-            });
-            m_list.append(entries);
-            endInsertRows();
-            emit entriesAdded(m_list.count() - entries.count(), entries);
-            emit countChanged();
-        }
+    if (!entries.isEmpty()) {
+        insertEntries(0, entries);
+        emitEntriesAdded(0, entries.count());
+    }
+    emit countChanged();
+}
+
+void NewLogsModel::pageReply(int commandId, const QVariantMap &data)
+{
+    // Pages requested before the last clear() are dropped
+    if (!m_pendingPages.contains(commandId)) {
+        return;
+    }
+    Page page = m_pendingPages.take(commandId);
+    if (!m_cursors.contains(page.source)) {
+        updateBusy();
+        return;
+    }
+
+    Cursor &cursor = m_cursors[page.source];
+    if (!data.contains("logEntries")) {
+        // Leave the cursor where it is, the page is fetched again when the view asks for more
+        qCWarning(dcLogEngine()) << "Fetching page for" << page.source << "at offset" << cursor.offset << "failed";
+        cursor.busy = false;
+        updateBusy();
+        return;
     }
 
+    qint64 rtt = m_clock.elapsed() - page.sentAt;
+    m_pageRtt = m_pageRtt == 0 ? rtt : (7 * m_pageRtt + rtt) / 8;
+
+    LogEntryStore entries = unpackEntries(data.value("logEntries").toList(), true);
+    qCDebug(dcLogEngine()) << "Page received for" << page.source << "at offset" << cursor.offset << ":" << entries.count() << "entries in" << rtt << "ms";
+
+    cursor.busy = false;
+    cursor.offset += entries.count();
+    cursor.exhausted = entries.count() < page.limit;
+    cursor.pending = cursor.pending.mid(cursor.position);
+    cursor.position = 0;
+    cursor.pending.insert(cursor.pending.count(), entries);
+
+    mergePages();
+    updateBusy();
+    // Sources which ran dry in the merge need their next page, and the view might still be close to the end
+    readAhead(m_viewedRow);
 }
 
 void NewLogsModel::newLogEntryReceived(const QVariantMap &map)
 {
     QString source = map.value("source").toString();
-    QDateTime timestamp = QDateTime::fromMSecsSinceEpoch(map.value("timestamp").toULongLong());
+    qint64 timestamp = map.value("timestamp").toLongLong();
     QVariantMap values = map.value("values").toMap();
 
-    if (m_sources.contains(source) && m_sampleRate == SampleRateAny) {
-        NewLogEntry *entry = new NewLogEntry(source, timestamp, values, this);
+    if (!m_sources.contains(source) || m_sampleRate != SampleRateAny) {
+        return;
+    }
+    if (paging()) {
+        // The pages bring everything up to m_currentNewest, which is pinned with the first one
+        if (m_cursors.isEmpty() || timestamp <= m_currentNewest.toMSecsSinceEpoch()) {
+            return;
+        }
+        // Newer than anything paged. In ascending order the pages still to come go in before it.
         if (m_sortOrder == Qt::AscendingOrder) {
-            beginInsertRows(QModelIndex(), m_list.count(), m_list.count());
-            m_list.append(entry);
-            endInsertRows();
-            emit entriesAdded(m_list.count() - 1, {entry});
-        } else {
-            beginInsertRows(QModelIndex(), 0, 0);
-            m_list.prepend(entry);
-            endInsertRows();
-            emit entriesAdded(0, {entry});
+            m_liveCount++;
+        }
+    }
+
+    LogEntryStore entry;
+    entry.append(timestamp, source, values);
+    int index = m_sortOrder == Qt::AscendingOrder ? m_store.count() : 0;
+    insertEntries(index, entry);
+    emitEntriesAdded(index, 1);
+    emit countChanged();
+}
+
+void NewLogsModel::insertEntries(int index, const LogEntryStore &entries)
+{
+    beginInsertRows(QModelIndex(), index, index + entries.count() - 1);
+    if (index < m_store.count()) {
+        QHash<int, NewLogEntry*> shifted;
+        shifted.reserve(m_entries.count());
+        for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it) {
+            shifted.insert(it.key() >= index ? it.key() + entries.count() : it.key(), it.value());
+        }
+        m_entries = shifted;
+    }
+    m_store.insert(index, entries);
+    endInsertRows();
+}
+
+void NewLogsModel::emitEntriesAdded(int index, int count)
+{
+    // Workaround for older Qt versions (5.12 and older) which can't deal with the QList<NewLogEntry*> argument
+    emit entriesAddedIdx(index, count);
+
+    // Only create wrappers if someone actually listens for them
+    if (isSignalConnected(QMetaMethod::fromSignal(&NewLogsModel::entriesAdded))) {
+        QList<NewLogEntry*> entries;
+        entries.reserve(count);
+        for (int i = 0; i < count; i++) {
+            entries.append(get(index + i));
+        }
+        emit entriesAdded(index, entries);
+    }
+}
+
+bool NewLogsModel::paging() const
+{
+    return m_sampleRate == SampleRateAny && (m_startTime.isNull() || m_endTime.isNull());
+}
+
+void NewLogsModel::readAhead(int row) const
+{
+    m_viewedRow = qMax(m_viewedRow, row);
+    if (!m_viewDriven || m_readAheadScheduled || !m_engine || !paging()) {
+        return;
+    }
+    // Fetch the next page while the view is still a page away from the end of the paged entries
+    if (m_store.count() - m_liveCount - 1 - m_viewedRow >= qMax(m_pageSize, m_blockSize) || !canFetchMore(QModelIndex())) {
+        return;
+    }
+    // Not from within data(), views don't expect the model to change while they read it
+    m_readAheadScheduled = true;
+    QTimer::singleShot(0, const_cast<NewLogsModel*>(this), &NewLogsModel::fetchPages);
+}
+
+void NewLogsModel::fetchPages()
+{
+    m_readAheadScheduled = false;
+    if (!m_engine || !paging()) {
+        return;
+    }
+
+    if (m_cursors.isEmpty()) {
+        // Pin the end of the paged range so new entries don't shift the offsets, they come in live
+        m_currentNewest = QDateTime::currentDateTime();
+        foreach (const QString &source, m_sources) {
+            m_cursors.insert(source, Cursor());
+        }
+    }
+
+    updatePageSize();
+
+    QMetaEnum sortOrderEnum = QMetaEnum::fromType<Qt::SortOrder>();
+    for (auto it = m_cursors.begin(); it != m_cursors.end(); ++it) {
+        Cursor &cursor = it.value();
+        // Sources which still have a page buffered don't need more yet
+        if (cursor.exhausted || cursor.busy || cursor.pending.count() - cursor.position >= m_pageSize) {
+            continue;
+        }
+        QVariantMap params {
+            {"sources", QStringList(it.key())},
+            {"columns", m_columns},
+            {"filter", m_filter},
+            {"limit", m_pageSize},
+            {"offset", cursor.offset},
+            {"endTime", m_currentNewest.toMSecsSinceEpoch()},
+            {"sortOrder", sortOrderEnum.valueToKey(m_sortOrder)}
+        };
+        qCDebug(dcLogEngine()) << "Fetching page:" << QJsonDocument::fromVariant(params).toJson();
+        int commandId = m_engine->jsonRpcClient()->sendCommand("Logging.GetLogEntries", params, this, "pageReply", JsonRpcClient::fetchTimeout);
+
+        Page page;
+        page.source = it.key();
+        page.limit = m_pageSize;
+        page.sentAt = m_clock.elapsed();
+        m_pendingPages.insert(commandId, page);
+        cursor.busy = true;
+    }
+    updateBusy();
+}
+
+void NewLogsModel::updatePageSize()
+{
+    qint64 now = m_clock.elapsed();
+    int viewedRow = qMax(m_viewedRow, 0);
+    if (m_velocityTime >= 0 && now > m_velocityTime) {
+        double velocity = qMax(0, viewedRow - m_velocityRow) * 1000.0 / (now - m_velocityTime);
+        m_scrollVelocity = (m_scrollVelocity + velocity) / 2;
+    }
+    m_velocityRow = viewedRow;
+    m_velocityTime = now;
+
+    // A page should last for two round trips at the current scroll speed
+    int pageSize = qCeil(m_scrollVelocity * m_pageRtt / 1000 * 2);
+    m_pageSize = qBound(m_blockSize, pageSize, qMax(m_blockSize, maxPageSize));
+}
+
+void NewLogsModel::mergePages()
+{
+    // k-way merge of the buffered pages in sort order. An entry can only go in once every source
+    // which may still have entries before it has something buffered to compare with.
+    LogEntryStore merged;
+    while (true) {
+        Cursor *next = nullptr;
+        bool blocked = false;
+        for (auto it = m_cursors.begin(); it != m_cursors.end(); ++it) {
+            Cursor &cursor = it.value();
+            if (cursor.position == cursor.pending.count()) {
+                if (!cursor.exhausted) {
+                    blocked = true;
+                    break;
+                }
+                continue;
+            }
+            if (!next) {
+                next = &cursor;
+                continue;
+            }
+            qint64 timestamp = cursor.pending.timestampAt(cursor.position);
+            qint64 nextTimestamp = next->pending.timestampAt(next->position);
+            if (m_sortOrder == Qt::DescendingOrder ? timestamp > nextTimestamp : timestamp < nextTimestamp) {
+                next = &cursor;
+            }
+        }
+        if (blocked || !next) {
+            break;
+        }
+        merged.append(next->pending, next->position);
+        next->position++;
+    }
+
+    for (auto it = m_cursors.begin(); it != m_cursors.end(); ++it) {
+        if (it.value().position == it.value().pending.count()) {
+            it.value().pending.clear();
+            it.value().position = 0;
         }
+    }
+
+    if (!merged.isEmpty()) {
+        int index = m_store.count() - m_liveCount;
+        insertEntries(index, merged);
+        emitEntriesAdded(index, merged.count());
         emit countChanged();
     }
 }
+
+void NewLogsModel::updateBusy()
+{
+    bool busy = !m_pendingPages.isEmpty() || m_pendingFetch != -1;
+    if (m_busy != busy) {
+        m_busy = busy;
+        emit busyChanged();
+    }
+}
+
+LogEntryStore NewLogsModel::unpackEntries(const QVariantList &logEntries, bool sorted) const
+{
+    QVector<QPair<qint64, int>> timestamps;
+    timestamps.reserve(logEntries.count());
+    for (int i = 0; i < logEntries.count(); i++) {
+        timestamps.append(qMakePair(logEntries.at(i).toMap().value("timestamp").toLongLong(), i));
+    }
+    if (sorted) {
+        Qt::SortOrder sortOrder = m_sortOrder;
+        std::stable_sort(timestamps.begin(), timestamps.end(), [sortOrder](const QPair<qint64, int> &left, const QPair<qint64, int> &right){
+            return sortOrder == Qt::DescendingOrder ? left.first > right.first : left.first < right.first;
+        });
+    }
+
+    LogEntryStore entries;
+    entries.reserve(timestamps.count());
+    foreach (const auto &timestamp, timestamps) {
+        QVariantMap map = logEntries.at(timestamp.second).toMap();
+        entries.append(timestamp.first, map.value("source").toString(), map.value("values").toMap());
+    }
+    return entries;
+}
@@ -3,7 +3,9 @@
 
 #include <QAbstractListModel>
 #include <QQmlParserStatus>
+#include <QElapsedTimer>
 #include "newlogentry.h"
+#include "logentrystore.h"
 
 class Engine;
 
@@ -124,9 +126,30 @@ signals:
 
 private slots:
     void logsReply(int commandId, const QVariantMap &data);
+    void pageReply(int commandId, const QVariantMap &data);
     void newLogEntryReceived(const QVariantMap &map);
+    void fetchPages();
 
 private:
+    // Paging state of a single source in continuous scrolling lists
+    class Cursor {
+    public:
+        // Entries of this source fetched so far, the offset of its next page
+        int offset = 0;
+        bool exhausted = false;
+        bool busy = false;
+        // Fetched entries which are not in the model yet, from position on
+        LogEntryStore pending;
+        int position = 0;
+    };
+
+    class Page {
+    public:
+        QString source;
+        int limit = 0;
+        qint64 sentAt = 0;
+    };
+
     Engine *m_engine = nullptr;
     QStringList m_sources;
     QStringList m_columns;
@@ -146,10 +169,39 @@ private:
     bool m_completed = false;
     bool m_canFetchMore = true;
     int m_blockSize = 50;
-    int m_lastOffset = 0;
     QDateTime m_currentNewest;
-
-    QList<NewLogEntry*> m_list;
+    // One cursor per source, merged into the model in sort order
+    QHash<QString, Cursor> m_cursors;
+    // Page requests in flight, by command id
+    QHash<int, Page> m_pendingPages;
+    // The fetch for time based sampling in flight
+    int m_pendingFetch = -1;
+
+    // Read ahead. The page size grows with the scroll speed and the round trip time, but is at least m_blockSize.
+    bool m_viewDriven = false;
+    mutable bool m_readAheadScheduled = false;
+    mutable int m_viewedRow = -1;
+    int m_pageSize = 0;
+    double m_pageRtt = 0;
+    double m_scrollVelocity = 0;
+    int m_velocityRow = 0;
+    qint64 m_velocityTime = -1;
+    QElapsedTimer m_clock;
+
+    LogEntryStore m_store;
+    // Live entries at the end of m_store in ascending paged lists. Pages are merged in before them.
+    int m_liveCount = 0;
+    // Wrappers handed out by get(), by index. They stay alive until clear() as QML may hold on to them.
+    mutable QHash<int, NewLogEntry*> m_entries;
+
+    bool paging() const;
+    void readAhead(int row) const;
+    void updatePageSize();
+    void mergePages();
+    void updateBusy();
+    LogEntryStore unpackEntries(const QVariantList &logEntries, bool sorted) const;
+    void insertEntries(int index, const LogEntryStore &entries);
+    void emitEntriesAdded(int index, int count);
 };
 
 #endif // NEWLOGSMODEL_H
@@ -0,0 +1,115 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU General Public License as published by the Free Software
+* Foundation, GNU version 3. This project is distributed in the hope that it
+* will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+* Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "rangeaggregate.h"
+
+#include <QtNumeric>
+
+void RangeAggregate::clear()
+{
+    m_sums.clear();
+    m_blockMin.clear();
+    m_blockMax.clear();
+    m_valid = 0;
+}
+
+void RangeAggregate::invalidate(int index)
+{
+    m_valid = qMin(m_valid, qMax(index, 0));
+}
+
+RangeAggregate::Result RangeAggregate::query(const QVector<double> &values, int first, int last) const
+{
+    first = qMax(first, 0);
+    last = qMin(last, values.count());
+    Result ret;
+    if (first >= last) {
+        return ret;
+    }
+    update(values);
+
+    // Whole blocks from the block values, the partial ones at the edges value by value
+    double minValue = qInf();
+    double maxValue = -qInf();
+    int i = first;
+    while (i < last) {
+        if (i % BlockSize == 0 && i + BlockSize <= last) {
+            minValue = qMin(minValue, m_blockMin.at(i / BlockSize));
+            maxValue = qMax(maxValue, m_blockMax.at(i / BlockSize));
+            i += BlockSize;
+        } else {
+            minValue = qMin(minValue, values.at(i));
+            maxValue = qMax(maxValue, values.at(i));
+            i++;
+        }
+    }
+    ret.minValue = minValue;
+    ret.maxValue = maxValue;
+    ret.sum = m_sums.at(last) - m_sums.at(first);
+    ret.count = last - first;
+    return ret;
+}
+
+RangeAggregate::Result RangeAggregate::total(const QVector<double> &values) const
+{
+    return query(values, 0, values.count());
+}
+
+void RangeAggregate::update(const QVector<double> &values) const
+{
+    int count = values.count();
+    m_valid = qMin(m_valid, count);
+    if (m_valid == count && m_sums.count() == count + 1) {
+        return;
+    }
+
+    m_sums.resize(count + 1);
+    m_sums[0] = 0;
+    for (int i = m_valid; i < count; i++) {
+        m_sums[i + 1] = m_sums.at(i) + values.at(i);
+    }
+
+    int blocks = (count + BlockSize - 1) / BlockSize;
+    m_blockMin.resize(blocks);
+    m_blockMax.resize(blocks);
+    for (int block = m_valid / BlockSize; block < blocks; block++) {
+        int first = block * BlockSize;
+        int last = qMin(first + BlockSize, count);
+        double minValue = values.at(first);
+        double maxValue = values.at(first);
+        for (int i = first + 1; i < last; i++) {
+            minValue = qMin(minValue, values.at(i));
+            maxValue = qMax(maxValue, values.at(i));
+        }
+        m_blockMin[block] = minValue;
+        m_blockMax[block] = maxValue;
+    }
+    m_valid = count;
+}
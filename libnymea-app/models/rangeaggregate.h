@@ -0,0 +1,75 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU General Public License as published by the Free Software
+* Foundation, GNU version 3. This project is distributed in the hope that it
+* will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+* Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef RANGEAGGREGATE_H
+#define RANGEAGGREGATE_H
+
+#include <QVector>
+
+// Answers min, max, sum and average of any index range of a series of values it doesn't own,
+// e.g. a column of an EnergyLogStore. Sums come from prefix sums, min and max from the min and
+// max of fixed size blocks, so a query costs O(BlockSize + n / BlockSize). Both are brought up to
+// date lazily on the next query. Appended values are picked up by themselves, values inserted or
+// replaced before the end need an invalidate().
+class RangeAggregate
+{
+public:
+    static const int BlockSize = 64;
+
+    struct Result {
+        double minValue = 0;
+        double maxValue = 0;
+        double sum = 0;
+        int count = 0;
+
+        bool isEmpty() const { return count == 0; }
+        double average() const { return count > 0 ? sum / count : 0; }
+    };
+
+    void clear();
+    // The values from index on have been inserted or replaced
+    void invalidate(int index);
+
+    // Aggregates values in [first, last). values must be the series this aggregate has been invalidated for.
+    Result query(const QVector<double> &values, int first, int last) const;
+    Result total(const QVector<double> &values) const;
+
+private:
+    void update(const QVector<double> &values) const;
+
+    // m_sums[i] is the sum of the values before i
+    mutable QVector<double> m_sums;
+    mutable QVector<double> m_blockMin;
+    mutable QVector<double> m_blockMax;
+    // Values before this index are covered
+    mutable int m_valid = 0;
+};
+
+#endif // RANGEAGGREGATE_H
@@ -0,0 +1,302 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU General Public License as published by the Free Software
+* Foundation, GNU version 3. This project is distributed in the hope that it
+* will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+* Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "sampledlogs.h"
+
+#include "engine.h"
+
+#include "logging.h"
+Q_DECLARE_LOGGING_CATEGORY(dcLogEngine)
+
+#include <QJsonDocument>
+#include <QMetaEnum>
+#include <QtNumeric>
+
+#include <algorithm>
+
+SampledLogs::SampledLogs(QObject *parent)
+    : QObject{parent}
+{
+
+}
+
+Engine *SampledLogs::engine() const
+{
+    return m_engine;
+}
+
+void SampledLogs::setEngine(Engine *engine)
+{
+    if (m_engine != engine) {
+        m_engine = engine;
+        emit engineChanged();
+    }
+}
+
+QStringList SampledLogs::sources() const
+{
+    return m_sources;
+}
+
+void SampledLogs::setSources(const QStringList &sources)
+{
+    if (m_sources != sources) {
+        m_sources = sources;
+        emit sourcesChanged();
+    }
+}
+
+QDateTime SampledLogs::startTime() const
+{
+    return m_startTime;
+}
+
+void SampledLogs::setStartTime(const QDateTime &startTime)
+{
+    if (m_startTime != startTime) {
+        m_startTime = startTime;
+        emit startTimeChanged();
+    }
+}
+
+QDateTime SampledLogs::endTime() const
+{
+    return m_endTime;
+}
+
+void SampledLogs::setEndTime(const QDateTime &endTime)
+{
+    if (m_endTime != endTime) {
+        m_endTime = endTime;
+        emit endTimeChanged();
+    }
+}
+
+NewLogsModel::SampleRate SampledLogs::sampleRate() const
+{
+    return m_sampleRate;
+}
+
+void SampledLogs::setSampleRate(NewLogsModel::SampleRate sampleRate)
+{
+    if (m_sampleRate != sampleRate) {
+        m_sampleRate = sampleRate;
+        emit sampleRateChanged();
+    }
+}
+
+int SampledLogs::count() const
+{
+    return m_timestamps.count();
+}
+
+bool SampledLogs::busy() const
+{
+    return m_pendingCommand != -1;
+}
+
+qint64 SampledLogs::timestampAt(int row) const
+{
+    return m_timestamps.at(row);
+}
+
+int SampledLogs::column(const QString &source, const QString &name) const
+{
+    return m_columnIndexes.value(qMakePair(source, name), -1);
+}
+
+double SampledLogs::valueAt(int row, int column) const
+{
+    if (column < 0 || column >= m_columns.count()) {
+        return qQNaN();
+    }
+    return m_columns.at(column).at(row);
+}
+
+QDateTime SampledLogs::timestamp(int row) const
+{
+    if (row < 0 || row >= m_timestamps.count()) {
+        return QDateTime();
+    }
+    return QDateTime::fromMSecsSinceEpoch(m_timestamps.at(row));
+}
+
+QVariant SampledLogs::value(int row, const QString &source, const QString &name) const
+{
+    if (row < 0 || row >= m_timestamps.count()) {
+        return QVariant();
+    }
+    double value = valueAt(row, column(source, name));
+    return qIsNaN(value) ? QVariant() : QVariant(value);
+}
+
+int SampledLogs::find(const QDateTime &timestamp) const
+{
+    if (m_timestamps.isEmpty()) {
+        return -1;
+    }
+    qint64 searched = timestamp.toMSecsSinceEpoch();
+    int row = static_cast<int>(std::lower_bound(m_timestamps.constBegin(), m_timestamps.constEnd(), searched) - m_timestamps.constBegin());
+    if (row == m_timestamps.count()) {
+        return row - 1;
+    }
+    if (row > 0 && searched - m_timestamps.at(row - 1) < m_timestamps.at(row) - searched) {
+        return row - 1;
+    }
+    return row;
+}
+
+void SampledLogs::clear()
+{
+    bool wasBusy = busy();
+    int oldCount = m_timestamps.count();
+    if (m_engine && m_pendingCommand != -1) {
+        m_engine->jsonRpcClient()->cancel(m_pendingCommand);
+    }
+    m_pendingCommand = -1;
+    m_timestamps.clear();
+    m_columnIndexes.clear();
+    m_columns.clear();
+    emit samplesChanged();
+    if (oldCount != 0) {
+        emit countChanged();
+    }
+    if (wasBusy) {
+        emit busyChanged();
+    }
+}
+
+void SampledLogs::fetchLogs()
+{
+    // Nothing to show any more, don't leave the samples of the previous sources around
+    if (m_sources.isEmpty()) {
+        clear();
+        return;
+    }
+    if (!m_engine) {
+        return;
+    }
+    if (m_startTime.isNull() || m_endTime.isNull()) {
+        qCWarning(dcLogEngine()) << "startTime and endTime is required when asking for resampling";
+        return;
+    }
+
+    QVariantMap params {
+        {"sources", m_sources},
+        {"startTime", m_startTime.toMSecsSinceEpoch()},
+        {"endTime", m_endTime.toMSecsSinceEpoch()}
+    };
+    // SampleRateAny would return every single entry of all sources, nothing to align
+    if (m_sampleRate != NewLogsModel::SampleRateAny) {
+        QMetaEnum sampleRateEnum = QMetaEnum::fromType<NewLogsModel::SampleRate>();
+        params.insert("sampleRate", sampleRateEnum.valueToKey(m_sampleRate));
+    }
+    QMetaEnum sortOrderEnum = QMetaEnum::fromType<Qt::SortOrder>();
+    params.insert("sortOrder", sortOrderEnum.valueToKey(Qt::AscendingOrder));
+
+    qCDebug(dcLogEngine()) << "Fetching sampled logs:" << QJsonDocument::fromVariant(params).toJson();
+    bool wasBusy = busy();
+    // The previous window isn't of interest any more
+    if (m_pendingCommand != -1) {
+        m_engine->jsonRpcClient()->cancel(m_pendingCommand);
+    }
+    m_pendingCommand = m_engine->jsonRpcClient()->sendCommand("Logging.GetLogEntries", params, this, "logsReply", JsonRpcClient::fetchTimeout);
+    if (!wasBusy) {
+        emit busyChanged();
+    }
+}
+
+void SampledLogs::logsReply(int commandId, const QVariantMap &data)
+{
+    // Only the latest request counts
+    if (commandId != m_pendingCommand) {
+        return;
+    }
+    m_pendingCommand = -1;
+
+    if (!data.contains("logEntries")) {
+        // Keep showing the previous window
+        qCWarning(dcLogEngine()) << "Fetching sampled logs failed:" << data;
+        emit busyChanged();
+        return;
+    }
+
+    QVariantList logEntries = data.value("logEntries").toList();
+
+    // All sources are sampled on the same grid, but some may lack samples at the edges
+    QVector<qint64> timestamps;
+    timestamps.reserve(logEntries.count());
+    foreach (const QVariant &logEntry, logEntries) {
+        timestamps.append(logEntry.toMap().value("timestamp").toLongLong());
+    }
+    std::sort(timestamps.begin(), timestamps.end());
+    timestamps.erase(std::unique(timestamps.begin(), timestamps.end()), timestamps.end());
+
+    int oldCount = m_timestamps.count();
+    m_timestamps = timestamps;
+    m_columnIndexes.clear();
+    m_columns.clear();
+
+    foreach (const QVariant &logEntry, logEntries) {
+        QVariantMap map = logEntry.toMap();
+        qint64 timestamp = map.value("timestamp").toLongLong();
+        int row = static_cast<int>(std::lower_bound(m_timestamps.constBegin(), m_timestamps.constEnd(), timestamp) - m_timestamps.constBegin());
+        QString source = map.value("source").toString();
+        QVariantMap values = map.value("values").toMap();
+        for (auto it = values.constBegin(); it != values.constEnd(); ++it) {
+            // Only numbers and bools can be plotted
+            if (it.value().userType() == QMetaType::QString) {
+                continue;
+            }
+            bool ok = false;
+            double value = it.value().toDouble(&ok);
+            if (!ok) {
+                continue;
+            }
+
+            QPair<QString, QString> key = qMakePair(source, it.key());
+            int column = m_columnIndexes.value(key, -1);
+            if (column < 0) {
+                column = m_columns.count();
+                m_columnIndexes.insert(key, column);
+                m_columns.append(QVector<double>(m_timestamps.count(), qQNaN()));
+            }
+            m_columns[column][row] = value;
+        }
+    }
+
+    qCDebug(dcLogEngine()) << "Sampled logs received:" << m_timestamps.count() << "rows for" << m_columns.count() << "columns";
+
+    emit samplesChanged();
+    if (oldCount != m_timestamps.count()) {
+        emit countChanged();
+    }
+    emit busyChanged();
+}
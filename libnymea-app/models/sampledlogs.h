@@ -0,0 +1,128 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU General Public License as published by the Free Software
+* Foundation, GNU version 3. This project is distributed in the hope that it
+* will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+* Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef SAMPLEDLOGS_H
+#define SAMPLEDLOGS_H
+
+#include <QObject>
+#include <QDateTime>
+#include <QVector>
+#include <QHash>
+
+#include "newlogsmodel.h"
+
+class Engine;
+
+// Resampled logs of several sources in one time window, fetched with a single request.
+// The result is a matrix: one row per timestamp, shared by all sources, and one column per
+// source and value name. Cells without a sample are NaN.
+class SampledLogs : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(Engine* engine READ engine WRITE setEngine NOTIFY engineChanged)
+    Q_PROPERTY(QStringList sources READ sources WRITE setSources NOTIFY sourcesChanged)
+    Q_PROPERTY(QDateTime startTime READ startTime WRITE setStartTime NOTIFY startTimeChanged)
+    Q_PROPERTY(QDateTime endTime READ endTime WRITE setEndTime NOTIFY endTimeChanged)
+    Q_PROPERTY(NewLogsModel::SampleRate sampleRate READ sampleRate WRITE setSampleRate NOTIFY sampleRateChanged)
+
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+    Q_PROPERTY(bool busy READ busy NOTIFY busyChanged)
+
+public:
+    explicit SampledLogs(QObject *parent = nullptr);
+
+    Engine *engine() const;
+    void setEngine(Engine *engine);
+
+    QStringList sources() const;
+    void setSources(const QStringList &sources);
+
+    QDateTime startTime() const;
+    void setStartTime(const QDateTime &startTime);
+
+    QDateTime endTime() const;
+    void setEndTime(const QDateTime &endTime);
+
+    NewLogsModel::SampleRate sampleRate() const;
+    void setSampleRate(NewLogsModel::SampleRate sampleRate);
+
+    // Number of rows
+    int count() const;
+    bool busy() const;
+
+    // Timestamps in msecs since epoch, ascending
+    qint64 timestampAt(int row) const;
+    // Index of the column for the given source and value name, -1 if there is none
+    int column(const QString &source, const QString &name) const;
+    // NaN if there is no sample for that row
+    double valueAt(int row, int column) const;
+
+    Q_INVOKABLE QDateTime timestamp(int row) const;
+    // Undefined if there is no sample
+    Q_INVOKABLE QVariant value(int row, const QString &source, const QString &name) const;
+    // The row closest to the given timestamp, -1 if there are none
+    Q_INVOKABLE int find(const QDateTime &timestamp) const;
+
+public slots:
+    void clear();
+    void fetchLogs();
+
+signals:
+    void engineChanged();
+    void sourcesChanged();
+    void startTimeChanged();
+    void endTimeChanged();
+    void sampleRateChanged();
+    void countChanged();
+    void busyChanged();
+
+    // The matrix has been replaced
+    void samplesChanged();
+
+private slots:
+    void logsReply(int commandId, const QVariantMap &data);
+
+private:
+    Engine *m_engine = nullptr;
+    QStringList m_sources;
+    QDateTime m_startTime;
+    QDateTime m_endTime;
+    NewLogsModel::SampleRate m_sampleRate = NewLogsModel::SampleRate15Mins;
+
+    // Replies to requests sent before the last clear() are dropped
+    int m_pendingCommand = -1;
+
+    QVector<qint64> m_timestamps;
+    // Column indexes, by source and value name
+    QHash<QPair<QString, QString>, int> m_columnIndexes;
+    QVector<QVector<double>> m_columns;
+};
+
+#endif // SAMPLEDLOGS_H
@@ -0,0 +1,131 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU General Public License as published by the Free Software
+* Foundation, GNU version 3. This project is distributed in the hope that it
+* will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+* Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "sampledseriesadapter.h"
+
+#include <QtNumeric>
+
+SampledSeriesAdapter::SampledSeriesAdapter(QObject *parent)
+    : QObject{parent}
+{
+    m_flushTimer.setSingleShot(true);
+    m_flushTimer.setInterval(16);
+    connect(&m_flushTimer, &QTimer::timeout, this, &SampledSeriesAdapter::flush);
+}
+
+SampledLogs *SampledSeriesAdapter::sampledLogs() const
+{
+    return m_sampledLogs;
+}
+
+void SampledSeriesAdapter::setSampledLogs(SampledLogs *sampledLogs)
+{
+    if (m_sampledLogs != sampledLogs) {
+        if (m_sampledLogs) {
+            disconnect(m_sampledLogs, &SampledLogs::samplesChanged, this, &SampledSeriesAdapter::scheduleFlush);
+        }
+        m_sampledLogs = sampledLogs;
+        emit sampledLogsChanged();
+        if (m_sampledLogs) {
+            connect(m_sampledLogs, &SampledLogs::samplesChanged, this, &SampledSeriesAdapter::scheduleFlush);
+        }
+        scheduleFlush();
+    }
+}
+
+QString SampledSeriesAdapter::source() const
+{
+    return m_source;
+}
+
+void SampledSeriesAdapter::setSource(const QString &source)
+{
+    if (m_source != source) {
+        m_source = source;
+        emit sourceChanged();
+        scheduleFlush();
+    }
+}
+
+QString SampledSeriesAdapter::valueName() const
+{
+    return m_valueName;
+}
+
+void SampledSeriesAdapter::setValueName(const QString &valueName)
+{
+    if (m_valueName != valueName) {
+        m_valueName = valueName;
+        emit valueNameChanged();
+        scheduleFlush();
+    }
+}
+
+QtCharts::QXYSeries *SampledSeriesAdapter::xySeries() const
+{
+    return m_series;
+}
+
+void SampledSeriesAdapter::setXySeries(QtCharts::QXYSeries *series)
+{
+    if (m_series != series) {
+        m_series = series;
+        emit xySeriesChanged();
+        scheduleFlush();
+    }
+}
+
+void SampledSeriesAdapter::scheduleFlush()
+{
+    if (!m_flushTimer.isActive()) {
+        m_flushTimer.start();
+    }
+}
+
+void SampledSeriesAdapter::flush()
+{
+    if (!m_series) {
+        return;
+    }
+
+    QVector<QPointF> points;
+    int column = m_sampledLogs ? m_sampledLogs->column(m_source, m_valueName) : -1;
+    if (column >= 0) {
+        points.reserve(m_sampledLogs->count());
+        for (int row = 0; row < m_sampledLogs->count(); row++) {
+            // Rows where this source has no sample are left out rather than plotted as 0
+            double value = m_sampledLogs->valueAt(row, column);
+            if (!qIsNaN(value)) {
+                points.append(QPointF(m_sampledLogs->timestampAt(row), value));
+            }
+        }
+    }
+    m_series->replace(points);
+}
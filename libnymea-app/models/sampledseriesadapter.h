@@ -0,0 +1,84 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU General Public License as published by the Free Software
+* Foundation, GNU version 3. This project is distributed in the hope that it
+* will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+* Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef SAMPLEDSERIESADAPTER_H
+#define SAMPLEDSERIESADAPTER_H
+
+#include "sampledlogs.h"
+
+#include <QObject>
+#include <QTimer>
+#include <QXYSeries>
+
+// Plots one column of a SampledLogs matrix
+class SampledSeriesAdapter : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(SampledLogs* sampledLogs READ sampledLogs WRITE setSampledLogs NOTIFY sampledLogsChanged)
+    Q_PROPERTY(QString source READ source WRITE setSource NOTIFY sourceChanged)
+    Q_PROPERTY(QString valueName READ valueName WRITE setValueName NOTIFY valueNameChanged)
+    Q_PROPERTY(QtCharts::QXYSeries* xySeries READ xySeries WRITE setXySeries NOTIFY xySeriesChanged)
+
+public:
+    explicit SampledSeriesAdapter(QObject *parent = nullptr);
+
+    SampledLogs* sampledLogs() const;
+    void setSampledLogs(SampledLogs *sampledLogs);
+
+    QString source() const;
+    void setSource(const QString &source);
+
+    QString valueName() const;
+    void setValueName(const QString &valueName);
+
+    QtCharts::QXYSeries* xySeries() const;
+    void setXySeries(QtCharts::QXYSeries *series);
+
+signals:
+    void sampledLogsChanged();
+    void sourceChanged();
+    void valueNameChanged();
+    void xySeriesChanged();
+
+private slots:
+    void scheduleFlush();
+    void flush();
+
+private:
+    SampledLogs *m_sampledLogs = nullptr;
+    QString m_source;
+    QString m_valueName;
+    QtCharts::QXYSeries* m_series = nullptr;
+
+    // Coalesces updates into one series update per frame
+    QTimer m_flushTimer;
+};
+
+#endif // SAMPLEDSERIESADAPTER_H
@@ -0,0 +1,80 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU General Public License as published by the Free Software
+* Foundation, GNU version 3. This project is distributed in the hope that it
+* will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+* Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "seriesdecimator.h"
+
+#include <QtMath>
+
+QVector<QPointF> SeriesDecimator::lttb(const QVector<QPointF> &points, int threshold)
+{
+    if (threshold < 3 || points.count() <= threshold) {
+        return points;
+    }
+
+    QVector<QPointF> ret;
+    ret.reserve(threshold);
+    ret.append(points.first());
+
+    // The first and last point are kept as they are, the others are split in threshold - 2 buckets.
+    // From each bucket, pick the point spanning the largest triangle with the previously picked point
+    // and the average of the next bucket.
+    double bucketSize = static_cast<double>(points.count() - 2) / (threshold - 2);
+    int previous = 0;
+    for (int bucket = 0; bucket < threshold - 2; bucket++) {
+        int nextFirst = static_cast<int>((bucket + 1) * bucketSize) + 1;
+        int nextLast = qMin(static_cast<int>((bucket + 2) * bucketSize) + 1, points.count());
+        double averageX = 0, averageY = 0;
+        for (int i = nextFirst; i < nextLast; i++) {
+            averageX += points.at(i).x();
+            averageY += points.at(i).y();
+        }
+        int nextCount = qMax(nextLast - nextFirst, 1);
+        averageX /= nextCount;
+        averageY /= nextCount;
+
+        const QPointF &a = points.at(previous);
+        int first = static_cast<int>(bucket * bucketSize) + 1;
+        int last = static_cast<int>((bucket + 1) * bucketSize) + 1;
+        double maxArea = -1;
+        int picked = first;
+        for (int i = first; i < last; i++) {
+            double area = qAbs((a.x() - averageX) * (points.at(i).y() - a.y()) - (a.x() - points.at(i).x()) * (averageY - a.y()));
+            if (area > maxArea) {
+                maxArea = area;
+                picked = i;
+            }
+        }
+        ret.append(points.at(picked));
+        previous = picked;
+    }
+
+    ret.append(points.last());
+    return ret;
+}
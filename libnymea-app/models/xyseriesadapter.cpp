@@ -1,13 +1,20 @@
 #include "xyseriesadapter.h"
+#include "seriesdecimator.h"
 
 #include <QDebug>
 
 #include <QLoggingCategory>
 Q_DECLARE_LOGGING_CATEGORY(dcLogEngine)
 
+// A week of samples per second is ~600k, this is plenty while protecting us from bogus timestamps
+static const int maxBuckets = 10000000;
+
 XYSeriesAdapter::XYSeriesAdapter(QObject *parent) : QObject(parent)
 {
-
+    // Log entries arrive one by one, push them into the series at most once per frame
+    m_flushTimer.setSingleShot(true);
+    m_flushTimer.setInterval(16);
+    connect(&m_flushTimer, &QTimer::timeout, this, &XYSeriesAdapter::flush);
 }
 
 LogsModel *XYSeriesAdapter::logsModel() const
@@ -18,10 +25,15 @@ LogsModel *XYSeriesAdapter::logsModel() const
 void XYSeriesAdapter::setLogsModel(LogsModel *logsModel)
 {
     if (m_model != logsModel) {
+        if (m_model) {
+            disconnect(m_model, &LogsModel::entriesAdded, this, &XYSeriesAdapter::entriesAdded);
+        }
         m_model = logsModel;
         emit logsModelChanged();
-//        update();
-        connect(logsModel, &LogsModel::logEntryAdded, this, &XYSeriesAdapter::logEntryAdded);
+        if (m_model) {
+            connect(m_model, &LogsModel::entriesAdded, this, &XYSeriesAdapter::entriesAdded);
+        }
+        reload();
     }
 }
 
@@ -36,7 +48,11 @@ void XYSeriesAdapter::setXySeries(QtCharts::QXYSeries *series)
         m_series = series;
         emit xySeriesChanged();
 
-        ensureSamples(QDateTime::currentDateTime(), QDateTime::currentDateTime().addMSecs(2 * 60000));
+        if (m_series) {
+            ensureSamples(QDateTime::currentDateTime(), QDateTime::currentDateTime().addMSecs(2 * 60000));
+            // Entries may have arrived before the series was there
+            invalidate(0);
+        }
     }
 }
 
@@ -48,40 +64,24 @@ QtCharts::QXYSeries *XYSeriesAdapter::baseSeries() const
 void XYSeriesAdapter::setBaseSeries(QtCharts::QXYSeries *series)
 {
     if (m_baseSeries != series) {
+        if (m_baseSeries) {
+            disconnect(m_baseSeries, nullptr, this, nullptr);
+        }
         m_baseSeries = series;
         emit baseSeriesChanged();
+        invalidate(0);
 
-        connect(m_baseSeries, &QtCharts::QXYSeries::pointAdded, this, [=](int index){
-            if (m_series->count() > index) {
-                qreal value = calculateSampleValue(index);
-                m_series->replace(index, m_series->at(index).x(), value);
-                if (value < m_minValue) {
-                    m_minValue = value;
-//                    qDebug() << "New min:" << m_minValue;
-                    emit minValueChanged();
-                }
-                if (value > m_maxValue) {
-                    m_maxValue = value;
-//                    qDebug() << "New max:" << m_maxValue;
-                    emit maxValueChanged();
-                }
-            }
+        if (!m_baseSeries) {
+            return;
+        }
+        connect(m_baseSeries, &QtCharts::QXYSeries::pointAdded, this, [=](){
+            invalidate(0);
+        });
+        connect(m_baseSeries, &QtCharts::QXYSeries::pointReplaced, this, [=](){
+            invalidate(0);
         });
-        connect(m_baseSeries, &QtCharts::QXYSeries::pointReplaced, this, [=](int index){
-            if (m_series->count() > index) {
-                qreal value = calculateSampleValue(index);
-                m_series->replace(index, m_series->at(index).x(), value);
-                if (value < m_minValue) {
-                    m_minValue = value;
-//                    qDebug() << "New min:" << m_minValue;
-                    emit minValueChanged();
-                }
-                if (value > m_maxValue) {
-                    m_maxValue = value;
-//                    qDebug() << "New max:" << m_maxValue;
-                    emit maxValueChanged();
-                }
-            }
+        connect(m_baseSeries, &QtCharts::QXYSeries::pointsReplaced, this, [=](){
+            invalidate(0);
         });
     }
 }
@@ -96,6 +96,7 @@ void XYSeriesAdapter::setSampleRate(XYSeriesAdapter::SampleRate sampleRate)
     if (m_sampleRate != sampleRate) {
         m_sampleRate = sampleRate;
         emit sampleRateChanged();
+        reload();
     }
 }
 
@@ -122,6 +123,7 @@ void XYSeriesAdapter::setInverted(bool inverted)
     if (m_inverted != inverted) {
         m_inverted = inverted;
         emit invertedChanged();
+        invalidate(0);
     }
 }
 
@@ -135,129 +137,349 @@ qreal XYSeriesAdapter::minValue() const
     return m_minValue;
 }
 
+QDateTime XYSeriesAdapter::windowStart() const
+{
+    return m_windowStart;
+}
+
+void XYSeriesAdapter::setWindowStart(const QDateTime &windowStart)
+{
+    if (m_windowStart != windowStart) {
+        m_windowStart = windowStart;
+        emit windowStartChanged();
+        updateMinMax();
+        scheduleFlush();
+    }
+}
+
+QDateTime XYSeriesAdapter::windowEnd() const
+{
+    return m_windowEnd;
+}
+
+void XYSeriesAdapter::setWindowEnd(const QDateTime &windowEnd)
+{
+    if (m_windowEnd != windowEnd) {
+        m_windowEnd = windowEnd;
+        emit windowEndChanged();
+        updateMinMax();
+        scheduleFlush();
+    }
+}
+
+qreal XYSeriesAdapter::windowMaxValue() const
+{
+    return m_windowMaxValue;
+}
+
+qreal XYSeriesAdapter::windowMinValue() const
+{
+    return m_windowMinValue;
+}
+
+int XYSeriesAdapter::plotWidth() const
+{
+    return m_plotWidth;
+}
+
+void XYSeriesAdapter::setPlotWidth(int plotWidth)
+{
+    if (m_plotWidth != plotWidth) {
+        m_plotWidth = plotWidth;
+        emit plotWidthChanged();
+        scheduleFlush();
+    }
+}
+
+XYSeriesAdapter::Decimation XYSeriesAdapter::decimation() const
+{
+    return m_decimation;
+}
+
+void XYSeriesAdapter::setDecimation(Decimation decimation)
+{
+    if (m_decimation != decimation) {
+        m_decimation = decimation;
+        emit decimationChanged();
+        scheduleFlush();
+    }
+}
+
 void XYSeriesAdapter::ensureSamples(const QDateTime &from, const QDateTime &to)
+{
+    ensureBuckets(from.toSecsSinceEpoch(), to.toSecsSinceEpoch());
+}
+
+void XYSeriesAdapter::entriesAdded(int index, int count)
+{
+    const LogEntryStore &store = m_model->store();
+    int column = store.column("value");
+    for (int i = index; i < index + count; i++) {
+        addEntry(store.timestampAt(i) / 1000, store.valueAt(i, column).toDouble());
+    }
+}
+
+void XYSeriesAdapter::flush()
 {
     if (!m_series) {
         return;
     }
+    updateValues();
+    // Every single replace(index, ...) would repaint the chart, hand over all points at once instead
+    m_series->replace(points());
+    updateMinMax();
+}
+
+int XYSeriesAdapter::bucketCount() const
+{
+    return m_buckets.count() - m_front;
+}
+
+XYSeriesAdapter::Bucket &XYSeriesAdapter::bucket(int index)
+{
+    return m_buckets[m_front + index];
+}
+
+qint64 XYSeriesAdapter::bucketEnd(int index) const
+{
+    return m_oldestEnd + static_cast<qint64>(index) * m_sampleRate;
+}
+
+void XYSeriesAdapter::ensureBuckets(qint64 from, qint64 to)
+{
+    if (bucketCount() == 0) {
+        m_oldestEnd = from + m_sampleRate / 2;
+        m_buckets.resize(m_front + 1);
+        invalidate(0);
+    }
 
-    if (m_samples.isEmpty()) {
-        Sample *sample = new Sample();
-        sample->timestamp = from.addSecs(m_sampleRate / 2);
-//        qWarning() << "Added first" << from << sample->timestamp;
-        m_newestSample = sample->timestamp;
-        m_oldestSample = m_newestSample;
-        m_samples.append(sample);
-        m_series->insert(0, QPointF(sample->timestamp.toMSecsSinceEpoch(), 0));
-    }
-
-    while (to > m_newestSample) {
-        Sample *sample = new Sample();
-        sample->timestamp = m_newestSample.addSecs(m_sampleRate);
-        Sample *oldNewest = m_samples.first();
-        if (oldNewest->entries.count() > 0) {
-            sample->startingPoint = oldNewest->entries.last();
-        } else if (oldNewest->startingPoint != nullptr) {
-            sample->startingPoint = oldNewest->startingPoint;
+    // The oldest bucket needs to end at or after from, but less than a sample later
+    if (from <= m_oldestEnd - m_sampleRate) {
+        qint64 missing = (m_oldestEnd - from) / m_sampleRate;
+        if (missing > maxBuckets - bucketCount()) {
+            qCWarning(dcLogEngine) << objectName() << "Not adding" << missing << "samples to XYSeriesAdapter, too many samples.";
+            return;
         }
-        m_newestSample = sample->timestamp;
-        m_samples.prepend(sample);
-        m_series->insert(0, QPointF(sample->timestamp.toMSecsSinceEpoch(), m_series->at(0).y()));
+        if (m_front < missing) {
+            // Grow by at least the current size so this is amortized O(1) per sample
+            int grow = qMax(static_cast<int>(missing) - m_front, bucketCount());
+            m_buckets.insert(0, grow, Bucket());
+            m_front += grow;
+        }
+        m_front -= static_cast<int>(missing);
+        m_oldestEnd -= missing * m_sampleRate;
+        invalidate(0);
     }
 
-    while (from < m_oldestSample.addSecs(-m_sampleRate)) {
-//        qWarning() << "Added one before" << from << m_oldestSample.addMSecs(-m_sampleRate) << m_oldestSample;
-        Sample *sample = new Sample();
-        sample->timestamp = m_oldestSample.addSecs(-m_sampleRate);
-        m_oldestSample = sample->timestamp;
-        m_samples.append(sample);
-        m_series->append(sample->timestamp.toMSecsSinceEpoch(), 0);
+    qint64 newestEnd = bucketEnd(bucketCount() - 1);
+    if (to > newestEnd) {
+        qint64 missing = (to - newestEnd + m_sampleRate - 1) / m_sampleRate;
+        if (missing > maxBuckets - bucketCount()) {
+            qCWarning(dcLogEngine) << objectName() << "Not adding" << missing << "samples to XYSeriesAdapter, too many samples.";
+            return;
+        }
+        int oldCount = bucketCount();
+        m_buckets.resize(m_buckets.count() + static_cast<int>(missing));
+        invalidate(oldCount);
     }
-//    qWarning() << "Ensuring samples:" << from.toString("yyyy-MM-dd hh:mm:ss") << to.toString("yyyy-MM-dd hh:mm:ss") << "Oldest:" << m_oldestSample.toString("yyyy-MM-dd hh:mm:ss") << "Newest:" << m_newestSample.toString("yyyy-MM-dd hh:mm:ss") ;
 }
 
-void XYSeriesAdapter::logEntryAdded(LogEntry *entry)
+void XYSeriesAdapter::addEntry(qint64 timestamp, double value)
 {
-    if (!m_series) {
+    ensureBuckets(timestamp, timestamp);
+    qint64 index = (timestamp - m_oldestEnd + m_sampleRate - 1) / m_sampleRate;
+    if (index < 0 || index >= bucketCount()) {
         return;
     }
 
-    ensureSamples(entry->timestamp(), entry->timestamp());
+    Bucket &b = bucket(static_cast<int>(index));
+    b.sum += value;
+    b.count++;
+    // Entries don't necessarily arrive in order, but only the newest one matters for the following samples
+    if (b.count == 1 || timestamp >= b.lastTimestamp) {
+        b.lastTimestamp = timestamp;
+        b.lastValue = value;
+    }
+    invalidate(static_cast<int>(index));
+}
 
-    int idx = entry->timestamp().secsTo(m_newestSample) / m_sampleRate;
-    if (idx > m_samples.count()) {
-        qCWarning(dcLogEngine) << objectName() << "Overflowing integer size for XYSeriesAdapter!";
-        return;
+void XYSeriesAdapter::reload()
+{
+    m_buckets.clear();
+    m_front = 0;
+    m_values.clear();
+    m_aggregate.clear();
+
+    if (m_series) {
+        ensureSamples(QDateTime::currentDateTime(), QDateTime::currentDateTime().addMSecs(2 * 60000));
     }
-//    qWarning() << objectName() << "Inserting sample at:" << idx << entry->timestamp().toString("yyyy-MM-dd hh:mm:ss");
-    Sample *sample = m_samples.at(idx);
-    LogEntry *oldLast = nullptr;
-    // In theory we'd need to insert sorted, but only the last one actually matters for subsequent samples
-    // For the current sample we're calculating the median anyways, so just append/prepend t be a bit faster
-    if (sample->entries.count() > 0 && sample->entries.last()->timestamp() < entry->timestamp()) {
-        oldLast = sample->entries.last();
-        sample->entries.append(entry);
-    } else {
-        sample->entries.prepend(entry);
-    }
-    LogEntry *newLast = sample->entries.last();
-
-    qreal value = calculateSampleValue(idx);
-    m_series->replace(idx, sample->timestamp.toMSecsSinceEpoch(), value);
-//    qWarning() << "sample value updated" << idx << sample->timestamp.toString("yyyy-MM-dd hh:mm:ss") << value;
-
-    if (value < m_minValue) {
-        m_minValue = value;
-//        qDebug() << "New min:" << m_minValue;
-        emit minValueChanged();
+    if (m_model) {
+        entriesAdded(0, m_model->rowCount());
     }
-    if (value > m_maxValue) {
-        m_maxValue = value;
-//        qDebug() << "New max:" << m_maxValue;
-        emit maxValueChanged();
+    invalidate(0);
+}
+
+void XYSeriesAdapter::invalidate(int index)
+{
+    m_dirtyFrom = qMin(m_dirtyFrom, index);
+    scheduleFlush();
+}
+
+void XYSeriesAdapter::scheduleFlush()
+{
+    if (!m_flushTimer.isActive()) {
+        m_flushTimer.start();
     }
+}
 
-    // check if we need to update more samples
-    for (int i = idx - 1; i >= 0; i--) {
-        Sample *nextSample = m_samples.at(i);
-        if (nextSample->startingPoint == oldLast) {
-            nextSample->startingPoint = newLast;
-            qreal value = calculateSampleValue(i);
-//            qWarning() << "Updating" << i << value;
-            m_series->replace(i, nextSample->timestamp.toMSecsSinceEpoch(), value);
+void XYSeriesAdapter::updateValues()
+{
+    int count = bucketCount();
+
+    // Each sample averages its entries and its starting point, which is the newest entry of the
+    // samples before. Recalculate everything from the first changed sample in one pass.
+    bool hasStart = false;
+    double start = 0;
+    for (int i = m_dirtyFrom - 1; i >= 0 && !hasStart; i--) {
+        const Bucket &b = m_buckets.at(m_front + i);
+        if (b.count > 0) {
+            start = b.lastValue;
+            hasStart = true;
+        }
+    }
+    for (int i = m_dirtyFrom; i < count; i++) {
+        Bucket &b = bucket(i);
+        double value = b.sum;
+        int entries = b.count;
+        if (hasStart) {
+            value += start;
+            entries++;
+        }
+        if (entries > 1) {
+            value /= entries;
+        }
+        value += baseValue(bucketEnd(i) * 1000.0);
+        if (m_inverted) {
+            value *= -1;
+        }
+        b.value = value;
 
-        } else {
-            break;
+        if (b.count > 0) {
+            start = b.lastValue;
+            hasStart = true;
         }
     }
+
+    m_values.resize(count);
+    for (int i = m_dirtyFrom; i < count; i++) {
+        m_values[i] = m_buckets.at(m_front + i).value;
+    }
+    m_aggregate.invalidate(m_dirtyFrom);
+    m_dirtyFrom = count;
 }
 
-qreal XYSeriesAdapter::calculateSampleValue(int index)
+QVector<QPointF> XYSeriesAdapter::points() const
 {
-    Sample *sample = m_samples.at(index);
-    qreal value = 0;
-    int count = 0;
-    if (sample->startingPoint) {
-        value = sample->startingPoint->value().toDouble();
-        count++;
+    int first = 0;
+    int last = m_values.count();
+    QVector<QPointF> ret;
+
+    if (m_decimation == DecimationNone || m_plotWidth <= 0) {
+        ret.reserve(last);
+        for (int i = first; i < last; i++) {
+            ret.append(QPointF(bucketEnd(i) * 1000.0, m_values.at(i)));
+        }
+        return ret;
     }
 
-    foreach (LogEntry *entry, sample->entries) {
-        value += entry->value().toDouble();
-        count++;
+    // Only the window is on screen, plus one sample on each side so the lines leave the plot area
+    windowRange(&first, &last);
+    first = qMax(0, first - 1);
+    last = qMin(m_values.count(), last + 1);
+
+    if (m_decimation == DecimationLttb || last - first <= 2 * m_plotWidth) {
+        ret.reserve(last - first);
+        for (int i = first; i < last; i++) {
+            ret.append(QPointF(bucketEnd(i) * 1000.0, m_values.at(i)));
+        }
+        return SeriesDecimator::lttb(ret, 2 * m_plotWidth);
     }
 
-    if (count > 1) {
-        value /= count;
+    // One pixel wide slices, each drawn as a vertical line from its min to its max. The aggregate
+    // answers each slice from its block values, so this barely depends on the number of samples in the window.
+    ret.reserve(2 * m_plotWidth);
+    for (int pixel = 0; pixel < m_plotWidth; pixel++) {
+        int sliceFirst = first + static_cast<int>(static_cast<qint64>(last - first) * pixel / m_plotWidth);
+        int sliceLast = first + static_cast<int>(static_cast<qint64>(last - first) * (pixel + 1) / m_plotWidth);
+        if (sliceFirst >= sliceLast) {
+            continue;
+        }
+        RangeAggregate::Result slice = m_aggregate.query(m_values, sliceFirst, sliceLast);
+        // Keep the order in which the values appear so the line connects to its neighbours
+        bool rising = m_values.at(sliceFirst) <= m_values.at(sliceLast - 1);
+        ret.append(QPointF(bucketEnd(sliceFirst) * 1000.0, rising ? slice.minValue : slice.maxValue));
+        if (sliceLast - sliceFirst > 1) {
+            ret.append(QPointF(bucketEnd(sliceLast - 1) * 1000.0, rising ? slice.maxValue : slice.minValue));
+        }
     }
+    return ret;
+}
 
-    if (m_baseSeries && m_baseSeries->count() > index) {
-        value += m_baseSeries->at(index).y();
+qreal XYSeriesAdapter::baseValue(qreal x) const
+{
+    if (!m_baseSeries || m_baseSeries->count() == 0) {
+        return 0;
+    }
+    // The base series is another adapter with the same sample rate, find the point by its position
+    int index = qRound((x - m_baseSeries->at(0).x()) / (m_sampleRate * 1000.0));
+    if (index < 0 || index >= m_baseSeries->count() || qAbs(m_baseSeries->at(index).x() - x) * 2 >= m_sampleRate * 1000.0) {
+        return 0;
     }
+    return m_baseSeries->at(index).y();
+}
 
-    if (m_inverted) {
-        value *= -1;
+void XYSeriesAdapter::windowRange(int *first, int *last) const
+{
+    // Samples are m_sampleRate apart, starting at m_oldestEnd
+    *first = 0;
+    *last = m_values.count();
+    if (!m_values.isEmpty() && m_windowStart.isValid()) {
+        qint64 secs = m_windowStart.toSecsSinceEpoch() - m_oldestEnd;
+        *first = secs <= 0 ? 0 : static_cast<int>(qMin<qint64>((secs + m_sampleRate - 1) / m_sampleRate, *last));
     }
+    if (!m_values.isEmpty() && m_windowEnd.isValid()) {
+        qint64 secs = m_windowEnd.toSecsSinceEpoch() - m_oldestEnd;
+        *last = secs < 0 ? 0 : static_cast<int>(qMin<qint64>(secs / m_sampleRate + 1, *last));
+    }
+}
 
-    return value;
+void XYSeriesAdapter::updateMinMax()
+{
+    int first, last;
+    windowRange(&first, &last);
+
+    // Like before, 0 is always part of the range so charts keep their baseline
+    RangeAggregate::Result total = m_aggregate.total(m_values);
+    RangeAggregate::Result window = m_aggregate.query(m_values, first, last);
+    qreal minValue = qMin(0.0, total.minValue);
+    qreal maxValue = qMax(0.0, total.maxValue);
+    qreal windowMinValue = qMin(0.0, window.minValue);
+    qreal windowMaxValue = qMax(0.0, window.maxValue);
+
+    if (m_minValue != minValue) {
+        m_minValue = minValue;
+        emit minValueChanged();
+    }
+    if (m_maxValue != maxValue) {
+        m_maxValue = maxValue;
+        emit maxValueChanged();
+    }
+    if (m_windowMinValue != windowMinValue) {
+        m_windowMinValue = windowMinValue;
+        emit windowMinValueChanged();
+    }
+    if (m_windowMaxValue != windowMaxValue) {
+        m_windowMaxValue = windowMaxValue;
+        emit windowMaxValueChanged();
+    }
 }
@@ -2,8 +2,10 @@
 #define XYSERIESADAPTER_H
 
 #include "logsmodel.h"
+#include "rangeaggregate.h"
 
 #include <QObject>
+#include <QTimer>
 #include <QXYSeries>
 
 class XYSeriesAdapter : public QObject
@@ -20,6 +22,16 @@ class XYSeriesAdapter : public QObject
     Q_PROPERTY(qreal maxValue READ maxValue NOTIFY maxValueChanged)
     Q_PROPERTY(qreal minValue READ minValue NOTIFY minValueChanged)
 
+    // The part of the series which is on screen, and the value range within it
+    Q_PROPERTY(QDateTime windowStart READ windowStart WRITE setWindowStart NOTIFY windowStartChanged)
+    Q_PROPERTY(QDateTime windowEnd READ windowEnd WRITE setWindowEnd NOTIFY windowEndChanged)
+    Q_PROPERTY(qreal windowMaxValue READ windowMaxValue NOTIFY windowMaxValueChanged)
+    Q_PROPERTY(qreal windowMinValue READ windowMinValue NOTIFY windowMinValueChanged)
+
+    // Width of the plot area in pixels. If set, the window is decimated to about two points per pixel.
+    Q_PROPERTY(int plotWidth READ plotWidth WRITE setPlotWidth NOTIFY plotWidthChanged)
+    Q_PROPERTY(Decimation decimation READ decimation WRITE setDecimation NOTIFY decimationChanged)
+
 public:
     enum SampleRate {
         SampleRateSecond = 1,
@@ -30,6 +42,13 @@ public:
     };
     Q_ENUM(SampleRate)
 
+    enum Decimation {
+        DecimationNone, // Exact, every sample is a point
+        DecimationMinMax, // Min and max per pixel, independent of the number of samples in the window
+        DecimationLttb // Largest-Triangle-Three-Buckets, linear in the number of samples in the window
+    };
+    Q_ENUM(Decimation)
+
     explicit XYSeriesAdapter(QObject *parent = nullptr);
 
     LogsModel* logsModel() const;
@@ -53,6 +72,21 @@ public:
     qreal maxValue() const;
     qreal minValue() const;
 
+    QDateTime windowStart() const;
+    void setWindowStart(const QDateTime &windowStart);
+
+    QDateTime windowEnd() const;
+    void setWindowEnd(const QDateTime &windowEnd);
+
+    qreal windowMaxValue() const;
+    qreal windowMinValue() const;
+
+    int plotWidth() const;
+    void setPlotWidth(int plotWidth);
+
+    Decimation decimation() const;
+    void setDecimation(Decimation decimation);
+
     Q_INVOKABLE void ensureSamples(const QDateTime &from, const QDateTime &to);
 
 signals:
@@ -64,20 +98,46 @@ signals:
     void invertedChanged();
     void maxValueChanged();
     void minValueChanged();
+    void windowStartChanged();
+    void windowEndChanged();
+    void windowMaxValueChanged();
+    void windowMinValueChanged();
+    void plotWidthChanged();
+    void decimationChanged();
 
 private slots:
-    void logEntryAdded(LogEntry *entry);
+    void entriesAdded(int index, int count);
+    void flush();
 
 private:
-    qreal calculateSampleValue(int index);
-
-private:
-    class Sample {
+    // One per sample, all log entries from (end - sampleRate, end]
+    class Bucket {
     public:
-        QDateTime timestamp; // The timestamp where this sample *ends*
-        QVector<LogEntry*> entries; // all log entries in this sample, that is, from timestamp - smaple size to timestamp
-        LogEntry *startingPoint = nullptr; // the starting point for the sample. Normally the last entry of the previous sample
+        double sum = 0;
+        int count = 0;
+        // The newest entry, it is the starting point for the following samples
+        qint64 lastTimestamp = 0;
+        double lastValue = 0;
+        // The value in the series
+        double value = 0;
     };
+
+    int bucketCount() const;
+    Bucket &bucket(int index);
+    qint64 bucketEnd(int index) const;
+    void ensureBuckets(qint64 from, qint64 to);
+    void addEntry(qint64 timestamp, double value);
+    void reload();
+    void invalidate(int index);
+    void scheduleFlush();
+    void updateValues();
+    QVector<QPointF> points() const;
+    qreal baseValue(qreal x) const;
+    // Index range [first, last) of the samples in the window
+    void windowRange(int *first, int *last) const;
+    void updateMinMax();
+
+private:
     LogsModel* m_model = nullptr;
     QtCharts::QXYSeries* m_series = nullptr;
     QtCharts::QXYSeries* m_baseSeries = nullptr;
@@ -85,12 +145,32 @@ private:
     bool m_smooth = true;
     bool m_inverted = false;
 
-    QVector<Sample*> m_samples;
-    QDateTime m_newestSample;
-    QDateTime m_oldestSample;
+    // Samples, oldest first, keyed by (timestamp - m_oldestEnd) / m_sampleRate. The first m_front
+    // buckets are preallocated for older samples so fetching backwards in time doesn't shift the
+    // whole array for every sample.
+    QVector<Bucket> m_buckets;
+    int m_front = 0;
+    // End of the oldest sample, in seconds since epoch
+    qint64 m_oldestEnd = 0;
+
+    // Values from here on changed since they have been pushed into the series
+    int m_dirtyFrom = 0;
+    // Coalesces updates into one series update per frame
+    QTimer m_flushTimer;
+
+    // Sample values, oldest first
+    QVector<double> m_values;
+    RangeAggregate m_aggregate;
+
+    QDateTime m_windowStart;
+    QDateTime m_windowEnd;
+    int m_plotWidth = 0;
+    Decimation m_decimation = DecimationMinMax;
 
     qreal m_maxValue = 0;
     qreal m_minValue = 0;
+    qreal m_windowMaxValue = 0;
+    qreal m_windowMinValue = 0;
 };
 
 #endif // XYSERIESADAPTER_H
@@ -56,6 +56,9 @@ Params *PluginConfigManager::params()
 void PluginConfigManager::getPluginConfigResponse(int /*commandId*/, const QVariantMap &params)
 {
     qCWarning(dcThingManager) << "plugin config response" << params;
+    if (JsonRpcClient::isLost(params)) {
+        return;
+    }
     m_params->clearModel();
 
     QVariantList pluginParams = params.value("configuration").toList();
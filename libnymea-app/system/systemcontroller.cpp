@@ -213,6 +213,9 @@ QString SystemController::deviceSerialNumber() const
 
 void SystemController::getCapabilitiesResponse(int /*commandId*/, const QVariantMap &data)
 {
+    if (JsonRpcClient::isLost(data)) {
+        return;
+    }
     m_powerManagementAvailable = data.value("powerManagement").toBool();
     emit powerManagementAvailableChanged();
 
@@ -238,6 +241,9 @@ void SystemController::getCapabilitiesResponse(int /*commandId*/, const QVariant
 void SystemController::getUpdateStatusResponse(int /*commandId*/, const QVariantMap &data)
 {
     qCDebug(dcSystemController()) << "Update status:" << qUtf8Printable(QJsonDocument::fromVariant(data).toJson(QJsonDocument::Indented));
+    if (JsonRpcClient::isLost(data)) {
+        return;
+    }
     m_updateManagementBusy = data.value("busy").toBool();
     m_updateRunning = data.value("updateRunning").toBool();
     emit updateRunningChanged();
@@ -287,6 +293,9 @@ void SystemController::enableRepositoryResponse(int commandId, const QVariantMap
 void SystemController::getServerTimeResponse(int commandId, const QVariantMap &params)
 {
     Q_UNUSED(commandId)
+    if (JsonRpcClient::isLost(params)) {
+        return;
+    }
 
     // NOTE: Ideally we'd just set the TimeZone of our serverTime prooperly, however, there's a bug on Android
     // Which doesn't allow to create QTimeZone objects by IANA id.... So, let's keep that separated in a string
@@ -337,6 +346,9 @@ void SystemController::shutdownResponse(int commandId, const QVariantMap &params
 void SystemController::getSystemInfoResponse(int commandId, const QVariantMap &params)
 {
     Q_UNUSED(commandId)
+    if (JsonRpcClient::isLost(params)) {
+        return;
+    }
     m_deviceSerialNumber = params.value("deviceSerialNumber").toString();
     emit deviceSerialNumberChanged();
 }
@@ -88,12 +88,7 @@ ThingClass *ThingClasses::get(int index) const
 
 ThingClass *ThingClasses::getThingClass(QUuid thingClassId) const
 {
-    foreach (ThingClass *thingClass, m_thingClasses) {
-        if (thingClass->id() == thingClassId) {
-            return thingClass;
-        }
-    }
-    return nullptr;
+    return m_thingClassesById.value(thingClassId);
 }
 
 void ThingClasses::addThingClass(ThingClass *thingClass)
@@ -101,6 +96,9 @@ void ThingClasses::addThingClass(ThingClass *thingClass)
     thingClass->setParent(this);
     beginInsertRows(QModelIndex(), m_thingClasses.count(), m_thingClasses.count());
     m_thingClasses.append(thingClass);
+    if (!m_thingClassesById.contains(thingClass->id())) {
+        m_thingClassesById.insert(thingClass->id(), thingClass);
+    }
     endInsertRows();
     emit countChanged();
 }
@@ -110,6 +108,7 @@ void ThingClasses::clearModel()
     beginResetModel();
     qDeleteAll(m_thingClasses);
     m_thingClasses.clear();
+    m_thingClassesById.clear();
     endResetModel();
     emit countChanged();
 }
@@ -73,6 +73,7 @@ protected:
 
 private:
     QList<ThingClass *> m_thingClasses;
+    QHash<QUuid, ThingClass*> m_thingClassesById;
 
 };
 
@@ -64,6 +64,7 @@ void ThingClassesProxy::setFilterInterface(const QString &filterInterface)
 {
     if (m_filterInterface != filterInterface) {
         m_filterInterface = filterInterface;
+        m_filterInterfaceId = filterInterface.isEmpty() ? -1 : InterfaceBits::idOf(filterInterface);
         emit filterInterfaceChanged();
         invalidateFilter();
         emit countChanged();
@@ -202,6 +203,7 @@ void ThingClassesProxy::resetFilter()
 {
     m_filterVendorId = QUuid();
     m_filterInterface.clear();
+    m_filterInterfaceId = -1;
     m_filterVendorName.clear();
     m_filterDisplayName.clear();
     invalidateFilter();
@@ -221,10 +223,10 @@ bool ThingClassesProxy::filterAcceptsRow(int sourceRow, const QModelIndex &sourc
     if (!m_filterVendorId.isNull() && thingClass->vendorId() != m_filterVendorId)
         return false;
 
-    if (!m_filterInterface.isEmpty() && !thingClass->interfaces().contains(m_filterInterface)) {
+    if (m_filterInterfaceId >= 0 && !thingClass->interfaceBits().testBit(m_filterInterfaceId)) {
         if (!m_includeProvidedInterfaces) {
             return false;
-        } else if (!thingClass->providedInterfaces().contains(m_filterInterface)) {
+        } else if (!thingClass->providedInterfaceBits().testBit(m_filterInterfaceId)) {
             return false;
         }
     }
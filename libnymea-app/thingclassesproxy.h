@@ -116,6 +116,7 @@ protected:
 private:
     Engine *m_engine = nullptr;
     QString m_filterInterface;
+    int m_filterInterfaceId = -1;
     bool m_includeProvidedInterfaces = false;
     QString m_filterDisplayName;
     QUuid m_filterVendorId;
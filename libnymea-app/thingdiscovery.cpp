@@ -216,6 +216,9 @@ void ThingDiscovery::discoverThingsResponse(int commandId, const QVariantMap &pa
 
     QMetaEnum metaEnum = QMetaEnum::fromType<Thing::ThingError>();
     Thing::ThingError thingError = static_cast<Thing::ThingError>(metaEnum.keyToValue(params.value("thingError").toByteArray()));
+    if (JsonRpcClient::isLost(params)) {
+        thingError = Thing::ThingErrorTimeout;
+    }
     emit discoverThingsReply(commandId, thingError, m_displayMessage);
 
     m_pendingRequests.removeAll(commandId);
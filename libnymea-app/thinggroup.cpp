@@ -40,12 +40,11 @@ ThingGroup::ThingGroup(ThingManager *thingManager, ThingClass *thingClass, Thing
 {
     thingClass->setParent(this);
 
-    States *states = new States(this);
+    States *states = new States(id(), thingClass->stateTypes(), this);
     for (int i = 0; i < thingClass->stateTypes()->rowCount(); i++) {
         StateType *st = thingClass->stateTypes()->get(i);
-        State *state = new State(id(), st->id(), QVariant(), this);
         qDebug() << "Adding state" << st->name() << st->minValue() << st->maxValue();
-        states->addState(state);
+        states->addState(st->id(), QVariant());
     }
     setStates(states);
     syncStates();
@@ -54,22 +53,6 @@ ThingGroup::ThingGroup(ThingManager *thingManager, ThingClass *thingClass, Thing
     connect(things, &ThingsProxy::dataChanged, this, [this](const QModelIndex &/*topLeft*/, const QModelIndex &/*bottomRight*/, const QVector<int> &/*roles*/){
         syncStates();
     });
-
-    connect(m_thingManager, &ThingManager::executeActionReply, this, [this](int commandId, Thing::ThingError error, const QString &displayMessage){
-        // This should maybe check the params and create a sensible group result instead of just forwarding the result of the last reply
-        qDebug() << "action reply:" << commandId;
-        foreach (int id, m_pendingGroupActions.keys()) {
-            if (m_pendingGroupActions.value(id).contains(commandId)) {
-                m_pendingGroupActions[id].removeAll(commandId);
-                if (m_pendingGroupActions[id].isEmpty()) {
-                    m_pendingGroupActions.remove(id);
-                    emit executeActionReply(id, error, displayMessage);
-                }
-                return;
-            }
-        }
-    });
-
 }
 
 int ThingGroup::executeAction(const QString &actionName, const QVariantList &params)
@@ -117,18 +100,36 @@ int ThingGroup::executeAction(const QString &actionName, const QVariantList &par
 
         qDebug() << "Initial params" << params;
         qDebug() << "Executing" << thing->id() << actionType->name() << finalParams;
-        int id = m_thingManager->executeAction(thing->id(), actionType->id(), finalParams);
+        int id = m_thingManager->executeAction(this, thing->id(), actionType->id(), finalParams);
         pendingIds.append(id);
     }
-    m_pendingGroupActions.insert(++m_idCounter, pendingIds);
+    m_idCounter++;
+    m_pendingGroupActions.insert(m_idCounter, pendingIds);
+    foreach (int commandId, pendingIds) {
+        m_pendingCommands.insert(commandId, m_idCounter);
+    }
     return m_idCounter;
 }
 
+void ThingGroup::actionExecuted(int commandId, Thing::ThingError thingError, const QString &displayMessage)
+{
+    // This should maybe check the params and create a sensible group result instead of just forwarding the result of the last reply
+    qDebug() << "action reply:" << commandId;
+    if (!m_pendingCommands.contains(commandId)) {
+        return;
+    }
+    int id = m_pendingCommands.take(commandId);
+    m_pendingGroupActions[id].removeAll(commandId);
+    if (m_pendingGroupActions[id].isEmpty()) {
+        m_pendingGroupActions.remove(id);
+        emit executeActionReply(id, thingError, displayMessage);
+    }
+}
+
 void ThingGroup::syncStates()
 {
     for (int i = 0; i < thingClass()->stateTypes()->rowCount(); i++) {
         StateType *stateType = thingClass()->stateTypes()->get(i);
-        State *state = states()->getState(stateType->id());
 
         qDebug() << "syncing state" << stateType->name() << stateType->type();
 
@@ -166,7 +167,7 @@ void ThingGroup::syncStates()
         if (count > 0) {
             value = value.toDouble() / count;
         }
-        state->setValue(value);
+        states()->setValue(stateType->id(), value);
     }
 }
 
@@ -47,6 +47,8 @@ public:
 
     Q_INVOKABLE int executeAction(const QString &actionName, const QVariantList &params) override;
 
+    void actionExecuted(int commandId, Thing::ThingError thingError, const QString &displayMessage) override;
+
 private:
     void syncStates();
 
@@ -57,6 +59,8 @@ private:
 
     int m_idCounter = 0;
     QHash<int, QList<int>> m_pendingGroupActions;
+    // command id -> group action id
+    QHash<int, int> m_pendingCommands;
 };
 
 #endif // THINGGROUP_H
@@ -38,8 +38,20 @@
 
 #include <QMetaEnum>
 #include <QFile>
+#include <QSaveFile>
+#include <QDir>
+#include <QFileInfo>
+#include <QRegExp>
+#include <QDataStream>
+#include <QSet>
+#include <QLocale>
 #include <QStandardPaths>
 #include <QJsonDocument>
+#include <QGuiApplication>
+
+// Bump this whenever the layout of the snapshot files changes
+static const quint32 snapshotMagic = 0x6e796d61;
+static const quint32 snapshotVersion = 1;
 
 #include "logging.h"
 NYMEA_LOGGING_CATEGORY(dcThingManager, "ThingManager")
@@ -54,10 +66,25 @@ ThingManager::ThingManager(JsonRpcClient* jsonclient, QObject *parent) :
     m_jsonClient(jsonclient)
 {
     m_jsonClient->registerNotificationHandler(this, "Integrations", "notificationReceived");
+
+    m_stateUpdateTimer.setSingleShot(true);
+    connect(&m_stateUpdateTimer, &QTimer::timeout, this, &ThingManager::flushStateChanges);
+
+    QGuiApplication *app = qobject_cast<QGuiApplication*>(QGuiApplication::instance());
+    if (app) {
+        connect(app, &QGuiApplication::applicationStateChanged, this, &ThingManager::updateStateUpdateTimer);
+    }
+    updateStateUpdateTimer();
 }
 
 void ThingManager::clear()
 {
+    m_actionOwners.clear();
+    m_browsingRequests.clear();
+    m_browserDetailsRequests.clear();
+    m_stateUpdateTimer.stop();
+    m_pendingStateChanges.clear();
+    m_pendingStateChangeIndexes.clear();
     m_things->clearModel();
     m_thingClasses->clearModel();
     m_vendors->clearModel();
@@ -67,12 +94,36 @@ void ThingManager::clear()
 
 void ThingManager::init()
 {
-    m_connectionBenchmark = QDateTime::currentDateTime();
+    m_bootstrapTimer.start();
+    m_bootstrapTimings.clear();
+    m_pendingBootstrapPhases = {"ThingClasses", "Things", "Plugins", "Vendors", "IOConnections"};
+    m_thingClassesLoaded = false;
+    m_pendingThings.clear();
+    m_liveThingClasses.clear();
 
     m_fetchingData = true;
     emit fetchingDataChanged();
 
+    m_snapshotLoaded = loadSnapshot();
+    if (m_snapshotLoaded) {
+        qCInfo(dcThingManager()) << "Loaded" << m_things->rowCount() << "things from snapshot in" << m_bootstrapTimer.elapsed() << "ms";
+        m_bootstrapTimings.append(qMakePair(QString("Snapshot"), m_bootstrapTimer.elapsed()));
+        m_fetchingData = false;
+        emit fetchingDataChanged();
+    }
+
+    // None of those depend on each other on the wire. Send them all at once to save round trips.
+    // Things need their thing classes to be unpacked, getThingsResponse() takes care of that.
     m_jsonClient->sendCommand("Integrations.GetThingClasses", this, "getThingClassesResponse");
+    m_jsonClient->sendCommand("Integrations.GetThings", this, "getThingsResponse");
+    m_jsonClient->sendCommand("Integrations.GetPlugins", this, "getPluginsResponse");
+    m_jsonClient->sendCommand("Integrations.GetVendors", this, "getVendorsResponse");
+    m_jsonClient->sendCommand("Integrations.GetIOConnections", this, "getIOConnectionsResponse");
+}
+
+void ThingManager::refreshThings()
+{
+    m_jsonClient->sendCommand("Integrations.GetThings", this, "getThingsResponse");
 }
 
 Vendors *ThingManager::vendors() const
@@ -105,6 +156,34 @@ bool ThingManager::fetchingData() const
     return m_fetchingData;
 }
 
+int ThingManager::stateUpdateInterval() const
+{
+    return m_stateUpdateInterval;
+}
+
+void ThingManager::setStateUpdateInterval(int stateUpdateInterval)
+{
+    if (m_stateUpdateInterval != stateUpdateInterval) {
+        m_stateUpdateInterval = stateUpdateInterval;
+        emit stateUpdateIntervalChanged();
+        updateStateUpdateTimer();
+    }
+}
+
+int ThingManager::backgroundStateUpdateInterval() const
+{
+    return m_backgroundStateUpdateInterval;
+}
+
+void ThingManager::setBackgroundStateUpdateInterval(int backgroundStateUpdateInterval)
+{
+    if (m_backgroundStateUpdateInterval != backgroundStateUpdateInterval) {
+        m_backgroundStateUpdateInterval = backgroundStateUpdateInterval;
+        emit backgroundStateUpdateIntervalChanged();
+        updateStateUpdateTimer();
+    }
+}
+
 int ThingManager::addThing(const QUuid &thingClassId, const QString &name, const QVariantList &thingParams)
 {
     QVariantMap params;
@@ -119,26 +198,19 @@ void ThingManager::notificationReceived(const QVariantMap &data)
     qCDebug(dcThingManager()) << "ThingManager notifications received:" << qUtf8Printable(QJsonDocument::fromVariant(data).toJson());
     QString notification = data.value("notification").toString();
     QVariantMap params = data.value("params").toMap();
+
+    // Keep the order of events when other notifications interleave with queued state changes
+    if (notification != "Integrations.StateChanged" && !m_pendingStateChanges.isEmpty()) {
+        m_stateUpdateTimer.stop();
+        flushStateChanges();
+    }
+
     if (notification == "Integrations.StateChanged") {
-        Thing *thing = m_things->getThing(params.value("thingId").toUuid());
-        if (!thing) {
-            if (!m_fetchingData) {
-                qCWarning(dcThingManager()) << "Thing state change notification received for an unknown thing";
-            }
-            return;
-        }
-        QUuid stateTypeId = params.value("stateTypeId").toUuid();
-        QVariant value = params.value("value");
-//        qDebug() << "Thing state changed for:" << dev->name() << "State name:" << dev->thingClass()->stateTypes()->getStateType(stateTypeId) << "value:" << value;
-        State *state = thing->state(stateTypeId);
-        state->setValue(value);
-        if (params.contains("minValue")) {
-            state->setMinValue(params.value("minValue"));
-        }
-        if (params.contains("maxValue")) {
-            state->setMaxValue(params.value("maxValue"));
+        if (m_stateUpdateTimer.interval() <= 0) {
+            applyStateChange(params);
+        } else {
+            queueStateChange(params);
         }
-        emit thingStateChanged(thing->id(), stateTypeId, value);
     } else if (notification == "Integrations.ThingAdded") {
         Thing *thing = unpackThing(this, data.value("params").toMap().value("thing").toMap(), m_thingClasses);
         if (!thing) {
@@ -229,6 +301,81 @@ void ThingManager::notificationReceived(const QVariantMap &data)
     }
 }
 
+void ThingManager::queueStateChange(const QVariantMap &params)
+{
+    QPair<QUuid, QUuid> key = qMakePair(params.value("thingId").toUuid(), params.value("stateTypeId").toUuid());
+    QHash<QPair<QUuid, QUuid>, int>::const_iterator it = m_pendingStateChangeIndexes.constFind(key);
+    if (it == m_pendingStateChangeIndexes.constEnd()) {
+        m_pendingStateChangeIndexes.insert(key, m_pendingStateChanges.count());
+        m_pendingStateChanges.append(params);
+    } else {
+        // Only the latest value counts, but don't lose min/max updates from earlier notifications
+        QVariantMap &pending = m_pendingStateChanges[it.value()];
+        for (QVariantMap::const_iterator paramIt = params.constBegin(); paramIt != params.constEnd(); ++paramIt) {
+            pending.insert(paramIt.key(), paramIt.value());
+        }
+    }
+
+    if (!m_stateUpdateTimer.isActive()) {
+        m_stateUpdateTimer.start();
+    }
+}
+
+void ThingManager::applyStateChange(const QVariantMap &params)
+{
+    Thing *thing = m_things->getThing(params.value("thingId").toUuid());
+    if (!thing) {
+        if (!m_fetchingData) {
+            qCWarning(dcThingManager()) << "Thing state change notification received for an unknown thing";
+        }
+        return;
+    }
+    QUuid stateTypeId = params.value("stateTypeId").toUuid();
+    QVariant value = params.value("value");
+//    qDebug() << "Thing state changed for:" << dev->name() << "State name:" << dev->thingClass()->stateTypes()->getStateType(stateTypeId) << "value:" << value;
+    States *states = thing->states();
+    int index = states->indexOf(stateTypeId);
+    if (index < 0) {
+        qCWarning(dcThingManager()) << "Thing state change notification received for an unknown state" << stateTypeId;
+        return;
+    }
+    states->setValueAt(index, value);
+    if (params.contains("minValue")) {
+        states->setMinValueAt(index, params.value("minValue"));
+    }
+    if (params.contains("maxValue")) {
+        states->setMaxValueAt(index, params.value("maxValue"));
+    }
+    emit thingStateChanged(thing->id(), stateTypeId, value);
+}
+
+void ThingManager::flushStateChanges()
+{
+    QList<QVariantMap> pendingStateChanges = m_pendingStateChanges;
+    m_pendingStateChanges.clear();
+    m_pendingStateChangeIndexes.clear();
+    foreach (const QVariantMap &params, pendingStateChanges) {
+        applyStateChange(params);
+    }
+}
+
+void ThingManager::updateStateUpdateTimer()
+{
+    QGuiApplication *app = qobject_cast<QGuiApplication*>(QGuiApplication::instance());
+    bool background = app && app->applicationState() != Qt::ApplicationActive;
+    int interval = background ? m_backgroundStateUpdateInterval : m_stateUpdateInterval;
+    if (interval == m_stateUpdateTimer.interval()) {
+        return;
+    }
+    qCDebug(dcThingManager()) << "State update interval is now" << interval << "ms";
+    m_stateUpdateTimer.setInterval(interval);
+    // Don't leave things waiting on the old interval, e.g. when coming back to the foreground
+    if (m_stateUpdateTimer.isActive() || interval <= 0) {
+        m_stateUpdateTimer.stop();
+        flushStateChanges();
+    }
+}
+
 void ThingManager::getVendorsResponse(int /*commandId*/, const QVariantMap &params)
 {
 //    qDebug() << "Got GetSupportedVendors response" << params;
@@ -240,11 +387,37 @@ void ThingManager::getVendorsResponse(int /*commandId*/, const QVariantMap &para
 //            qDebug() << "Added Vendor:" << vendor->name();
         }
     }
+    bootstrapPhaseFinished("Vendors");
 }
 
 void ThingManager::getThingClassesResponse(int /*commandId*/, const QVariantMap &params)
 {
     qCDebug(dcThingManager) << "GetThingClasses response:" << qUtf8Printable(QJsonDocument::fromVariant(params).toJson());
+    m_liveThingClasses = params.value("thingClasses").toList();
+
+    // Without a reply there's nothing to compare with. Keep what the snapshot has, if anything.
+    if (m_snapshotLoaded && !JsonRpcClient::isLost(params)) {
+        if (m_liveThingClasses == m_snapshotThingClasses) {
+            qCDebug(dcThingManager()) << "Thing classes in snapshot are up to date.";
+            m_snapshotThingClasses.clear();
+            m_thingClassesLoaded = true;
+            bootstrapPhaseFinished("ThingClasses");
+            if (m_pendingBootstrapPhases.contains("Things") && !m_pendingThings.isEmpty()) {
+                processThings(m_pendingThings);
+                m_pendingThings.clear();
+            }
+            return;
+        }
+        // Thing objects hold on to their thing class, so we can't just swap those out. Start over with live data.
+        qCInfo(dcThingManager()) << "Thing classes have changed since the snapshot has been taken. Discarding snapshot.";
+        m_snapshotLoaded = false;
+        m_snapshotThingClasses.clear();
+        m_fetchingData = true;
+        emit fetchingDataChanged();
+        m_things->clearModel();
+        m_thingClasses->clearModel();
+    }
+
     if (params.keys().contains("thingClasses")) {
         QVariantList thingClassList = params.value("thingClasses").toList();
         foreach (QVariant thingClassVariant, thingClassList) {
@@ -252,7 +425,13 @@ void ThingManager::getThingClassesResponse(int /*commandId*/, const QVariantMap
             m_thingClasses->addThingClass(thingClass);
         }
     }
-    m_jsonClient->sendCommand("Integrations.GetThings", this, "getThingsResponse");
+    m_thingClassesLoaded = true;
+    bootstrapPhaseFinished("ThingClasses");
+
+    if (m_pendingBootstrapPhases.contains("Things") && !m_pendingThings.isEmpty()) {
+        processThings(m_pendingThings);
+        m_pendingThings.clear();
+    }
 }
 
 void ThingManager::getPluginsResponse(int /*commandId*/, const QVariantMap &params)
@@ -265,59 +444,194 @@ void ThingManager::getPluginsResponse(int /*commandId*/, const QVariantMap &para
             m_plugins->addPlugin(plugin);
         }
     }
-    m_jsonClient->sendCommand("Integrations.GetVendors", this, "getVendorsResponse");
+    bootstrapPhaseFinished("Plugins");
 }
 
 void ThingManager::getThingsResponse(int /*commandId*/, const QVariantMap &params)
+{
+    if (!m_thingClassesLoaded) {
+        qCDebug(dcThingManager()) << "Things arrived before thing classes. Holding them back.";
+        m_pendingThings = params;
+        // Make sure we don't end up waiting forever on an empty reply
+        if (m_pendingThings.isEmpty()) {
+            m_pendingThings.insert("things", QVariantList());
+        }
+        return;
+    }
+    processThings(params);
+}
+
+void ThingManager::processThings(const QVariantMap &params)
 {
 //    qCritical() << "Things received:" << qUtf8Printable(QJsonDocument::fromVariant(params).toJson(QJsonDocument::Indented));
     if (params.keys().contains("things")) {
         QVariantList thingsList = params.value("things").toList();
         QList<Thing*> newThings;
+        QSet<QUuid> liveThingIds;
         foreach (QVariant thingVariant, thingsList) {
-            Thing *thing = unpackThing(this, thingVariant.toMap(), m_thingClasses);
+            QVariantMap thingMap = thingVariant.toMap();
+            liveThingIds.insert(thingMap.value("id").toUuid());
+
+            // Things loaded from the snapshot are updated in place so the UI keeps its references
+            Thing *existingThing = m_things->getThing(thingMap.value("id").toUuid());
+            if (existingThing && existingThing->thingClassId() != thingMap.value("thingClassId").toUuid()) {
+                m_things->removeThing(existingThing);
+                emit thingRemoved(existingThing);
+                existingThing = nullptr;
+            }
+
+            Thing *thing = unpackThing(this, thingMap, m_thingClasses, existingThing);
             if (!thing) {
-                qWarning() << "Error unpacking thing" << thingVariant.toMap().value("name").toString();
+                qWarning() << "Error unpacking thing" << thingMap.value("name").toString();
                 continue;
             }
 
             // set initial state values
-            QVariantList stateVariantList = thingVariant.toMap().value("states").toList();
-            foreach (const QVariant &stateMap, stateVariantList) {
-                QString stateTypeId = stateMap.toMap().value("stateTypeId").toString();
-                StateType *st = thing->thingClass()->stateTypes()->getStateType(stateTypeId);
-                if (!st) {
-                    qWarning() << "Can't find a statetype for this state";
-                    continue;
-                }
-                QVariant value = stateMap.toMap().value("value");
-                if (st->type() == "Bool") {
-                    value.convert(QVariant::Bool);
-                } else if (st->type() == "Double") {
-                    value.convert(QVariant::Double);
-                } else if (st->type() == "Int") {
-                    value.convert(QVariant::Int);
+            applyStateValues(thing, thingMap.value("states").toList());
+            if (!existingThing) {
+                newThings.append(thing);
+            }
+        }
+
+        // Things from the snapshot or an earlier fetch might be gone by now
+        if (m_things->rowCount() > 0) {
+            foreach (Thing *thing, m_things->devices()) {
+                if (!liveThingIds.contains(thing->id())) {
+                    qCDebug(dcThingManager()) << "Thing" << thing->name() << "doesn't exist any more.";
+                    m_things->removeThing(thing);
+                    emit thingRemoved(thing);
                 }
-                thing->setStateValue(stateTypeId, value);
-//                qDebug() << "Set thing state value:" << thing->stateValue(stateTypeId) << value;
             }
-            newThings.append(thing);
         }
+
         things()->addThings(newThings);
+
+        saveSnapshot(thingsList);
     }
-    qDebug() << "Initializing thing manager took" << m_connectionBenchmark.msecsTo(QDateTime::currentDateTime()) << "ms";
-    m_fetchingData = false;
-    emit fetchingDataChanged();
+    bootstrapPhaseFinished("Things");
 
-    m_jsonClient->sendCommand("Integrations.GetIOConnections", this, "getIOConnectionsResponse");
+    // Thing classes and things are all that's needed to show the things. Plugins, vendors and IO connections may still
+    // be on the way but nothing in the UI waits for those.
+    if (m_fetchingData) {
+        m_fetchingData = false;
+        emit fetchingDataChanged();
+    }
+}
 
-    m_jsonClient->sendCommand("Integrations.GetPlugins", this, "getPluginsResponse");
+void ThingManager::applyStateValues(Thing *thing, const QVariantList &stateVariantList)
+{
+    foreach (const QVariant &stateMap, stateVariantList) {
+        QString stateTypeId = stateMap.toMap().value("stateTypeId").toString();
+        StateType *st = thing->thingClass()->stateTypes()->getStateType(stateTypeId);
+        if (!st) {
+            qWarning() << "Can't find a statetype for this state";
+            continue;
+        }
+        // States converts the value to the state type's type
+        thing->setStateValue(stateTypeId, stateMap.toMap().value("value"));
+//        qDebug() << "Set thing state value:" << thing->stateValue(stateTypeId) << value;
+    }
+}
+
+QString ThingManager::snapshotFileName() const
+{
+    QString serverUuid = m_jsonClient->serverUuid().remove(QRegExp("[{}]"));
+    if (serverUuid.isEmpty()) {
+        return QString();
+    }
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/snapshots/" + serverUuid + ".snapshot";
+}
+
+bool ThingManager::loadSnapshot()
+{
+    QString fileName = snapshotFileName();
+    if (fileName.isEmpty()) {
+        return false;
+    }
+    QFile f(fileName);
+    if (!f.exists() || !f.open(QFile::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream stream(&f);
+    stream.setVersion(QDataStream::Qt_5_12);
+    quint32 magic, version;
+    QString locale;
+    QVariantList thingClassList, thingList;
+    stream >> magic >> version;
+    if (magic != snapshotMagic || version != snapshotVersion) {
+        qCInfo(dcThingManager()) << "Ignoring snapshot file of unsupported version" << version;
+        return false;
+    }
+    stream >> locale >> thingClassList >> thingList;
+    if (stream.status() != QDataStream::Ok) {
+        qCWarning(dcThingManager()) << "Snapshot file" << fileName << "is corrupt. Ignoring it.";
+        return false;
+    }
+    // Thing classes contain translated strings
+    if (locale != QLocale().name()) {
+        return false;
+    }
+
+    foreach (const QVariant &thingClassVariant, thingClassList) {
+        m_thingClasses->addThingClass(unpackThingClass(thingClassVariant.toMap()));
+    }
+    QList<Thing*> things;
+    foreach (const QVariant &thingVariant, thingList) {
+        Thing *thing = unpackThing(this, thingVariant.toMap(), m_thingClasses);
+        if (!thing) {
+            continue;
+        }
+        applyStateValues(thing, thingVariant.toMap().value("states").toList());
+        things.append(thing);
+    }
+    m_things->addThings(things);
+    m_snapshotThingClasses = thingClassList;
+    return true;
+}
+
+void ThingManager::saveSnapshot(const QVariantList &things)
+{
+    QString fileName = snapshotFileName();
+    if (fileName.isEmpty() || m_liveThingClasses.isEmpty()) {
+        return;
+    }
+    QDir().mkpath(QFileInfo(fileName).absolutePath());
+    QSaveFile f(fileName);
+    if (!f.open(QFile::WriteOnly)) {
+        qCWarning(dcThingManager()) << "Unable to open snapshot file for writing:" << fileName << f.errorString();
+        return;
+    }
+    QDataStream stream(&f);
+    stream.setVersion(QDataStream::Qt_5_12);
+    stream << snapshotMagic << snapshotVersion << QLocale().name() << m_liveThingClasses << things;
+    if (!f.commit()) {
+        qCWarning(dcThingManager()) << "Error writing snapshot file:" << fileName << f.errorString();
+    }
+}
+
+void ThingManager::bootstrapPhaseFinished(const QString &phase)
+{
+    if (!m_pendingBootstrapPhases.removeOne(phase)) {
+        return;
+    }
+    qint64 elapsed = m_bootstrapTimer.elapsed();
+    qCDebug(dcThingManager()) << "Fetching" << phase << "finished after" << elapsed << "ms";
+    m_bootstrapTimings.append(qMakePair(phase, elapsed));
+
+    if (m_pendingBootstrapPhases.isEmpty()) {
+        QStringList timings;
+        for (int i = 0; i < m_bootstrapTimings.count(); i++) {
+            timings.append(QString("%1: %2 ms").arg(m_bootstrapTimings.at(i).first).arg(m_bootstrapTimings.at(i).second));
+        }
+        qCInfo(dcThingManager()) << "Initializing thing manager took" << elapsed << "ms." << qUtf8Printable(timings.join(", "));
+    }
 }
 
 void ThingManager::addThingResponse(int commandId, const QVariantMap &params)
 {
-    qDebug() << "Error from string:" << errorFromString(params.value("thingError").toByteArray()) << params.value("thingError");
-    emit addThingReply(commandId, errorFromString(params.value("thingError").toByteArray()), params.value("thingId").toUuid(), params.value("displayMessage").toString());
+    qDebug() << "Error from string:" << errorFromReply(params) << params.value("thingError");
+    emit addThingReply(commandId, errorFromReply(params), params.value("thingId").toUuid(), params.value("displayMessage").toString());
 
     if (params.value("thingError").toString() != "ThingErrorNoError") {
         qWarning() << "Failed to add thing:" << params.value("thingError").toString();
@@ -337,13 +651,13 @@ void ThingManager::addThingResponse(int commandId, const QVariantMap &params)
 void ThingManager::removeThingResponse(int commandId, const QVariantMap &params)
 {
     qDebug() << "Thing removed response" << params;
-    emit removeThingReply(commandId, errorFromString(params.value("thingError").toByteArray()), params.value("ruleIds").toStringList());
+    emit removeThingReply(commandId, errorFromReply(params), params.value("ruleIds").toStringList());
 }
 
 void ThingManager::pairThingResponse(int commandId, const QVariantMap &params)
 {
     emit pairThingReply(commandId,
-                        errorFromString(params.value("thingError").toByteArray()),
+                        errorFromReply(params),
                         params.value("pairingTransactionId").toUuid(),
                         params.value("setupMethod").toString(),
                         params.value("displayMessage").toString(),
@@ -353,31 +667,37 @@ void ThingManager::pairThingResponse(int commandId, const QVariantMap &params)
 void ThingManager::confirmPairingResponse(int commandId, const QVariantMap &params)
 {
     qDebug() << "ConfirmPairingResponse" << params;
-    emit confirmPairingReply(commandId, errorFromString(params.value("thingError").toByteArray()), params.value("thingId").toUuid(), params.value("displayMessage").toString());
+    emit confirmPairingReply(commandId, errorFromReply(params), params.value("thingId").toUuid(), params.value("displayMessage").toString());
 }
 
 void ThingManager::setPluginConfigResponse(int commandId, const QVariantMap &params)
 {
     qDebug() << "set plugin config response" << params;
-    emit savePluginConfigReply(commandId, errorFromString(params.value("thingError").toByteArray()));
+    emit savePluginConfigReply(commandId, errorFromReply(params));
 }
 
 void ThingManager::editThingResponse(int commandId, const QVariantMap &params)
 {
     qDebug() << "Edit thing response" << params;
-    emit editThingReply(commandId, errorFromString(params.value("thingError").toByteArray()));
+    emit editThingReply(commandId, errorFromReply(params));
 }
 
 void ThingManager::executeActionResponse(int commandId, const QVariantMap &params)
 {
     qCDebug(dcThingManager()) << "Execute Action response" << params;
-    emit executeActionReply(commandId, errorFromString(params.value("thingError").toByteArray()), params.value("displayMessage").toString());
+    Thing::ThingError thingError = errorFromReply(params);
+    QString displayMessage = params.value("displayMessage").toString();
+    QPointer<Thing> owner = m_actionOwners.take(commandId);
+    if (owner) {
+        owner->actionExecuted(commandId, thingError, displayMessage);
+    }
+    emit executeActionReply(commandId, thingError, displayMessage);
 }
 
 void ThingManager::reconfigureThingResponse(int commandId, const QVariantMap &params)
 {
     qDebug() << "Reconfigure device response" << params;
-    emit reconfigureThingReply(commandId, errorFromString(params.value("thingError").toByteArray()), params.value("displayMessage").toString());
+    emit reconfigureThingReply(commandId, errorFromReply(params), params.value("displayMessage").toString());
 }
 
 ThingGroup *ThingManager::createGroup(Interface *interface, ThingsProxy *things)
@@ -496,9 +816,23 @@ int ThingManager::executeAction(const QUuid &thingId, const QUuid &actionTypeId,
     }
 
     qCDebug(dcThingManager()) << "Executing action" << thingId << actionTypeId;
+
+    // Dragging a slider sends an action for every step. If the action sets a state to an absolute value,
+    // only the last one counts. Anything else, like "press" or "increase volume", must go out every time.
+    Thing *thing = m_things->getThing(thingId);
+    if (thing && thing->thingClass() && thing->thingClass()->stateTypes()->getStateType(actionTypeId) && params.count() == 1) {
+        return m_jsonClient->sendReplaceableCommand("Integrations.ExecuteAction", p, thingId.toString() + '-' + actionTypeId.toString(), this, "executeActionResponse");
+    }
     return m_jsonClient->sendCommand("Integrations.ExecuteAction", p, this, "executeActionResponse");
 }
 
+int ThingManager::executeAction(Thing *owner, const QUuid &thingId, const QUuid &actionTypeId, const QVariantList &params)
+{
+    int commandId = executeAction(thingId, actionTypeId, params);
+    m_actionOwners.insert(commandId, owner);
+    return commandId;
+}
+
 BrowserItems *ThingManager::browseThing(const QUuid &thingId, const QString &itemId)
 {
     QVariantMap params;
@@ -556,6 +890,11 @@ void ThingManager::browseThingResponse(int commandId, const QVariantMap &params)
         qDebug() << "BrowserItems model seems to have disappeared. Discarding browsing result.";
         return;
     }
+    if (JsonRpcClient::isLost(params)) {
+        // Keep showing what's there
+        itemModel->setBusy(false);
+        return;
+    }
 
     QList<BrowserItem*> itemsToRemove = itemModel->list();
 
@@ -604,6 +943,9 @@ void ThingManager::browserItemResponse(int commandId, const QVariantMap &params)
         qDebug() << "BrowserItem seems to have disappeared. Discarding browser item details result.";
         return;
     }
+    if (JsonRpcClient::isLost(params)) {
+        return;
+    }
 
     QVariantMap itemMap = params.value("item").toMap();
     item->setDisplayName(itemMap.value("displayName").toString());
@@ -629,7 +971,7 @@ int ThingManager::executeBrowserItem(const QUuid &thingId, const QString &itemId
 void ThingManager::executeBrowserItemResponse(int commandId, const QVariantMap &params)
 {
     qDebug() << "Execute Browser Item finished" << params;
-    emit executeBrowserItemReply(commandId, errorFromString(params.value("thingError").toByteArray()), params.value("displayMessage").toString());
+    emit executeBrowserItemReply(commandId, errorFromReply(params), params.value("displayMessage").toString());
 }
 
 int ThingManager::executeBrowserItemAction(const QUuid &thingId, const QString &itemId, const QUuid &actionTypeId, const QVariantList &params)
@@ -679,7 +1021,7 @@ int ThingManager::disconnectIO(const QUuid &ioConnectionId)
 void ThingManager::executeBrowserItemActionResponse(int commandId, const QVariantMap &params)
 {
     qDebug() << "Execute Browser Item Action finished" << params;
-    emit executeBrowserItemActionReply(commandId, errorFromString(params.value("thingError").toByteArray()), params.value("displayMessage").toString());
+    emit executeBrowserItemActionReply(commandId, errorFromReply(params), params.value("displayMessage").toString());
 }
 
 void ThingManager::getIOConnectionsResponse(int /*commandId*/, const QVariantMap &params)
@@ -697,6 +1039,7 @@ void ThingManager::getIOConnectionsResponse(int /*commandId*/, const QVariantMap
         IOConnection *ioConnection = new IOConnection(id, inputThingId, inputStateTypeId, outputThingId, outputStateTypeId, inverted);
         m_ioConnections->addIOConnection(ioConnection);
     }
+    bootstrapPhaseFinished("IOConnections");
 }
 
 void ThingManager::connectIOResponse(int commandId, const QVariantMap &params)
@@ -959,28 +1302,19 @@ Thing* ThingManager::unpackThing(ThingManager *thingManager, const QVariantMap &
 
     States *states = thing->states();
     if (!states) {
-        states = new States(thing);
+        states = new States(thing->id(), thing->thingClass()->stateTypes(), thing);
     }
     foreach (const QVariant &stateVariant, thingMap.value("states").toList()) {
         QVariantMap stateMap = stateVariant.toMap();
-        State *state = states->getState(stateMap.value("stateTypeId").toUuid());
-        if (!state) {
-            state = new State(thing->id(), stateMap.value("stateTypeId").toUuid(), stateMap.value("value"), states);
-            states->addState(state);
-        } else {
-            state->setValue(stateMap.value("value"));
-        }
-        StateType *stateType = thing->thingClass()->stateTypes()->getStateType(state->stateTypeId());
-        if (stateMap.contains("minValue")) {
-            state->setMinValue(stateMap.value("minValue"));
-        } else {
-            state->setMinValue(stateType->minValue());
-        }
-        if (stateMap.contains("maxValue")) {
-            state->setMaxValue(stateMap.value("maxValue"));
-        } else {
-            state->setMaxValue(stateType->maxValue());
+        QUuid stateTypeId = stateMap.value("stateTypeId").toUuid();
+        if (!states->addState(stateTypeId, stateMap.value("value"))) {
+            qCWarning(dcThingManager()) << "Skipping state with unknown state type" << stateTypeId << "for thing" << thing->name();
+            continue;
         }
+        // If not overridden by the server, min and max fall back to the state type's
+        int index = states->indexOf(stateTypeId);
+        states->setMinValueAt(index, stateMap.value("minValue"));
+        states->setMaxValueAt(index, stateMap.value("maxValue"));
     }
     thing->setStates(states);
 
@@ -1017,6 +1351,15 @@ Thing::ThingError ThingManager::errorFromString(const QByteArray &thingErrorStri
     return static_cast<Thing::ThingError>(metaEnum.keyToValue(thingErrorString));
 }
 
+Thing::ThingError ThingManager::errorFromReply(const QVariantMap &params)
+{
+    // The request might or might not have reached the thing
+    if (JsonRpcClient::isLost(params)) {
+        return Thing::ThingErrorTimeout;
+    }
+    return errorFromString(params.value("thingError").toByteArray());
+}
+
 ThingClass::SetupMethod ThingManager::stringToSetupMethod(const QString &setupMethodString)
 {
     if (setupMethodString == "SetupMethodJustAdd") {
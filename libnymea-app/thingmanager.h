@@ -32,6 +32,8 @@
 #define THINGMANAGER_H
 
 #include <QObject>
+#include <QElapsedTimer>
+#include <QTimer>
 
 #include "types/vendors.h"
 #include "things.h"
@@ -58,6 +60,11 @@ class ThingManager : public QObject
 
     Q_PROPERTY(bool fetchingData READ fetchingData NOTIFY fetchingDataChanged)
 
+    // State changes are collected and applied in batches at most every stateUpdateInterval milliseconds,
+    // keeping only the latest value per state. 0 applies every change immediately.
+    Q_PROPERTY(int stateUpdateInterval READ stateUpdateInterval WRITE setStateUpdateInterval NOTIFY stateUpdateIntervalChanged)
+    Q_PROPERTY(int backgroundStateUpdateInterval READ backgroundStateUpdateInterval WRITE setBackgroundStateUpdateInterval NOTIFY backgroundStateUpdateIntervalChanged)
+
     Q_ENUMS(RemovePolicy)
 public:
     enum RemovePolicy {
@@ -71,6 +78,8 @@ public:
 
     void clear();
     void init();
+    // Fetches the things again and updates them in place
+    void refreshThings();
 
     Vendors* vendors() const;
     Plugins* plugins() const;
@@ -80,6 +89,12 @@ public:
 
     bool fetchingData() const;
 
+    int stateUpdateInterval() const;
+    void setStateUpdateInterval(int stateUpdateInterval);
+
+    int backgroundStateUpdateInterval() const;
+    void setBackgroundStateUpdateInterval(int backgroundStateUpdateInterval);
+
     Q_INVOKABLE int addThing(const QUuid &thingClassId, const QString &name, const QVariantList &thingParams);
     // Param thingClassId is deprecated as of jsonrpc 5.4
     Q_INVOKABLE int addDiscoveredThing(const QUuid &thingClassId, const QUuid &thingDescriptorId, const QString &name, const QVariantList &thingParams);
@@ -93,6 +108,8 @@ public:
     Q_INVOKABLE int reconfigureThing(const QUuid &thingId, const QVariantList &thingParams);
     Q_INVOKABLE int reconfigureDiscoveredThing(const QUuid &thingDescriptorId, const QVariantList &paramOverride);
     Q_INVOKABLE int executeAction(const QUuid &thingId, const QUuid &actionTypeId, const QVariantList &params = QVariantList());
+    // The reply is delivered to owner->actionExecuted(), in addition to the executeActionReply signal
+    int executeAction(Thing *owner, const QUuid &thingId, const QUuid &actionTypeId, const QVariantList &params);
     Q_INVOKABLE BrowserItems* browseThing(const QUuid &thingId, const QString &itemId = QString());
     Q_INVOKABLE void refreshBrowserItems(BrowserItems *browserItems);
     Q_INVOKABLE BrowserItem* browserItem(const QUuid &thingId, const QString &itemId);
@@ -145,9 +162,12 @@ signals:
     void executeBrowserItemReply(int commandId, Thing::ThingError thingError, const QString &displayMessage);
     void executeBrowserItemActionReply(int commandId, Thing::ThingError thingError, const QString &displayMessage);
     void fetchingDataChanged();
+    void stateUpdateIntervalChanged();
+    void backgroundStateUpdateIntervalChanged();
     void notificationReceived(const QString &thingId, const QString &eventTypeId, const QVariantList &params);
 
     void eventTriggered(const QUuid &thingId, const QUuid &eventTypeId, const QVariantMap params);
+    // Emitted once the (coalesced) value has been applied to the thing
     void thingStateChanged(const QUuid &thingId, const QUuid &stateTypeId, const QVariant &value);
 
     void thingAdded(Thing *thing);
@@ -166,7 +186,21 @@ private:
 
     static QVariantMap packParam(Param *param);
 
+    void queueStateChange(const QVariantMap &params);
+    void applyStateChange(const QVariantMap &params);
+    void flushStateChanges();
+    void updateStateUpdateTimer();
+
+    void processThings(const QVariantMap &params);
+    void applyStateValues(Thing *thing, const QVariantList &stateVariantList);
+    void bootstrapPhaseFinished(const QString &phase);
+
+    QString snapshotFileName() const;
+    bool loadSnapshot();
+    void saveSnapshot(const QVariantList &things);
+
     static Thing::ThingError errorFromString(const QByteArray &thingErrorString);
+    static Thing::ThingError errorFromReply(const QVariantMap &params);
     static ThingClass::SetupMethod stringToSetupMethod(const QString &setupMethodString);
     static Types::Unit stringToUnit(const QString &unitString);
     static Types::InputType stringToInputType(const QString &inputTypeString);
@@ -182,10 +216,29 @@ private:
 
     JsonRpcClient *m_jsonClient = nullptr;
 
+    QTimer m_stateUpdateTimer;
+    int m_stateUpdateInterval = 16;
+    int m_backgroundStateUpdateInterval = 1000;
+    QList<QVariantMap> m_pendingStateChanges;
+    QHash<QPair<QUuid, QUuid>, int> m_pendingStateChangeIndexes;
+
+    QHash<int, QPointer<Thing> > m_actionOwners;
+
     QHash<int, QPointer<BrowserItems> > m_browsingRequests;
     QHash<int, QPointer<BrowserItem> > m_browserDetailsRequests;
 
-    QDateTime m_connectionBenchmark;
+    // Initial data fetch. All requests are sent at once, things are held back until their thing classes are known.
+    QElapsedTimer m_bootstrapTimer;
+    QStringList m_pendingBootstrapPhases;
+    QList<QPair<QString, qint64> > m_bootstrapTimings;
+    bool m_thingClassesLoaded = false;
+    QVariantMap m_pendingThings;
+
+    // Snapshot of the last known thing classes and things, used to show the things right away on connect.
+    // Live data is reconciled into it once it arrives.
+    bool m_snapshotLoaded = false;
+    QVariantList m_snapshotThingClasses;
+    QVariantList m_liveThingClasses;
 };
 
 Q_DECLARE_METATYPE(QList<QUuid>)
@@ -53,12 +53,7 @@ Thing *Things::get(int index) const
 
 Thing *Things::getThing(const QUuid &thingId) const
 {
-    foreach (Thing *thing, m_things) {
-        if (thing->id() == thingId) {
-            return thing;
-        }
-    }
-    return nullptr;
+    return m_thingsById.value(thingId);
 }
 
 int Things::indexOf(Thing *thing) const
@@ -116,6 +111,10 @@ void Things::addThings(const QList<Thing *> things)
 
     foreach (Thing *thing, things) {
         thing->setParent(this);
+        // getThing() returns the first one, like the list lookup did
+        if (!m_thingsById.contains(thing->id())) {
+            m_thingsById.insert(thing->id(), thing);
+        }
         connect(thing, &Thing::nameChanged, this, [thing, this]() {
             int idx = m_things.indexOf(thing);
             if (idx < 0) return;
@@ -144,16 +143,37 @@ void Things::removeThing(Thing *thing)
     beginRemoveRows(QModelIndex(), index, index);
     qDebug() << "Removed thing" << thing->name();
     m_things.takeAt(index)->deleteLater();
+    if (m_thingsById.value(thing->id()) == thing) {
+        m_thingsById.remove(thing->id());
+        // Another one with the same id becomes the first one
+        foreach (Thing *other, m_things) {
+            if (other->id() == thing->id()) {
+                m_thingsById.insert(other->id(), other);
+                break;
+            }
+        }
+    }
     endRemoveRows();
     emit countChanged();
     emit thingRemoved(thing);
 }
 
+void Things::notifyTagsChanged(const QUuid &thingId)
+{
+    Thing *thing = m_thingsById.value(thingId);
+    if (!thing) {
+        return;
+    }
+    int idx = m_things.indexOf(thing);
+    emit dataChanged(index(idx), index(idx));
+}
+
 void Things::clearModel()
 {
     beginResetModel();
     qDeleteAll(m_things);
     m_things.clear();
+    m_thingsById.clear();
     endResetModel();
     emit countChanged();
 }
@@ -72,6 +72,10 @@ public:
     void addThings(const QList<Thing*> things);
     void removeThing(Thing *thing);
 
+    // Tags aren't part of the thing, but filters depend on them. Signals the thing's row as changed so
+    // proxies re-evaluate only that row.
+    void notifyTagsChanged(const QUuid &thingId);
+
     void clearModel();
 
 protected:
@@ -84,6 +88,7 @@ signals:
 
 private:
     QList<Thing *> m_things;
+    QHash<QUuid, Thing*> m_thingsById;
 
 };
 
@@ -33,6 +33,17 @@
 #include "tagsmanager.h"
 #include "types/tag.h"
 
+// Reads the value directly instead of going through Thing::stateByName() which would create a State object
+static bool stateValueByName(Thing *thing, const QString &stateName, QVariant *value)
+{
+    StateType *stateType = thing->thingClass()->stateTypes()->findByName(stateName);
+    if (!stateType || !thing->hasState(stateType->id())) {
+        return false;
+    }
+    *value = thing->stateValue(stateType->id());
+    return true;
+}
+
 ThingsProxy::ThingsProxy(QObject *parent) :
     QSortFilterProxyModel(parent)
 {
@@ -40,6 +51,15 @@ ThingsProxy::ThingsProxy(QObject *parent) :
     connect(this, &ThingsProxy::countChanged, this, [=](){
         m_oldCount = rowCount();
     });
+
+    // With dynamicSortFilter the base class re-evaluates only the rows affected by dataChanged and rowsInserted
+    // in the source model. Just keep track of the resulting count changes.
+    connect(this, &QAbstractItemModel::rowsInserted, this, &ThingsProxy::updateCount);
+    connect(this, &QAbstractItemModel::rowsRemoved, this, &ThingsProxy::updateCount);
+    connect(this, &QAbstractItemModel::modelReset, this, &ThingsProxy::updateCount);
+    connect(this, &QAbstractItemModel::modelAboutToBeReset, this, [this](){
+        m_acceptedThingClasses.clear();
+    });
 }
 
 Engine *ThingsProxy::engine() const
@@ -51,7 +71,7 @@ void ThingsProxy::setEngine(Engine *engine)
 {
     if (m_engine != engine) {
         if (m_engine) {
-            disconnect(m_engine->tagsManager()->tags(), &Tags::countChanged, this, &ThingsProxy::invalidateFilter);
+            disconnect(m_engine->tagsManager()->tags(), &Tags::modelReset, this, &ThingsProxy::onTagsReset);
         }
         m_engine = engine;
         emit engineChanged();
@@ -60,7 +80,9 @@ void ThingsProxy::setEngine(Engine *engine)
             return;
         }
 
-        connect(m_engine->tagsManager()->tags(), &Tags::countChanged, this, &ThingsProxy::invalidateFilterInternal);
+        // Tag changes for a single thing arrive as dataChanged for that row in the Things model.
+        // Only if the whole tags model is reset all rows need to be checked again.
+        connect(m_engine->tagsManager()->tags(), &Tags::modelReset, this, &ThingsProxy::onTagsReset);
 
         if (!sourceModel()) {
             setSourceModel(m_engine->thingManager()->things());
@@ -68,13 +90,6 @@ void ThingsProxy::setEngine(Engine *engine)
             setSortRole(Things::RoleName);
             sort(0, sortOrder());
             emit countChanged();
-            connect(sourceModel(), SIGNAL(countChanged()), this, SIGNAL(countChanged()));
-            connect(sourceModel(), &QAbstractItemModel::dataChanged, this, [this]() {
-                // Only invalidate the filter if we're actually interested in state changes
-                if (!m_sortStateName.isEmpty() || m_filterBatteryCritical || m_filterDisconnected || m_filterUpdates || m_filterSetupFailed || !m_stateFilter.isEmpty()) {
-                    invalidateFilterInternal();
-                }
-            });
         }
     }
 }
@@ -93,19 +108,8 @@ void ThingsProxy::setParentProxy(ThingsProxy *parentProxy)
         if (!m_engine) {
             return;
         }
-        connect(m_parentProxy, SIGNAL(countChanged()), this, SIGNAL(countChanged()));
 
-        connect(m_parentProxy, &QAbstractItemModel::dataChanged, this, [this]() {
-            if (m_engine &&
-                    // Only invalidate the filter if we're actually interested in state changes
-                    (!m_sortStateName.isEmpty() || m_filterBatteryCritical || m_filterDisconnected || m_filterUpdates || m_filterSetupFailed)) {
-                invalidateFilterInternal();
-            }
-        });
-
-        if (m_engine) {
-            invalidateFilter();
-        }
+        invalidateFilterInternal();
 
         emit parentProxyChanged();
         emit countChanged();
@@ -567,12 +571,130 @@ int ThingsProxy::indexOf(Thing *thing) const
 
 void ThingsProxy::invalidateFilterInternal()
 {
+    compileFilter();
     invalidateFilter();
+    updateCount();
+}
+
+void ThingsProxy::updateCount()
+{
     if (m_oldCount != rowCount()) {
         emit countChanged();
     }
 }
 
+void ThingsProxy::onTagsReset()
+{
+    if (!m_filterTagId.isEmpty() || !m_hideTagId.isEmpty()) {
+        invalidateFilterInternal();
+    }
+}
+
+void ThingsProxy::compileFilter()
+{
+    m_filterThingUuid = QUuid(m_filterThingId);
+    m_shownInterfaceBits = InterfaceBits::fromNames(m_shownInterfaces);
+    m_hiddenInterfaceBits = InterfaceBits::fromNames(m_hiddenInterfaces);
+    m_nameFilterLower = m_nameFilter.toLower().trimmed();
+    m_shownThingIdsSet.clear();
+    foreach (const QUuid &id, m_shownThingIds) {
+        m_shownThingIdsSet.insert(id);
+    }
+    m_hiddenThingIdsSet.clear();
+    foreach (const QUuid &id, m_hiddenThingIds) {
+        m_hiddenThingIdsSet.insert(id);
+    }
+
+    m_compiledParamsFilter.clear();
+    for (QVariantMap::const_iterator it = m_paramsFilter.constBegin(); it != m_paramsFilter.constEnd(); ++it) {
+        m_compiledParamsFilter.append(qMakePair(it.key(), it.value()));
+    }
+    m_compiledStateFilter.clear();
+    for (QVariantMap::const_iterator it = m_stateFilter.constBegin(); it != m_stateFilter.constEnd(); ++it) {
+        m_compiledStateFilter.append(qMakePair(it.key(), it.value()));
+    }
+
+    m_acceptedThingClasses.clear();
+}
+
+bool ThingsProxy::thingClassAccepted(ThingClass *thingClass) const
+{
+    QHash<QUuid, bool>::const_iterator it = m_acceptedThingClasses.constFind(thingClass->id());
+    if (it != m_acceptedThingClasses.constEnd()) {
+        return it.value();
+    }
+    bool accepted = filterAcceptsThingClass(thingClass);
+    m_acceptedThingClasses.insert(thingClass->id(), accepted);
+    return accepted;
+}
+
+bool ThingsProxy::filterAcceptsThingClass(ThingClass *thingClass) const
+{
+    InterfaceBits interfaces = thingClass->interfaceBits();
+    if (!m_shownInterfaces.isEmpty() && !interfaces.intersects(m_shownInterfaceBits)) {
+        return false;
+    }
+
+    if (interfaces.intersects(m_hiddenInterfaceBits)) {
+        return false;
+    }
+
+    if (!m_shownThingClassIds.isEmpty()) {
+        if (!m_shownThingClassIds.contains(thingClass->id())) {
+            return false;
+        }
+    }
+
+    if (m_hiddenThingClassIds.contains(thingClass->id())) {
+        return false;
+    }
+
+    if (m_showDigitalInputs || m_showDigitalOutputs || m_showAnalogInputs || m_showAnalogOutputs) {
+        if (m_showDigitalInputs && thingClass->stateTypes()->ioStateTypes(Types::IOTypeDigitalInput).isEmpty()) {
+            return false;
+        }
+        if (m_showDigitalOutputs && thingClass->stateTypes()->ioStateTypes(Types::IOTypeDigitalOutput).isEmpty()) {
+            return false;
+        }
+        if (m_showAnalogInputs && thingClass->stateTypes()->ioStateTypes(Types::IOTypeAnalogInput).isEmpty()) {
+            return false;
+        }
+        if (m_showAnalogOutputs && thingClass->stateTypes()->ioStateTypes(Types::IOTypeAnalogOutput).isEmpty()) {
+            return false;
+        }
+    }
+
+    static const int batteryInterface = InterfaceBits::idOf("battery");
+    static const int connectableInterface = InterfaceBits::idOf("connectable");
+    static const int updateInterface = InterfaceBits::idOf("update");
+    if (m_filterBatteryCritical && !interfaces.testBit(batteryInterface)) {
+        return false;
+    }
+    if (m_filterDisconnected && !interfaces.testBit(connectableInterface)) {
+        return false;
+    }
+    if (m_filterUpdates && !interfaces.testBit(updateInterface)) {
+        return false;
+    }
+
+    if (!m_requiredEventName.isEmpty()) {
+        if (!thingClass->eventTypes()->findByName(m_requiredEventName)) {
+            return false;
+        }
+    }
+    if (!m_requiredStateName.isEmpty()) {
+        if (!thingClass->stateTypes()->findByName(m_requiredStateName)) {
+            return false;
+        }
+    }
+    if (!m_requiredActionName.isEmpty()) {
+        if (!thingClass->actionTypes()->findByName(m_requiredActionName)) {
+            return false;
+        }
+    }
+    return true;
+}
+
 Thing *ThingsProxy::getInternal(int source_index) const
 {
     Things* d = qobject_cast<Things*>(sourceModel());
@@ -612,10 +734,10 @@ bool ThingsProxy::lessThan(const QModelIndex &left, const QModelIndex &right) co
             Q_ASSERT(false);
             return false;
         }
-        State *leftState = leftThing->stateByName(m_sortStateName);
-        State *rightState = rightThing->stateByName(m_sortStateName);
-        QVariant leftStateValue = leftState ? leftState->value() : 0;
-        QVariant rightStateValue = rightState ? rightState->value() : 0;
+        QVariant leftStateValue = 0;
+        QVariant rightStateValue = 0;
+        stateValueByName(leftThing, m_sortStateName, &leftStateValue);
+        stateValueByName(rightThing, m_sortStateName, &rightStateValue);
         return leftStateValue < rightStateValue;
     }
 
@@ -637,7 +759,7 @@ bool ThingsProxy::filterAcceptsRow(int source_row, const QModelIndex &source_par
 {
     Thing *thing = getInternal(source_row);
     if (!m_filterTagId.isEmpty()) {
-        Tag *tag = m_engine->tagsManager()->tags()->findThingTag(thing->id().toString(), m_filterTagId);
+        Tag *tag = m_engine->tagsManager()->tags()->findThingTag(thing->id(), m_filterTagId);
         if (!tag) {
             return false;
         }
@@ -646,7 +768,7 @@ bool ThingsProxy::filterAcceptsRow(int source_row, const QModelIndex &source_par
         }
     }
     if (!m_hideTagId.isEmpty()) {
-        Tag *tag = m_engine->tagsManager()->tags()->findThingTag(thing->id().toString(), m_hideTagId);
+        Tag *tag = m_engine->tagsManager()->tags()->findThingTag(thing->id(), m_hideTagId);
         if (tag && m_hideTagValue.isEmpty()) {
             return false;
         }
@@ -656,77 +778,34 @@ bool ThingsProxy::filterAcceptsRow(int source_row, const QModelIndex &source_par
     }
 
     if (!m_filterThingId.isEmpty()) {
-        if (thing->id() != QUuid(m_filterThingId)) {
-            return false;
-        }
-    }
-
-    ThingClass *thingClass = thing->thingClass();
-    if (!m_shownInterfaces.isEmpty()) {
-        bool foundMatch = false;
-        foreach (const QString &filterInterface, m_shownInterfaces) {
-            if (thingClass->interfaces().contains(filterInterface)) {
-                foundMatch = true;
-                break;
-            }
-        }
-        if (!foundMatch) {
+        if (thing->id() != m_filterThingUuid) {
             return false;
         }
     }
 
-    if (!m_hiddenInterfaces.isEmpty()) {
-        foreach (const QString &filterInterface, m_hiddenInterfaces) {
-            if (thingClass->interfaces().contains(filterInterface)) {
-                return false;
-            }
-        }
-    }
-
-
-    if (!m_shownThingClassIds.isEmpty()) {
-        if (!m_shownThingClassIds.contains(thing->thingClassId())) {
+    if (!m_shownThingIdsSet.isEmpty()) {
+        if (!m_shownThingIdsSet.contains(thing->id())) {
             return false;
         }
     }
 
-    if (m_hiddenThingClassIds.contains(thing->thingClassId())) {
+    if (m_hiddenThingIdsSet.contains(thing->id())) {
         return false;
     }
 
-    if (!m_shownThingIds.isEmpty()) {
-        if (!m_shownThingIds.contains(thing->id())) {
-            return false;
-        }
-    }
-
-    if (m_hiddenThingIds.contains(thing->id())) {
+    ThingClass *thingClass = thing->thingClass();
+    if (!thingClassAccepted(thingClass)) {
         return false;
     }
 
-    if (m_showDigitalInputs || m_showDigitalOutputs || m_showAnalogInputs || m_showAnalogOutputs) {
-        if (m_showDigitalInputs && thingClass->stateTypes()->ioStateTypes(Types::IOTypeDigitalInput).isEmpty()) {
-            return false;
-        }
-        if (m_showDigitalOutputs && thingClass->stateTypes()->ioStateTypes(Types::IOTypeDigitalOutput).isEmpty()) {
-            return false;
-        }
-        if (m_showAnalogInputs && thingClass->stateTypes()->ioStateTypes(Types::IOTypeAnalogInput).isEmpty()) {
-            return false;
-        }
-        if (m_showAnalogOutputs && thingClass->stateTypes()->ioStateTypes(Types::IOTypeAnalogOutput).isEmpty()) {
-            return false;
-        }
-    }
-
     if (m_filterBatteryCritical) {
-        if (!thingClass->interfaces().contains("battery") || thing->stateValue(thingClass->stateTypes()->findByName("batteryCritical")->id()).toBool() == false) {
+        if (thing->stateValue(thingClass->stateTypes()->findByName("batteryCritical")->id()).toBool() == false) {
             return false;
         }
     }
 
     if (m_filterDisconnected) {
-        if (!thingClass->interfaces().contains("connectable") || thing->stateValue(thingClass->stateTypes()->findByName("connected")->id()).toBool() == true) {
+        if (thing->stateValue(thingClass->stateTypes()->findByName("connected")->id()).toBool() == true) {
             return false;
         }
     }
@@ -738,51 +817,28 @@ bool ThingsProxy::filterAcceptsRow(int source_row, const QModelIndex &source_par
     }
 
     if (m_filterUpdates) {
-        if (!thingClass->interfaces().contains("update")) {
-            return false;
-        }
         if (thing->stateValue(thingClass->stateTypes()->findByName("updateStatus")->id()).toString() == "idle") {
             return false;
         }
     }
 
-    if (!m_nameFilter.isEmpty()) {
-        if (!thing->name().toLower().contains(m_nameFilter.toLower().trimmed())) {
+    if (!m_nameFilterLower.isEmpty()) {
+        if (!thing->name().toLower().contains(m_nameFilterLower)) {
             return false;
         }
     }
 
-    if (!m_requiredEventName.isEmpty()) {
-        if (!thing->thingClass()->eventTypes()->findByName(m_requiredEventName)) {
-            return false;
-        }
-    }
-    if (!m_requiredStateName.isEmpty()) {
-        if (!thing->thingClass()->stateTypes()->findByName(m_requiredStateName)) {
-            return false;
-        }
-    }
-    if (!m_requiredActionName.isEmpty()) {
-        if (!thing->thingClass()->actionTypes()->findByName(m_requiredActionName)) {
+    for (int i = 0; i < m_compiledParamsFilter.count(); i++) {
+        Param *param = thing->paramByName(m_compiledParamsFilter.at(i).first);
+        if (!param || param->value() != m_compiledParamsFilter.at(i).second) {
             return false;
         }
     }
 
-    if (!m_paramsFilter.isEmpty()) {
-        foreach (const QString &paramName, m_paramsFilter.keys()) {
-            Param *param = thing->paramByName(paramName);
-            if (!param || param->value() != m_paramsFilter.value(paramName)) {
-                return false;
-            }
-        }
-    }
-
-    if (!m_stateFilter.isEmpty()) {
-        foreach (const QString &stateName, m_stateFilter.keys()) {
-            State *state = thing->stateByName(stateName);
-            if (!state || state->value() != m_stateFilter.value(stateName)) {
-                return false;
-            }
+    for (int i = 0; i < m_compiledStateFilter.count(); i++) {
+        QVariant value;
+        if (!stateValueByName(thing, m_compiledStateFilter.at(i).first, &value) || value != m_compiledStateFilter.at(i).second) {
+            return false;
         }
     }
 
@@ -32,6 +32,7 @@
 #define THINGSPROXY_H
 
 #include <QUuid>
+#include <QSet>
 #include <QObject>
 #include <QSortFilterProxyModel>
 
@@ -224,10 +225,16 @@ signals:
 
 private slots:
     void invalidateFilterInternal();
+    void updateCount();
+    void onTagsReset();
 
 private:
     Thing *getInternal(int source_index) const;
 
+    void compileFilter();
+    bool thingClassAccepted(ThingClass *thingClass) const;
+    bool filterAcceptsThingClass(ThingClass *thingClass) const;
+
     Engine *m_engine = nullptr;
     ThingsProxy *m_parentProxy = nullptr;
     QString m_filterTagId;
@@ -264,6 +271,18 @@ private:
 
     QString m_sortStateName;
 
+    // Compiled from the filter properties in compileFilter() so filterAcceptsRow() doesn't need to parse them for each row
+    QUuid m_filterThingUuid;
+    InterfaceBits m_shownInterfaceBits;
+    InterfaceBits m_hiddenInterfaceBits;
+    QString m_nameFilterLower;
+    QSet<QUuid> m_shownThingIdsSet;
+    QSet<QUuid> m_hiddenThingIdsSet;
+    QList<QPair<QString, QVariant>> m_compiledParamsFilter;
+    QList<QPair<QString, QVariant>> m_compiledStateFilter;
+    // Result of all filters only depending on the thing class, evaluated once per thing class
+    mutable QHash<QUuid, bool> m_acceptedThingClasses;
+
     int m_oldCount = 0;
 
 protected:
@@ -48,12 +48,7 @@ ActionType *ActionTypes::get(int index) const
 
 ActionType *ActionTypes::getActionType(const QUuid &actionTypeId) const
 {
-    foreach (ActionType *actionType, m_actionTypes) {
-        if (actionType->id() == actionTypeId) {
-            return actionType;
-        }
-    }
-    return nullptr;
+    return m_actionTypesById.value(actionTypeId);
 }
 
 int ActionTypes::rowCount(const QModelIndex &parent) const
@@ -82,24 +77,27 @@ void ActionTypes::addActionType(ActionType *actionType)
     beginInsertRows(QModelIndex(), m_actionTypes.count(), m_actionTypes.count());
     //qDebug() << "ActionTypes: loaded actionType" << actionType->name();
     m_actionTypes.append(actionType);
+    if (!m_actionTypesById.contains(actionType->id())) {
+        m_actionTypesById.insert(actionType->id(), actionType);
+    }
+    if (!m_actionTypesByName.contains(actionType->name())) {
+        m_actionTypesByName.insert(actionType->name(), actionType);
+    }
     endInsertRows();
     emit countChanged();
 }
 
 ActionType *ActionTypes::findByName(const QString &name) const
 {
-    foreach (ActionType *at, m_actionTypes) {
-        if (at->name() == name) {
-            return at;
-        }
-    }
-    return nullptr;
+    return m_actionTypesByName.value(name);
 }
 
 void ActionTypes::clearModel()
 {
     beginResetModel();
     m_actionTypes.clear();
+    m_actionTypesById.clear();
+    m_actionTypesByName.clear();
     endResetModel();
     emit countChanged();
 }
@@ -71,6 +71,8 @@ protected:
 
 private:
     QList<ActionType *> m_actionTypes;
+    QHash<QUuid, ActionType*> m_actionTypesById;
+    QHash<QString, ActionType*> m_actionTypesByName;
 };
 
 #endif // ACTIONTYPES_H
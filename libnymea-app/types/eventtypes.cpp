@@ -49,12 +49,7 @@ EventType *EventTypes::get(int index) const
 
 EventType *EventTypes::getEventType(const QUuid &eventTypeId) const
 {
-    foreach (EventType *eventType, m_eventTypes) {
-        if (eventType->id() == eventTypeId) {
-            return eventType;
-        }
-    }
-    return nullptr;
+    return m_eventTypesById.value(eventTypeId);
 }
 
 int EventTypes::rowCount(const QModelIndex &parent) const
@@ -83,6 +78,12 @@ void EventTypes::addEventType(EventType *eventType)
     beginInsertRows(QModelIndex(), m_eventTypes.count(), m_eventTypes.count());
     //qDebug() << "EventTypes: loaded eventType" << eventType->name();
     m_eventTypes.append(eventType);
+    if (!m_eventTypesById.contains(eventType->id())) {
+        m_eventTypesById.insert(eventType->id(), eventType);
+    }
+    if (!m_eventTypesByName.contains(eventType->name())) {
+        m_eventTypesByName.insert(eventType->name(), eventType);
+    }
     endInsertRows();
     emit countChanged();
 }
@@ -91,18 +92,15 @@ void EventTypes::clearModel()
 {
     beginResetModel();
     m_eventTypes.clear();
+    m_eventTypesById.clear();
+    m_eventTypesByName.clear();
     endResetModel();
     emit countChanged();
 }
 
 EventType *EventTypes::findByName(const QString &name) const
 {
-    foreach (EventType *eventType, m_eventTypes) {
-        if (eventType->name() == name) {
-            return eventType;
-        }
-    }
-    return nullptr;
+    return m_eventTypesByName.value(name);
 }
 
 QHash<int, QByteArray> EventTypes::roleNames() const
@@ -72,6 +72,8 @@ protected:
 
 private:
     QList<EventType *> m_eventTypes;
+    QHash<QUuid, EventType*> m_eventTypesById;
+    QHash<QString, EventType*> m_eventTypesByName;
 
 };
 
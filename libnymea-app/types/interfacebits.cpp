@@ -0,0 +1,213 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU General Public License as published by the Free Software
+* Foundation, GNU version 3. This project is distributed in the hope that it
+* will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+* Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "interfacebits.h"
+
+#include <QHash>
+
+namespace {
+
+struct InterfaceRegistry {
+    QHash<QString, int> ids;
+    QStringList names;
+    // Indexed by interface id, contains the interface itself and all the ones it extends
+    QVector<InterfaceBits> closures;
+    bool definitionsLoaded = false;
+};
+
+// The interfaces from Interfaces which extend others, parents first. Interfaces without a parent don't need an
+// entry. Interfaces::addInterface() asserts that this matches its definitions.
+struct InterfaceDefinition {
+    const char *name;
+    const char *extends[3];
+};
+
+const InterfaceDefinition s_definitions[] = {
+    {"gateway", {"connectable"}},
+    {"account", {"gateway"}},
+    {"closable", {"simpleclosable"}},
+    {"awning", {"closable"}},
+    {"blind", {"closable"}},
+    {"closablesensor", {"sensor"}},
+    {"cosensor", {"sensor"}},
+    {"co2sensor", {"sensor"}},
+    {"gassensor", {"sensor"}},
+    {"dimmablelight", {"light"}},
+    {"colortemperaturelight", {"light", "dimmablelight"}},
+    {"colorlight", {"light", "dimmablelight", "colortemperaturelight"}},
+    {"conductivitysensor", {"sensor"}},
+    {"daylightsensor", {"sensor"}},
+    {"extendedclosable", {"closable"}},
+    {"extendedawning", {"awning", "extendedclosable"}},
+    {"extendedblind", {"blind", "extendedclosable"}},
+    {"mediacontroller", {"media"}},
+    {"shutter", {"simpleclosable"}},
+    {"extendedshutter", {"shutter", "extendedclosable"}},
+    {"smartmeterconsumer", {"smartmeter"}},
+    {"smartmeterproducer", {"smartmeter"}},
+    {"energymeter", {"smartmeter"}},
+    {"useraccesscontrol", {"accesscontrol"}},
+    {"fingerprintreader", {"useraccesscontrol"}},
+    {"impulsegaragedoor", {"garagedoor"}},
+    {"simplegaragedoor", {"garagedoor", "closable"}},
+    {"statefulgaragedoor", {"garagedoor", "closable"}},
+    {"extendedstatfulgaragedoor", {"statefulgaragedoor", "extendedclosable"}},
+    {"garagegate", {"garagedoor", "closable"}},
+    {"humiditysensor", {"sensor"}},
+    {"irrigation", {"power"}},
+    {"lightsensor", {"sensor"}},
+    {"longpressbutton", {"button"}},
+    {"mediametadataprovider", {"media"}},
+    {"mediaplayer", {"media"}},
+    {"moisturesensor", {"sensor"}},
+    {"multibutton", {"button"}},
+    {"noisesensor", {"sensor"}},
+    {"powerswitch", {"button", "power"}},
+    {"presencesensor", {"sensor"}},
+    {"vibrationsensor", {"sensor"}},
+    {"pressuresensor", {"sensor"}},
+    {"temperaturesensor", {"sensor"}},
+    {"ventilation", {"power"}},
+    {"windspeedsensor", {"sensor"}},
+    {"wirelessconnectable", {"connectable"}},
+    {"watersensor", {"sensor"}},
+    {"firesensor", {"sensor"}},
+};
+
+}
+
+Q_GLOBAL_STATIC(InterfaceRegistry, s_registry)
+
+int InterfaceBits::idOf(const QString &interfaceName)
+{
+    QHash<QString, int>::const_iterator it = s_registry->ids.constFind(interfaceName);
+    if (it != s_registry->ids.constEnd()) {
+        return it.value();
+    }
+    int id = s_registry->names.count();
+    s_registry->ids.insert(interfaceName, id);
+    s_registry->names.append(interfaceName);
+    InterfaceBits self;
+    self.setBit(id);
+    s_registry->closures.append(self);
+    return id;
+}
+
+QString InterfaceBits::nameOf(int id)
+{
+    return s_registry->names.value(id);
+}
+
+static void loadDefinitions()
+{
+    for (const InterfaceDefinition &definition : s_definitions) {
+        int id = InterfaceBits::idOf(QString::fromLatin1(definition.name));
+        InterfaceBits closure;
+        closure.setBit(id);
+        for (const char *extend : definition.extends) {
+            if (extend) {
+                closure |= s_registry->closures.at(InterfaceBits::idOf(QString::fromLatin1(extend)));
+            }
+        }
+        s_registry->closures[id] = closure;
+    }
+    s_registry->definitionsLoaded = true;
+}
+
+InterfaceBits InterfaceBits::fromNames(const QStringList &interfaceNames)
+{
+    InterfaceBits ret;
+    foreach (const QString &interfaceName, interfaceNames) {
+        ret.setBit(idOf(interfaceName));
+    }
+    return ret;
+}
+
+InterfaceBits InterfaceBits::withInherited(const QStringList &interfaceNames)
+{
+    if (!s_registry->definitionsLoaded) {
+        loadDefinitions();
+    }
+    InterfaceBits ret;
+    foreach (const QString &interfaceName, interfaceNames) {
+        ret |= s_registry->closures.at(idOf(interfaceName));
+    }
+    return ret;
+}
+
+bool InterfaceBits::isEmpty() const
+{
+    foreach (quint64 word, m_words) {
+        if (word != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool InterfaceBits::testBit(int id) const
+{
+    int word = id / 64;
+    if (id < 0 || word >= m_words.count()) {
+        return false;
+    }
+    return m_words.at(word) & (Q_UINT64_C(1) << (id % 64));
+}
+
+void InterfaceBits::setBit(int id)
+{
+    int word = id / 64;
+    if (word >= m_words.count()) {
+        m_words.resize(word + 1);
+    }
+    m_words[word] |= Q_UINT64_C(1) << (id % 64);
+}
+
+bool InterfaceBits::intersects(const InterfaceBits &other) const
+{
+    int count = qMin(m_words.count(), other.m_words.count());
+    for (int i = 0; i < count; i++) {
+        if (m_words.at(i) & other.m_words.at(i)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+InterfaceBits &InterfaceBits::operator|=(const InterfaceBits &other)
+{
+    if (other.m_words.count() > m_words.count()) {
+        m_words.resize(other.m_words.count());
+    }
+    for (int i = 0; i < other.m_words.count(); i++) {
+        m_words[i] |= other.m_words.at(i);
+    }
+    return *this;
+}
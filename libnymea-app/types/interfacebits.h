@@ -0,0 +1,65 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU General Public License as published by the Free Software
+* Foundation, GNU version 3. This project is distributed in the hope that it
+* will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+* Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef INTERFACEBITS_H
+#define INTERFACEBITS_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// A set of interfaces. Interface names are interned to small integer ids on first use so testing
+// for interfaces is a bit test and matching two sets a word-wise AND instead of string comparisons.
+// The registry is not thread safe and must only be used from the main thread.
+class InterfaceBits
+{
+public:
+    InterfaceBits() = default;
+
+    static int idOf(const QString &interfaceName);
+    static QString nameOf(int id);
+
+    // Only the given interfaces
+    static InterfaceBits fromNames(const QStringList &interfaceNames);
+    // The given interfaces and all the ones they extend
+    static InterfaceBits withInherited(const QStringList &interfaceNames);
+
+    bool isEmpty() const;
+    bool testBit(int id) const;
+    void setBit(int id);
+    bool intersects(const InterfaceBits &other) const;
+
+    InterfaceBits &operator|=(const InterfaceBits &other);
+
+private:
+    QVector<quint64> m_words;
+};
+
+#endif // INTERFACEBITS_H
@@ -30,6 +30,7 @@
 
 #include "interfaces.h"
 #include "interface.h"
+#include "interfacebits.h"
 
 #include "eventtypes.h"
 #include "eventtype.h"
@@ -385,6 +386,12 @@ void Interfaces::addInterface(const QString &name, const QString &displayName, c
     }
     m_list.append(newIface);
     m_hash.insert(name, newIface);
+#ifndef QT_NO_DEBUG
+    InterfaceBits inherited = InterfaceBits::withInherited({name});
+    foreach (const QString &extend, extends) {
+        Q_ASSERT_X(inherited.testBit(InterfaceBits::idOf(extend)), "Interfaces", "Interface hierarchy in InterfaceBits is out of date");
+    }
+#endif
 }
 
 void Interfaces::addEventType(const QString &interfaceName, const QString &name, const QString &displayName, ParamTypes *paramTypes)
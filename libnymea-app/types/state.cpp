@@ -29,61 +29,52 @@
 * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
 
 #include "state.h"
+#include "states.h"
 
 #include <QDebug>
 
-State::State(const QUuid &thingId, const QUuid &stateTypeId, const QVariant &value, QObject *parent) :
-    QObject(parent),
-    m_thingId(thingId),
-    m_stateTypeId(stateTypeId),
-    m_value(value)
+State::State(States *states, int index) :
+    QObject(states),
+    m_states(states),
+    m_index(index)
 {
 }
 
 QUuid State::thingId() const
 {
-    return m_thingId;
+    return m_states->thingId();
 }
 
 QUuid State::stateTypeId() const
 {
-    return m_stateTypeId;
+    return m_states->stateTypeIdAt(m_index);
 }
 
 QVariant State::value() const
 {
-    return m_value;
+    return m_states->valueAt(m_index);
 }
 
 void State::setValue(const QVariant &value)
 {
-    if (m_value != value) {
-        m_value = value;
-        emit valueChanged();
-    }
+    m_states->setValueAt(m_index, value);
 }
 
 QVariant State::minValue() const
 {
-    return m_minValue;
+    return m_states->minValueAt(m_index);
 }
 
 void State::setMinValue(const QVariant &minValue) {
-    if (m_minValue != minValue) {
-        m_minValue = minValue;
-        emit minValueChanged();
-    }
+    m_states->setMinValueAt(m_index, minValue);
 }
 
 QVariant State::maxValue() const
 {
-    return m_maxValue;
+    return m_states->maxValueAt(m_index);
 }
 
 void State::setMaxValue(const QVariant &maxValue)
 {
-    if (m_maxValue != maxValue) {
-        m_maxValue = maxValue;
-        emit maxValueChanged();
-    }
+    m_states->setMaxValueAt(m_index, maxValue);
 }
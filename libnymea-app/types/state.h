@@ -35,6 +35,9 @@
 #include <QObject>
 #include <QVariant>
 
+class States;
+
+// The values are held in States. State objects are only created when they are requested, e.g. by QML.
 class State : public QObject
 {
     Q_OBJECT
@@ -45,7 +48,7 @@ class State : public QObject
     Q_PROPERTY(QVariant maxValue READ maxValue NOTIFY maxValueChanged)
 
 public:
-    explicit State(const QUuid &thingId, const QUuid &stateTypeId, const QVariant &value, QObject *parent = nullptr);
+    explicit State(States *states, int index);
 
     QUuid thingId() const;
     QUuid stateTypeId() const;
@@ -60,11 +63,8 @@ public:
     void setMaxValue(const QVariant &maxValue);
 
 private:
-    QUuid m_thingId;
-    QUuid m_stateTypeId;
-    QVariant m_value;
-    QVariant m_minValue;
-    QVariant m_maxValue;
+    States *m_states = nullptr;
+    int m_index = -1;
 
 signals:
     void valueChanged();
@@ -32,64 +32,209 @@
 
 #include <QDebug>
 
-States::States(QObject *parent) :
-    QAbstractListModel(parent)
+States::States(const QUuid &thingId, StateTypes *stateTypes, QObject *parent) :
+    QAbstractListModel(parent),
+    m_thingId(thingId),
+    m_stateTypes(stateTypes),
+    m_slotIndexes(stateTypes->rowCount(), -1)
 {
+    m_slots.reserve(stateTypes->rowCount());
 }
 
-QList<State *> States::states()
+QUuid States::thingId() const
 {
-    return m_states;
+    return m_thingId;
 }
 
 State *States::get(int index) const
 {
-    return m_states.at(index);
+    if (index < 0 || index >= m_slots.count()) {
+        return nullptr;
+    }
+    // Creating the wrapper doesn't change the model
+    States *self = const_cast<States*>(this);
+    Slot &slot = self->m_slots[index];
+    if (!slot.wrapper) {
+        slot.wrapper = new State(self, index);
+    }
+    return slot.wrapper;
 }
 
 State *States::getState(const QUuid &stateTypeId) const
 {
-    foreach (State *state, m_states) {
-        if (state->stateTypeId() == stateTypeId) {
-            return state;
-        }
-    }
-    return nullptr;
+    return get(indexOf(stateTypeId));
 }
 
 int States::rowCount(const QModelIndex &parent) const
 {
     Q_UNUSED(parent)
-    return m_states.count();
+    return m_slots.count();
 }
 
 QVariant States::data(const QModelIndex &index, int role) const
 {
-    if (index.row() < 0 || index.row() >= m_states.count())
+    if (index.row() < 0 || index.row() >= m_slots.count())
         return QVariant();
 
-    State *state = m_states.at(index.row());
     if (role == ValueRole) {
-        return state->value();
+        return valueAt(index.row());
     } else if (role == StateTypeIdRole) {
-        return state->stateTypeId().toString();
+        return stateTypeIdAt(index.row()).toString();
     }
     return QVariant();
 }
 
-void States::addState(State *state)
+bool States::addState(const QUuid &stateTypeId, const QVariant &value)
 {
-    state->setParent(this);
-    beginInsertRows(QModelIndex(), m_states.count(), m_states.count());
-    //qDebug() << "States: loaded state" << state->stateTypeId();
-    m_states.append(state);
-    connect(state, &State::valueChanged, this, [state, this]() {
-        int idx = m_states.indexOf(state);
-        if (idx < 0) return;
-        emit dataChanged(index(idx), index(idx), {ValueRole});
-    });
+    int stateTypeIndex = m_stateTypes->indexOf(stateTypeId);
+    if (stateTypeIndex < 0) {
+        return false;
+    }
+    if (stateTypeIndex >= m_slotIndexes.count()) {
+        // State types have been added after this model was created
+        int oldCount = m_slotIndexes.count();
+        m_slotIndexes.resize(m_stateTypes->rowCount());
+        for (int i = oldCount; i < m_slotIndexes.count(); i++) {
+            m_slotIndexes[i] = -1;
+        }
+    }
+    if (m_slotIndexes.at(stateTypeIndex) >= 0) {
+        setValueAt(m_slotIndexes.at(stateTypeIndex), value);
+        return true;
+    }
+
+    // States are never removed, so the row of a state is fixed once added
+    int idx = m_slots.count();
+    beginInsertRows(QModelIndex(), idx, idx);
+    Slot slot;
+    slot.stateTypeIndex = static_cast<qint16>(stateTypeIndex);
+    storeValue(slot, value);
+    m_slots.append(slot);
+    m_slotIndexes[stateTypeIndex] = idx;
     endInsertRows();
     emit countChanged();
+    return true;
+}
+
+int States::indexOf(const QUuid &stateTypeId) const
+{
+    return m_slotIndexes.value(m_stateTypes->indexOf(stateTypeId), -1);
+}
+
+bool States::hasState(const QUuid &stateTypeId) const
+{
+    return indexOf(stateTypeId) >= 0;
+}
+
+QVariant States::value(const QUuid &stateTypeId) const
+{
+    return valueAt(indexOf(stateTypeId));
+}
+
+void States::setValue(const QUuid &stateTypeId, const QVariant &value)
+{
+    setValueAt(indexOf(stateTypeId), value);
+}
+
+QUuid States::stateTypeIdAt(int index) const
+{
+    if (index < 0 || index >= m_slots.count()) {
+        return QUuid();
+    }
+    return m_stateTypes->get(m_slots.at(index).stateTypeIndex)->id();
+}
+
+QVariant States::valueAt(int index) const
+{
+    if (index < 0 || index >= m_slots.count()) {
+        return QVariant();
+    }
+    const Slot &slot = m_slots.at(index);
+    switch (slot.kind) {
+    case ValueKindInvalid:
+        return QVariant();
+    case ValueKindBool:
+        return slot.scalar.boolValue;
+    case ValueKindInt:
+        return slot.scalar.intValue;
+    case ValueKindUInt:
+        return slot.scalar.uintValue;
+    case ValueKindDouble:
+        return slot.scalar.doubleValue;
+    case ValueKindVariant:
+        return m_variantValues.at(slot.variantIndex);
+    }
+    return QVariant();
+}
+
+void States::setValueAt(int index, const QVariant &value)
+{
+    if (index < 0 || index >= m_slots.count()) {
+        return;
+    }
+    Slot &slot = m_slots[index];
+    if (storeValue(slot, value)) {
+        emit dataChanged(this->index(index), this->index(index), {ValueRole});
+        if (slot.wrapper) {
+            emit slot.wrapper->valueChanged();
+        }
+    }
+}
+
+QVariant States::minValueAt(int index) const
+{
+    if (index < 0 || index >= m_slots.count()) {
+        return QVariant();
+    }
+    QHash<int, QVariant>::const_iterator it = m_minValues.constFind(index);
+    if (it != m_minValues.constEnd()) {
+        return it.value();
+    }
+    return m_stateTypes->get(m_slots.at(index).stateTypeIndex)->minValue();
+}
+
+void States::setMinValueAt(int index, const QVariant &minValue)
+{
+    if (index < 0 || index >= m_slots.count()) {
+        return;
+    }
+    QVariant oldValue = minValueAt(index);
+    if (!minValue.isValid() || minValue == m_stateTypes->get(m_slots.at(index).stateTypeIndex)->minValue()) {
+        m_minValues.remove(index);
+    } else {
+        m_minValues.insert(index, minValue);
+    }
+    if (m_slots.at(index).wrapper && minValueAt(index) != oldValue) {
+        emit m_slots.at(index).wrapper->minValueChanged();
+    }
+}
+
+QVariant States::maxValueAt(int index) const
+{
+    if (index < 0 || index >= m_slots.count()) {
+        return QVariant();
+    }
+    QHash<int, QVariant>::const_iterator it = m_maxValues.constFind(index);
+    if (it != m_maxValues.constEnd()) {
+        return it.value();
+    }
+    return m_stateTypes->get(m_slots.at(index).stateTypeIndex)->maxValue();
+}
+
+void States::setMaxValueAt(int index, const QVariant &maxValue)
+{
+    if (index < 0 || index >= m_slots.count()) {
+        return;
+    }
+    QVariant oldValue = maxValueAt(index);
+    if (!maxValue.isValid() || maxValue == m_stateTypes->get(m_slots.at(index).stateTypeIndex)->maxValue()) {
+        m_maxValues.remove(index);
+    } else {
+        m_maxValues.insert(index, maxValue);
+    }
+    if (m_slots.at(index).wrapper && maxValueAt(index) != oldValue) {
+        emit m_slots.at(index).wrapper->maxValueChanged();
+    }
 }
 
 QHash<int, QByteArray> States::roleNames() const
@@ -100,3 +245,87 @@ QHash<int, QByteArray> States::roleNames() const
     return roles;
 }
 
+bool States::storeValue(Slot &slot, const QVariant &value)
+{
+    ValueKind kind = ValueKindVariant;
+    Scalar scalar;
+    scalar.doubleValue = 0;
+    bool ok = false;
+    if (!value.isValid()) {
+        kind = ValueKindInvalid;
+    } else {
+        switch (m_stateTypes->get(slot.stateTypeIndex)->valueType()) {
+        case QVariant::Bool:
+            if (value.canConvert(QVariant::Bool)) {
+                scalar.boolValue = value.toBool();
+                kind = ValueKindBool;
+            }
+            break;
+        case QVariant::Int:
+            scalar.intValue = value.toInt(&ok);
+            if (ok) {
+                kind = ValueKindInt;
+            }
+            break;
+        case QVariant::UInt:
+            scalar.uintValue = value.toUInt(&ok);
+            if (ok) {
+                kind = ValueKindUInt;
+            }
+            break;
+        case QVariant::Double:
+            scalar.doubleValue = value.toDouble(&ok);
+            if (ok) {
+                kind = ValueKindDouble;
+            }
+            break;
+        default:
+            // Anything else, and values which can't be converted to the state's type, are kept as they are
+            break;
+        }
+    }
+
+    if (kind == ValueKindVariant) {
+        if (slot.kind == ValueKindVariant && m_variantValues.at(slot.variantIndex) == value) {
+            return false;
+        }
+        if (slot.variantIndex < 0) {
+            slot.variantIndex = static_cast<qint16>(m_variantValues.count());
+            m_variantValues.append(value);
+        } else {
+            m_variantValues[slot.variantIndex] = value;
+        }
+        slot.kind = kind;
+        return true;
+    }
+
+    bool changed = slot.kind != kind;
+    if (!changed) {
+        switch (kind) {
+        case ValueKindBool:
+            changed = slot.scalar.boolValue != scalar.boolValue;
+            break;
+        case ValueKindInt:
+            changed = slot.scalar.intValue != scalar.intValue;
+            break;
+        case ValueKindUInt:
+            changed = slot.scalar.uintValue != scalar.uintValue;
+            break;
+        case ValueKindDouble:
+            changed = slot.scalar.doubleValue != scalar.doubleValue;
+            break;
+        default:
+            break;
+        }
+    }
+    if (!changed) {
+        return false;
+    }
+    if (slot.kind == ValueKindVariant) {
+        // Release whatever the variant held, the slot keeps its index for later
+        m_variantValues[slot.variantIndex] = QVariant();
+    }
+    slot.kind = kind;
+    slot.scalar = scalar;
+    return true;
+}
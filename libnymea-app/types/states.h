@@ -33,9 +33,15 @@
 
 #include <QObject>
 #include <QAbstractListModel>
+#include <QVector>
 
 #include "state.h"
+#include "statetypes.h"
 
+// Holds the state values of a thing in a flat array. Bool, int, uint and double states, which is the vast majority,
+// are stored in place, converted to the type given by the state type. Everything else is kept as QVariant on the side.
+// Min and max values are taken from the state type unless the server overrides them.
+// State objects are only created when get() or getState() is called and stay alive for the lifetime of the model.
 class States : public QAbstractListModel
 {
     Q_OBJECT
@@ -47,9 +53,9 @@ public:
         StateTypeIdRole
     };
 
-    explicit States(QObject *parent = nullptr);
+    explicit States(const QUuid &thingId, StateTypes *stateTypes, QObject *parent = nullptr);
 
-    QList<State *> states();
+    QUuid thingId() const;
 
     Q_INVOKABLE State *get(int index) const;
     Q_INVOKABLE State *getState(const QUuid &stateTypeId) const;
@@ -57,7 +63,24 @@ public:
     int rowCount(const QModelIndex & parent = QModelIndex()) const;
     QVariant data(const QModelIndex & index, int role = Qt::DisplayRole) const;
 
-    void addState(State *state);
+    // Returns false if the state type is not known for this thing
+    bool addState(const QUuid &stateTypeId, const QVariant &value);
+
+    int indexOf(const QUuid &stateTypeId) const;
+    bool hasState(const QUuid &stateTypeId) const;
+
+    QVariant value(const QUuid &stateTypeId) const;
+    void setValue(const QUuid &stateTypeId, const QVariant &value);
+
+    QUuid stateTypeIdAt(int index) const;
+    QVariant valueAt(int index) const;
+    void setValueAt(int index, const QVariant &value);
+    QVariant minValueAt(int index) const;
+    // An invalid value resets to the min value of the state type
+    void setMinValueAt(int index, const QVariant &minValue);
+    QVariant maxValueAt(int index) const;
+    // An invalid value resets to the max value of the state type
+    void setMaxValueAt(int index, const QVariant &maxValue);
 
 signals:
     void countChanged();
@@ -66,7 +89,41 @@ protected:
     QHash<int, QByteArray> roleNames() const;
 
 private:
-    QList<State *> m_states;
+    enum ValueKind : quint8 {
+        ValueKindInvalid,
+        ValueKindBool,
+        ValueKindInt,
+        ValueKindUInt,
+        ValueKindDouble,
+        ValueKindVariant
+    };
+
+    union Scalar {
+        bool boolValue;
+        int intValue;
+        uint uintValue;
+        double doubleValue;
+    };
+
+    struct Slot {
+        ValueKind kind = ValueKindInvalid;
+        qint16 stateTypeIndex = -1;
+        // Index in m_variantValues, assigned the first time the slot holds a non scalar value
+        qint16 variantIndex = -1;
+        Scalar scalar;
+        State *wrapper = nullptr;
+    };
+
+    bool storeValue(Slot &slot, const QVariant &value);
+
+    QUuid m_thingId;
+    StateTypes *m_stateTypes = nullptr;
+    QVector<Slot> m_slots;
+    // Maps the index of the state type in the thing class to the index in m_slots
+    QVector<int> m_slotIndexes;
+    QVector<QVariant> m_variantValues;
+    QHash<int, QVariant> m_minValues;
+    QHash<int, QVariant> m_maxValues;
 };
 
 #endif // STATES_H
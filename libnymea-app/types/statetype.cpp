@@ -73,11 +73,28 @@ QString StateType::type() const
 void StateType::setType(const QString &type)
 {
     m_type = type;
+    QString lowerType = type.toLower();
+    if (lowerType == "bool") {
+        m_valueType = QVariant::Bool;
+    } else if (lowerType == "int") {
+        m_valueType = QVariant::Int;
+    } else if (lowerType == "uint") {
+        m_valueType = QVariant::UInt;
+    } else if (lowerType == "double") {
+        m_valueType = QVariant::Double;
+    } else {
+        m_valueType = QVariant::Invalid;
+    }
 }
 
 void StateType::setType(QVariant::Type type)
 {
-    m_type = QVariant::typeToName(type);
+    setType(QString(QVariant::typeToName(type)));
+}
+
+QVariant::Type StateType::valueType() const
+{
+    return m_valueType;
 }
 
 int StateType::index() const
@@ -68,6 +68,9 @@ public:
     void setType(const QString &type);
     void setType(QVariant::Type type);
 
+    // The type values of this state are stored as. Invalid for types which are kept the way the server sends them.
+    QVariant::Type valueType() const;
+
     int index() const;
     void setIndex(const int &index);
 
@@ -94,6 +97,7 @@ private:
     QString m_name;
     QString m_displayName;
     QString m_type;
+    QVariant::Type m_valueType = QVariant::Invalid;
     int m_index;
     QVariant m_defaultValue;
     QVariantList m_allowedValues;
@@ -52,12 +52,12 @@ StateType *StateTypes::get(int index) const
 
 StateType *StateTypes::getStateType(const QUuid &stateTypeId) const
 {
-    foreach (StateType *stateType, m_stateTypes) {
-        if (stateType->id() == stateTypeId) {
-            return stateType;
-        }
-    }
-    return nullptr;
+    return get(indexOf(stateTypeId));
+}
+
+int StateTypes::indexOf(const QUuid &stateTypeId) const
+{
+    return m_indexesById.value(stateTypeId, -1);
 }
 
 int StateTypes::rowCount(const QModelIndex &parent) const
@@ -95,19 +95,20 @@ void StateTypes::addStateType(StateType *stateType)
 {
     stateType->setParent(this);
     beginInsertRows(QModelIndex(), m_stateTypes.count(), m_stateTypes.count());
+    if (!m_indexesById.contains(stateType->id())) {
+        m_indexesById.insert(stateType->id(), m_stateTypes.count());
+    }
     m_stateTypes.append(stateType);
+    if (!m_stateTypesByName.contains(stateType->name())) {
+        m_stateTypesByName.insert(stateType->name(), stateType);
+    }
     endInsertRows();
     emit countChanged();
 }
 
 StateType *StateTypes::findByName(const QString &name) const
 {
-    foreach (StateType *stateType, m_stateTypes) {
-        if (stateType->name() == name) {
-            return stateType;
-        }
-    }
-    return nullptr;
+    return m_stateTypesByName.value(name);
 }
 
 QList<StateType *> StateTypes::ioStateTypes(Types::IOType ioType) const
@@ -126,6 +127,8 @@ void StateTypes::clearModel()
     beginResetModel();
     qDeleteAll(m_stateTypes);
     m_stateTypes.clear();
+    m_indexesById.clear();
+    m_stateTypesByName.clear();
     endResetModel();
     emit countChanged();
 }
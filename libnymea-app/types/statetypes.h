@@ -59,6 +59,7 @@ public:
 
     Q_INVOKABLE StateType *get(int index) const;
     Q_INVOKABLE StateType *getStateType(const QUuid &stateTypeId) const;
+    int indexOf(const QUuid &stateTypeId) const;
 
     int rowCount(const QModelIndex & parent = QModelIndex()) const;
     QVariant data(const QModelIndex & index, int role = Qt::DisplayRole) const;
@@ -79,6 +80,8 @@ signals:
 
 private:
     QList<StateType *> m_stateTypes;
+    QHash<QUuid, int> m_indexesById;
+    QHash<QString, StateType*> m_stateTypesByName;
 
 };
 
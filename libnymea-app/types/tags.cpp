@@ -32,6 +32,7 @@
 #include "tag.h"
 
 #include <QDebug>
+#include <QSet>
 
 #include <QLoggingCategory>
 Q_DECLARE_LOGGING_CATEGORY(dcTags)
@@ -79,9 +80,13 @@ void Tags::addTag(Tag *tag)
     connect(tag, &Tag::valueChanged, this, &Tags::tagValueChanged);
     beginInsertRows(QModelIndex(), m_list.count(), m_list.count());
     m_list.append(tag);
+    indexTag(tag);
     endInsertRows();
     qDebug() << "tags count changed";
     emit countChanged();
+    if (!tag->thingId().isNull()) {
+        emit thingTagsChanged(tag->thingId());
+    }
 }
 
 void Tags::addTags(QList<Tag *> tags)
@@ -95,8 +100,18 @@ void Tags::addTags(QList<Tag *> tags)
         connect(tag, &Tag::valueChanged, this, &Tags::tagValueChanged);
     }
     m_list.append(tags);
+    QSet<QUuid> thingIds;
+    foreach (Tag *tag, tags) {
+        indexTag(tag);
+        if (!tag->thingId().isNull()) {
+            thingIds.insert(tag->thingId());
+        }
+    }
     endInsertRows();
     emit countChanged();
+    foreach (const QUuid &thingId, thingIds) {
+        emit thingTagsChanged(thingId);
+    }
 }
 
 void Tags::removeTag(Tag *tag)
@@ -108,9 +123,13 @@ void Tags::removeTag(Tag *tag)
     }
     beginRemoveRows(QModelIndex(), idx, idx);
     m_list.removeAt(idx);
+    unindexTag(tag);
     endRemoveRows();
     tag->deleteLater();
     emit countChanged();
+    if (!tag->thingId().isNull()) {
+        emit thingTagsChanged(tag->thingId());
+    }
 }
 
 Tag *Tags::get(int index) const
@@ -123,12 +142,7 @@ Tag *Tags::get(int index) const
 
 Tag *Tags::findThingTag(const QUuid &thingId, const QString &tagId) const
 {
-    foreach (Tag *tag, m_list) {
-        if (tag->thingId() == thingId && tag->tagId() == tagId) {
-            return tag;
-        }
-    }
-    return nullptr;
+    return m_thingTags.value(qMakePair(thingId, tagId));
 }
 
 Tag *Tags::findRuleTag(const QString &ruleId, const QString &tagId) const
@@ -146,6 +160,7 @@ void Tags::clear()
     beginResetModel();
     qDeleteAll(m_list);
     m_list.clear();
+    m_thingTags.clear();
     endResetModel();
     emit countChanged();
 }
@@ -156,4 +171,34 @@ void Tags::tagValueChanged()
     Tag *tag = static_cast<Tag*>(sender());
     int idx = m_list.indexOf(tag);
     emit dataChanged(index(idx, 0), index(idx, 0), {RoleValue});
+    if (!tag->thingId().isNull()) {
+        emit thingTagsChanged(tag->thingId());
+    }
+}
+
+void Tags::indexTag(Tag *tag)
+{
+    if (tag->thingId().isNull()) {
+        return;
+    }
+    // Like a linear search would, keep the first one if the same tag is in the list multiple times
+    QPair<QUuid, QString> key = qMakePair(tag->thingId(), tag->tagId());
+    if (!m_thingTags.contains(key)) {
+        m_thingTags.insert(key, tag);
+    }
+}
+
+void Tags::unindexTag(Tag *tag)
+{
+    QPair<QUuid, QString> key = qMakePair(tag->thingId(), tag->tagId());
+    if (m_thingTags.value(key) != tag) {
+        return;
+    }
+    m_thingTags.remove(key);
+    foreach (Tag *other, m_list) {
+        if (other->thingId() == tag->thingId() && other->tagId() == tag->tagId()) {
+            m_thingTags.insert(key, other);
+            return;
+        }
+    }
 }
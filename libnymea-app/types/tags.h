@@ -32,6 +32,7 @@
 #define TAGS_H
 
 #include <QAbstractListModel>
+#include <QUuid>
 
 class Tag;
 
@@ -67,12 +68,19 @@ public:
 
 signals:
     void countChanged();
+    // Emitted when a tag of the given thing has been added, removed or changed its value
+    void thingTagsChanged(const QUuid &thingId);
 
 private slots:
     void tagValueChanged();
 
 private:
+    void indexTag(Tag *tag);
+    void unindexTag(Tag *tag);
+
     QList<Tag*> m_list;
+    // <thingId, tagId>
+    QHash<QPair<QUuid, QString>, Tag*> m_thingTags;
 };
 
 #endif // TAGS_H
@@ -41,12 +41,6 @@ Thing::Thing(ThingManager *thingManager, ThingClass *thingClass, const QUuid &pa
     m_parentId(parentId),
     m_thingClass(thingClass)
 {
-    connect(thingManager, &ThingManager::executeActionReply, this, [=](int commandId, Thing::ThingError thingError, const QString &displayMessage){
-        if (m_pendingActions.contains(commandId)) {
-            m_pendingActions.removeAll(commandId);
-            emit executeActionReply(commandId, thingError, displayMessage);
-        }
-    });
 }
 
 QString Thing::name() const
@@ -190,32 +184,17 @@ ThingClass *Thing::thingClass() const
 
 bool Thing::hasState(const QUuid &stateTypeId) const
 {
-    foreach (State *state, states()->states()) {
-        if (state->stateTypeId() == stateTypeId) {
-            return true;
-        }
-    }
-    return false;
+    return m_states->hasState(stateTypeId);
 }
 
 QVariant Thing::stateValue(const QUuid &stateTypeId) const
 {
-    foreach (State *state, states()->states()) {
-        if (state->stateTypeId() == stateTypeId) {
-            return state->value();
-        }
-    }
-    return QVariant();
+    return m_states->value(stateTypeId);
 }
 
 void Thing::setStateValue(const QUuid &stateTypeId, const QVariant &value)
 {
-    foreach (State *state, states()->states()) {
-        if (state->stateTypeId() == stateTypeId) {
-            state->setValue(value);
-            return;
-        }
-    }
+    m_states->setValue(stateTypeId, value);
 }
 
 QList<QUuid> Thing::loggedStateTypeIds() const
@@ -278,9 +257,12 @@ int Thing::executeAction(const QString &actionName, const QVariantList &params)
         finalParams.append(param);
     }
 //    qCritical() << "Executing action" << finalParams;
-    int commandId = m_thingManager->executeAction(m_id, actionType->id(), finalParams);
-    m_pendingActions.append(commandId);
-    return commandId;
+    return m_thingManager->executeAction(this, m_id, actionType->id(), finalParams);
+}
+
+void Thing::actionExecuted(int commandId, Thing::ThingError thingError, const QString &displayMessage)
+{
+    emit executeActionReply(commandId, thingError, displayMessage);
 }
 
 QDebug operator<<(QDebug &dbg, Thing *thing)
@@ -306,8 +288,7 @@ QDebug operator<<(QDebug &dbg, Thing *thing)
     }
     for (int i = 0; i < thing->thingClass()->stateTypes()->rowCount(); i++) {
         StateType *st = thing->thingClass()->stateTypes()->get(i);
-        State *s = thing->states()->getState(st->id());
-        dbg << "  State " << i << ": " << st->id() << ": " << st->name() << " = " << s->value() << endl;
+        dbg << "  State " << i << ": " << st->id() << ": " << st->name() << " = " << thing->stateValue(st->id()) << endl;
     }
     return dbg;
 }
@@ -146,6 +146,9 @@ public:
 
     Q_INVOKABLE virtual int executeAction(const QString &actionName, const QVariantList &params);
 
+    // Called by the ThingManager with the reply to an action this thing has executed
+    virtual void actionExecuted(int commandId, Thing::ThingError thingError, const QString &displayMessage);
+
 signals:
     void nameChanged();
     void setupStatusChanged();
@@ -174,8 +177,6 @@ protected:
     QList<QUuid> m_loggedStateTypeIds;
     QList<QUuid> m_loggedEventTypeIds;
     QList<QUuid> m_loggedActionTypeIds;
-
-    QList<int> m_pendingActions;
 };
 Q_DECLARE_METATYPE(Thing::ThingError)
 
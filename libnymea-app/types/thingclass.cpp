@@ -125,6 +125,7 @@ QStringList ThingClass::interfaces() const
 void ThingClass::setInterfaces(const QStringList &interfaces)
 {
     m_interfaces = interfaces;
+    m_interfaceBits = InterfaceBits::withInherited(interfaces);
 }
 
 QStringList ThingClass::providedInterfaces() const
@@ -135,6 +136,17 @@ QStringList ThingClass::providedInterfaces() const
 void ThingClass::setProvidedInterfaces(const QStringList &providedInterfaces)
 {
     m_providedInterfaces = providedInterfaces;
+    m_providedInterfaceBits = InterfaceBits::withInherited(providedInterfaces);
+}
+
+InterfaceBits ThingClass::interfaceBits() const
+{
+    return m_interfaceBits;
+}
+
+InterfaceBits ThingClass::providedInterfaceBits() const
+{
+    return m_providedInterfaceBits;
 }
 
 QString ThingClass::baseInterface() const
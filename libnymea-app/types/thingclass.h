@@ -40,6 +40,7 @@
 #include "statetypes.h"
 #include "eventtypes.h"
 #include "actiontypes.h"
+#include "interfacebits.h"
 
 class ThingClass : public QObject
 {
@@ -113,6 +114,10 @@ public:
     QStringList providedInterfaces() const;
     void setProvidedInterfaces(const QStringList &providedInterfaces);
 
+    // Interned interfaces, including the inherited ones
+    InterfaceBits interfaceBits() const;
+    InterfaceBits providedInterfaceBits() const;
+
     QString baseInterface() const;
 
     bool browsable() const;
@@ -161,6 +166,8 @@ private:
     SetupMethod m_setupMethod;
     QStringList m_interfaces;
     QStringList m_providedInterfaces;
+    InterfaceBits m_interfaceBits;
+    InterfaceBits m_providedInterfaceBits;
     bool m_browsable = false;
 
     ParamTypes *m_paramTypes = nullptr;
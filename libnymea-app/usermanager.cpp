@@ -182,6 +182,9 @@ void UserManager::getUsersResponse(int commandId, const QVariantMap &data)
 void UserManager::getUserInfoResponse(int commandId, const QVariantMap &data)
 {
     qCDebug(dcUserManager()) << "User info reply" << commandId << data;
+    if (JsonRpcClient::isLost(data)) {
+        return;
+    }
     QVariantMap userMap = data.value("userInfo").toMap();
     m_userInfo->setUsername(userMap.value("username").toString());
     m_userInfo->setEmail(userMap.value("email").toString());
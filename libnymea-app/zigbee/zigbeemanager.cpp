@@ -220,6 +220,9 @@ void ZigbeeManager::init()
 void ZigbeeManager::getAvailableBackendsResponse(int commandId, const QVariantMap &params)
 {
     qCDebug(dcZigbee()) << "Zigbee get available backends response" << commandId << params;
+    if (JsonRpcClient::isLost(params)) {
+        return;
+    }
     m_availableBackends.clear();
     foreach (const QVariant &backendVariant, params.value("backends").toList()) {
         m_availableBackends << backendVariant.toString();
@@ -230,6 +233,9 @@ void ZigbeeManager::getAvailableBackendsResponse(int commandId, const QVariantMa
 void ZigbeeManager::getAdaptersResponse(int commandId, const QVariantMap &params)
 {
     qCDebug(dcZigbee()) << "Zigbee get adapters response" << commandId << params;
+    if (JsonRpcClient::isLost(params)) {
+        return;
+    }
     m_adapters->clear();
     foreach (const QVariant &adapterVariant, params.value("adapters").toList()) {
         QVariantMap adapterMap = adapterVariant.toMap();
@@ -242,6 +248,11 @@ void ZigbeeManager::getAdaptersResponse(int commandId, const QVariantMap &params
 void ZigbeeManager::getNetworksResponse(int commandId, const QVariantMap &params)
 {
     qCDebug(dcZigbee()) << "Zigbee get networks response" << commandId << params;
+    if (JsonRpcClient::isLost(params)) {
+        m_fetchingData = false;
+        emit fetchingDataChanged();
+        return;
+    }
     m_networks->clear();
     foreach (const QVariant &networkVariant, params.value("zigbeeNetworks").toList()) {
         QVariantMap networkMap = networkVariant.toMap();
@@ -127,6 +127,9 @@ void ZWaveManager::init()
 void ZWaveManager::isZWaveAvailableResponse(int commandId, const QVariantMap &params)
 {
     Q_UNUSED(commandId)
+    if (JsonRpcClient::isLost(params)) {
+        return;
+    }
     m_zwaveAvailable = params.value("available").toBool();
     emit zwaveAvailableChanged();
 }
@@ -94,7 +94,20 @@ Dialog {
                         wrapTexts: false
                         progressive: false
                         text: model.url
-                        subText: model.name
+                        subText: {
+                            var ret = model.name
+                            if (connection.handshakeTime >= 0) {
+                                ret += " - " + qsTr("Connect: %1 ms").arg(connection.handshakeTime)
+                            }
+                            if (connection.roundTripTimeP50 >= 0) {
+                                ret += " - " + qsTr("RTT: %1/%2 ms").arg(connection.roundTripTimeP50).arg(connection.roundTripTimeP95)
+                            }
+                            if (connection.successCount + connection.failureCount > 0) {
+                                ret += " - " + qsTr("%1 of %2 attempts succeeded").arg(connection.successCount).arg(connection.successCount + connection.failureCount)
+                            }
+                            return ret
+                        }
+                        readonly property Connection connection: root.nymeaHost.connections.get(index)
                         prominentSubText: false
                         iconName: {
                             switch (model.bearerType) {
@@ -133,6 +146,45 @@ Dialog {
             }
         }
 
+        ThinDivider { Layout.columnSpan: 2 }
+        Label {
+            Layout.columnSpan: 2
+            text: qsTr("Requests")
+        }
+
+        Flickable {
+            Layout.columnSpan: 2
+            Layout.fillWidth: true
+            Layout.preferredHeight: 150
+            contentHeight: requestsColumn.implicitHeight
+            clip: true
+            ColumnLayout {
+                id: requestsColumn
+                width: parent.width
+                Repeater {
+                    model: root.nymeaEngine ? root.nymeaEngine.jsonRpcClient.diagnostics : null
+                    delegate: NymeaSwipeDelegate {
+                        Layout.fillWidth: true
+                        wrapTexts: false
+                        progressive: false
+                        prominentSubText: false
+                        text: model.method
+                        subText: {
+                            var ret = qsTr("%1 sent").arg(model.requests)
+                            if (model.timeouts > 0) {
+                                ret += ", " + qsTr("%1 timed out").arg(model.timeouts)
+                            }
+                            if (model.latencyP50 >= 0) {
+                                ret += " - " + qsTr("%1/%2/%3 ms").arg(model.latencyP50).arg(model.latencyP95).arg(model.latencyP99)
+                            }
+                            ret += " - " + qsTr("%1 kB in, %2 kB out").arg(Math.round(model.bytesIn / 1024)).arg(Math.round(model.bytesOut / 1024))
+                            return ret
+                        }
+                    }
+                }
+            }
+        }
+
         RowLayout {
             Layout.columnSpan: 2
             Button {
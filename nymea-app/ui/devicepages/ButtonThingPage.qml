@@ -69,7 +69,7 @@ ThingPageBase {
                 engine: _engine
                 sources: ["event-" + root.thing.id + "-pressed", "event-" + root.thing.id + "-longPressed"]
                 live: true
-                fetchBlockSize: 200 // As paging doesn't work with multiple sources
+                sortOrder: Qt.DescendingOrder
             }
 
             Component.onCompleted: print("**************** created", logsModel.sources)
@@ -56,6 +56,7 @@ Page {
     NewLogsModel {
         id: logsModel
         engine: _engine
+        sortOrder: Qt.DescendingOrder
 //        columns: [root.stateType.name]
         sources: {
             var ret = []
@@ -102,10 +103,6 @@ Page {
 //                   : []
 //        live: true
 
-        onEntriesAdded: {
-            console.log("entries added", JSON.stringify(entries))
-        }
-
         property bool filterEnabled: false
     }
 
@@ -27,6 +27,41 @@ Page {
         LineSeries { }
     }
 
+    // All line series share the same sample rate and time window, fetch them in one go
+    SampledLogs {
+        id: lineSeriesLogs
+        engine: _engine
+        sources: {
+            var ret = []
+            for (var i = 0; i < zoneWrapper.thermostats.count; i++) {
+                ret.push("state-" + zoneWrapper.thermostats.get(i).id + "-temperature")
+            }
+            for (var i = 0; i < zoneWrapper.indoorTempSensors.count; i++) {
+                ret.push("state-" + zoneWrapper.indoorTempSensors.get(i).id + "-temperature")
+            }
+            for (var i = 0; i < zoneWrapper.indoorHumiditySensors.count; i++) {
+                ret.push("state-" + zoneWrapper.indoorHumiditySensors.get(i).id + "-humidity")
+            }
+            for (var i = 0; i < zoneWrapper.indoorVocSensors.count; i++) {
+                ret.push("state-" + zoneWrapper.indoorVocSensors.get(i).id + "-voc")
+            }
+            return ret
+        }
+        startTime: new Date(d.startTime.getTime() - d.range * 60000)
+        endTime: new Date(d.endTime.getTime() + d.range * 60000)
+        sampleRate: d.sampleRate
+        onBusyChanged: {
+            if (busy) {
+                chartView.busyCounter++
+            } else {
+                chartView.busyCounter--
+            }
+        }
+        // Thermostats and sensors show up while the zone is being loaded
+        onSourcesChanged: fetchLogs()
+        Component.onCompleted: fetchLogs()
+    }
+
     QtObject {
         id: d
 
@@ -49,18 +84,7 @@ Page {
         }
 
         function refreshAll() {
-            for (var i = 0; i < thermostatsRepeater.count; i++) {
-                thermostatsRepeater.itemAt(i).logsModel.fetchLogs()
-            }
-            for (var i = 0; i < tempRepeater.count; i++) {
-                tempRepeater.itemAt(i).logsModel.fetchLogs()
-            }
-            for (var i = 0; i < humidityRepeater.count; i++) {
-                humidityRepeater.itemAt(i).logsModel.fetchLogs()
-            }
-            for (var i = 0; i < vocRepeater.count; i++) {
-                vocRepeater.itemAt(i).logsModel.fetchLogs()
-            }
+            lineSeriesLogs.fetchLogs()
 
             for (var i = 0; i < windowOpenRepeater.count; i++) {
                 windowOpenRepeater.itemAt(i).logsModel.fetchLogs()
@@ -308,35 +332,13 @@ Page {
                         readonly property Thing thing: zoneWrapper.thermostats.get(index)
                         property XYSeries series: null
 
-                        readonly property NewLogsModel logsModel: NewLogsModel {
-                            objectName: "temp: " + thing.name
-                            engine: _engine
-                            source: "state-" + thing.id + "-temperature"
-                            startTime: new Date(d.startTime.getTime() - d.range * 60000)
-                            endTime: new Date(d.endTime.getTime() + d.range * 60000)
-                            sampleRate: d.sampleRate
-                            onBusyChanged: {
-                                if (busy) {
-                                    chartView.busyCounter++
-                                } else {
-                                    chartView.busyCounter--
-                                }
-                            }
+                        readonly property string source: "state-" + thing.id + "-temperature"
 
-                            onEntriesAddedIdx: {
-                                for (var i = 0; i < count; i++) {
-                                    var entry = logsModel.get(i)
-                                    var value = entry.values["temperature"]
-                                    if (value == null) {
-                                        value = 0;
-                                    }
-                                    series.insert(index + i, entry.timestamp, value)
-                                }
-                            }
-                            onEntriesRemoved: {
-                                series.removePoints(index, count)
-                            }
-                            Component.onCompleted: fetchLogs()
+                        SampledSeriesAdapter {
+                            sampledLogs: lineSeriesLogs
+                            source: thermostatDelegate.source
+                            valueName: "temperature"
+                            xySeries: thermostatDelegate.series
                         }
 
                         Component.onCompleted: {
@@ -365,36 +367,13 @@ Page {
                         readonly property Thing thing: zoneWrapper.indoorTempSensors.get(index)
                         property XYSeries series: null
 
-                        readonly property NewLogsModel logsModel: NewLogsModel {
-                            objectName: "temp: " + thing.name
-                            engine: _engine
-                            source: "state-" + thing.id + "-temperature"
-                            startTime: new Date(d.startTime.getTime() - d.range * 60000)
-                            endTime: new Date(d.endTime.getTime() + d.range * 60000)
-                            sampleRate: d.sampleRate
-                            onBusyChanged: {
-                                if (busy) {
-                                    chartView.busyCounter++
-                                } else {
-                                    chartView.busyCounter--
-                                }
-                            }
-
-                            onEntriesAddedIdx: {
-                                for (var i = 0; i < count; i++) {
-                                    var entry = logsModel.get(i)
-                                    var value = entry.values["temperature"]
-                                    if (value == null) {
-                                        value = 0;
-                                    }
-                                    series.insert(index + i, entry.timestamp, value)
-                                }
-                            }
-                            onEntriesRemoved: {
-                                series.removePoints(index, count)
-                            }
-                            Component.onCompleted: fetchLogs()
+                        readonly property string source: "state-" + thing.id + "-temperature"
 
+                        SampledSeriesAdapter {
+                            sampledLogs: lineSeriesLogs
+                            source: tempDelegate.source
+                            valueName: "temperature"
+                            xySeries: tempDelegate.series
                         }
 
                         Component.onCompleted: {
@@ -423,35 +402,13 @@ Page {
                         readonly property Thing thing: zoneWrapper.indoorHumiditySensors.get(index)
                         property XYSeries series: null
 
-                        readonly property NewLogsModel logsModel: NewLogsModel {
-                            objectName: "hum: " + thing.name
-                            engine: _engine
-                            source: "state-" + thing.id + "-humidity"
-                            startTime: new Date(d.startTime.getTime() - d.range * 60000)
-                            endTime: new Date(d.endTime.getTime() + d.range * 60000)
-                            sampleRate: d.sampleRate
-                            onBusyChanged: {
-                                if (busy) {
-                                    chartView.busyCounter++
-                                } else {
-                                    chartView.busyCounter--
-                                }
-                            }
+                        readonly property string source: "state-" + thing.id + "-humidity"
 
-                            onEntriesAddedIdx: {
-                                for (var i = 0; i < count; i++) {
-                                    var entry = logsModel.get(i)
-                                    var value = entry.values["humidity"]
-                                    if (value == null) {
-                                        value = 0;
-                                    }
-                                    series.insert(index + i, entry.timestamp, value)
-                                }
-                            }
-                            onEntriesRemoved: {
-                                series.removePoints(index, count)
-                            }
-                            Component.onCompleted: fetchLogs()
+                        SampledSeriesAdapter {
+                            sampledLogs: lineSeriesLogs
+                            source: humidityDelegate.source
+                            valueName: "humidity"
+                            xySeries: humidityDelegate.series
                         }
 
                         Component.onCompleted: {
@@ -477,34 +434,13 @@ Page {
                         id: vocDelegate
                         readonly property Thing thing: zoneWrapper.indoorVocSensors.get(index)
                         property XYSeries series: null
-                        readonly property NewLogsModel logsModel: NewLogsModel {
-                            objectName: "voc: " + thing.name
-                            engine: _engine
-                            source: "state-" + thing.id + "-voc"
-                            startTime: new Date(d.startTime.getTime() - d.range * 60000)
-                            endTime: new Date(d.endTime.getTime() + d.range * 60000)
-                            sampleRate: d.sampleRate
-                            onBusyChanged: {
-                                if (busy) {
-                                    chartView.busyCounter++
-                                } else {
-                                    chartView.busyCounter--
-                                }
-                            }
-                            onEntriesAddedIdx: {
-                                for (var i = 0; i < count; i++) {
-                                    var entry = logsModel.get(i)
-                                    var value = entry.values["voc"]
-                                    if (value == null) {
-                                        value = 0;
-                                    }
-                                    series.insert(index + i, entry.timestamp, value)
-                                }
-                            }
-                            onEntriesRemoved: {
-                                series.removePoints(index, count)
-                            }
-                            Component.onCompleted: fetchLogs()
+                        readonly property string source: "state-" + thing.id + "-voc"
+
+                        SampledSeriesAdapter {
+                            sampledLogs: lineSeriesLogs
+                            source: vocDelegate.source
+                            valueName: "voc"
+                            xySeries: vocDelegate.series
                         }
 
                         Component.onCompleted: {
@@ -896,7 +832,7 @@ Page {
                     delegate: TooltipDelegate {
                         visible: (mouseArea.containsMouse || mouseArea.tooltipping) && !mouseArea.dragging
                         thing: thermostatsRepeater.itemAt(index).thing
-                        entry: thermostatsRepeater.itemAt(index).logsModel.find(tooltips.timestamp)
+                        value: lineSeriesLogs.value(lineSeriesLogs.find(tooltips.timestamp), thermostatsRepeater.itemAt(index).source, "temperature")
                         color: app.interfaceToColor("temperaturesensor")
                         iconSource: app.interfaceToIcon("temperaturesensor")
                         valueName: "temperature"
@@ -916,7 +852,7 @@ Page {
                     delegate: TooltipDelegate {
                         visible: (mouseArea.containsMouse || mouseArea.tooltipping) && !mouseArea.dragging
                         thing: tempRepeater.itemAt(index).thing
-                        entry: tempRepeater.itemAt(index).logsModel.find(tooltips.timestamp)
+                        value: lineSeriesLogs.value(lineSeriesLogs.find(tooltips.timestamp), tempRepeater.itemAt(index).source, "temperature")
                         valueName: "temperature"
                         color: app.interfaceToColor("temperaturesensor")
                         iconSource: app.interfaceToIcon("temperaturesensor")
@@ -936,7 +872,7 @@ Page {
                     delegate: TooltipDelegate {
                         visible: (mouseArea.containsMouse || mouseArea.tooltipping) && !mouseArea.dragging
                         thing: humidityRepeater.itemAt(index).thing
-                        entry: humidityRepeater.itemAt(index).logsModel.find(tooltips.timestamp)
+                        value: lineSeriesLogs.value(lineSeriesLogs.find(tooltips.timestamp), humidityRepeater.itemAt(index).source, "humidity")
                         color: app.interfaceToColor("humiditysensor")
                         iconSource: app.interfaceToIcon("humiditysensor")
                         valueName: "humidity"
@@ -956,7 +892,7 @@ Page {
                     delegate: TooltipDelegate {
                         visible: (mouseArea.containsMouse || mouseArea.tooltipping) && !mouseArea.dragging
                         thing: vocRepeater.itemAt(index).thing
-                        entry: vocRepeater.itemAt(index).logsModel.find(tooltips.timestamp)
+                        value: lineSeriesLogs.value(lineSeriesLogs.find(tooltips.timestamp), vocRepeater.itemAt(index).source, "voc")
                         valueName: "voc"
                         color: app.interfaceToColor("vocsensor")
                         iconSource: app.interfaceToIcon("vocsensor")
@@ -224,6 +224,9 @@ Page {
                     logsModel: thermostatDelegate.logsModel
                     xySeries: series
                     sampleRate: XYSeriesAdapter.SampleRate10Minutes
+                    windowStart: d.startTime
+                    windowEnd: d.endTime
+                    plotWidth: chartView.plotArea.width
                 }
 
                 Component.onCompleted: {
@@ -273,6 +276,9 @@ Page {
                     logsModel: tempDelegate.logsModel
                     xySeries: series
                     sampleRate: XYSeriesAdapter.SampleRate10Minutes
+                    windowStart: d.startTime
+                    windowEnd: d.endTime
+                    plotWidth: chartView.plotArea.width
                 }
 
                 Component.onCompleted: {
@@ -321,6 +327,9 @@ Page {
                     logsModel: humidityDelegate.logsModel
                     xySeries: series
                     sampleRate: XYSeriesAdapter.SampleRate10Minutes
+                    windowStart: d.startTime
+                    windowEnd: d.endTime
+                    plotWidth: chartView.plotArea.width
                 }
 
                 Component.onCompleted: {
@@ -367,6 +376,9 @@ Page {
                     logsModel: vocDelegate.logsModel
                     xySeries: series
                     sampleRate: XYSeriesAdapter.SampleRate10Minutes
+                    windowStart: d.startTime
+                    windowEnd: d.endTime
+                    plotWidth: chartView.plotArea.width
                 }
 
                 Component.onCompleted: {
@@ -419,6 +431,9 @@ Page {
                     logsModel: closableDelegate.logsModel
                     xySeries: closableUpperSeries
                     inverted: true
+                    windowStart: d.startTime
+                    windowEnd: d.endTime
+                    plotWidth: chartView.plotArea.width
                 }
 
                 Component.onCompleted: {
@@ -453,8 +468,8 @@ Page {
                 }
                 LineSeries {
                     id: heatingLowerSeries
-                    XYPoint {x: dateTimeAxis.max.getTime(); y: 0}
                     XYPoint {x: dateTimeAxis.min.getTime(); y: 0}
+                    XYPoint {x: dateTimeAxis.max.getTime(); y: 0}
 
                 }
 
@@ -480,6 +495,9 @@ Page {
                 BoolSeriesAdapter {
                     logsModel: heatingDelegate.logsModel
                     xySeries: heatingUpperSeries
+                    windowStart: d.startTime
+                    windowEnd: d.endTime
+                    plotWidth: chartView.plotArea.width
                 }
 
                 Component.onCompleted: {
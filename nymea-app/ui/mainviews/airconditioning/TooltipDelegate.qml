@@ -20,8 +20,10 @@ NymeaToolTip {
     property ValueAxis axis: null
     property int unit: Types.UnitNone
 
-    readonly property var value: entry.values[valueName]
-    readonly property int realY: entry ? Math.min(Math.max(mouseArea.height - (root.value * mouseArea.height / axis.max) - height / 2 /*- Style.margins*/, 0), mouseArea.height - height) : 0
+    // Either taken from the entry or set directly
+    property var value: entry ? entry.values[valueName] : undefined
+    readonly property bool hasValue: value !== undefined && value !== null
+    readonly property int realY: hasValue ? Math.min(Math.max(mouseArea.height - (root.value * mouseArea.height / axis.max) - height / 2 /*- Style.margins*/, 0), mouseArea.height - height) : 0
     property int fixedY: 0
     y: fixedY // Animated
 
@@ -44,7 +46,7 @@ NymeaToolTip {
             visible: !icon.visible
         }
         Label {
-            text: "%1: %2%3".arg(thing.name).arg(entry ? round(Types.toUiValue(root.value, unit)) : "-").arg(Types.toUiUnit(unit))
+            text: "%1: %2%3".arg(thing.name).arg(root.hasValue ? round(Types.toUiValue(root.value, unit)) : "-").arg(Types.toUiUnit(unit))
             Layout.fillWidth: true
             font: Style.extraSmallFont
             elide: Text.ElideMiddle
@@ -15,6 +15,8 @@ Item {
         engine: _engine
         startTime: new Date(d.startTime.getTime() - d.range * 60000)
         endTime: new Date(d.endTime.getTime() + d.range * 60000)
+        windowStart: d.startTime
+        windowEnd: d.endTime
         sampleRate: d.sampleRate
         Component.onCompleted: fetchLogs()
     }
@@ -249,7 +251,7 @@ Item {
                 ValueAxis {
                     id: valueAxis
                     min: 0
-                    max: Math.ceil(Math.max(-powerBalanceLogs.minValue, powerBalanceLogs.maxValue) / 100) * 100
+                    max: Math.ceil(Math.max(-powerBalanceLogs.windowMinValue, powerBalanceLogs.windowMaxValue) / 100) * 100
                     labelFormat: ""
                     gridLineColor: Style.tileOverlayColor
                     labelsVisible: false
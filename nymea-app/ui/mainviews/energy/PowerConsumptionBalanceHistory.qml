@@ -13,6 +13,8 @@ Item {
         engine: _engine
         startTime: new Date(d.startTime.getTime() - (d.range * 60 * 1000))
         endTime: new Date(d.endTime.getTime() + (d.range * 60 * 1000))
+        windowStart: d.startTime
+        windowEnd: d.endTime
         sampleRate: d.sampleRate
         Component.onCompleted: fetchLogs()
     }
@@ -196,7 +198,7 @@ Item {
                 ValueAxis {
                     id: valueAxis
                     min: 0
-                    max: Math.ceil(powerBalanceLogs.maxValue / 100) * 100
+                    max: Math.ceil(powerBalanceLogs.windowMaxValue / 100) * 100
                     labelFormat: ""
                     gridLineColor: Style.tileOverlayColor
                     labelsVisible: false
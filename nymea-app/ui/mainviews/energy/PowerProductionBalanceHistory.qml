@@ -13,6 +13,8 @@ Item {
         engine: _engine
         startTime: new Date(d.startTime.getTime() - d.range * 60000)
         endTime: new Date(d.endTime.getTime() + d.range * 60000)
+        windowStart: d.startTime
+        windowEnd: d.endTime
         sampleRate: d.sampleRate
         Component.onCompleted: fetchLogs()
     }
@@ -197,7 +199,7 @@ Item {
                 ValueAxis {
                     id: valueAxis
                     min: 0
-                    max: Math.ceil(-powerBalanceLogs.minValue / 100) * 100
+                    max: Math.ceil(-powerBalanceLogs.windowMinValue / 100) * 100
                     labelFormat: ""
                     gridLineColor: Style.tileOverlayColor
                     labelsVisible: false
@@ -0,0 +1,5 @@
+TARGET = tst_connectionstats
+
+include(../unittests.pri)
+
+SOURCES += tst_connectionstats.cpp
@@ -0,0 +1,298 @@
+#include <QtTest>
+#include <QCryptographicHash>
+#include <QSettings>
+
+#include "connection/connectionstats.h"
+#include "connection/latencyhistogram.h"
+#include "connection/nymeahost.h"
+
+class TestConnectionStats: public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void init();
+
+    void histogramEmpty();
+    void histogramPercentiles_data();
+    void histogramPercentiles();
+    void histogramBounds();
+    void histogramFavorsRecent();
+    void histogramSetBuckets();
+
+    void successAndFailure();
+    void saveAndLoad();
+    void loadBrokenRecord_data();
+    void loadBrokenRecord();
+
+    void bestMatch();
+
+    void benchmarkRoundTrip_data();
+    void benchmarkRoundTrip();
+
+private:
+    QString settingsKey(const QUrl &url) const;
+};
+
+void TestConnectionStats::initTestCase()
+{
+    // Keep the stats away from the ones of the actual app
+    QStandardPaths::setTestModeEnabled(true);
+    QCoreApplication::setOrganizationName("nymea-tests");
+    QCoreApplication::setApplicationName("tst_connectionstats");
+}
+
+void TestConnectionStats::init()
+{
+    QSettings settings;
+    settings.remove("ConnectionStats");
+}
+
+QString TestConnectionStats::settingsKey(const QUrl &url) const
+{
+    return QCryptographicHash::hash(url.toEncoded(), QCryptographicHash::Sha1).toHex();
+}
+
+void TestConnectionStats::histogramEmpty()
+{
+    LatencyHistogram histogram;
+    QCOMPARE(histogram.count(), 0);
+    QCOMPARE(histogram.percentile(0.5), -1);
+    QVERIFY(histogram.buckets().isEmpty());
+
+    histogram.add(10);
+    histogram.clear();
+    QCOMPARE(histogram.count(), 0);
+    QCOMPARE(histogram.percentile(0.99), -1);
+}
+
+void TestConnectionStats::histogramPercentiles_data()
+{
+    QTest::addColumn<qreal>("share");
+    QTest::addColumn<int>("expected");
+
+    QTest::newRow("p50") << 0.5 << 500;
+    QTest::newRow("p95") << 0.95 << 950;
+    QTest::newRow("p99") << 0.99 << 990;
+}
+
+void TestConnectionStats::histogramPercentiles()
+{
+    QFETCH(qreal, share);
+    QFETCH(int, expected);
+
+    // Evenly spread times are interpolated within a few percent
+    LatencyHistogram histogram;
+    for (int time = 1; time <= 1000; time++) {
+        histogram.add(time);
+    }
+    QCOMPARE(histogram.count(), 1000);
+    int percentile = histogram.percentile(share);
+    QVERIFY2(qAbs(percentile - expected) <= expected / 20, qPrintable(QString::number(percentile)));
+}
+
+void TestConnectionStats::histogramBounds()
+{
+    // A single time is somewhere in its bucket, at most a factor of sqrt(2) off
+    LatencyHistogram histogram;
+    for (int i = 0; i < 100; i++) {
+        histogram.add(100);
+    }
+    for (qreal share = 0; share <= 1; share += 0.25) {
+        QVERIFY(histogram.percentile(share) >= 100 / M_SQRT2);
+        QVERIFY(histogram.percentile(share) <= 100 * M_SQRT2);
+    }
+    // Shares are clamped
+    QCOMPARE(histogram.percentile(-1), histogram.percentile(0));
+    QCOMPARE(histogram.percentile(2), histogram.percentile(1));
+
+    // Zero, negative and huge times don't break it
+    histogram.clear();
+    histogram.add(0);
+    histogram.add(-5);
+    QVERIFY(histogram.percentile(1) <= 2);
+    histogram.add(24 * 60 * 60 * 1000);
+    QCOMPARE(histogram.count(), 3);
+    QVERIFY(histogram.percentile(1) > 60000);
+}
+
+void TestConnectionStats::histogramFavorsRecent()
+{
+    LatencyHistogram histogram;
+    for (int i = 0; i < 4096; i++) {
+        histogram.add(10);
+    }
+    for (int i = 0; i < 4096; i++) {
+        histogram.add(1000);
+    }
+    // The sample count stays bounded and old samples fade out
+    QVERIFY(histogram.count() <= 4096);
+    QVERIFY(histogram.count() > 2048);
+    QVERIFY(histogram.percentile(0.5) > 700);
+    QVERIFY(histogram.percentile(0.1) < 15);
+}
+
+void TestConnectionStats::histogramSetBuckets()
+{
+    LatencyHistogram histogram;
+    for (int time = 1; time <= 100; time++) {
+        histogram.add(time);
+    }
+
+    LatencyHistogram copy;
+    copy.setBuckets(histogram.buckets());
+    QCOMPARE(copy.count(), 100);
+    QCOMPARE(copy.percentile(0.9), histogram.percentile(0.9));
+
+    // Another layout is ignored
+    copy.setBuckets(QVector<quint32>(10, 1));
+    QCOMPARE(copy.count(), 100);
+    copy.setBuckets(QVector<quint32>());
+    QCOMPARE(copy.count(), 0);
+}
+
+void TestConnectionStats::successAndFailure()
+{
+    ConnectionStats stats;
+    QCOMPARE(stats.handshakeTime, -1);
+    QCOMPARE(stats.roundTripPercentile(0.5), -1);
+
+    stats.addSuccess(100);
+    QCOMPARE(stats.handshakeTime, 100);
+    QCOMPARE(stats.successCount, 1);
+    QVERIFY(stats.lastSuccess.isValid());
+
+    // Smoothed, a single outlier moves it a quarter of the way
+    stats.addSuccess(500);
+    QCOMPARE(stats.handshakeTime, 200);
+
+    stats.addFailure();
+    stats.addFailure();
+    QCOMPARE(stats.failureCount, 2);
+    QCOMPARE(stats.failureStreak, 2);
+    QVERIFY(stats.lastFailure.isValid());
+    stats.addSuccess(200);
+    QCOMPARE(stats.failureStreak, 0);
+    QCOMPARE(stats.failureCount, 2);
+    QCOMPARE(stats.successCount, 3);
+
+    stats.addTimeToFirstByte(40);
+    stats.addTimeToFirstByte(80);
+    QCOMPARE(stats.timeToFirstByte, 50);
+}
+
+void TestConnectionStats::saveAndLoad()
+{
+    QUrl url("nymeas://10.0.0.2:2222");
+    ConnectionStats stats;
+    stats.addSuccess(120);
+    stats.addFailure();
+    stats.addTimeToFirstByte(200);
+    for (int time = 1; time <= 500; time++) {
+        stats.addRoundTripTime(time);
+    }
+    stats.save(url);
+
+    ConnectionStats loaded = ConnectionStats::load(url);
+    QCOMPARE(loaded.handshakeTime, 120);
+    QCOMPARE(loaded.timeToFirstByte, 200);
+    QCOMPARE(loaded.successCount, 1);
+    QCOMPARE(loaded.failureCount, 1);
+    QCOMPARE(loaded.failureStreak, 1);
+    QCOMPARE(loaded.lastSuccess, QDateTime::fromMSecsSinceEpoch(stats.lastSuccess.toMSecsSinceEpoch()));
+    QCOMPARE(loaded.lastFailure, QDateTime::fromMSecsSinceEpoch(stats.lastFailure.toMSecsSinceEpoch()));
+    QCOMPARE(loaded.roundTripCount(), 500);
+    QCOMPARE(loaded.roundTripPercentile(0.95), stats.roundTripPercentile(0.95));
+
+    // Compact, and per url
+    QSettings settings;
+    QVERIFY(settings.value("ConnectionStats/" + settingsKey(url)).toByteArray().size() < 200);
+    QCOMPARE(ConnectionStats::load(QUrl("nymeas://10.0.0.3:2222")).successCount, 0);
+}
+
+void TestConnectionStats::loadBrokenRecord_data()
+{
+    QTest::addColumn<QByteArray>("record");
+
+    QTest::newRow("empty") << QByteArray();
+    QTest::newRow("other version") << QByteArray(64, 7);
+    QTest::newRow("truncated") << QByteArray::fromHex("010000007800");
+}
+
+void TestConnectionStats::loadBrokenRecord()
+{
+    QFETCH(QByteArray, record);
+
+    QUrl url("ws://10.0.0.2:4444");
+    QSettings settings;
+    settings.setValue("ConnectionStats/" + settingsKey(url), record);
+
+    ConnectionStats stats = ConnectionStats::load(url);
+    QCOMPARE(stats.handshakeTime, -1);
+    QCOMPARE(stats.successCount, 0);
+    QCOMPARE(stats.roundTripCount(), 0);
+    QVERIFY(!stats.lastSuccess.isValid());
+}
+
+void TestConnectionStats::bestMatch()
+{
+    Connections connections;
+    connections.addConnection(QUrl("nymeas://10.0.0.2:2222"), Connection::BearerTypeLan, true, "first");
+    connections.addConnection(QUrl("nymeas://10.0.0.3:2222"), Connection::BearerTypeLan, true, "second");
+    Connection *first = connections.get(0);
+    Connection *second = connections.get(1);
+    QCOMPARE(connections.bestMatch(Connection::BearerTypeLan), first);
+
+    // Out of equal ones the faster one wins, round trips count more than the handshake
+    second->addSuccess(50);
+    QCOMPARE(connections.bestMatch(Connection::BearerTypeLan), second);
+    first->addSuccess(20);
+    QCOMPARE(connections.bestMatch(Connection::BearerTypeLan), first);
+    for (int i = 0; i < 10; i++) {
+        first->addRoundTripTime(200);
+        second->addRoundTripTime(20);
+    }
+    QCOMPARE(connections.bestMatch(Connection::BearerTypeLan), second);
+
+    // One which keeps failing loses, even when it was faster
+    second->addFailure();
+    second->addFailure();
+    QCOMPARE(connections.bestMatch(Connection::BearerTypeLan), second);
+    second->addFailure();
+    QCOMPARE(connections.bestMatch(Connection::BearerTypeLan), first);
+    second->addSuccess(50);
+    QCOMPARE(connections.bestMatch(Connection::BearerTypeLan), second);
+}
+
+void TestConnectionStats::benchmarkRoundTrip_data()
+{
+    QTest::addColumn<bool>("readPercentiles");
+
+    QTest::newRow("add") << false;
+    QTest::newRow("add and read p50/p95/p99") << true;
+}
+
+void TestConnectionStats::benchmarkRoundTrip()
+{
+    QFETCH(bool, readPercentiles);
+
+    // What every JSON-RPC reply costs, with the connection info dialog open or not
+    ConnectionStats stats;
+    int time = 1;
+    QBENCHMARK {
+        for (int i = 0; i < 10000; i++) {
+            time = (time * 17 + 3) % 2000 + 1;
+            stats.addRoundTripTime(time);
+            if (readPercentiles) {
+                stats.roundTripPercentile(0.5);
+                stats.roundTripPercentile(0.95);
+                stats.roundTripPercentile(0.99);
+            }
+        }
+    }
+    QVERIFY(stats.roundTripCount() > 0);
+}
+
+QTEST_GUILESS_MAIN(TestConnectionStats)
+#include "tst_connectionstats.moc"
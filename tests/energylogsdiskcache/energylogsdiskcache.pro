@@ -0,0 +1,5 @@
+TARGET = tst_energylogsdiskcache
+
+include(../unittests.pri)
+
+SOURCES += tst_energylogsdiskcache.cpp
@@ -0,0 +1,351 @@
+#include <QtTest>
+
+#include "energy/energylogstore.h"
+#include "energy/energylogsdiskcache.h"
+
+typedef QVector<EnergyLogRanges::Range> RangeList;
+
+class TestEnergyLogsDiskCache: public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void init();
+
+    void addRanges_data();
+    void addRanges();
+    void gaps_data();
+    void gaps();
+    void removeBefore();
+    void mergeStores();
+
+    void appendAndLoad();
+    void perThingAndSampleRate();
+    void truncatedFile();
+    void unsupportedFile();
+    void expiredSamples();
+    void compaction();
+    void evictUnused();
+
+    void benchmarkLoad_data();
+    void benchmarkLoad();
+
+private:
+    EnergyLogStore samples(qint64 from, int count, int sampleRate);
+    QString cacheDir() const;
+
+    QString m_serverUuid;
+    QUuid m_thingId;
+    qint64 m_now = 0;
+};
+
+EnergyLogStore TestEnergyLogsDiskCache::samples(qint64 from, int count, int sampleRate)
+{
+    EnergyLogStore store(3);
+    store.reserve(count);
+    for (int i = 0; i < count; i++) {
+        store.append(from + i * sampleRate * 60, {i * 1.5, i * 10.0, 0});
+    }
+    return store;
+}
+
+QString TestEnergyLogsDiskCache::cacheDir() const
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/energylogs";
+}
+
+void TestEnergyLogsDiskCache::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+    m_serverUuid = QUuid::createUuid().toString();
+    m_thingId = QUuid::createUuid();
+    // Samples are aligned to the sample rate, an hour works for all the ones used here
+    m_now = QDateTime::currentSecsSinceEpoch() / 3600 * 3600;
+}
+
+void TestEnergyLogsDiskCache::init()
+{
+    QDir(cacheDir()).removeRecursively();
+}
+
+void TestEnergyLogsDiskCache::addRanges_data()
+{
+    QTest::addColumn<RangeList>("added");
+    QTest::addColumn<RangeList>("expected");
+
+    QTest::newRow("single") << RangeList({{10, 20}}) << RangeList({{10, 20}});
+    QTest::newRow("invalid") << RangeList({{20, 10}}) << RangeList();
+    QTest::newRow("disjoint, unordered") << RangeList({{50, 60}, {10, 20}, {30, 40}}) << RangeList({{10, 20}, {30, 40}, {50, 60}});
+    QTest::newRow("overlapping") << RangeList({{10, 20}, {15, 30}}) << RangeList({{10, 30}});
+    QTest::newRow("adjacent") << RangeList({{10, 20}, {21, 30}}) << RangeList({{10, 30}});
+    QTest::newRow("contained") << RangeList({{10, 40}, {20, 30}}) << RangeList({{10, 40}});
+    QTest::newRow("bridging") << RangeList({{10, 20}, {30, 40}, {50, 60}, {15, 55}}) << RangeList({{10, 60}});
+    QTest::newRow("bridging some") << RangeList({{10, 20}, {30, 40}, {50, 60}, {70, 80}, {35, 52}}) << RangeList({{10, 20}, {30, 60}, {70, 80}});
+}
+
+void TestEnergyLogsDiskCache::addRanges()
+{
+    QFETCH(RangeList, added);
+    QFETCH(RangeList, expected);
+
+    EnergyLogRanges ranges;
+    foreach (const EnergyLogRanges::Range &range, added) {
+        ranges.add(range.first, range.second);
+    }
+    QCOMPARE(ranges.ranges(), expected);
+    QCOMPARE(ranges.isEmpty(), expected.isEmpty());
+}
+
+void TestEnergyLogsDiskCache::gaps_data()
+{
+    QTest::addColumn<qint64>("from");
+    QTest::addColumn<qint64>("to");
+    QTest::addColumn<RangeList>("expected");
+
+    // Covered: [10, 20] and [30, 40]
+    QTest::newRow("all covered") << qint64(12) << qint64(18) << RangeList();
+    QTest::newRow("nothing covered") << qint64(0) << qint64(5) << RangeList({{0, 5}});
+    QTest::newRow("before and after") << qint64(0) << qint64(50) << RangeList({{0, 9}, {21, 29}, {41, 50}});
+    QTest::newRow("starting inside") << qint64(15) << qint64(35) << RangeList({{21, 29}});
+    QTest::newRow("ending on the edge") << qint64(21) << qint64(30) << RangeList({{21, 29}});
+}
+
+void TestEnergyLogsDiskCache::gaps()
+{
+    QFETCH(qint64, from);
+    QFETCH(qint64, to);
+    QFETCH(RangeList, expected);
+
+    EnergyLogRanges ranges;
+    ranges.add(10, 20);
+    ranges.add(30, 40);
+    QCOMPARE(ranges.gaps(from, to), expected);
+    QCOMPARE(EnergyLogRanges().gaps(from, to), RangeList({{from, to}}));
+}
+
+void TestEnergyLogsDiskCache::removeBefore()
+{
+    EnergyLogRanges ranges;
+    ranges.add(10, 20);
+    ranges.add(30, 40);
+    ranges.add(50, 60);
+    ranges.removeBefore(35);
+    QCOMPARE(ranges.ranges(), RangeList({{35, 40}, {50, 60}}));
+    ranges.removeBefore(45);
+    QCOMPARE(ranges.ranges(), RangeList({{50, 60}}));
+    ranges.removeBefore(100);
+    QVERIFY(ranges.isEmpty());
+}
+
+void TestEnergyLogsDiskCache::mergeStores()
+{
+    EnergyLogStore store(1);
+    store.append(10, {1});
+    store.append(30, {3});
+    EnergyLogStore other(1);
+    other.append(5, {0});
+    other.append(20, {2});
+    other.append(30, {-1});
+    other.append(40, {4});
+
+    // Existing samples win over fetched ones with the same timestamp
+    store.merge(other);
+    QCOMPARE(store.timestamps(), QVector<qint64>({5, 10, 20, 30, 40}));
+    QCOMPARE(store.column(0), QVector<double>({0, 1, 2, 3, 4}));
+
+    EnergyLogStore later(1);
+    later.append(50, {5});
+    store.merge(later);
+    QCOMPARE(store.count(), 6);
+    QCOMPARE(store.lowerBound(25), 3);
+    QCOMPARE(store.nearestIndex(24), 2);
+    QCOMPARE(store.nearestIndex(100), 5);
+}
+
+void TestEnergyLogsDiskCache::appendAndLoad()
+{
+    EnergyLogsDiskCache cache(m_serverUuid, "ThingPowerLogs", m_thingId, 15);
+    QVERIFY(cache.isValid());
+    QVERIFY(!EnergyLogsDiskCache(QString(), "ThingPowerLogs", m_thingId, 15).isValid());
+
+    EnergyLogStore entries(3);
+    EnergyLogRanges ranges;
+    QVERIFY(!cache.load(3, &entries, &ranges));
+
+    // Two fetches, the second one overlapping the first, and a range without any samples on the server
+    qint64 start = m_now - 1000 * 15 * 60;
+    cache.append(samples(start, 100, 15), start, start + 100 * 15 * 60 - 1);
+    cache.append(samples(start + 50 * 15 * 60, 100, 15), start + 50 * 15 * 60, start + 150 * 15 * 60 - 1);
+    cache.append(EnergyLogStore(3), start + 300 * 15 * 60, start + 400 * 15 * 60);
+
+    QVERIFY(cache.load(3, &entries, &ranges));
+    QCOMPARE(entries.count(), 150);
+    QCOMPARE(entries.firstTimestamp(), start);
+    QCOMPARE(entries.valueAt(60, 0), 90.0);
+    QCOMPARE(ranges.ranges(), RangeList({{start, start + 150 * 15 * 60 - 1}, {start + 300 * 15 * 60, start + 400 * 15 * 60}}));
+
+    cache.remove();
+    EnergyLogStore removed(3);
+    QVERIFY(!cache.load(3, &removed, &ranges));
+}
+
+void TestEnergyLogsDiskCache::perThingAndSampleRate()
+{
+    qint64 start = m_now - 100 * 3600;
+    EnergyLogsDiskCache(m_serverUuid, "ThingPowerLogs", m_thingId, 60).append(samples(start, 10, 60), start, start + 10 * 3600);
+
+    EnergyLogStore entries(3);
+    EnergyLogRanges ranges;
+    QVERIFY(!EnergyLogsDiskCache(m_serverUuid, "ThingPowerLogs", m_thingId, 15).load(3, &entries, &ranges));
+    QVERIFY(!EnergyLogsDiskCache(m_serverUuid, "ThingPowerLogs", QUuid::createUuid(), 60).load(3, &entries, &ranges));
+    QVERIFY(!EnergyLogsDiskCache(m_serverUuid, "PowerBalanceLogs", QUuid(), 60).load(8, &entries, &ranges));
+    QVERIFY(!EnergyLogsDiskCache(QUuid::createUuid().toString(), "ThingPowerLogs", m_thingId, 60).load(3, &entries, &ranges));
+    QVERIFY(EnergyLogsDiskCache(m_serverUuid, "ThingPowerLogs", m_thingId, 60).load(3, &entries, &ranges));
+    QCOMPARE(entries.count(), 10);
+}
+
+void TestEnergyLogsDiskCache::truncatedFile()
+{
+    EnergyLogsDiskCache cache(m_serverUuid, "ThingPowerLogs", m_thingId, 15);
+    qint64 start = m_now - 1000 * 15 * 60;
+    cache.append(samples(start, 100, 15), start, start + 100 * 15 * 60 - 1);
+    cache.append(samples(start + 200 * 15 * 60, 100, 15), start + 200 * 15 * 60, start + 300 * 15 * 60 - 1);
+
+    // As if the app was killed while appending the second segment
+    QString fileName = QDir(cacheDir() + "/" + m_serverUuid.mid(1, 36)).entryInfoList(QDir::Files).first().absoluteFilePath();
+    QFile f(fileName);
+    QVERIFY(f.resize(f.size() - 10));
+
+    EnergyLogStore entries(3);
+    EnergyLogRanges ranges;
+    QVERIFY(cache.load(3, &entries, &ranges));
+    QCOMPARE(entries.count(), 100);
+    QCOMPARE(ranges.ranges().count(), 1);
+
+    // The broken part is gone, so appending works again
+    cache.append(samples(start + 200 * 15 * 60, 100, 15), start + 200 * 15 * 60, start + 300 * 15 * 60 - 1);
+    entries.clear();
+    ranges.clear();
+    QVERIFY(cache.load(3, &entries, &ranges));
+    QCOMPARE(entries.count(), 200);
+    QCOMPARE(ranges.ranges().count(), 2);
+}
+
+void TestEnergyLogsDiskCache::unsupportedFile()
+{
+    EnergyLogsDiskCache cache(m_serverUuid, "ThingPowerLogs", m_thingId, 15);
+    qint64 start = m_now - 1000 * 15 * 60;
+    cache.append(samples(start, 100, 15), start, start + 100 * 15 * 60 - 1);
+
+    // A different column count, e.g. after an update added one
+    EnergyLogStore entries(4);
+    EnergyLogRanges ranges;
+    QVERIFY(!cache.load(4, &entries, &ranges));
+    QVERIFY(QDir(cacheDir() + "/" + m_serverUuid.mid(1, 36)).entryList(QDir::Files).isEmpty());
+}
+
+void TestEnergyLogsDiskCache::expiredSamples()
+{
+    // 20000 samples are kept, plus a quarter more before the file is rewritten
+    EnergyLogsDiskCache cache(m_serverUuid, "ThingPowerLogs", m_thingId, 1);
+    qint64 oldest = m_now - 20000 * 60;
+    cache.append(samples(oldest - 30000 * 60, 1000, 1), oldest - 30000 * 60, oldest - 29000 * 60);
+    cache.append(samples(oldest - 100 * 60, 200, 1), oldest - 100 * 60, oldest + 100 * 60);
+
+    EnergyLogStore entries(3);
+    EnergyLogRanges ranges;
+    QVERIFY(cache.load(3, &entries, &ranges));
+    QVERIFY(entries.firstTimestamp() >= oldest - 60);
+    QVERIFY(entries.count() <= 102);
+    QCOMPARE(ranges.ranges().count(), 1);
+    QVERIFY(ranges.ranges().first().first >= oldest - 60);
+    QCOMPARE(ranges.ranges().first().second, oldest + 100 * 60);
+}
+
+void TestEnergyLogsDiskCache::compaction()
+{
+    EnergyLogsDiskCache cache(m_serverUuid, "ThingPowerLogs", m_thingId, 15);
+    qint64 start = m_now - 1000 * 15 * 60;
+    // Many small adjacent fetches, like a live chart
+    for (int i = 0; i < 50; i++) {
+        qint64 from = start + i * 10 * 15 * 60;
+        cache.append(samples(from, 10, 15), from, from + 10 * 15 * 60 - 1);
+    }
+    QString fileName = QDir(cacheDir() + "/" + m_serverUuid.mid(1, 36)).entryInfoList(QDir::Files).first().absoluteFilePath();
+    qint64 size = QFileInfo(fileName).size();
+
+    EnergyLogStore entries(3);
+    EnergyLogRanges ranges;
+    QVERIFY(cache.load(3, &entries, &ranges));
+    QCOMPARE(entries.count(), 500);
+    QCOMPARE(ranges.ranges().count(), 1);
+    QVERIFY(QFileInfo(fileName).size() < size);
+
+    EnergyLogStore reloaded(3);
+    EnergyLogRanges reloadedRanges;
+    QVERIFY(cache.load(3, &reloaded, &reloadedRanges));
+    QCOMPARE(reloaded.timestamps(), entries.timestamps());
+    QCOMPARE(reloaded.column(1), entries.column(1));
+    QCOMPARE(reloadedRanges.ranges(), ranges.ranges());
+}
+
+void TestEnergyLogsDiskCache::evictUnused()
+{
+    // A server which hasn't been connected to for long
+    QString otherServer = QUuid::createUuid().toString();
+    EnergyLogsDiskCache other(otherServer, "ThingPowerLogs", m_thingId, 15);
+    qint64 start = m_now - 100 * 15 * 60;
+    other.append(samples(start, 10, 15), start, start + 10 * 15 * 60);
+    QString otherDir = cacheDir() + "/" + otherServer.mid(1, 36);
+    QFile f(QDir(otherDir).entryInfoList(QDir::Files).first().absoluteFilePath());
+    QVERIFY(f.open(QFile::ReadWrite));
+    QVERIFY(f.setFileTime(QDateTime::currentDateTime().addDays(-100), QFileDevice::FileModificationTime));
+    f.close();
+
+    EnergyLogsDiskCache cache(m_serverUuid, "ThingPowerLogs", m_thingId, 15);
+    cache.append(samples(start, 10, 15), start, start + 10 * 15 * 60);
+    EnergyLogStore entries(3);
+    EnergyLogRanges ranges;
+    QVERIFY(cache.load(3, &entries, &ranges));
+    QVERIFY(!QFile::exists(f.fileName()));
+    QVERIFY(!QDir(otherDir).exists());
+}
+
+void TestEnergyLogsDiskCache::benchmarkLoad_data()
+{
+    QTest::addColumn<int>("sampleRate");
+    QTest::addColumn<int>("sampleCount");
+
+    QTest::newRow("1 hour, a year") << 60 << 365 * 24;
+    QTest::newRow("15 mins, 20000 samples") << 15 << 20000;
+}
+
+void TestEnergyLogsDiskCache::benchmarkLoad()
+{
+    QFETCH(int, sampleRate);
+    QFETCH(int, sampleCount);
+
+    // Fetched a day at a time, then compacted by the first load
+    EnergyLogsDiskCache cache(m_serverUuid, "ThingPowerLogs", m_thingId, sampleRate);
+    int perDay = 24 * 60 / sampleRate;
+    qint64 start = m_now - static_cast<qint64>(sampleCount) * sampleRate * 60;
+    for (int i = 0; i < sampleCount; i += perDay) {
+        qint64 from = start + static_cast<qint64>(i) * sampleRate * 60;
+        cache.append(samples(from, qMin(perDay, sampleCount - i), sampleRate), from, from + perDay * sampleRate * 60 - 1);
+    }
+    EnergyLogStore entries(3);
+    EnergyLogRanges ranges;
+    QVERIFY(cache.load(3, &entries, &ranges));
+
+    // What reopening the chart costs
+    QBENCHMARK {
+        EnergyLogStore loaded(3);
+        EnergyLogRanges loadedRanges;
+        cache.load(3, &loaded, &loadedRanges);
+        QCOMPARE(loaded.count(), entries.count());
+    }
+}
+
+QTEST_GUILESS_MAIN(TestEnergyLogsDiskCache)
+#include "tst_energylogsdiskcache.moc"
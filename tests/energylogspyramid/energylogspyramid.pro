@@ -0,0 +1,5 @@
+TARGET = tst_energylogspyramid
+
+include(../unittests.pri)
+
+SOURCES += tst_energylogspyramid.cpp
@@ -0,0 +1,372 @@
+#include <QtTest>
+#include <QGuiApplication>
+
+#include <time.h>
+
+#include "engine.h"
+#include "energy/energylogs.h"
+#include "energy/energylogspyramid.h"
+
+class TestEnergyLogsPyramid: public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void init();
+
+    void bucketing_data();
+    void bucketing();
+
+    void downsample();
+    void downsampleGaps();
+    void downsampleCalendar();
+
+    void upsample();
+    void upsampleLimits();
+
+    void liveLevels();
+    void eviction();
+    void aggregateFallback();
+
+private:
+    static qint64 local(int year, int month, int day, int hour = 0, int minute = 0);
+    // Samples of the given rate in [from, to), power and counter columns
+    static EnergyLogStore samples(qint64 from, qint64 to, int sampleRate, EnergyLogRanges *ranges = nullptr);
+
+    QVector<EnergyLogStore::Aggregation> m_aggregations;
+    Engine *m_engine = nullptr;
+    EnergyLogsPyramid *m_pyramid = nullptr;
+};
+
+void TestEnergyLogsPyramid::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+    QLoggingCategory::setFilterRules("EnergyLogs.debug=false\nNymeaConnection.warning=false");
+
+    m_aggregations = {EnergyLogStore::AggregationAverage, EnergyLogStore::AggregationLast};
+    m_engine = new Engine(this);
+    m_pyramid = EnergyLogsPyramid::forEngine(m_engine);
+    QCOMPARE(EnergyLogsPyramid::forEngine(m_engine), m_pyramid);
+}
+
+void TestEnergyLogsPyramid::init()
+{
+    m_pyramid->clear();
+}
+
+qint64 TestEnergyLogsPyramid::local(int year, int month, int day, int hour, int minute)
+{
+    return QDateTime(QDate(year, month, day), QTime(hour, minute)).toSecsSinceEpoch();
+}
+
+EnergyLogStore TestEnergyLogsPyramid::samples(qint64 from, qint64 to, int sampleRate, EnergyLogRanges *ranges)
+{
+    // Power is the sample's index, the counter grows by one per sample
+    EnergyLogStore store(2);
+    int index = 0;
+    for (qint64 timestamp = from; timestamp < to; timestamp = EnergyLogsPyramid::nextBucketStart(timestamp, sampleRate)) {
+        store.append(timestamp, {static_cast<double>(index), static_cast<double>(index + 1)});
+        index++;
+    }
+    if (ranges && !store.isEmpty()) {
+        ranges->add(store.firstTimestamp(), store.lastTimestamp());
+    }
+    return store;
+}
+
+void TestEnergyLogsPyramid::bucketing_data()
+{
+    QTest::addColumn<int>("sampleRate");
+    QTest::addColumn<qint64>("timestamp");
+    QTest::addColumn<qint64>("bucketStart");
+    QTest::addColumn<qint64>("nextBucketStart");
+    QTest::addColumn<qint64>("length");
+
+    // Buckets are aligned in local time, TZ is Europe/Vienna. DST starts 2021-03-28 02:00 and ends 2021-10-31 03:00.
+    QTest::newRow("15 mins") << static_cast<int>(EnergyLogs::SampleRate15Mins) << local(2021, 6, 1, 10, 37) << local(2021, 6, 1, 10, 30) << local(2021, 6, 1, 10, 45) << 900ll;
+    QTest::newRow("15 mins, into DST") << static_cast<int>(EnergyLogs::SampleRate15Mins) << local(2021, 3, 28, 1, 50) << local(2021, 3, 28, 1, 45) << local(2021, 3, 28, 3, 0) << 900ll;
+    QTest::newRow("15 mins, in DST") << static_cast<int>(EnergyLogs::SampleRate15Mins) << local(2021, 3, 28, 3, 10) << local(2021, 3, 28, 3, 0) << local(2021, 3, 28, 3, 15) << 900ll;
+    QTest::newRow("hour") << static_cast<int>(EnergyLogs::SampleRate1Hour) << local(2021, 6, 1, 10, 37) << local(2021, 6, 1, 10, 0) << local(2021, 6, 1, 11, 0) << 3600ll;
+    QTest::newRow("3 hours") << static_cast<int>(EnergyLogs::SampleRate3Hours) << local(2021, 6, 1, 10, 37) << local(2021, 6, 1, 9, 0) << local(2021, 6, 1, 12, 0) << 3 * 3600ll;
+    QTest::newRow("day") << static_cast<int>(EnergyLogs::SampleRate1Day) << local(2021, 6, 1, 10, 37) << local(2021, 6, 1) << local(2021, 6, 2) << 24 * 3600ll;
+    QTest::newRow("day, DST starts") << static_cast<int>(EnergyLogs::SampleRate1Day) << local(2021, 3, 28, 12, 0) << local(2021, 3, 28) << local(2021, 3, 29) << 23 * 3600ll;
+    QTest::newRow("day, DST ends") << static_cast<int>(EnergyLogs::SampleRate1Day) << local(2021, 10, 31, 23, 59) << local(2021, 10, 31) << local(2021, 11, 1) << 25 * 3600ll;
+    QTest::newRow("week") << static_cast<int>(EnergyLogs::SampleRate1Week) << local(2021, 6, 3, 10, 0) << local(2021, 5, 31) << local(2021, 6, 7) << 7 * 24 * 3600ll;
+    QTest::newRow("week, Monday") << static_cast<int>(EnergyLogs::SampleRate1Week) << local(2021, 5, 31) << local(2021, 5, 31) << local(2021, 6, 7) << 7 * 24 * 3600ll;
+    QTest::newRow("week, Sunday") << static_cast<int>(EnergyLogs::SampleRate1Week) << local(2021, 6, 6, 23, 59) << local(2021, 5, 31) << local(2021, 6, 7) << 7 * 24 * 3600ll;
+    QTest::newRow("week, DST starts") << static_cast<int>(EnergyLogs::SampleRate1Week) << local(2021, 3, 25, 8, 0) << local(2021, 3, 22) << local(2021, 3, 29) << 7 * 24 * 3600ll - 3600;
+    QTest::newRow("week, over new year") << static_cast<int>(EnergyLogs::SampleRate1Week) << local(2021, 1, 2, 12, 0) << local(2020, 12, 28) << local(2021, 1, 4) << 7 * 24 * 3600ll;
+    QTest::newRow("month, February") << static_cast<int>(EnergyLogs::SampleRate1Month) << local(2021, 2, 15) << local(2021, 2, 1) << local(2021, 3, 1) << 28 * 24 * 3600ll;
+    QTest::newRow("month, DST starts") << static_cast<int>(EnergyLogs::SampleRate1Month) << local(2021, 3, 31, 23, 30) << local(2021, 3, 1) << local(2021, 4, 1) << 31 * 24 * 3600ll - 3600;
+    QTest::newRow("month, DST ends") << static_cast<int>(EnergyLogs::SampleRate1Month) << local(2021, 10, 1) << local(2021, 10, 1) << local(2021, 11, 1) << 31 * 24 * 3600ll + 3600;
+    QTest::newRow("year, leap year") << static_cast<int>(EnergyLogs::SampleRate1Year) << local(2020, 7, 1) << local(2020, 1, 1) << local(2021, 1, 1) << 366 * 24 * 3600ll;
+}
+
+void TestEnergyLogsPyramid::bucketing()
+{
+    QFETCH(int, sampleRate);
+    QFETCH(qint64, timestamp);
+    QFETCH(qint64, bucketStart);
+    QFETCH(qint64, nextBucketStart);
+    QFETCH(qint64, length);
+
+    QCOMPARE(EnergyLogsPyramid::bucketStart(timestamp, sampleRate), bucketStart);
+    QCOMPARE(EnergyLogsPyramid::nextBucketStart(bucketStart, sampleRate), nextBucketStart);
+    QCOMPARE(nextBucketStart - bucketStart, length);
+    // Buckets are seamless
+    QCOMPARE(EnergyLogsPyramid::bucketStart(nextBucketStart - 1, sampleRate), bucketStart);
+    QCOMPARE(EnergyLogsPyramid::bucketStart(nextBucketStart, sampleRate), nextBucketStart);
+}
+
+void TestEnergyLogsPyramid::downsample()
+{
+    EnergyLogRanges ranges;
+    qint64 start = local(2021, 6, 1);
+    EnergyLogStore entries = samples(start, start + 4 * 3600, EnergyLogs::SampleRate15Mins, &ranges);
+    QCOMPARE(entries.count(), 16);
+
+    EnergyLogStore hours = EnergyLogsPyramid::downsample(entries, ranges, EnergyLogs::SampleRate15Mins, EnergyLogs::SampleRate1Hour, m_aggregations);
+    QCOMPARE(hours.count(), 4);
+    for (int i = 0; i < hours.count(); i++) {
+        QCOMPARE(hours.timestampAt(i), start + i * 3600);
+        // Power is averaged, the counter is the last value in the bucket
+        QCOMPARE(hours.valueAt(i, 0), i * 4 + 1.5);
+        QCOMPARE(hours.valueAt(i, 1), i * 4 + 4.0);
+    }
+
+    // Aggregated levels can be aggregated further, the partial last bucket is left out
+    EnergyLogStore threeHours = EnergyLogsPyramid::downsample(hours, ranges, EnergyLogs::SampleRate1Hour, EnergyLogs::SampleRate3Hours, m_aggregations);
+    QCOMPARE(threeHours.count(), 1);
+    QCOMPARE(threeHours.timestampAt(0), start);
+    QCOMPARE(threeHours.valueAt(0, 0), 5.5);
+    QCOMPARE(threeHours.valueAt(0, 1), 12.0);
+}
+
+void TestEnergyLogsPyramid::downsampleGaps()
+{
+    qint64 start = local(2021, 6, 1);
+
+    // Nothing fetched for 02:15 and 02:30. That bucket would average over two samples only.
+    EnergyLogRanges ranges;
+    EnergyLogStore entries = samples(start, start + 2 * 3600 + 900, EnergyLogs::SampleRate15Mins, &ranges);
+    EnergyLogStore tail = samples(start + 2 * 3600 + 2700, start + 4 * 3600, EnergyLogs::SampleRate15Mins, &ranges);
+    entries.append(tail);
+    EnergyLogStore hours = EnergyLogsPyramid::downsample(entries, ranges, EnergyLogs::SampleRate15Mins, EnergyLogs::SampleRate1Hour, m_aggregations);
+    QCOMPARE(hours.timestamps(), QVector<qint64>({start, start + 3600, start + 3 * 3600}));
+
+    // The same if the samples are there but not marked as fetched
+    EnergyLogRanges partialRanges;
+    partialRanges.add(start, start + 2 * 3600);
+    partialRanges.add(start + 2 * 3600 + 2700, start + 4 * 3600);
+    entries = samples(start, start + 4 * 3600, EnergyLogs::SampleRate15Mins);
+    hours = EnergyLogsPyramid::downsample(entries, partialRanges, EnergyLogs::SampleRate15Mins, EnergyLogs::SampleRate1Hour, m_aggregations);
+    QCOMPARE(hours.timestamps(), QVector<qint64>({start, start + 3600, start + 3 * 3600}));
+
+    // Fetched from 00:30 on, the first bucket is partial
+    EnergyLogRanges edgeRanges;
+    entries = samples(start + 1800, start + 4 * 3600, EnergyLogs::SampleRate15Mins, &edgeRanges);
+    hours = EnergyLogsPyramid::downsample(entries, edgeRanges, EnergyLogs::SampleRate15Mins, EnergyLogs::SampleRate1Hour, m_aggregations);
+    QCOMPARE(hours.timestamps(), QVector<qint64>({start + 3600, start + 2 * 3600, start + 3 * 3600}));
+
+    // The running bucket: fetched up to now, but 03:45 isn't produced yet
+    EnergyLogRanges runningRanges;
+    runningRanges.add(start, start + 3 * 3600 + 2700);
+    entries = samples(start, start + 3 * 3600 + 2700, EnergyLogs::SampleRate15Mins);
+    hours = EnergyLogsPyramid::downsample(entries, runningRanges, EnergyLogs::SampleRate15Mins, EnergyLogs::SampleRate1Hour, m_aggregations);
+    QCOMPARE(hours.timestamps(), QVector<qint64>({start, start + 3600, start + 2 * 3600}));
+}
+
+void TestEnergyLogsPyramid::downsampleCalendar()
+{
+    // Daily samples from the middle of February to the middle of April, across the DST switch
+    EnergyLogRanges ranges;
+    EnergyLogStore entries = samples(local(2021, 2, 15), local(2021, 4, 16), EnergyLogs::SampleRate1Day, &ranges);
+    QCOMPARE(entries.count(), 14 + 31 + 15);
+
+    // February and April are partial, only March is complete
+    EnergyLogStore months = EnergyLogsPyramid::downsample(entries, ranges, EnergyLogs::SampleRate1Day, EnergyLogs::SampleRate1Month, m_aggregations);
+    QCOMPARE(months.count(), 1);
+    QCOMPARE(months.timestampAt(0), local(2021, 3, 1));
+    QCOMPARE(months.valueAt(0, 0), 14 + 15.0);
+    QCOMPARE(months.valueAt(0, 1), 14 + 31.0);
+
+    // Weeks across month boundaries and the DST switch
+    EnergyLogStore weeks = EnergyLogsPyramid::downsample(entries, ranges, EnergyLogs::SampleRate1Day, EnergyLogs::SampleRate1Week, m_aggregations);
+    QCOMPARE(weeks.count(), 8);
+    QCOMPARE(weeks.timestampAt(0), local(2021, 2, 15));
+    QCOMPARE(weeks.timestampAt(6), local(2021, 3, 29));
+    for (int i = 0; i < weeks.count(); i++) {
+        QCOMPARE(weeks.valueAt(i, 0), i * 7 + 3.0);
+        QCOMPARE(weeks.valueAt(i, 1), i * 7 + 7.0);
+    }
+}
+
+void TestEnergyLogsPyramid::upsample()
+{
+    qint64 start = local(2021, 6, 1);
+    EnergyLogStore hours(2);
+    hours.append(start, {100, 10});
+    hours.append(start + 3600, {200, 14});
+    hours.append(start + 2 * 3600, {300, 22});
+    // Not contiguous
+    hours.append(start + 5 * 3600, {400, 30});
+
+    EnergyLogStore quarters = EnergyLogsPyramid::upsample(hours, EnergyLogs::SampleRate1Hour, EnergyLogs::SampleRate15Mins, m_aggregations);
+    QCOMPARE(quarters.count(), 16);
+    QVector<double> power;
+    QVector<double> counter;
+    for (int i = 0; i < quarters.count(); i++) {
+        QCOMPARE(quarters.timestampAt(i), start + (i < 12 ? i : i + 8) * 900);
+        power.append(quarters.valueAt(i, 0));
+        counter.append(quarters.valueAt(i, 1));
+    }
+    // Power is repeated
+    QCOMPARE(power, QVector<double>({100, 100, 100, 100, 200, 200, 200, 200, 300, 300, 300, 300, 400, 400, 400, 400}));
+    // Counters grow towards the coarse value, unless there is no previous sample to start from
+    QCOMPARE(counter, QVector<double>({10, 10, 10, 10, 11, 12, 13, 14, 16, 18, 20, 22, 30, 30, 30, 30}));
+
+    // Days over the DST switch get 23 and 25 hours
+    EnergyLogStore days(2);
+    days.append(local(2021, 3, 28), {1, 1});
+    days.append(local(2021, 10, 31), {1, 1});
+    EnergyLogStore dayHours = EnergyLogsPyramid::upsample(days, EnergyLogs::SampleRate1Day, EnergyLogs::SampleRate1Hour, m_aggregations);
+    QCOMPARE(dayHours.count(), 23 + 25);
+    QCOMPARE(dayHours.timestampAt(22), local(2021, 3, 28, 23, 0));
+    QCOMPARE(dayHours.timestampAt(23), local(2021, 10, 31));
+}
+
+void TestEnergyLogsPyramid::upsampleLimits()
+{
+    qint64 start = local(2021, 6, 1);
+    EnergyLogStore hours = samples(start, start + 24 * 3600, EnergyLogs::SampleRate1Hour);
+
+    // Only the coarse buckets touching the window
+    EnergyLogStore window = EnergyLogsPyramid::upsample(hours, EnergyLogs::SampleRate1Hour, EnergyLogs::SampleRate15Mins, m_aggregations, start + 3600 + 1200, start + 2 * 3600 + 600);
+    QCOMPARE(window.count(), 8);
+    QCOMPARE(window.timestampAt(0), start + 3600);
+    QCOMPARE(window.lastTimestamp(), start + 2 * 3600 + 2700);
+
+    // A month of days spread over minutes stops at the limit, in whole days
+    EnergyLogStore days = samples(start, local(2021, 7, 1), EnergyLogs::SampleRate1Day);
+    EnergyLogStore minutes = EnergyLogsPyramid::upsample(days, EnergyLogs::SampleRate1Day, EnergyLogs::SampleRate1Min, m_aggregations);
+    QVERIFY(minutes.count() <= EnergyLogsPyramid::MaxPreviewSamples);
+    QCOMPARE(minutes.count(), EnergyLogsPyramid::MaxPreviewSamples / 1440 * 1440);
+    QCOMPARE(minutes.firstTimestamp(), start);
+}
+
+void TestEnergyLogsPyramid::liveLevels()
+{
+    QUuid thingId = QUuid::createUuid();
+    qint64 start = local(2021, 6, 1);
+
+    EnergyLogRanges *ranges = new EnergyLogRanges();
+    EnergyLogStore *entries = new EnergyLogStore(samples(start, start + 3600, EnergyLogs::SampleRate15Mins, ranges));
+    m_pyramid->attach(EnergyLogsRouter::LogTypeThingPower, thingId, EnergyLogs::SampleRate15Mins, entries, ranges);
+    QCOMPARE(m_pyramid->levelCount(), 1);
+    // Read in place, nothing copied
+    QCOMPARE(m_pyramid->cachedBytes(), 0ll);
+
+    // Samples arriving for the model are seen right away
+    entries->append(start + 3600, {4, 5});
+    ranges->add(start + 3600, start + 3600);
+    EnergyLogRanges lookedUpRanges;
+    EnergyLogStore lookedUp = m_pyramid->lookup(EnergyLogsRouter::LogTypeThingPower, thingId, EnergyLogs::SampleRate15Mins, &lookedUpRanges);
+    QCOMPARE(lookedUp.count(), 5);
+    QCOMPARE(lookedUpRanges.ranges(), ranges->ranges());
+
+    // Loading from the disk cache doesn't replace what the model shows
+    m_pyramid->update(EnergyLogsRouter::LogTypeThingPower, thingId, EnergyLogs::SampleRate15Mins, EnergyLogStore(2), EnergyLogRanges());
+    QCOMPARE(m_pyramid->lookup(EnergyLogsRouter::LogTypeThingPower, thingId, EnergyLogs::SampleRate15Mins, &lookedUpRanges).count(), 5);
+
+    // The model goes away, a copy stays
+    m_pyramid->detach(entries);
+    delete entries;
+    delete ranges;
+    QVERIFY(m_pyramid->cachedBytes() > 0);
+    lookedUp = m_pyramid->lookup(EnergyLogsRouter::LogTypeThingPower, thingId, EnergyLogs::SampleRate15Mins, &lookedUpRanges);
+    QCOMPARE(lookedUp.count(), 5);
+    QCOMPARE(lookedUp.lastTimestamp(), start + 3600);
+    QCOMPARE(lookedUpRanges.ranges().count(), 1);
+
+    // Unknown stores are ignored
+    EnergyLogStore other;
+    m_pyramid->detach(&other);
+    QCOMPARE(m_pyramid->levelCount(), 1);
+}
+
+void TestEnergyLogsPyramid::eviction()
+{
+    // Three levels of about 7 MB each, two fit
+    qint64 start = local(2021, 6, 1);
+    EnergyLogRanges ranges;
+    EnergyLogStore entries = samples(start, start + 300000 * 60, EnergyLogs::SampleRate1Min, &ranges);
+    QUuid first = QUuid::createUuid();
+    QUuid second = QUuid::createUuid();
+    QUuid third = QUuid::createUuid();
+    EnergyLogRanges lookedUpRanges;
+
+    m_pyramid->update(EnergyLogsRouter::LogTypeThingPower, first, EnergyLogs::SampleRate1Min, entries, ranges);
+    m_pyramid->update(EnergyLogsRouter::LogTypeThingPower, second, EnergyLogs::SampleRate1Min, entries, ranges);
+    QCOMPARE(m_pyramid->levelCount(), 2);
+    // Using the first one makes the second one the least recently used
+    QVERIFY(!m_pyramid->lookup(EnergyLogsRouter::LogTypeThingPower, first, EnergyLogs::SampleRate1Min, &lookedUpRanges).isEmpty());
+    m_pyramid->update(EnergyLogsRouter::LogTypeThingPower, third, EnergyLogs::SampleRate1Min, entries, ranges);
+    QCOMPARE(m_pyramid->levelCount(), 2);
+    QVERIFY(m_pyramid->cachedBytes() <= EnergyLogsPyramid::MaxCachedBytes);
+    QVERIFY(!m_pyramid->lookup(EnergyLogsRouter::LogTypeThingPower, first, EnergyLogs::SampleRate1Min, &lookedUpRanges).isEmpty());
+    QVERIFY(m_pyramid->lookup(EnergyLogsRouter::LogTypeThingPower, second, EnergyLogs::SampleRate1Min, &lookedUpRanges).isEmpty());
+    QVERIFY(!m_pyramid->lookup(EnergyLogsRouter::LogTypeThingPower, third, EnergyLogs::SampleRate1Min, &lookedUpRanges).isEmpty());
+
+    // Levels a model shows are neither counted nor dropped
+    m_pyramid->clear();
+    EnergyLogStore live = entries;
+    m_pyramid->attach(EnergyLogsRouter::LogTypePowerBalance, QUuid(), EnergyLogs::SampleRate1Min, &live, &ranges);
+    m_pyramid->update(EnergyLogsRouter::LogTypeThingPower, first, EnergyLogs::SampleRate1Min, entries, ranges);
+    m_pyramid->update(EnergyLogsRouter::LogTypeThingPower, second, EnergyLogs::SampleRate1Min, entries, ranges);
+    m_pyramid->update(EnergyLogsRouter::LogTypeThingPower, third, EnergyLogs::SampleRate1Min, entries, ranges);
+    QCOMPARE(m_pyramid->levelCount(), 3);
+    QVERIFY(!m_pyramid->lookup(EnergyLogsRouter::LogTypePowerBalance, QUuid(), EnergyLogs::SampleRate1Min, &lookedUpRanges).isEmpty());
+    m_pyramid->detach(&live);
+}
+
+void TestEnergyLogsPyramid::aggregateFallback()
+{
+    QUuid thingId = QUuid::createUuid();
+    qint64 start = local(2021, 6, 1);
+    EnergyLogRanges ranges;
+    EnergyLogStore quarters = samples(start, start + 24 * 3600, EnergyLogs::SampleRate15Mins, &ranges);
+    EnergyLogRanges dayRanges;
+    EnergyLogStore days = samples(start, start + 7 * 24 * 3600, EnergyLogs::SampleRate1Day, &dayRanges);
+    m_pyramid->update(EnergyLogsRouter::LogTypeThingPower, thingId, EnergyLogs::SampleRate15Mins, quarters, ranges);
+    m_pyramid->update(EnergyLogsRouter::LogTypeThingPower, thingId, EnergyLogs::SampleRate1Day, days, dayRanges);
+
+    // Zooming out, the finer level is aggregated
+    EnergyLogStore hours = m_pyramid->aggregate(EnergyLogsRouter::LogTypeThingPower, thingId, EnergyLogs::SampleRate1Hour, m_aggregations);
+    QCOMPARE(hours.count(), 24);
+
+    // Zooming in past the finest level, the coarse samples are shown until the fine ones are there
+    EnergyLogStore minutes = m_pyramid->aggregate(EnergyLogsRouter::LogTypeThingPower, thingId, EnergyLogs::SampleRate1Min, m_aggregations, start + 3600, start + 2 * 3600 - 1);
+    QCOMPARE(minutes.count(), 60);
+    QCOMPARE(minutes.firstTimestamp(), start + 3600);
+    QCOMPARE(minutes.valueAt(0, 0), 4.0);
+
+    // Nothing for other things
+    QVERIFY(m_pyramid->aggregate(EnergyLogsRouter::LogTypeThingPower, QUuid::createUuid(), EnergyLogs::SampleRate1Hour, m_aggregations).isEmpty());
+}
+
+int main(int argc, char *argv[])
+{
+    // Bucketing follows local time, test it in a zone with DST
+    qputenv("TZ", "Europe/Vienna");
+    tzset();
+    // Engine and NymeaConnection want a QGuiApplication
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QGuiApplication app(argc, argv);
+    TestEnergyLogsPyramid test;
+    return QTest::qExec(&test, argc, argv);
+}
+
+#include "tst_energylogspyramid.moc"
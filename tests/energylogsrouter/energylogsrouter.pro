@@ -0,0 +1,5 @@
+TARGET = tst_energylogsrouter
+
+include(../unittests.pri)
+
+SOURCES += tst_energylogsrouter.cpp
@@ -0,0 +1,211 @@
+#include <QtTest>
+#include <QGuiApplication>
+
+#include "engine.h"
+#include "jsonrpc/jsonrpcclient.h"
+#include "connection/nymeahost.h"
+#include "energy/energylogsrouter.h"
+#include "energy/thingpowerlogs.h"
+#include "energy/powerbalancelogs.h"
+
+class TestEnergyLogsRouter: public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void routing();
+    void notLive();
+    void resubscribe();
+
+    void benchmarkNotifications_data();
+    void benchmarkNotifications();
+
+private:
+    ThingPowerLogs *createLogs(const QUuid &thingId, EnergyLogs::SampleRate sampleRate, QObject *parent);
+    void sendThingPowerEntry(const QUuid &thingId, const QString &sampleRate);
+    void sendPowerBalanceEntry(const QString &sampleRate);
+
+    Engine *m_engine = nullptr;
+    qint64 m_timestamp = 0;
+};
+
+void TestEnergyLogsRouter::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+    QLoggingCategory::setFilterRules("NymeaConnection.warning=false");
+
+    // Subscriptions are only made if the server announces the Energy experience in the handshake
+    m_engine = new Engine(this);
+    NymeaHost *host = new NymeaHost(this);
+    host->setUuid(QUuid::createUuid());
+    m_engine->jsonRpcClient()->connectToHost(host);
+    QVariantMap hello;
+    hello.insert("uuid", host->uuid());
+    hello.insert("name", "test");
+    hello.insert("protocol version", "8.0");
+    hello.insert("experiences", QVariantList({QVariantMap({{"name", "Energy"}, {"version", "1.0"}})}));
+    QVERIFY(QMetaObject::invokeMethod(m_engine->jsonRpcClient(), "helloReply", Q_ARG(int, 0), Q_ARG(QVariantMap, hello)));
+    QCOMPARE(m_engine->jsonRpcClient()->experiences().value("Energy").toString(), QString("1.0"));
+
+    m_timestamp = QDateTime::currentSecsSinceEpoch();
+}
+
+ThingPowerLogs *TestEnergyLogsRouter::createLogs(const QUuid &thingId, EnergyLogs::SampleRate sampleRate, QObject *parent)
+{
+    ThingPowerLogs *logs = new ThingPowerLogs(parent);
+    logs->setThingId(thingId);
+    logs->setSampleRate(sampleRate);
+    logs->setEngine(m_engine);
+    return logs;
+}
+
+void TestEnergyLogsRouter::sendThingPowerEntry(const QUuid &thingId, const QString &sampleRate)
+{
+    // Every entry needs a new timestamp, known samples are skipped
+    m_timestamp += 60;
+    QVariantMap entry({{"timestamp", m_timestamp}, {"thingId", thingId}, {"currentPower", 100.5}, {"totalConsumption", 12.5}, {"totalProduction", 0}});
+    QVariantMap notification({{"notification", "Energy.ThingPowerLogEntryAdded"}, {"params", QVariantMap({{"sampleRate", sampleRate}, {"thingPowerLogEntry", entry}})}});
+    QMetaObject::invokeMethod(EnergyLogsRouter::forEngine(m_engine), "notificationReceived", Q_ARG(QVariantMap, notification));
+}
+
+void TestEnergyLogsRouter::sendPowerBalanceEntry(const QString &sampleRate)
+{
+    m_timestamp += 60;
+    QVariantMap entry({{"timestamp", m_timestamp}, {"consumption", 500}, {"production", 200}, {"acquisition", 300}, {"storage", 0}});
+    QVariantMap notification({{"notification", "Energy.PowerBalanceLogEntryAdded"}, {"params", QVariantMap({{"sampleRate", sampleRate}, {"powerBalanceLogEntry", entry}})}});
+    QMetaObject::invokeMethod(EnergyLogsRouter::forEngine(m_engine), "notificationReceived", Q_ARG(QVariantMap, notification));
+}
+
+void TestEnergyLogsRouter::routing()
+{
+    QObject parent;
+    QUuid thing1 = QUuid::createUuid();
+    QUuid thing2 = QUuid::createUuid();
+    ThingPowerLogs *thing1Logs = createLogs(thing1, EnergyLogs::SampleRate15Mins, &parent);
+    ThingPowerLogs *thing1MinuteLogs = createLogs(thing1, EnergyLogs::SampleRate1Min, &parent);
+    ThingPowerLogs *thing2Logs = createLogs(thing2, EnergyLogs::SampleRate15Mins, &parent);
+    ThingPowerLogs *otherThing1Logs = createLogs(thing1, EnergyLogs::SampleRate15Mins, &parent);
+    PowerBalanceLogs *balanceLogs = new PowerBalanceLogs(&parent);
+    balanceLogs->setEngine(m_engine);
+
+    sendThingPowerEntry(thing1, "SampleRate15Mins");
+    QCOMPARE(thing1Logs->rowCount(), 1);
+    QCOMPARE(otherThing1Logs->rowCount(), 1);
+    QCOMPARE(thing1MinuteLogs->rowCount(), 0);
+    QCOMPARE(thing2Logs->rowCount(), 0);
+    QCOMPARE(balanceLogs->rowCount(), 0);
+    QCOMPARE(thing1Logs->get(0)->timestamp(), QDateTime::fromSecsSinceEpoch(m_timestamp));
+
+    sendThingPowerEntry(thing1, "SampleRate1Min");
+    QCOMPARE(thing1MinuteLogs->rowCount(), 1);
+    QVERIFY(thing1MinuteLogs->liveEntry());
+    QCOMPARE(thing1MinuteLogs->liveEntry()->currentPower(), 100.5);
+    QCOMPARE(thing1Logs->rowCount(), 1);
+
+    sendPowerBalanceEntry("SampleRate15Mins");
+    sendPowerBalanceEntry("SampleRate1Hour");
+    QCOMPARE(balanceLogs->rowCount(), 1);
+    QCOMPARE(thing1Logs->rowCount(), 1);
+    QCOMPARE(thing2Logs->rowCount(), 0);
+
+    // Notifications for things nobody is interested in are fine
+    sendThingPowerEntry(QUuid::createUuid(), "SampleRate15Mins");
+    QCOMPARE(thing1Logs->rowCount(), 1);
+    QCOMPARE(thing2Logs->rowCount(), 0);
+}
+
+void TestEnergyLogsRouter::notLive()
+{
+    QObject parent;
+    QUuid thingId = QUuid::createUuid();
+    ThingPowerLogs *logs = createLogs(thingId, EnergyLogs::SampleRate15Mins, &parent);
+    logs->setLive(false);
+    sendThingPowerEntry(thingId, "SampleRate15Mins");
+    QCOMPARE(logs->rowCount(), 0);
+
+    logs->setLive(true);
+    sendThingPowerEntry(thingId, "SampleRate15Mins");
+    QCOMPARE(logs->rowCount(), 1);
+}
+
+void TestEnergyLogsRouter::resubscribe()
+{
+    QUuid thing1 = QUuid::createUuid();
+    QUuid thing2 = QUuid::createUuid();
+    ThingPowerLogs *logs = createLogs(thing1, EnergyLogs::SampleRate15Mins, nullptr);
+    ThingPowerLogs *other = createLogs(thing1, EnergyLogs::SampleRate15Mins, nullptr);
+
+    sendThingPowerEntry(thing1, "SampleRate15Mins");
+    QCOMPARE(logs->rowCount(), 1);
+
+    // Switching the thing drops the samples of the old one and only the new one is delivered
+    logs->setThingId(thing2);
+    QCOMPARE(logs->rowCount(), 0);
+    sendThingPowerEntry(thing1, "SampleRate15Mins");
+    QCOMPARE(logs->rowCount(), 0);
+    sendThingPowerEntry(thing2, "SampleRate15Mins");
+    QCOMPARE(logs->rowCount(), 1);
+
+    // There's nothing finer to aggregate 1 minute samples from, so this starts out empty
+    logs->setSampleRate(EnergyLogs::SampleRate1Min);
+    QCOMPARE(logs->rowCount(), 0);
+    sendThingPowerEntry(thing2, "SampleRate15Mins");
+    QCOMPARE(logs->rowCount(), 0);
+    sendThingPowerEntry(thing2, "SampleRate1Min");
+    QCOMPARE(logs->rowCount(), 1);
+
+    // Destroyed models unsubscribe, the others sharing the key still get the entries
+    delete logs;
+    sendThingPowerEntry(thing2, "SampleRate1Min");
+    int count = other->rowCount();
+    sendThingPowerEntry(thing1, "SampleRate15Mins");
+    QCOMPARE(other->rowCount(), count + 1);
+    delete other;
+    sendThingPowerEntry(thing1, "SampleRate15Mins");
+}
+
+void TestEnergyLogsRouter::benchmarkNotifications_data()
+{
+    QTest::addColumn<int>("subscriberCount");
+
+    QTest::newRow("1 subscriber") << 1;
+    QTest::newRow("10 subscribers") << 10;
+    QTest::newRow("50 subscribers") << 50;
+    QTest::newRow("200 subscribers") << 200;
+}
+
+void TestEnergyLogsRouter::benchmarkNotifications()
+{
+    QFETCH(int, subscriberCount);
+
+    // An energy overview: one model per consumer
+    QObject parent;
+    QList<QUuid> thingIds;
+    for (int i = 0; i < subscriberCount; i++) {
+        thingIds.append(QUuid::createUuid());
+        createLogs(thingIds.last(), EnergyLogs::SampleRate1Min, &parent);
+    }
+
+    // The same amount of notifications, each relevant for one of the models. The time per run
+    // should not depend on the number of subscribers.
+    QBENCHMARK {
+        for (int i = 0; i < 1000; i++) {
+            sendThingPowerEntry(thingIds.at(i % thingIds.count()), "SampleRate1Min");
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    // Engine and NymeaConnection want a QGuiApplication
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QGuiApplication app(argc, argv);
+    TestEnergyLogsRouter test;
+    return QTest::qExec(&test, argc, argv);
+}
+
+#include "tst_energylogsrouter.moc"
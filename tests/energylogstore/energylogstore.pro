@@ -0,0 +1,5 @@
+TARGET = tst_energylogstore
+
+include(../unittests.pri)
+
+SOURCES += tst_energylogstore.cpp
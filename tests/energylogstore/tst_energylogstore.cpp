@@ -0,0 +1,294 @@
+#include <QtTest>
+
+#include "energy/energylogstore.h"
+#include "energy/powerbalancelogs.h"
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+class TestEnergyLogStore: public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void appendAndMerge();
+    void lookups();
+
+    void benchmarkIndexOf_data();
+    void benchmarkIndexOf();
+    void benchmarkGet_data();
+    void benchmarkGet();
+    void benchmarkMemory_data();
+    void benchmarkMemory();
+
+private:
+    QVariantMap logsReply(int count);
+    PowerBalanceLogs *createLogs(const QVariantMap &reply, QObject *parent);
+    QList<EnergyLogEntry*> createEntryList(const QVariantMap &reply);
+    int listIndexOf(const QList<EnergyLogEntry*> &list, const QDateTime &timestamp) const;
+    qint64 heapUsage() const;
+
+    // 15 minute samples
+    const int m_sampleRate = 15;
+    const qint64 m_start = 1600000000 - 1600000000 % 900;
+};
+
+void TestEnergyLogStore::initTestCase()
+{
+    QLoggingCategory::setFilterRules("EnergyLogs.debug=false");
+}
+
+QVariantMap TestEnergyLogStore::logsReply(int count)
+{
+    QVariantList entries;
+    for (int i = 0; i < count; i++) {
+        QVariantMap entry;
+        entry.insert("timestamp", m_start + static_cast<qint64>(i) * m_sampleRate * 60);
+        entry.insert("consumption", 500 + i % 300);
+        entry.insert("production", i % 96 < 48 ? 0 : 1500 - i % 48);
+        entry.insert("acquisition", 100 - i % 200);
+        entry.insert("storage", i % 50 - 25);
+        entry.insert("totalConsumption", i * 0.125);
+        entry.insert("totalProduction", i * 0.1);
+        entry.insert("totalAcquisition", i * 0.05);
+        entry.insert("totalReturn", i * 0.025);
+        entries.append(entry);
+    }
+    return QVariantMap({{"powerBalanceLogEntries", entries}});
+}
+
+PowerBalanceLogs *TestEnergyLogStore::createLogs(const QVariantMap &reply, QObject *parent)
+{
+    // Without an engine nothing is fetched, the reply is handed in as if it was one
+    PowerBalanceLogs *logs = new PowerBalanceLogs(parent);
+    QMetaObject::invokeMethod(logs, "getLogsResponse", Q_ARG(int, -1), Q_ARG(QVariantMap, reply));
+    return logs;
+}
+
+QList<EnergyLogEntry*> TestEnergyLogStore::createEntryList(const QVariantMap &reply)
+{
+    // One QObject per sample, like the models kept them before the columnar store
+    QList<EnergyLogEntry*> list;
+    foreach (const QVariant &variant, reply.value("powerBalanceLogEntries").toList()) {
+        QVariantMap map = variant.toMap();
+        list.append(new PowerBalanceLogEntry(QDateTime::fromSecsSinceEpoch(map.value("timestamp").toLongLong()),
+                                             map.value("consumption").toDouble(), map.value("production").toDouble(),
+                                             map.value("acquisition").toDouble(), map.value("storage").toDouble(),
+                                             map.value("totalConsumption").toDouble(), map.value("totalProduction").toDouble(),
+                                             map.value("totalAcquisition").toDouble(), map.value("totalReturn").toDouble(), nullptr));
+    }
+    return list;
+}
+
+int TestEnergyLogStore::listIndexOf(const QList<EnergyLogEntry*> &list, const QDateTime &timestamp) const
+{
+    // The lookup EnergyLogs::indexOf() did on the list: guess from the sample rate, then check the neighbours
+    if (list.isEmpty()) {
+        return -1;
+    }
+    QDateTime first = list.first()->timestamp();
+    int index = qRound(1.0 * first.secsTo(timestamp) / (m_sampleRate * 60));
+    if (index < 0 || index >= list.count()) {
+        return -1;
+    }
+    QDateTime found = list.at(index)->timestamp();
+    QDateTime previous = index > 0 ? list.at(index - 1)->timestamp() : found;
+    QDateTime next = index < list.count() - 1 ? list.at(index + 1)->timestamp() : found;
+    qint64 diffToFound = qAbs(timestamp.secsTo(found));
+    if (qAbs(timestamp.secsTo(previous)) < diffToFound) {
+        return index - 1;
+    }
+    if (qAbs(timestamp.secsTo(next)) < diffToFound) {
+        return index + 1;
+    }
+    return index;
+}
+
+qint64 TestEnergyLogStore::heapUsage() const
+{
+#if defined(__GLIBC__) && __GLIBC_PREREQ(2, 33)
+    return static_cast<qint64>(mallinfo2().uordblks);
+#elif defined(__GLIBC__)
+    return mallinfo().uordblks;
+#else
+    return -1;
+#endif
+}
+
+void TestEnergyLogStore::appendAndMerge()
+{
+    EnergyLogStore store(2);
+    store.append(100, {1, 10});
+    store.append(300, {3, 30});
+    QCOMPARE(store.count(), 2);
+    QCOMPARE(store.valueAt(1, 1), 30.0);
+
+    // Merging keeps what's there for timestamps present in both
+    EnergyLogStore other(2);
+    other.append(0, {0, 0});
+    other.append(200, {2, 20});
+    other.append(300, {-1, -1});
+    other.append(400, {4, 40});
+    store.merge(other);
+    QCOMPARE(store.timestamps(), QVector<qint64>({0, 100, 200, 300, 400}));
+    QCOMPARE(store.column(0), QVector<double>({0, 1, 2, 3, 4}));
+    QCOMPARE(store.column(1), QVector<double>({0, 10, 20, 30, 40}));
+
+    EnergyLogStore middle = store.mid(1, 3);
+    QCOMPARE(middle.firstTimestamp(), Q_INT64_C(100));
+    QCOMPARE(middle.lastTimestamp(), Q_INT64_C(300));
+    QCOMPARE(middle.columnCount(), 2);
+}
+
+void TestEnergyLogStore::lookups()
+{
+    QObject parent;
+    QVariantMap reply = logsReply(1000);
+    PowerBalanceLogs *logs = createLogs(reply, &parent);
+    QList<EnergyLogEntry*> list = createEntryList(reply);
+    QCOMPARE(logs->rowCount(), list.count());
+
+    // Both find the same samples, also when asked for a time in between two of them
+    for (int i = 0; i < list.count(); i += 7) {
+        QDateTime timestamp = list.at(i)->timestamp().addSecs(i % 3 == 0 ? 0 : i % 3 == 1 ? 400 : -400);
+        QCOMPARE(logs->indexOf(timestamp), listIndexOf(list, timestamp));
+        QCOMPARE(logs->get(logs->indexOf(timestamp))->timestamp(), list.at(i)->timestamp());
+    }
+    QCOMPARE(logs->indexOf(list.first()->timestamp().addSecs(-3600)), -1);
+    QCOMPARE(logs->indexOf(list.last()->timestamp().addSecs(3600)), -1);
+    QCOMPARE(qobject_cast<PowerBalanceLogEntry*>(logs->get(10))->consumption(), 510.0);
+    QCOMPARE(logs->get(10), logs->get(10));
+    qDeleteAll(list);
+}
+
+void TestEnergyLogStore::benchmarkIndexOf_data()
+{
+    QTest::addColumn<bool>("list");
+
+    QTest::newRow("QList<EnergyLogEntry*>") << true;
+    QTest::newRow("EnergyLogStore") << false;
+}
+
+void TestEnergyLogStore::benchmarkIndexOf()
+{
+    QFETCH(bool, list);
+
+    // A chart looking up every sample of a 10k sample series, e.g. for the tooltip while dragging across it
+    QObject parent;
+    QVariantMap reply = logsReply(10000);
+    PowerBalanceLogs *logs = createLogs(reply, &parent);
+    QList<EnergyLogEntry*> entries = createEntryList(reply);
+    QList<QDateTime> timestamps;
+    for (int i = 0; i < entries.count(); i++) {
+        timestamps.append(entries.at(i)->timestamp().addSecs(i % 2 == 0 ? 0 : 300));
+    }
+
+    int found = 0;
+    QBENCHMARK {
+        found = 0;
+        foreach (const QDateTime &timestamp, timestamps) {
+            found += (list ? listIndexOf(entries, timestamp) : logs->indexOf(timestamp)) >= 0;
+        }
+    }
+    QCOMPARE(found, timestamps.count());
+    qDeleteAll(entries);
+}
+
+void TestEnergyLogStore::benchmarkGet_data()
+{
+    QTest::addColumn<bool>("list");
+    QTest::addColumn<bool>("firstAccess");
+
+    QTest::newRow("QList<EnergyLogEntry*>") << true << false;
+    QTest::newRow("EnergyLogStore, wrappers created") << false << true;
+    QTest::newRow("EnergyLogStore, wrappers cached") << false << false;
+}
+
+void TestEnergyLogStore::benchmarkGet()
+{
+    QFETCH(bool, list);
+    QFETCH(bool, firstAccess);
+
+    // Reading a value of every sample through the QML facing objects
+    QObject parent;
+    QVariantMap reply = logsReply(10000);
+    QList<EnergyLogEntry*> entries = createEntryList(reply);
+    PowerBalanceLogs *logs = createLogs(reply, &parent);
+    if (!list && !firstAccess) {
+        for (int i = 0; i < logs->rowCount(); i++) {
+            logs->get(i);
+        }
+    }
+
+    double sum = 0;
+    auto readAll = [&]() {
+        sum = 0;
+        for (int i = 0; i < entries.count(); i++) {
+            EnergyLogEntry *entry = list ? entries.at(i) : logs->get(i);
+            sum += static_cast<PowerBalanceLogEntry*>(entry)->consumption();
+        }
+    };
+    if (firstAccess) {
+        // Wrappers stay cached after the first get(), so only the first round creates them
+        QBENCHMARK_ONCE {
+            readAll();
+        }
+    } else {
+        QBENCHMARK {
+            readAll();
+        }
+    }
+    QVERIFY(sum > 0);
+    qDeleteAll(entries);
+}
+
+void TestEnergyLogStore::benchmarkMemory_data()
+{
+    QTest::addColumn<int>("storage");
+
+    QTest::newRow("QList<EnergyLogEntry*>") << 0;
+    QTest::newRow("EnergyLogStore") << 1;
+    QTest::newRow("PowerBalanceLogs") << 2;
+}
+
+void TestEnergyLogStore::benchmarkMemory()
+{
+    QFETCH(int, storage);
+
+    if (heapUsage() < 0) {
+        QSKIP("Heap usage can only be measured with glibc");
+    }
+
+    // Bytes per 10k power balance samples. The model row includes its range aggregates on top of the store.
+    QVariantMap reply = logsReply(10000);
+    QList<QVariantMap> maps;
+    foreach (const QVariant &entry, reply.value("powerBalanceLogEntries").toList()) {
+        maps.append(entry.toMap());
+    }
+
+    QObject parent;
+    qint64 before = heapUsage();
+    QList<EnergyLogEntry*> list;
+    EnergyLogStore store;
+    if (storage == 0) {
+        list = createEntryList(reply);
+    } else if (storage == 1) {
+        store = EnergyLogStore(PowerBalanceLogs::ColumnCount);
+        foreach (const QVariantMap &map, maps) {
+            PowerBalanceLogs::unpackEntry(map, &store);
+        }
+    } else {
+        PowerBalanceLogs *logs = createLogs(reply, &parent);
+        QCOMPARE(logs->rowCount(), 10000);
+    }
+    qint64 used = heapUsage() - before;
+    qDeleteAll(list);
+
+    QTest::setBenchmarkResult(used, QTest::BytesAllocated);
+}
+
+QTEST_GUILESS_MAIN(TestEnergyLogStore)
+#include "tst_energylogstore.moc"
@@ -0,0 +1,5 @@
+TARGET = tst_jsonrpccborcodec
+
+include(../unittests.pri)
+
+SOURCES += tst_jsonrpccborcodec.cpp
@@ -0,0 +1,178 @@
+#include <QtTest>
+#include <QtEndian>
+#include <QJsonDocument>
+
+#include "jsonrpc/jsonrpccborcodec.h"
+
+class TestJsonRpcCborCodec: public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void roundtrip_data();
+    void roundtrip();
+    void keyDictionary();
+    void uuidKeys();
+    void lengthPrefix();
+    void invalidData();
+    void encodedSize();
+
+    void benchmarkDecode_data();
+    void benchmarkDecode();
+
+private:
+    QVariantMap getThingsReply(int thingCount);
+    QStringList dictionary();
+};
+
+QVariantMap TestJsonRpcCborCodec::getThingsReply(int thingCount)
+{
+    QVariantList things;
+    for (int i = 0; i < thingCount; i++) {
+        QVariantList states;
+        for (int j = 0; j < 10; j++) {
+            states.append(QVariantMap({{"stateTypeId", QUuid::createUuid().toString()}, {"value", j % 2 == 0 ? QVariant(j * 1.5) : QVariant(true)}}));
+        }
+        QVariantMap thing;
+        thing.insert("id", QUuid::createUuid().toString());
+        thing.insert("thingClassId", QUuid::createUuid().toString());
+        thing.insert("name", QString("Thing %1").arg(i));
+        thing.insert("setupStatus", "ThingSetupStatusComplete");
+        thing.insert("params", QVariantList({QVariantMap({{"paramTypeId", QUuid::createUuid().toString()}, {"value", "192.168.0.10"}})}));
+        thing.insert("states", states);
+        things.append(thing);
+    }
+    QVariantMap reply;
+    reply.insert("id", 42);
+    reply.insert("status", "success");
+    reply.insert("params", QVariantMap({{"things", things}}));
+    return reply;
+}
+
+QStringList TestJsonRpcCborCodec::dictionary()
+{
+    return {"id", "status", "params", "things", "thingClassId", "name", "setupStatus", "paramTypeId", "stateTypeId", "states", "value"};
+}
+
+void TestJsonRpcCborCodec::roundtrip_data()
+{
+    QTest::addColumn<QVariantMap>("message");
+
+    QTest::newRow("empty") << QVariantMap();
+    QTest::newRow("scalars") << QVariantMap({{"int", 5}, {"negative", -17}, {"double", 2.25}, {"bool", false}, {"string", "Kitchen"}, {"empty", QString()}});
+    QTest::newRow("nested") << QVariantMap({{"list", QVariantList({1, "two", QVariantMap({{"three", 3}}), QVariantList()})}, {"map", QVariantMap({{"a", QVariantMap({{"b", "c"}})}})}});
+    QTest::newRow("uuid strings") << QVariantMap({{"thingId", QUuid::createUuid().toString()}, {"ids", QVariantList({QUuid::createUuid().toString(), QUuid::createUuid().toString()})}});
+    QTest::newRow("brace strings") << QVariantMap({{"notAnId", "{this is not a uuid at all, 38 chars!}"}, {"short", "{abc}"}});
+    QTest::newRow("uuid in free text") << QVariantMap({{"name", QUuid::createUuid().toString().toUpper()}, {"value", QVariantList({QUuid::createUuid().toString().toUpper()})}});
+    QTest::newRow("get things") << getThingsReply(3);
+}
+
+void TestJsonRpcCborCodec::roundtrip()
+{
+    QFETCH(QVariantMap, message);
+
+    JsonRpcCborCodec codec;
+    bool ok = false;
+    QCOMPARE(codec.decode(codec.encode(message).mid(4), &ok), message);
+    QVERIFY(ok);
+
+    codec.setKeyDictionary(dictionary());
+    QCOMPARE(codec.decode(codec.encode(message).mid(4), &ok), message);
+    QVERIFY(ok);
+}
+
+void TestJsonRpcCborCodec::keyDictionary()
+{
+    QVariantMap message({{"id", 1}, {"status", "success"}, {"unknown", "key"}});
+
+    JsonRpcCborCodec plain;
+    JsonRpcCborCodec codec;
+    codec.setKeyDictionary(dictionary());
+    QVERIFY(codec.encode(message).length() < plain.encode(message).length());
+
+    // A peer without the dictionary can still read the keys it doesn't know
+    QVariantMap decoded = plain.decode(codec.encode(message).mid(4));
+    QCOMPARE(decoded.value("0"), QVariant(1));
+    QCOMPARE(decoded.value("unknown"), QVariant("key"));
+
+    codec.clear();
+    QCOMPARE(codec.encode(message), plain.encode(message));
+}
+
+void TestJsonRpcCborCodec::uuidKeys()
+{
+    JsonRpcCborCodec codec;
+    QString uuid = QUuid::createUuid().toString();
+
+    // Binary only for id fields, lists of ids included
+    QByteArray asId = codec.encode(QVariantMap({{"thingId", uuid}}));
+    QByteArray asIds = codec.encode(QVariantMap({{"thingIds", QVariantList({uuid})}}));
+    QByteArray asText = codec.encode(QVariantMap({{"thingXd", uuid}}));
+    QVERIFY(asId.length() < asText.length());
+    QVERIFY(asIds.length() < asText.length());
+    QVERIFY(codec.encode(QVariantMap({{"name", uuid}})).length() > uuid.length());
+    QCOMPARE(codec.decode(asId.mid(4)).value("thingId"), QVariant(uuid));
+}
+
+void TestJsonRpcCborCodec::lengthPrefix()
+{
+    JsonRpcCborCodec codec;
+    QByteArray frame = codec.encode(getThingsReply(1));
+    QCOMPARE(qFromBigEndian<quint32>(reinterpret_cast<const uchar*>(frame.constData())), static_cast<quint32>(frame.length() - 4));
+}
+
+void TestJsonRpcCborCodec::invalidData()
+{
+    JsonRpcCborCodec codec;
+    bool ok = true;
+    QCOMPARE(codec.decode(QByteArray("\xff\x00\x13", 3), &ok), QVariantMap());
+    QVERIFY(!ok);
+
+    // Valid CBOR, but not a map
+    ok = true;
+    QCOMPARE(codec.decode(QByteArray("\x83\x01\x02\x03", 4), &ok), QVariantMap());
+    QVERIFY(!ok);
+}
+
+void TestJsonRpcCborCodec::encodedSize()
+{
+    QVariantMap reply = getThingsReply(100);
+    JsonRpcCborCodec codec;
+    codec.setKeyDictionary(dictionary());
+
+    int jsonSize = QJsonDocument::fromVariant(reply).toJson(QJsonDocument::Compact).length() + 1;
+    int cborSize = codec.encode(reply).length();
+    QVERIFY2(cborSize < jsonSize, qPrintable(QString("GetThings reply with 100 things: JSON %1 bytes, CBOR %2 bytes").arg(jsonSize).arg(cborSize)));
+}
+
+void TestJsonRpcCborCodec::benchmarkDecode_data()
+{
+    QTest::addColumn<bool>("cbor");
+
+    QTest::newRow("JSON") << false;
+    QTest::newRow("CBOR") << true;
+}
+
+void TestJsonRpcCborCodec::benchmarkDecode()
+{
+    QFETCH(bool, cbor);
+
+    QVariantMap reply = getThingsReply(500);
+    JsonRpcCborCodec codec;
+    codec.setKeyDictionary(dictionary());
+    QByteArray data = cbor ? codec.encode(reply).mid(4) : QJsonDocument::fromVariant(reply).toJson(QJsonDocument::Compact);
+
+    // The same steps JsonRpcClient takes for a received frame
+    QBENCHMARK {
+        QVariantMap message;
+        if (cbor) {
+            message = codec.decode(data);
+        } else {
+            message = QJsonDocument::fromJson(data).toVariant().toMap();
+        }
+        QCOMPARE(message.value("params").toMap().value("things").toList().count(), 500);
+    }
+}
+
+QTEST_GUILESS_MAIN(TestJsonRpcCborCodec)
+#include "tst_jsonrpccborcodec.moc"
@@ -0,0 +1,5 @@
+TARGET = tst_jsonrpcclient
+
+include(../unittests.pri)
+
+SOURCES += tst_jsonrpcclient.cpp
@@ -0,0 +1,439 @@
+#include <QtTest>
+#include <QGuiApplication>
+
+#include "jsonrpc/jsonrpcclient.h"
+#include "connection/nymeaconnection.h"
+#include "connection/nymeahost.h"
+#include "connection/nymeatransportinterface.h"
+
+// Stands in for a server: connects right away and keeps what's sent to it. Replies are fed to the client by the test.
+class StandInTransport: public NymeaTransportInterface
+{
+    Q_OBJECT
+public:
+    StandInTransport(QList<QByteArray> *sent, QObject *parent): NymeaTransportInterface(parent), m_sent(sent) {}
+
+    bool connect(const QUrl &url) override {
+        m_url = url;
+        QTimer::singleShot(0, this, [this](){
+            m_state = ConnectionStateConnected;
+            emit connected();
+        });
+        return true;
+    }
+    QUrl url() const override { return m_url; }
+    void disconnect() override { m_state = ConnectionStateDisconnected; }
+    ConnectionState connectionState() const override { return m_state; }
+    void sendData(const QByteArray &data) override { m_sent->append(data); }
+
+private:
+    QList<QByteArray> *m_sent = nullptr;
+    QUrl m_url;
+    ConnectionState m_state = ConnectionStateDisconnected;
+};
+
+class StandInTransportFactory: public NymeaTransportInterfaceFactory
+{
+public:
+    StandInTransportFactory(QList<QByteArray> *sent): m_sent(sent) {}
+
+    NymeaTransportInterface *createTransport(QObject *parent = nullptr) const override {
+        return new StandInTransport(m_sent, parent);
+    }
+    QStringList supportedSchemes() const override { return {"standin"}; }
+
+private:
+    QList<QByteArray> *m_sent = nullptr;
+};
+
+class Receiver: public QObject
+{
+    Q_OBJECT
+public:
+    Q_INVOKABLE void reply(int commandId, const QVariantMap &params) {
+        replies.insert(commandId, params);
+        order.append(commandId);
+    }
+
+    QHash<int, QVariantMap> replies;
+    QList<int> order;
+};
+
+class TestJsonRpcClient: public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void init();
+
+    void handshakeHold();
+    void priorityOrder();
+    void backgroundWindow();
+    void replaceKey();
+    void transportSwitch();
+    void lostOnDisconnect();
+
+private:
+    void connectStandIn(JsonRpcClient *client, NymeaHost *host);
+    // Answers the hello and the notification status, as the server would at the start of a session
+    void handshake(JsonRpcClient *client, NymeaHost *host);
+    void reply(JsonRpcClient *client, int commandId, const QVariantMap &params = QVariantMap());
+    // Requests sent since the last call, as method and command id. Leaves out the notification status, handshake() takes care of it.
+    QList<QPair<QString, int>> takeSent();
+    QStringList methods(const QList<QPair<QString, int>> &requests);
+
+    QList<QByteArray> m_sent;
+    int m_handled = 0;
+};
+
+void TestJsonRpcClient::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+    QCoreApplication::setOrganizationName("nymea-tests");
+    QCoreApplication::setApplicationName("tst_jsonrpcclient");
+    QLoggingCategory::setFilterRules("NymeaConnection.warning=false\nNymeaConnection.info=false\nJsonRpc.warning=false\nJsonRpc.info=false");
+}
+
+void TestJsonRpcClient::init()
+{
+    m_sent.clear();
+    m_handled = 0;
+}
+
+void TestJsonRpcClient::connectStandIn(JsonRpcClient *client, NymeaHost *host)
+{
+    host->setUuid(QUuid::createUuid());
+    host->setName("stand-in");
+    host->connections()->addConnection(QUrl("standin://localhost"), Connection::BearerTypeLoopback, false, "stand-in");
+
+    NymeaConnection *connection = client->findChild<NymeaConnection*>();
+    QVERIFY(connection);
+    // Owned by the connection
+    connection->registerTransport(new StandInTransportFactory(&m_sent));
+    client->connectToHost(host, host->connections()->get(0));
+
+    // The handshake is the first thing sent
+    QTRY_VERIFY(!m_sent.isEmpty());
+    QCOMPARE(methods(takeSent()), QStringList({"JSONRPC.Hello"}));
+}
+
+void TestJsonRpcClient::handshake(JsonRpcClient *client, NymeaHost *host)
+{
+    QVariantMap hello;
+    hello.insert("uuid", host->uuid());
+    hello.insert("name", "stand-in");
+    hello.insert("protocol version", "8.0");
+    QVERIFY(QMetaObject::invokeMethod(client, "helloReply", Q_ARG(int, 0), Q_ARG(QVariantMap, hello)));
+
+    // Anything queued goes out along with it, that's left for the test to look at
+    for (int i = m_handled; i < m_sent.count(); i++) {
+        QVariantMap request = QJsonDocument::fromJson(m_sent.at(i)).toVariant().toMap();
+        if (request.value("method").toString() == "JSONRPC.SetNotificationStatus") {
+            reply(client, request.value("id").toInt(), QVariantMap({{"namespaces", QStringList()}}));
+            return;
+        }
+    }
+    QFAIL("The notification status has not been set");
+}
+
+void TestJsonRpcClient::reply(JsonRpcClient *client, int commandId, const QVariantMap &params)
+{
+    QVariantMap reply({{"id", commandId}, {"status", "success"}, {"params", params}});
+    QByteArray data = QJsonDocument::fromVariant(reply).toJson(QJsonDocument::Compact) + "\n";
+    QVERIFY(QMetaObject::invokeMethod(client, "dataReceived", Q_ARG(QByteArray, data)));
+}
+
+QList<QPair<QString, int>> TestJsonRpcClient::takeSent()
+{
+    QList<QPair<QString, int>> requests;
+    while (m_handled < m_sent.count()) {
+        QVariantMap request = QJsonDocument::fromJson(m_sent.at(m_handled++)).toVariant().toMap();
+        if (request.value("method").toString() == "JSONRPC.SetNotificationStatus") {
+            continue;
+        }
+        requests.append(qMakePair(request.value("method").toString(), request.value("id").toInt()));
+    }
+    return requests;
+}
+
+QStringList TestJsonRpcClient::methods(const QList<QPair<QString, int>> &requests)
+{
+    QStringList methods;
+    for (int i = 0; i < requests.count(); i++) {
+        methods.append(requests.at(i).first);
+    }
+    return methods;
+}
+
+void TestJsonRpcClient::handshakeHold()
+{
+    NymeaHost host;
+    JsonRpcClient client;
+    connectStandIn(&client, &host);
+
+    // Nothing but the JSONRPC namespace goes out before the handshake is done
+    Receiver receiver;
+    QSignalSpy queueSpy(&client, &JsonRpcClient::sendQueueChanged);
+    int logs = client.sendCommand("Logging.GetLogEntries", QVariantMap(), &receiver, "reply");
+    int things = client.sendCommand("Integrations.GetThings", QVariantMap(), &receiver, "reply");
+    int action = client.sendCommand("Integrations.ExecuteAction", QVariantMap(), &receiver, "reply");
+    int version = client.sendCommand("JSONRPC.Version", QVariantMap(), &receiver, "reply");
+    QCOMPARE(takeSent(), QList<QPair<QString, int>>({qMakePair(QString("JSONRPC.Version"), version)}));
+    QCOMPARE(client.queueDepth(), 3);
+    QCOMPARE(client.inFlightCount(), 0);
+    QCOMPARE(queueSpy.count(), 3);
+
+    // Released in one go once it's done, by priority
+    handshake(&client, &host);
+    QCOMPARE(takeSent(), QList<QPair<QString, int>>({
+                 qMakePair(QString("Integrations.ExecuteAction"), action),
+                 qMakePair(QString("Integrations.GetThings"), things),
+                 qMakePair(QString("Logging.GetLogEntries"), logs)
+             }));
+    QCOMPARE(client.queueDepth(), 0);
+    QCOMPARE(client.inFlightCount(), 3);
+    QVERIFY(queueSpy.count() > 3);
+}
+
+void TestJsonRpcClient::priorityOrder()
+{
+    NymeaHost host;
+    JsonRpcClient client;
+    connectStandIn(&client, &host);
+    handshake(&client, &host);
+    client.setSendWindow(1);
+
+    // One at a time, the first one blocks the window
+    Receiver receiver;
+    int first = client.sendCommand("Integrations.GetThings", QVariantMap(), &receiver, "reply");
+    int background = client.sendCommand("Logging.GetLogEntries", QVariantMap(), &receiver, "reply");
+    int defaultFirst = client.sendCommand("Integrations.GetThingClasses", QVariantMap(), &receiver, "reply");
+    int defaultSecond = client.sendCommand("Integrations.GetPlugins", QVariantMap(), &receiver, "reply");
+    int interactive = client.sendCommand("Integrations.ExecuteAction", QVariantMap(), &receiver, "reply");
+    QCOMPARE(takeSent(), QList<QPair<QString, int>>({qMakePair(QString("Integrations.GetThings"), first)}));
+    QCOMPARE(client.queueDepth(), 4);
+    QCOMPARE(client.inFlightCount(), 1);
+
+    // Each reply frees the window for the most urgent one, first come first served within a priority
+    QList<int> expected({interactive, defaultFirst, defaultSecond, background});
+    int answer = first;
+    foreach (int next, expected) {
+        reply(&client, answer);
+        QList<QPair<QString, int>> sent = takeSent();
+        QCOMPARE(sent.count(), 1);
+        QCOMPARE(sent.first().second, next);
+        answer = next;
+    }
+    reply(&client, answer);
+    QCOMPARE(takeSent().count(), 0);
+    QCOMPARE(client.queueDepth(), 0);
+    QCOMPARE(client.inFlightCount(), 0);
+    QCOMPARE(receiver.order, QList<int>({first, interactive, defaultFirst, defaultSecond, background}));
+}
+
+void TestJsonRpcClient::backgroundWindow()
+{
+    NymeaHost host;
+    JsonRpcClient client;
+    connectStandIn(&client, &host);
+    handshake(&client, &host);
+    QCOMPARE(client.sendWindow(), 8);
+
+    // Background fetches get half of the window
+    Receiver receiver;
+    QList<int> logs;
+    for (int i = 0; i < 10; i++) {
+        logs.append(client.sendCommand("Logging.GetLogEntries", QVariantMap({{"offset", i}}), &receiver, "reply"));
+    }
+    QList<QPair<QString, int>> sent = takeSent();
+    QCOMPARE(sent.count(), 4);
+    QCOMPARE(sent.last().second, logs.at(3));
+    QCOMPARE(client.inFlightCount(), 4);
+    QCOMPARE(client.queueDepth(), 6);
+
+    // The rest stays free for everything else, even with background fetches waiting
+    QList<int> things;
+    for (int i = 0; i < 5; i++) {
+        things.append(client.sendCommand("Integrations.GetThings", QVariantMap({{"index", i}}), &receiver, "reply"));
+    }
+    sent = takeSent();
+    QCOMPARE(methods(sent), QStringList({"Integrations.GetThings", "Integrations.GetThings", "Integrations.GetThings", "Integrations.GetThings"}));
+    QCOMPARE(client.inFlightCount(), 8);
+    QCOMPARE(client.queueDepth(), 7);
+
+    // A finished background fetch makes room for the next one only while the default queue is empty
+    reply(&client, logs.at(0));
+    QCOMPARE(takeSent(), QList<QPair<QString, int>>({qMakePair(QString("Integrations.GetThings"), things.at(4))}));
+    reply(&client, logs.at(1));
+    QCOMPARE(takeSent(), QList<QPair<QString, int>>({qMakePair(QString("Logging.GetLogEntries"), logs.at(4))}));
+
+    // Other replies let background fetches fill up half of the window, but not more
+    reply(&client, things.at(0));
+    QCOMPARE(takeSent(), QList<QPair<QString, int>>({qMakePair(QString("Logging.GetLogEntries"), logs.at(5))}));
+    reply(&client, things.at(1));
+    QCOMPARE(takeSent().count(), 0);
+    QCOMPARE(client.inFlightCount(), 7);
+    QCOMPARE(client.queueDepth(), 4);
+
+    // With a window of one, a background fetch can still go out once nothing else is on the way
+    client.setSendWindow(1);
+    foreach (int commandId, QList<int>({things.at(2), things.at(3), things.at(4), logs.at(2), logs.at(3), logs.at(4)})) {
+        reply(&client, commandId);
+    }
+    QCOMPARE(takeSent().count(), 0);
+    reply(&client, logs.at(5));
+    QCOMPARE(takeSent(), QList<QPair<QString, int>>({qMakePair(QString("Logging.GetLogEntries"), logs.at(6))}));
+    QCOMPARE(client.inFlightCount(), 1);
+    QCOMPARE(client.queueDepth(), 3);
+}
+
+void TestJsonRpcClient::replaceKey()
+{
+    NymeaHost host;
+    JsonRpcClient client;
+    connectStandIn(&client, &host);
+    handshake(&client, &host);
+    client.setSendWindow(1);
+
+    Receiver receiver;
+    int blocking = client.sendCommand("Integrations.GetThings", QVariantMap(), &receiver, "reply");
+    QCOMPARE(takeSent().count(), 1);
+
+    // While waiting, the queued request with the same key is replaced by the newest one
+    int first = client.sendReplaceableCommand("Integrations.ExecuteAction", QVariantMap({{"value", 1}}), "dimmer", &receiver, "reply");
+    int second = client.sendReplaceableCommand("Integrations.ExecuteAction", QVariantMap({{"value", 2}}), "dimmer", &receiver, "reply");
+    int other = client.sendReplaceableCommand("Integrations.ExecuteAction", QVariantMap({{"value", 5}}), "heating", &receiver, "reply");
+    int third = client.sendReplaceableCommand("Integrations.ExecuteAction", QVariantMap({{"value", 3}}), "dimmer", &receiver, "reply");
+    QCOMPARE(client.queueDepth(), 2);
+
+    // The one with the other key keeps its place, the newest one for the dimmer goes to the end
+    reply(&client, blocking);
+    QVERIFY(m_sent.count() > m_handled);
+    QVariantMap request = QJsonDocument::fromJson(m_sent.at(m_handled)).toVariant().toMap();
+    QCOMPARE(takeSent(), QList<QPair<QString, int>>({qMakePair(QString("Integrations.ExecuteAction"), other)}));
+    QCOMPARE(request.value("params").toMap().value("value").toInt(), 5);
+    reply(&client, other, QVariantMap({{"thingError", "ThingErrorNoError"}}));
+    QVERIFY(m_sent.count() > m_handled);
+    request = QJsonDocument::fromJson(m_sent.at(m_handled)).toVariant().toMap();
+    QCOMPARE(takeSent(), QList<QPair<QString, int>>({qMakePair(QString("Integrations.ExecuteAction"), third)}));
+    QCOMPARE(request.value("params").toMap().value("value").toInt(), 3);
+
+    // Everyone who asked gets the reply, under their own id
+    QVariantMap params({{"thingError", "ThingErrorNoError"}, {"value", 3}});
+    reply(&client, third, params);
+    QCOMPARE(receiver.replies.value(first), params);
+    QCOMPARE(receiver.replies.value(second), params);
+    QCOMPARE(receiver.replies.value(third), params);
+    QCOMPARE(receiver.replies.value(other), QVariantMap({{"thingError", "ThingErrorNoError"}}));
+    QCOMPARE(receiver.order.count(), 5);
+    QCOMPARE(client.queueDepth(), 0);
+    QCOMPARE(client.inFlightCount(), 0);
+
+    // Nothing waits any more, a late duplicate reply goes nowhere
+    reply(&client, third, params);
+    QCOMPARE(receiver.order.count(), 5);
+}
+
+void TestJsonRpcClient::transportSwitch()
+{
+    NymeaHost host;
+    JsonRpcClient client;
+    connectStandIn(&client, &host);
+    handshake(&client, &host);
+    QVERIFY(client.connected());
+    NymeaConnection *connection = client.findChild<NymeaConnection*>();
+
+    // Reads can be sent again on another transport, so they don't hold off switching over
+    Receiver receiver;
+    int read = client.sendCommand("Integrations.GetThings", QVariantMap(), &receiver, "reply");
+    QVERIFY(!connection->upgradeHeld());
+    int write = client.sendCommand("Integrations.ExecuteAction", QVariantMap(), &receiver, "reply", 5000);
+    QVERIFY(connection->upgradeHeld());
+    QCOMPARE(takeSent(), QList<QPair<QString, int>>({qMakePair(QString("Integrations.GetThings"), read), qMakePair(QString("Integrations.ExecuteAction"), write)}));
+    reply(&client, write, QVariantMap({{"thingError", "ThingErrorNoError"}}));
+    QVERIFY(!connection->upgradeHeld());
+    QCOMPARE(receiver.replies.value(write), QVariantMap({{"thingError", "ThingErrorNoError"}}));
+
+    // Switching while a write is still on the way loses it
+    int lostWrite = client.sendCommand("Integrations.ExecuteAction", QVariantMap(), &receiver, "reply");
+    QVERIFY(connection->upgradeHeld());
+    QCOMPARE(takeSent().count(), 1);
+
+    // As NymeaConnection does it when switching transports. The session stays up.
+    QSignalSpy connectedSpy(&client, &JsonRpcClient::connectedChanged);
+    QSignalSpy switchedSpy(&client, &JsonRpcClient::transportSwitched);
+    QVERIFY(QMetaObject::invokeMethod(&client, "onInterfaceConnectedChanged", Q_ARG(bool, true)));
+    QCOMPARE(connectedSpy.count(), 0);
+    QVERIFY(client.connected());
+    QVERIFY(!connection->upgradeHeld());
+    QTRY_COMPARE(receiver.replies.value(lostWrite), QVariantMap({{"error", "lost"}}));
+
+    // Nothing but the handshake until it's done
+    QCOMPARE(methods(takeSent()), QStringList({"JSONRPC.Hello"}));
+    QVERIFY(!receiver.replies.contains(read));
+
+    // The read goes out again with its id, ahead of what has been queued meanwhile
+    int queued = client.sendCommand("Integrations.GetThingClasses", QVariantMap(), &receiver, "reply");
+    QCOMPARE(takeSent().count(), 0);
+    handshake(&client, &host);
+    QCOMPARE(takeSent(), QList<QPair<QString, int>>({qMakePair(QString("Integrations.GetThings"), read), qMakePair(QString("Integrations.GetThingClasses"), queued)}));
+    QCOMPARE(switchedSpy.count(), 1);
+    QCOMPARE(connectedSpy.count(), 0);
+
+    reply(&client, read, QVariantMap({{"things", QVariantList()}}));
+    reply(&client, queued, QVariantMap({{"thingClasses", QVariantList()}}));
+    QCOMPARE(receiver.replies.value(read), QVariantMap({{"things", QVariantList()}}));
+    QCOMPARE(receiver.order, QList<int>({write, lostWrite, read, queued}));
+}
+
+void TestJsonRpcClient::lostOnDisconnect()
+{
+    NymeaHost host;
+    JsonRpcClient client;
+    connectStandIn(&client, &host);
+    handshake(&client, &host);
+
+    // Four log pages fill the background window, the fifth waits in the queue
+    Receiver receiver;
+    QList<int> commandIds;
+    for (int i = 0; i < 5; i++) {
+        commandIds.append(client.sendCommand("Logging.GetLogEntries", QVariantMap({{"offset", i}}), &receiver, "reply"));
+    }
+    int write = client.sendCommand("Integrations.ExecuteAction", QVariantMap(), &receiver, "reply");
+    QCOMPARE(takeSent().count(), 5);
+    QCOMPARE(client.queueDepth(), 1);
+    commandIds.append(write);
+
+    // Everyone is told, whether sent or still queued, with or without a deadline
+    QSignalSpy responseSpy(&client, &JsonRpcClient::responseReceived);
+    QVERIFY(QMetaObject::invokeMethod(&client, "onInterfaceConnectedChanged", Q_ARG(bool, false)));
+    QVERIFY(!client.connected());
+    QVERIFY(receiver.replies.isEmpty());
+    QTRY_COMPARE(receiver.replies.count(), commandIds.count());
+    foreach (int commandId, commandIds) {
+        QVERIFY(JsonRpcClient::isLost(receiver.replies.value(commandId)));
+    }
+    QList<int> responses;
+    foreach (const QList<QVariant> &arguments, responseSpy) {
+        responses.append(arguments.at(0).toInt());
+    }
+    foreach (int commandId, commandIds) {
+        QVERIFY(responses.contains(commandId));
+    }
+    QCOMPARE(client.queueDepth(), 0);
+    QCOMPARE(client.inFlightCount(), 0);
+}
+
+int main(int argc, char *argv[])
+{
+    // NymeaConnection wants a QGuiApplication
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QGuiApplication app(argc, argv);
+    TestJsonRpcClient test;
+    return QTest::qExec(&test, argc, argv);
+}
+
+#include "tst_jsonrpcclient.moc"
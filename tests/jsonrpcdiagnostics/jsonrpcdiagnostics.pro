@@ -0,0 +1,5 @@
+TARGET = tst_jsonrpcdiagnostics
+
+include(../unittests.pri)
+
+SOURCES += tst_jsonrpcdiagnostics.cpp
@@ -0,0 +1,278 @@
+#include <QtTest>
+#include <QGuiApplication>
+
+#include "jsonrpc/jsonrpcclient.h"
+#include "jsonrpc/jsonrpcdiagnostics.h"
+#include "connection/nymeaconnection.h"
+#include "connection/nymeahost.h"
+#include "connection/nymeatransportinterface.h"
+
+// Stands in for a server: connects right away and keeps what's sent to it. Replies are fed to the client by the test.
+class StandInTransport: public NymeaTransportInterface
+{
+    Q_OBJECT
+public:
+    StandInTransport(QList<QByteArray> *sent, QObject *parent): NymeaTransportInterface(parent), m_sent(sent) {}
+
+    bool connect(const QUrl &url) override {
+        m_url = url;
+        QTimer::singleShot(0, this, [this](){
+            m_state = ConnectionStateConnected;
+            emit connected();
+        });
+        return true;
+    }
+    QUrl url() const override { return m_url; }
+    void disconnect() override { m_state = ConnectionStateDisconnected; }
+    ConnectionState connectionState() const override { return m_state; }
+    void sendData(const QByteArray &data) override { m_sent->append(data); }
+
+private:
+    QList<QByteArray> *m_sent = nullptr;
+    QUrl m_url;
+    ConnectionState m_state = ConnectionStateDisconnected;
+};
+
+class StandInTransportFactory: public NymeaTransportInterfaceFactory
+{
+public:
+    StandInTransportFactory(QList<QByteArray> *sent): m_sent(sent) {}
+
+    NymeaTransportInterface *createTransport(QObject *parent = nullptr) const override {
+        return new StandInTransport(m_sent, parent);
+    }
+    QStringList supportedSchemes() const override { return {"standin"}; }
+
+private:
+    QList<QByteArray> *m_sent = nullptr;
+};
+
+class Receiver: public QObject
+{
+    Q_OBJECT
+public:
+    Q_INVOKABLE void reply(int commandId, const QVariantMap &params) {
+        replies.insert(commandId, params);
+    }
+
+    QHash<int, QVariantMap> replies;
+};
+
+class TestJsonRpcDiagnostics: public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void model();
+    void timeout();
+    void cancel();
+    void replyLatency();
+
+    void benchmarkCheckTimeouts_data();
+    void benchmarkCheckTimeouts();
+
+private:
+    int row(JsonRpcDiagnostics *diagnostics, const QString &method);
+    void connectStandIn(JsonRpcClient *client, NymeaHost *host, QList<QByteArray> *sent);
+};
+
+void TestJsonRpcDiagnostics::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+    QCoreApplication::setOrganizationName("nymea-tests");
+    QCoreApplication::setApplicationName("tst_jsonrpcdiagnostics");
+    // Requests sent without a connection warn about it
+    QLoggingCategory::setFilterRules("NymeaConnection.warning=false\nNymeaConnection.info=false\nJsonRpc.warning=false");
+}
+
+int TestJsonRpcDiagnostics::row(JsonRpcDiagnostics *diagnostics, const QString &method)
+{
+    for (int i = 0; i < diagnostics->rowCount(); i++) {
+        if (diagnostics->data(diagnostics->index(i), JsonRpcDiagnostics::RoleMethod).toString() == method) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void TestJsonRpcDiagnostics::connectStandIn(JsonRpcClient *client, NymeaHost *host, QList<QByteArray> *sent)
+{
+    host->setUuid(QUuid::createUuid());
+    host->setName("stand-in");
+    host->connections()->addConnection(QUrl("standin://localhost"), Connection::BearerTypeLoopback, false, "stand-in");
+
+    NymeaConnection *connection = client->findChild<NymeaConnection*>();
+    QVERIFY(connection);
+    // Owned by the connection
+    connection->registerTransport(new StandInTransportFactory(sent));
+    client->connectToHost(host, host->connections()->get(0));
+
+    // The handshake is the first thing sent. It's never answered, the JSONRPC namespace goes out anyways.
+    QTRY_VERIFY(!sent->isEmpty());
+    QVERIFY(sent->first().contains("JSONRPC.Hello"));
+}
+
+void TestJsonRpcDiagnostics::model()
+{
+    JsonRpcDiagnostics diagnostics;
+    QSignalSpy countSpy(&diagnostics, &JsonRpcDiagnostics::countChanged);
+    QSignalSpy dataChangedSpy(&diagnostics, &JsonRpcDiagnostics::dataChanged);
+
+    diagnostics.addRequest("Integrations.GetThings", 100);
+    diagnostics.addRequest("Logging.GetLogEntries", 50);
+    diagnostics.addRequest("Logging.GetLogEntries", 60);
+    for (int latency = 1; latency <= 100; latency++) {
+        diagnostics.addReply("Logging.GetLogEntries", latency, 1000);
+    }
+    diagnostics.addTimeout("Logging.GetLogEntries");
+    diagnostics.addCancellation("Logging.GetLogEntries");
+    diagnostics.addCancellation("Energy.GetPowerBalanceLogs");
+
+    QCOMPARE(diagnostics.rowCount(), 3);
+    QCOMPARE(countSpy.count(), 3);
+    QVERIFY(dataChangedSpy.count() > 0);
+
+    int logs = row(&diagnostics, "Logging.GetLogEntries");
+    QModelIndex index = diagnostics.index(logs);
+    QCOMPARE(diagnostics.data(index, JsonRpcDiagnostics::RoleRequests).toInt(), 2);
+    QCOMPARE(diagnostics.data(index, JsonRpcDiagnostics::RoleTimeouts).toInt(), 1);
+    QCOMPARE(diagnostics.data(index, JsonRpcDiagnostics::RoleCancellations).toInt(), 1);
+    QCOMPARE(diagnostics.data(index, JsonRpcDiagnostics::RoleBytesOut).toLongLong(), Q_INT64_C(110));
+    QCOMPARE(diagnostics.data(index, JsonRpcDiagnostics::RoleBytesIn).toLongLong(), Q_INT64_C(100000));
+    int p50 = diagnostics.data(index, JsonRpcDiagnostics::RoleLatencyP50).toInt();
+    int p95 = diagnostics.data(index, JsonRpcDiagnostics::RoleLatencyP95).toInt();
+    int p99 = diagnostics.data(index, JsonRpcDiagnostics::RoleLatencyP99).toInt();
+    QVERIFY2(p50 >= 45 && p50 <= 55, qPrintable(QString::number(p50)));
+    QVERIFY(p50 <= p95);
+    QVERIFY(p95 <= p99);
+
+    // No replies yet, no latency
+    index = diagnostics.index(row(&diagnostics, "Integrations.GetThings"));
+    QCOMPARE(diagnostics.data(index, JsonRpcDiagnostics::RoleLatencyP50).toInt(), -1);
+    QCOMPARE(diagnostics.data(index, JsonRpcDiagnostics::RoleRequests).toInt(), 1);
+
+    diagnostics.clear();
+    QCOMPARE(diagnostics.rowCount(), 0);
+    QCOMPARE(countSpy.count(), 4);
+}
+
+void TestJsonRpcDiagnostics::timeout()
+{
+    // Without a connection requests are sent right away, and never answered
+    JsonRpcClient client;
+    Receiver receiver;
+    int withDeadline = client.sendCommand("Logging.GetLogEntries", QVariantMap(), &receiver, "reply", 100);
+    int withoutDeadline = client.sendCommand("Integrations.ExecuteAction", QVariantMap(), &receiver, "reply");
+
+    QTRY_VERIFY_WITH_TIMEOUT(receiver.replies.contains(withDeadline), 3000);
+    QCOMPARE(receiver.replies.value(withDeadline), QVariantMap({{"error", "lost"}}));
+
+    // A write might still be carried out, so it waits forever
+    QTest::qWait(1500);
+    QVERIFY(!receiver.replies.contains(withoutDeadline));
+
+    JsonRpcDiagnostics *diagnostics = client.diagnostics();
+    QModelIndex index = diagnostics->index(row(diagnostics, "Logging.GetLogEntries"));
+    QCOMPARE(diagnostics->data(index, JsonRpcDiagnostics::RoleTimeouts).toInt(), 1);
+    QCOMPARE(diagnostics->data(index, JsonRpcDiagnostics::RoleRequests).toInt(), 1);
+    index = diagnostics->index(row(diagnostics, "Integrations.ExecuteAction"));
+    QCOMPARE(diagnostics->data(index, JsonRpcDiagnostics::RoleTimeouts).toInt(), 0);
+}
+
+void TestJsonRpcDiagnostics::cancel()
+{
+    NymeaHost host;
+    QList<QByteArray> sent;
+    JsonRpcClient client;
+    connectStandIn(&client, &host, &sent);
+
+    Receiver receiver;
+    int commandId = client.sendCommand("JSONRPC.Version", QVariantMap(), &receiver, "reply", 200);
+    client.cancel(commandId);
+    // Unknown ones are ignored
+    client.cancel(commandId);
+    client.cancel(-42);
+
+    // Neither a late reply nor the deadline reach the caller any more
+    QByteArray reply = QJsonDocument::fromVariant(QVariantMap({{"id", commandId}, {"status", "success"}, {"params", QVariantMap()}})).toJson(QJsonDocument::Compact) + "\n";
+    QMetaObject::invokeMethod(&client, "dataReceived", Q_ARG(QByteArray, reply));
+    QTest::qWait(1500);
+    QVERIFY(receiver.replies.isEmpty());
+
+    JsonRpcDiagnostics *diagnostics = client.diagnostics();
+    QModelIndex index = diagnostics->index(row(diagnostics, "JSONRPC.Version"));
+    QCOMPARE(diagnostics->data(index, JsonRpcDiagnostics::RoleCancellations).toInt(), 1);
+    QCOMPARE(diagnostics->data(index, JsonRpcDiagnostics::RoleTimeouts).toInt(), 0);
+    QCOMPARE(diagnostics->data(index, JsonRpcDiagnostics::RoleLatencyP50).toInt(), -1);
+}
+
+void TestJsonRpcDiagnostics::replyLatency()
+{
+    NymeaHost host;
+    QList<QByteArray> sent;
+    JsonRpcClient client;
+    connectStandIn(&client, &host, &sent);
+
+    Receiver receiver;
+    int commandId = client.sendCommand("JSONRPC.Version", QVariantMap(), &receiver, "reply");
+    QVERIFY(sent.last().contains("JSONRPC.Version"));
+    int bytesOut = sent.last().size();
+
+    QTest::qWait(100);
+    QByteArray reply = QJsonDocument::fromVariant(QVariantMap({{"id", commandId}, {"status", "success"}, {"params", QVariantMap({{"version", "1.0"}})}})).toJson(QJsonDocument::Compact) + "\n";
+    QMetaObject::invokeMethod(&client, "dataReceived", Q_ARG(QByteArray, reply));
+    QCOMPARE(receiver.replies.value(commandId), QVariantMap({{"version", "1.0"}}));
+
+    JsonRpcDiagnostics *diagnostics = client.diagnostics();
+    QModelIndex index = diagnostics->index(row(diagnostics, "JSONRPC.Version"));
+    QCOMPARE(diagnostics->data(index, JsonRpcDiagnostics::RoleRequests).toInt(), 1);
+    QCOMPARE(diagnostics->data(index, JsonRpcDiagnostics::RoleBytesOut).toLongLong(), static_cast<qint64>(bytesOut));
+    // The framer drops the line break
+    QCOMPARE(diagnostics->data(index, JsonRpcDiagnostics::RoleBytesIn).toLongLong(), static_cast<qint64>(reply.size() - 1));
+    // Somewhere in the bucket of 100 ms
+    int p50 = diagnostics->data(index, JsonRpcDiagnostics::RoleLatencyP50).toInt();
+    QVERIFY2(p50 >= 90 && p50 <= 200, qPrintable(QString::number(p50)));
+
+    // The round trip counts for the connection as well
+    Connection *connection = host.connections()->get(0);
+    QVERIFY(connection->roundTripTimeP50() >= 90);
+}
+
+void TestJsonRpcDiagnostics::benchmarkCheckTimeouts_data()
+{
+    QTest::addColumn<int>("pending");
+
+    QTest::newRow("10 requests") << 10;
+    QTest::newRow("1000 requests") << 1000;
+    QTest::newRow("10000 requests") << 10000;
+}
+
+void TestJsonRpcDiagnostics::benchmarkCheckTimeouts()
+{
+    QFETCH(int, pending);
+
+    // What the once a second deadline check costs with many outstanding requests, none of them due yet
+    JsonRpcClient client;
+    for (int i = 0; i < pending; i++) {
+        client.sendCommand("Logging.GetLogEntries", QVariantMap(), nullptr, QString(), 600000);
+    }
+
+    QBENCHMARK {
+        QMetaObject::invokeMethod(&client, "checkTimeouts");
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    // NymeaConnection wants a QGuiApplication
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QGuiApplication app(argc, argv);
+    TestJsonRpcDiagnostics test;
+    return QTest::qExec(&test, argc, argv);
+}
+
+#include "tst_jsonrpcdiagnostics.moc"
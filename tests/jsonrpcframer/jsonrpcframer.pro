@@ -0,0 +1,5 @@
+TARGET = tst_jsonrpcframer
+
+include(../unittests.pri)
+
+SOURCES += tst_jsonrpcframer.cpp
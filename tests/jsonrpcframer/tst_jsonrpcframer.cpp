@@ -0,0 +1,270 @@
+#include <QtTest>
+#include <QtEndian>
+#include <QJsonDocument>
+
+#include "jsonrpc/jsonrpcframer.h"
+
+class TestJsonRpcFramer: public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void singleFrame();
+    void multipleFramesInOneChunk();
+    void frameSplitByteByByte();
+    void bracesInStrings();
+    void garbageBetweenFrames();
+    void cborFrames();
+    void oversizedCborFrame();
+    void switchEncodingBetweenFrames_data();
+    void switchEncodingBetweenFrames();
+    void clear();
+
+    void benchmarkStream_data();
+    void benchmarkStream();
+
+private:
+    QList<QByteArray> takeAll(JsonRpcFramer &framer);
+    QByteArray cborFrame(const QByteArray &payload);
+    QByteArray recordedStream(int minimumSize, int *messageCount);
+};
+
+QList<QByteArray> TestJsonRpcFramer::takeAll(JsonRpcFramer &framer)
+{
+    QList<QByteArray> frames;
+    QByteArray frame = framer.takeFrame();
+    while (!frame.isNull()) {
+        frames.append(frame);
+        frame = framer.takeFrame();
+    }
+    return frames;
+}
+
+QByteArray TestJsonRpcFramer::cborFrame(const QByteArray &payload)
+{
+    QByteArray length(4, 0);
+    qToBigEndian<quint32>(static_cast<quint32>(payload.length()), reinterpret_cast<uchar*>(length.data()));
+    return length + payload;
+}
+
+QByteArray TestJsonRpcFramer::recordedStream(int minimumSize, int *messageCount)
+{
+    // Resembles what a busy nymea instance sends: mostly state change notifications, now and then a big reply
+    QByteArray stream;
+    int count = 0;
+    while (stream.length() < minimumSize) {
+        QVariantMap params;
+        params.insert("thingId", QString("{%1d5e0b6c-6f4b-4b43-a7d6-2ef0aa9bd8c2}").arg(count % 200, 3, 10, QChar('0')));
+        params.insert("stateTypeId", "{0f8d0ebc-8c8f-4f37-9e4c-2f7d8f1e3d2a}");
+        params.insert("value", count * 0.5);
+        QVariantMap message;
+        message.insert("notification", "Integrations.StateChanged");
+        message.insert("params", params);
+        if (count % 100 == 0) {
+            QVariantList entries;
+            for (int i = 0; i < 500; i++) {
+                entries.append(QVariantMap({{"timestamp", 1600000000 + i * 60}, {"source", "state-{x}-\"power\""}, {"values", QVariantMap({{"currentPower", i}})}}));
+            }
+            message.clear();
+            message.insert("id", count);
+            message.insert("status", "success");
+            message.insert("params", QVariantMap({{"logEntries", entries}}));
+        }
+        stream.append(QJsonDocument::fromVariant(message).toJson(QJsonDocument::Compact) + "\n");
+        count++;
+    }
+    *messageCount = count;
+    return stream;
+}
+
+void TestJsonRpcFramer::singleFrame()
+{
+    JsonRpcFramer framer;
+    QVERIFY(framer.takeFrame().isNull());
+
+    framer.append("{\"id\": 1, \"params\": {}}\n");
+    QCOMPARE(framer.takeFrame(), QByteArray("{\"id\": 1, \"params\": {}}"));
+    QVERIFY(framer.takeFrame().isNull());
+    QCOMPARE(framer.bufferedBytes(), 0);
+}
+
+void TestJsonRpcFramer::multipleFramesInOneChunk()
+{
+    JsonRpcFramer framer;
+    framer.append("{\"id\": 1}\n{\"id\": 2}{\"id\": 3, \"params\": {\"list\": [1, {\"a\": 2}]}}\n{\"id\"");
+
+    QList<QByteArray> frames = takeAll(framer);
+    QCOMPARE(frames.count(), 3);
+    QCOMPARE(frames.at(0), QByteArray("{\"id\": 1}"));
+    QCOMPARE(frames.at(1), QByteArray("{\"id\": 2}"));
+    QCOMPARE(frames.at(2), QByteArray("{\"id\": 3, \"params\": {\"list\": [1, {\"a\": 2}]}}"));
+
+    framer.append(": 4}");
+    QCOMPARE(framer.takeFrame(), QByteArray("{\"id\": 4}"));
+}
+
+void TestJsonRpcFramer::frameSplitByteByByte()
+{
+    QByteArray message = "{\"id\": 5, \"params\": {\"name\": \"Living room\", \"values\": [1, 2, 3]}}";
+    QByteArray stream = message + "\n" + message + "\n";
+
+    JsonRpcFramer framer;
+    QList<QByteArray> frames;
+    for (int i = 0; i < stream.length(); i++) {
+        framer.append(stream.mid(i, 1));
+        frames.append(takeAll(framer));
+    }
+    QCOMPARE(frames.count(), 2);
+    QCOMPARE(frames.at(0), message);
+    QCOMPARE(frames.at(1), message);
+}
+
+void TestJsonRpcFramer::bracesInStrings()
+{
+    QByteArray message = "{\"name\": \"}{ [\\\"quoted\\\"] \\\\\", \"other\": \"{\"}";
+    JsonRpcFramer framer;
+    framer.append(message.left(10));
+    QVERIFY(framer.takeFrame().isNull());
+    framer.append(message.mid(10) + "\n");
+    QByteArray frame = framer.takeFrame();
+    QCOMPARE(frame, message);
+
+    QJsonParseError error;
+    QJsonDocument::fromJson(frame, &error);
+    QCOMPARE(error.error, QJsonParseError::NoError);
+}
+
+void TestJsonRpcFramer::garbageBetweenFrames()
+{
+    JsonRpcFramer framer;
+    // One warning for the whole run, not one per byte
+    QTest::ignoreMessage(QtWarningMsg, "Discarded 7 bytes of unexpected data between JSON frames");
+    framer.append("\r\n  garbage {\"id\": 1}\t\n");
+    QCOMPARE(takeAll(framer), QList<QByteArray>({"{\"id\": 1}"}));
+    QCOMPARE(framer.bufferedBytes(), 0);
+}
+
+void TestJsonRpcFramer::cborFrames()
+{
+    JsonRpcFramer framer;
+    framer.setEncoding(JsonRpcFramer::EncodingCbor);
+    QCOMPARE(framer.encoding(), JsonRpcFramer::EncodingCbor);
+
+    QByteArray stream = cborFrame("first") + cborFrame(QByteArray()) + cborFrame(QByteArray(70000, 'x'));
+    framer.append(stream.left(3));
+    QVERIFY(framer.takeFrame().isNull());
+    framer.append(stream.mid(3, 10));
+    QCOMPARE(framer.takeFrame(), QByteArray("first"));
+    QVERIFY(framer.takeFrame().isNull());
+    framer.append(stream.mid(13));
+    // The empty frame is skipped
+    QCOMPARE(framer.takeFrame(), QByteArray(70000, 'x'));
+    QVERIFY(framer.takeFrame().isNull());
+    QCOMPARE(framer.bufferedBytes(), 0);
+}
+
+void TestJsonRpcFramer::oversizedCborFrame()
+{
+    JsonRpcFramer framer;
+    framer.setEncoding(JsonRpcFramer::EncodingCbor);
+
+    // A length prefix just above the limit, the frame itself never arrives
+    QByteArray prefix(4, 0);
+    qToBigEndian<quint32>(JsonRpcFramer::MaxCborFrameSize + 1, reinterpret_cast<uchar*>(prefix.data()));
+    framer.append(cborFrame("first") + prefix + "partial");
+    QCOMPARE(framer.takeFrame(), QByteArray("first"));
+    QVERIFY(!framer.broken());
+
+    QTest::ignoreMessage(QtWarningMsg, QRegularExpression("^Rejecting CBOR frame of"));
+    QVERIFY(framer.takeFrame().isNull());
+    QVERIFY(framer.broken());
+    QCOMPARE(framer.bufferedBytes(), 0);
+
+    // Nothing is buffered any more until the framer is reset
+    framer.append(cborFrame("second"));
+    QCOMPARE(framer.bufferedBytes(), 0);
+    QVERIFY(framer.takeFrame().isNull());
+
+    framer.clear();
+    QVERIFY(!framer.broken());
+    framer.append("{\"id\": 1}");
+    QCOMPARE(framer.takeFrame(), QByteArray("{\"id\": 1}"));
+}
+
+void TestJsonRpcFramer::switchEncodingBetweenFrames_data()
+{
+    QTest::addColumn<int>("splitPosition");
+
+    QByteArray reply = "{\"id\": 1}";
+    QTest::newRow("one chunk") << -1;
+    QTest::newRow("split before line break") << reply.length();
+    QTest::newRow("split after line break") << reply.length() + 1;
+    QTest::newRow("split in CBOR frame") << reply.length() + 3;
+}
+
+void TestJsonRpcFramer::switchEncodingBetweenFrames()
+{
+    QFETCH(int, splitPosition);
+
+    // The reply to JSONRPC.SetEncoding is still JSON, everything after it CBOR
+    QByteArray stream = "{\"id\": 1}\n" + cborFrame("first") + cborFrame("second");
+
+    JsonRpcFramer framer;
+    framer.append(stream.left(splitPosition));
+    QCOMPARE(framer.takeFrame(), QByteArray("{\"id\": 1}"));
+    framer.setEncoding(JsonRpcFramer::EncodingCbor);
+    QList<QByteArray> frames = takeAll(framer);
+    if (splitPosition >= 0) {
+        framer.append(stream.mid(splitPosition));
+        frames.append(takeAll(framer));
+    }
+    QCOMPARE(frames, QList<QByteArray>({"first", "second"}));
+    QCOMPARE(framer.bufferedBytes(), 0);
+}
+
+void TestJsonRpcFramer::clear()
+{
+    JsonRpcFramer framer;
+    framer.setEncoding(JsonRpcFramer::EncodingCbor);
+    framer.append(cborFrame("incomplete").left(8));
+    framer.clear();
+    QCOMPARE(framer.encoding(), JsonRpcFramer::EncodingJson);
+    QCOMPARE(framer.bufferedBytes(), 0);
+
+    framer.append("{\"id\": 1}");
+    QCOMPARE(framer.takeFrame(), QByteArray("{\"id\": 1}"));
+}
+
+void TestJsonRpcFramer::benchmarkStream_data()
+{
+    QTest::addColumn<int>("chunkSize");
+
+    // Bluetooth and TCP/websocket sized reads
+    QTest::newRow("20 bytes") << 20;
+    QTest::newRow("512 bytes") << 512;
+    QTest::newRow("16 KiB") << 16 * 1024;
+    QTest::newRow("64 KiB") << 64 * 1024;
+}
+
+void TestJsonRpcFramer::benchmarkStream()
+{
+    QFETCH(int, chunkSize);
+
+    int messageCount = 0;
+    QByteArray stream = recordedStream(4 * 1024 * 1024, &messageCount);
+
+    QBENCHMARK {
+        JsonRpcFramer framer;
+        int frames = 0;
+        for (int position = 0; position < stream.length(); position += chunkSize) {
+            framer.append(stream.mid(position, chunkSize));
+            while (!framer.takeFrame().isNull()) {
+                frames++;
+            }
+        }
+        QCOMPARE(frames, messageCount);
+    }
+}
+
+QTEST_GUILESS_MAIN(TestJsonRpcFramer)
+#include "tst_jsonrpcframer.moc"
@@ -0,0 +1,5 @@
+TARGET = tst_logentrystore
+
+include(../unittests.pri)
+
+SOURCES += tst_logentrystore.cpp
@@ -0,0 +1,353 @@
+#include <QtTest>
+
+#include "models/logentrystore.h"
+#include "models/logsmodel.h"
+#include "types/logentry.h"
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+class TestLogEntryStore: public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void appendAndRead();
+    void mixedTypes();
+    void insertAndMid();
+    void interning();
+    void stringTables();
+    void modelWrappers();
+
+    void benchmarkMemory_data();
+    void benchmarkMemory();
+    void benchmarkFetchMore_data();
+    void benchmarkFetchMore();
+
+private:
+    QVariantList logEntries(int offset, int count);
+    void deliver(LogsModel *model, int offset, const QVariantList &entries);
+    qint64 heapUsage() const;
+
+    QList<QUuid> m_thingIds;
+    QUuid m_stateTypeId;
+};
+
+void TestLogEntryStore::initTestCase()
+{
+    QLoggingCategory::setFilterRules("LogEngine.info=false");
+    for (int i = 0; i < 10; i++) {
+        m_thingIds.append(QUuid::createUuid());
+    }
+    m_stateTypeId = QUuid::createUuid();
+}
+
+QVariantList TestLogEntryStore::logEntries(int offset, int count)
+{
+    // Newest first, like Logging.GetLogEntries returns them
+    QVariantList entries;
+    entries.reserve(count);
+    qint64 newest = 1600000000000;
+    for (int i = offset; i < offset + count; i++) {
+        QVariantMap entry;
+        entry.insert("timestamp", newest - static_cast<qint64>(i) * 60000);
+        entry.insert("thingId", m_thingIds.at(i % m_thingIds.count()));
+        entry.insert("typeId", m_stateTypeId);
+        entry.insert("value", i * 0.5);
+        entry.insert("source", "LoggingSourceStates");
+        entry.insert("eventType", "LoggingEventTypeTrigger");
+        entries.append(entry);
+    }
+    return entries;
+}
+
+void TestLogEntryStore::deliver(LogsModel *model, int offset, const QVariantList &entries)
+{
+    QVariantMap data({{"offset", offset}, {"count", entries.count()}, {"logEntries", entries}});
+    QMetaObject::invokeMethod(model, "logsReply", Q_ARG(int, 0), Q_ARG(QVariantMap, data));
+}
+
+qint64 TestLogEntryStore::heapUsage() const
+{
+#if defined(__GLIBC__) && __GLIBC_PREREQ(2, 33)
+    return static_cast<qint64>(mallinfo2().uordblks);
+#elif defined(__GLIBC__)
+    return mallinfo().uordblks;
+#else
+    return -1;
+#endif
+}
+
+void TestLogEntryStore::appendAndRead()
+{
+    LogEntryStore store;
+    QVERIFY(store.isEmpty());
+    store.append(1000, "source a", {{"int", 5}, {"double", 1.5}, {"bool", true}, {"string", "on"}});
+    store.append(2000, "source b", {{"int", -3}, {"string", "off"}});
+    store.append(3000, "source a", {{"list", QVariantList({1, 2})}});
+
+    QCOMPARE(store.count(), 3);
+    QCOMPARE(store.timestampAt(1), Q_INT64_C(2000));
+    QCOMPARE(store.sourceAt(0), QString("source a"));
+    QCOMPARE(store.sourceAt(1), QString("source b"));
+    QCOMPARE(store.columnNames().count(), 5);
+
+    // Values come back with their type
+    QCOMPARE(store.valueAt(0, "int").userType(), static_cast<int>(QMetaType::Int));
+    QCOMPARE(store.valueAt(1, "int"), QVariant(-3));
+    QCOMPARE(store.valueAt(0, "double"), QVariant(1.5));
+    QCOMPARE(store.valueAt(0, "bool").userType(), static_cast<int>(QMetaType::Bool));
+    QCOMPARE(store.valueAt(0, "bool"), QVariant(true));
+    QCOMPARE(store.valueAt(1, "string"), QVariant("off"));
+    QCOMPARE(store.valueAt(2, "list"), QVariant(QVariantList({1, 2})));
+
+    // Missing values and columns are invalid
+    QVERIFY(!store.valueAt(1, "double").isValid());
+    QVERIFY(!store.valueAt(0, "list").isValid());
+    QVERIFY(!store.valueAt(0, "unknown").isValid());
+    QCOMPARE(store.column("unknown"), -1);
+    QCOMPARE(store.valuesAt(1), QVariantMap({{"int", -3}, {"string", "off"}}));
+
+    store.clear();
+    QVERIFY(store.isEmpty());
+    QVERIFY(store.columnNames().isEmpty());
+}
+
+void TestLogEntryStore::mixedTypes()
+{
+    LogEntryStore store;
+    store.append(1, "s", {{"number", 1}, {"flag", true}, {"text", "a"}, {"big", Q_INT64_C(1) << 60}});
+    store.append(2, "s", {{"number", 2.5}, {"flag", 1}, {"text", 7}, {"big", Q_INT64_C(1) << 60 | 1}});
+
+    // Mixed numbers are doubles
+    QCOMPARE(store.valueAt(0, "number").userType(), static_cast<int>(QMetaType::Double));
+    QCOMPARE(store.valueAt(0, "number").toDouble(), 1.0);
+    QCOMPARE(store.valueAt(1, "number").toDouble(), 2.5);
+
+    // Anything else keeps the values as they came
+    QCOMPARE(store.valueAt(0, "flag"), QVariant(true));
+    QCOMPARE(store.valueAt(1, "flag"), QVariant(1));
+    QCOMPARE(store.valueAt(0, "text"), QVariant("a"));
+    QCOMPARE(store.valueAt(1, "text"), QVariant(7));
+
+    // Too big for a double
+    QCOMPARE(store.valueAt(0, "big").toLongLong(), Q_INT64_C(1) << 60);
+    QCOMPARE(store.valueAt(1, "big").toLongLong(), Q_INT64_C(1) << 60 | 1);
+}
+
+void TestLogEntryStore::insertAndMid()
+{
+    LogEntryStore store;
+    for (int i = 0; i < 10; i++) {
+        store.append(i, "store", {{"a", i}});
+    }
+    LogEntryStore other;
+    for (int i = 0; i < 5; i++) {
+        other.append(100 + i, "other", {{"b", QString::number(i)}, {"a", i * 0.5}});
+    }
+
+    store.insert(4, other);
+    QCOMPARE(store.count(), 15);
+    for (int i = 0; i < 15; i++) {
+        bool inserted = i >= 4 && i < 9;
+        int original = inserted ? i - 4 : (i < 4 ? i : i - 5);
+        QCOMPARE(store.timestampAt(i), static_cast<qint64>(inserted ? 100 + original : original));
+        QCOMPARE(store.sourceAt(i), QString(inserted ? "other" : "store"));
+        QCOMPARE(store.valueAt(i, "a").toDouble(), inserted ? original * 0.5 : original);
+        QCOMPARE(store.valueAt(i, "b"), inserted ? QVariant(QString::number(original)) : QVariant());
+    }
+
+    LogEntryStore mid = store.mid(3, 3);
+    QCOMPARE(mid.count(), 3);
+    QCOMPARE(mid.timestampAt(0), Q_INT64_C(3));
+    QCOMPARE(mid.valueAt(1, "b"), QVariant("0"));
+    QCOMPARE(mid.valueAt(2, "a").toDouble(), 0.5);
+    QCOMPARE(store.mid(13).count(), 2);
+    QCOMPARE(store.mid(13, 100).count(), 2);
+
+    LogEntryStore copy;
+    copy.append(store, 5);
+    QCOMPARE(copy.count(), 1);
+    QCOMPARE(copy.timestampAt(0), Q_INT64_C(101));
+    QCOMPARE(copy.valuesAt(0), store.valuesAt(5));
+}
+
+void TestLogEntryStore::interning()
+{
+    int id = LogEntryStore::intern("living room");
+    QCOMPARE(LogEntryStore::intern(QString("living") + " room"), id);
+    QCOMPARE(LogEntryStore::string(id), QString("living room"));
+    QVERIFY(LogEntryStore::intern("kitchen") != id);
+    QCOMPARE(LogEntryStore::string(-1), QString());
+
+    LogEntryStore store;
+    store.append(1, "living room", {});
+    store.append(2, "kitchen", {});
+    store.append(3, "living room", {});
+    QCOMPARE(store.sourceIdAt(0), id);
+    QCOMPARE(store.sourceIdAt(2), id);
+}
+
+void TestLogEntryStore::stringTables()
+{
+    // Sources and ids go into the pool, free form values don't. Ids are handed out in order.
+    int before = LogEntryStore::intern("string tables probe 1");
+    LogEntryStore store;
+    for (int i = 0; i < 100; i++) {
+        store.append(i, "string tables source", {{"value", QString("value %1").arg(i % 10)}, {"typeId", "string tables type"}});
+    }
+    int after = LogEntryStore::intern("string tables probe 2");
+    QCOMPARE(after, before + 3);
+    QVERIFY(LogEntryStore::intern("string tables source") < after);
+    QVERIFY(LogEntryStore::intern("string tables type") < after);
+    QCOMPARE(store.valueAt(42, "value"), QVariant("value 2"));
+    QCOMPARE(store.valueAt(42, "typeId"), QVariant("string tables type"));
+
+    // Stores with their own tables are combined
+    LogEntryStore other;
+    other.append(1000, "other", {{"value", "value 3"}, {"state", "off"}});
+    other.append(1001, "other", {{"value", "new value"}});
+    other.append(1002, "other", {{"state", "on"}});
+    store.insert(10, other);
+    QCOMPARE(store.count(), 103);
+    QCOMPARE(store.valueAt(10, "value"), QVariant("value 3"));
+    QCOMPARE(store.valueAt(11, "value"), QVariant("new value"));
+    QVERIFY(!store.valueAt(12, "value").isValid());
+    QCOMPARE(store.valueAt(12, "state"), QVariant("on"));
+    QCOMPARE(store.valueAt(9, "value"), QVariant("value 9"));
+    QCOMPARE(store.valueAt(13, "value"), QVariant("value 0"));
+
+    // Copies share the table until either one adds a string
+    LogEntryStore mid = store.mid(10, 3);
+    mid.append(2000, "mid", {{"value", "mid value"}});
+    store.append(mid, 3);
+    QCOMPARE(mid.valueAt(0, "value"), QVariant("value 3"));
+    QCOMPARE(mid.valueAt(3, "value"), QVariant("mid value"));
+    QCOMPARE(store.valueAt(store.count() - 1, "value"), QVariant("mid value"));
+    store.insert(0, mid);
+    QCOMPARE(store.valueAt(1, "value"), QVariant("new value"));
+    QCOMPARE(store.valueAt(3, "value"), QVariant("mid value"));
+    QCOMPARE(store.valueAt(4, "value"), QVariant("value 0"));
+
+    // Turning into a variant column keeps the strings
+    store.append(3000, "variant", {{"value", 5}});
+    QCOMPARE(store.valueAt(3, "value"), QVariant("mid value"));
+    QCOMPARE(store.valueAt(store.count() - 1, "value"), QVariant(5));
+}
+
+void TestLogEntryStore::modelWrappers()
+{
+    LogsModel model;
+    QVariantList entries = logEntries(0, 30);
+    deliver(&model, 0, entries.mid(10));
+    QCOMPARE(model.rowCount(), 20);
+
+    // Data is served from the store
+    QModelIndex index = model.index(0);
+    QCOMPARE(model.data(index, LogsModel::RoleTimestamp).toDateTime(), QDateTime::fromMSecsSinceEpoch(entries.at(10).toMap().value("timestamp").toLongLong()));
+    QCOMPARE(model.data(index, LogsModel::RoleValue).toDouble(), 5.0);
+    QCOMPARE(model.data(index, LogsModel::RoleThingId).toUuid(), m_thingIds.at(0));
+    QCOMPARE(model.data(index, LogsModel::RoleTypeId).toUuid(), m_stateTypeId);
+    QCOMPARE(model.data(index, LogsModel::RoleSource).toInt(), static_cast<int>(LogEntry::LoggingSourceStates));
+
+    // Wrappers are created on demand and kept
+    LogEntry *entry = model.get(5);
+    QVERIFY(entry);
+    QCOMPARE(model.get(5), entry);
+    QCOMPARE(entry->value().toDouble(), 7.5);
+    QCOMPARE(entry->thingId(), m_thingIds.at(5));
+    QCOMPARE(entry->typeId(), m_stateTypeId);
+    QVERIFY(!model.get(20));
+
+    // Inserting in front moves the wrappers along with their entries
+    deliver(&model, 0, entries.mid(0, 10));
+    QCOMPARE(model.rowCount(), 30);
+    QCOMPARE(model.get(15), entry);
+    QCOMPARE(model.get(5)->value().toDouble(), 2.5);
+}
+
+void TestLogEntryStore::benchmarkMemory_data()
+{
+    QTest::addColumn<bool>("wrappers");
+
+    QTest::newRow("columnar store") << false;
+    QTest::newRow("LogEntry objects") << true;
+}
+
+void TestLogEntryStore::benchmarkMemory()
+{
+    QFETCH(bool, wrappers);
+
+    if (heapUsage() < 0) {
+        QSKIP("Heap usage can only be measured with glibc");
+    }
+
+    // Bytes per 10k entries, either in the store or as one QObject each like the models had before
+    QVariantList entries = logEntries(0, 10000);
+    LogEntryStore source;
+    foreach (const QVariant &entry, entries) {
+        LogsModel::appendEntry(&source, entry.toMap());
+    }
+
+    qint64 before = heapUsage();
+    LogEntryStore store;
+    QList<LogEntry*> objects;
+    if (wrappers) {
+        for (int i = 0; i < source.count(); i++) {
+            objects.append(LogsModel::createEntry(source, i, nullptr));
+        }
+    } else {
+        foreach (const QVariant &entry, entries) {
+            LogsModel::appendEntry(&store, entry.toMap());
+        }
+    }
+    qint64 used = heapUsage() - before;
+    qDeleteAll(objects);
+
+    QTest::setBenchmarkResult(used, QTest::BytesAllocated);
+}
+
+void TestLogEntryStore::benchmarkFetchMore_data()
+{
+    QTest::addColumn<int>("existing");
+    QTest::addColumn<int>("handedOut");
+
+    QTest::newRow("first page") << 0 << 0;
+    QTest::newRow("after 10k") << 10000 << 0;
+    QTest::newRow("after 100k") << 100000 << 0;
+    QTest::newRow("after 10k, 1000 wrappers") << 10000 << 1000;
+}
+
+void TestLogEntryStore::benchmarkFetchMore()
+{
+    QFETCH(int, existing);
+    QFETCH(int, handedOut);
+
+    // The reply to fetchMore(): one page of 1000 entries appended to what's already there
+    QVariantList page = logEntries(existing, 1000);
+    QVariantList existingEntries = logEntries(0, existing);
+
+    // Filling the model must not count, so this times the reply by hand and reports the best of a few runs
+    qint64 best = -1;
+    for (int run = 0; run < 5; run++) {
+        LogsModel model;
+        deliver(&model, 0, existingEntries);
+        for (int i = 0; i < handedOut; i++) {
+            model.get(i);
+        }
+
+        QElapsedTimer timer;
+        timer.start();
+        deliver(&model, existing, page);
+        qint64 elapsed = timer.nsecsElapsed();
+        QCOMPARE(model.rowCount(), existing + 1000);
+        best = best < 0 ? elapsed : qMin(best, elapsed);
+    }
+    QTest::setBenchmarkResult(best / 1000000.0, QTest::WalltimeMilliseconds);
+}
+
+QTEST_GUILESS_MAIN(TestLogEntryStore)
+#include "tst_logentrystore.moc"
@@ -0,0 +1,5 @@
+TARGET = tst_newlogsmodel
+
+include(../unittests.pri)
+
+SOURCES += tst_newlogsmodel.cpp
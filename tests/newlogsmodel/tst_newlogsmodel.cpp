@@ -0,0 +1,335 @@
+#include <QtTest>
+#include <QGuiApplication>
+
+#include "engine.h"
+#include "jsonrpc/jsonrpcclient.h"
+#include "connection/nymeaconnection.h"
+#include "connection/nymeahost.h"
+#include "connection/nymeatransportinterface.h"
+#include "models/newlogsmodel.h"
+
+// Stands in for a server: connects right away and keeps what's sent to it. Replies are fed to the client by the test.
+class StandInTransport: public NymeaTransportInterface
+{
+    Q_OBJECT
+public:
+    StandInTransport(QList<QByteArray> *sent, QObject *parent): NymeaTransportInterface(parent), m_sent(sent) {}
+
+    bool connect(const QUrl &url) override {
+        m_url = url;
+        QTimer::singleShot(0, this, [this](){
+            m_state = ConnectionStateConnected;
+            emit connected();
+        });
+        return true;
+    }
+    QUrl url() const override { return m_url; }
+    void disconnect() override { m_state = ConnectionStateDisconnected; }
+    ConnectionState connectionState() const override { return m_state; }
+    void sendData(const QByteArray &data) override { m_sent->append(data); }
+
+private:
+    QList<QByteArray> *m_sent = nullptr;
+    QUrl m_url;
+    ConnectionState m_state = ConnectionStateDisconnected;
+};
+
+class StandInTransportFactory: public NymeaTransportInterfaceFactory
+{
+public:
+    StandInTransportFactory(QList<QByteArray> *sent): m_sent(sent) {}
+
+    NymeaTransportInterface *createTransport(QObject *parent = nullptr) const override {
+        return new StandInTransport(m_sent, parent);
+    }
+    QStringList supportedSchemes() const override { return {"standin"}; }
+
+private:
+    QList<QByteArray> *m_sent = nullptr;
+};
+
+class TestNewLogsModel: public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void init();
+
+    void multipleSources_data();
+    void multipleSources();
+    void failedPage();
+    void liveEntries_data();
+    void liveEntries();
+
+private:
+    typedef QHash<QString, QList<qint64>> Logs;
+
+    void setUp(NewLogsModel *model, const QStringList &sources, Qt::SortOrder sortOrder);
+    // Answers the page requests sent since the last call like the server would. Pages for sources in
+    // failing get a reply without entries. Returns the number of requests answered.
+    int serve(const Logs &logs, const QStringList &failing = QStringList());
+    // Serves pages until the model doesn't ask for more, checking the order after every step
+    void drain(NewLogsModel *model, const Logs &logs);
+    void reply(int commandId, const QVariantMap &params);
+    QList<qint64> timestamps(NewLogsModel *model);
+    QList<qint64> expected(const Logs &logs, Qt::SortOrder sortOrder);
+
+    Engine *m_engine = nullptr;
+    QList<QByteArray> m_sent;
+    int m_handled = 0;
+    // Source and offset of every page served
+    QList<QPair<QString, int>> m_served;
+    qint64 m_base = 0;
+};
+
+void TestNewLogsModel::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+    QLoggingCategory::setFilterRules("NymeaConnection.warning=false\nNymeaConnection.info=false\nJsonRpc.warning=false\nJsonRpc.info=false\nLogEngine.debug=false\nLogEngine.warning=false");
+
+    m_engine = new Engine(this);
+    // Created after the engine, so it's destroyed after it too
+    NymeaHost *host = new NymeaHost(this);
+    host->setUuid(QUuid::createUuid());
+    host->setName("stand-in");
+    host->connections()->addConnection(QUrl("standin://localhost"), Connection::BearerTypeLoopback, false, "stand-in");
+
+    NymeaConnection *connection = m_engine->jsonRpcClient()->findChild<NymeaConnection*>();
+    QVERIFY(connection);
+    // Owned by the connection
+    connection->registerTransport(new StandInTransportFactory(&m_sent));
+    m_engine->jsonRpcClient()->connectToHost(host, host->connections()->get(0));
+    QTRY_VERIFY(!m_sent.isEmpty());
+    QVERIFY(m_sent.first().contains("JSONRPC.Hello"));
+
+    // Opens the send queue. Nothing else is answered, so the engine doesn't start fetching things.
+    QVariantMap hello;
+    hello.insert("uuid", host->uuid());
+    hello.insert("name", "stand-in");
+    hello.insert("protocol version", "8.0");
+    QVERIFY(QMetaObject::invokeMethod(m_engine->jsonRpcClient(), "helloReply", Q_ARG(int, 0), Q_ARG(QVariantMap, hello)));
+
+    m_base = QDateTime::currentMSecsSinceEpoch() - 100000;
+}
+
+void TestNewLogsModel::init()
+{
+    m_handled = m_sent.count();
+    m_served.clear();
+}
+
+void TestNewLogsModel::setUp(NewLogsModel *model, const QStringList &sources, Qt::SortOrder sortOrder)
+{
+    model->setEngine(m_engine);
+    model->setSources(sources);
+    model->setSortOrder(sortOrder);
+    model->setFetchBlockSize(2);
+    model->classBegin();
+    model->componentComplete();
+}
+
+int TestNewLogsModel::serve(const Logs &logs, const QStringList &failing)
+{
+    int answered = 0;
+    while (m_handled < m_sent.count()) {
+        QVariantMap request = QJsonDocument::fromJson(m_sent.at(m_handled++)).toVariant().toMap();
+        if (request.value("method").toString() != "Logging.GetLogEntries") {
+            continue;
+        }
+        QVariantMap params = request.value("params").toMap();
+        QString source = params.value("sources").toList().first().toString();
+        int offset = params.value("offset").toInt();
+        m_served.append(qMakePair(source, offset));
+
+        QVariantMap replyParams;
+        if (failing.contains(source)) {
+            replyParams.insert("loggingError", "LoggingErrorLogEntryNotFound");
+        } else {
+            QList<qint64> sourceLogs;
+            foreach (qint64 timestamp, logs.value(source)) {
+                if (timestamp <= params.value("endTime").toLongLong()) {
+                    sourceLogs.append(timestamp);
+                }
+            }
+            std::sort(sourceLogs.begin(), sourceLogs.end());
+            if (params.value("sortOrder").toString() == "DescendingOrder") {
+                std::reverse(sourceLogs.begin(), sourceLogs.end());
+            }
+            QVariantList entries;
+            foreach (qint64 timestamp, sourceLogs.mid(offset, params.value("limit").toInt())) {
+                entries.append(QVariantMap({{"timestamp", timestamp}, {"source", source}, {"values", QVariantMap({{"value", timestamp - m_base}})}}));
+            }
+            replyParams.insert("logEntries", entries);
+        }
+        reply(request.value("id").toInt(), replyParams);
+        answered++;
+    }
+    return answered;
+}
+
+void TestNewLogsModel::drain(NewLogsModel *model, const Logs &logs)
+{
+    for (int round = 0; round < 100; round++) {
+        // Read ahead is scheduled
+        QCoreApplication::processEvents();
+        if (serve(logs) == 0) {
+            if (!model->canFetchMore(QModelIndex())) {
+                return;
+            }
+            model->fetchMore(QModelIndex());
+            if (serve(logs) == 0) {
+                return;
+            }
+        }
+        // Whatever is in the model is in order, nothing is merged in too early
+        QList<qint64> current = timestamps(model);
+        QList<qint64> sorted = current;
+        std::sort(sorted.begin(), sorted.end());
+        if (model->sortOrder() == Qt::DescendingOrder) {
+            std::reverse(sorted.begin(), sorted.end());
+        }
+        QCOMPARE(current, sorted);
+    }
+    QFAIL("The model keeps asking for pages");
+}
+
+void TestNewLogsModel::reply(int commandId, const QVariantMap &params)
+{
+    QVariantMap reply({{"id", commandId}, {"status", "success"}, {"params", params}});
+    QByteArray data = QJsonDocument::fromVariant(reply).toJson(QJsonDocument::Compact) + "\n";
+    QVERIFY(QMetaObject::invokeMethod(m_engine->jsonRpcClient(), "dataReceived", Q_ARG(QByteArray, data)));
+}
+
+QList<qint64> TestNewLogsModel::timestamps(NewLogsModel *model)
+{
+    QList<qint64> ret;
+    for (int i = 0; i < model->rowCount(); i++) {
+        ret.append(model->data(model->index(i), NewLogsModel::RoleTimestamp).toDateTime().toMSecsSinceEpoch());
+    }
+    return ret;
+}
+
+QList<qint64> TestNewLogsModel::expected(const Logs &logs, Qt::SortOrder sortOrder)
+{
+    QList<qint64> ret;
+    foreach (const QList<qint64> &sourceLogs, logs) {
+        ret.append(sourceLogs);
+    }
+    std::sort(ret.begin(), ret.end());
+    if (sortOrder == Qt::DescendingOrder) {
+        std::reverse(ret.begin(), ret.end());
+    }
+    return ret;
+}
+
+void TestNewLogsModel::multipleSources_data()
+{
+    QTest::addColumn<int>("sortOrder");
+
+    QTest::newRow("ascending") << static_cast<int>(Qt::AscendingOrder);
+    QTest::newRow("descending") << static_cast<int>(Qt::DescendingOrder);
+}
+
+void TestNewLogsModel::multipleSources()
+{
+    QFETCH(int, sortOrder);
+
+    // Pages of two. a runs over several pages, b is short with a late burst, c has nothing.
+    Logs logs;
+    logs.insert("a", {m_base, m_base + 3000, m_base + 6000, m_base + 9000, m_base + 12000, m_base + 15000, m_base + 18000});
+    logs.insert("b", {m_base + 1000, m_base + 4000, m_base + 20000});
+    logs.insert("c", {});
+
+    NewLogsModel model;
+    setUp(&model, {"a", "b", "c"}, static_cast<Qt::SortOrder>(sortOrder));
+    QVERIFY(model.canFetchMore(QModelIndex()));
+    model.fetchMore(QModelIndex());
+    QCOMPARE(serve(logs), 3);
+    drain(&model, logs);
+
+    QCOMPARE(timestamps(&model), expected(logs, static_cast<Qt::SortOrder>(sortOrder)));
+    QVERIFY(!model.canFetchMore(QModelIndex()));
+    QVERIFY(!model.busy());
+    // No page was asked for twice. The page size grows with the scroll speed, so their number varies.
+    for (int i = 0; i < m_served.count(); i++) {
+        QCOMPARE(m_served.count(m_served.at(i)), 1);
+    }
+    QCOMPARE(m_served.count(qMakePair(QString("c"), 0)), 1);
+}
+
+void TestNewLogsModel::failedPage()
+{
+    Logs logs;
+    logs.insert("a", {m_base, m_base + 2000, m_base + 4000});
+    logs.insert("b", {m_base + 1000, m_base + 3000});
+
+    NewLogsModel model;
+    setUp(&model, {"a", "b"}, Qt::AscendingOrder);
+    model.fetchMore(QModelIndex());
+    QCOMPARE(serve(logs, {"b"}), 2);
+
+    // Nothing can be merged without b, the request isn't pending any more
+    QCOMPARE(model.rowCount(), 0);
+    QVERIFY(!model.busy());
+    QVERIFY(model.canFetchMore(QModelIndex()));
+
+    // The view asks again, only b's page is fetched again, from where it failed
+    m_served.clear();
+    model.fetchMore(QModelIndex());
+    QCOMPARE(serve(logs), 1);
+    QCOMPARE(m_served.first(), qMakePair(QString("b"), 0));
+    drain(&model, logs);
+
+    QCOMPARE(timestamps(&model), expected(logs, Qt::AscendingOrder));
+}
+
+void TestNewLogsModel::liveEntries_data()
+{
+    QTest::addColumn<int>("sortOrder");
+
+    QTest::newRow("ascending") << static_cast<int>(Qt::AscendingOrder);
+    QTest::newRow("descending") << static_cast<int>(Qt::DescendingOrder);
+}
+
+void TestNewLogsModel::liveEntries()
+{
+    QFETCH(int, sortOrder);
+
+    Logs logs;
+    logs.insert("a", {m_base, m_base + 2000, m_base + 4000, m_base + 6000, m_base + 8000});
+    logs.insert("b", {m_base + 1000, m_base + 3000, m_base + 5000});
+
+    NewLogsModel model;
+    setUp(&model, {"a", "b"}, static_cast<Qt::SortOrder>(sortOrder));
+    model.fetchMore(QModelIndex());
+    QCOMPARE(serve(logs), 2);
+    QVERIFY(model.canFetchMore(QModelIndex()));
+
+    // Comes in while the older pages are still being fetched
+    qint64 live = QDateTime::currentMSecsSinceEpoch() + 60000;
+    QMetaObject::invokeMethod(&model, "newLogEntryReceived", Q_ARG(QVariantMap, QVariantMap({{"source", "a"}, {"timestamp", live}, {"values", QVariantMap({{"value", 1}})}})));
+    // Already part of the pages
+    QMetaObject::invokeMethod(&model, "newLogEntryReceived", Q_ARG(QVariantMap, QVariantMap({{"source", "b"}, {"timestamp", m_base + 3000}, {"values", QVariantMap({{"value", 1}})}})));
+    // Not shown by this model
+    QMetaObject::invokeMethod(&model, "newLogEntryReceived", Q_ARG(QVariantMap, QVariantMap({{"source", "c"}, {"timestamp", live + 1}, {"values", QVariantMap({{"value", 1}})}})));
+    drain(&model, logs);
+
+    logs["a"].append(live);
+    QCOMPARE(timestamps(&model), expected(logs, static_cast<Qt::SortOrder>(sortOrder)));
+    int liveRow = sortOrder == Qt::AscendingOrder ? model.rowCount() - 1 : 0;
+    QCOMPARE(model.data(model.index(liveRow), NewLogsModel::RoleSource).toString(), QString("a"));
+}
+
+int main(int argc, char *argv[])
+{
+    // Engine and NymeaConnection want a QGuiApplication
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QGuiApplication app(argc, argv);
+    TestNewLogsModel test;
+    return QTest::qExec(&test, argc, argv);
+}
+
+#include "tst_newlogsmodel.moc"
@@ -0,0 +1,5 @@
+TARGET = tst_rangeaggregate
+
+include(../unittests.pri)
+
+SOURCES += tst_rangeaggregate.cpp
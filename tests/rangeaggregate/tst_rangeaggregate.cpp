@@ -0,0 +1,242 @@
+#include <QtTest>
+#include <QRandomGenerator>
+
+#include "models/rangeaggregate.h"
+
+class TestRangeAggregate: public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void empty();
+    void appendAndQuery();
+    void insert();
+    void replace();
+    void blockEdges();
+    void randomOperations();
+
+    void benchmarkQuery_data();
+    void benchmarkQuery();
+
+private:
+    void verify(const RangeAggregate &aggregate, const QVector<double> &values, int first, int last);
+};
+
+void TestRangeAggregate::verify(const RangeAggregate &aggregate, const QVector<double> &values, int first, int last)
+{
+    // Integer values keep the sums exact
+    RangeAggregate::Result result = aggregate.query(values, first, last);
+    first = qMax(first, 0);
+    last = qMin(last, values.count());
+    QCOMPARE(result.count, qMax(last - first, 0));
+    if (first >= last) {
+        QVERIFY(result.isEmpty());
+        return;
+    }
+    double minValue = values.at(first), maxValue = values.at(first), sum = 0;
+    for (int i = first; i < last; i++) {
+        minValue = qMin(minValue, values.at(i));
+        maxValue = qMax(maxValue, values.at(i));
+        sum += values.at(i);
+    }
+    QCOMPARE(result.minValue, minValue);
+    QCOMPARE(result.maxValue, maxValue);
+    QCOMPARE(result.sum, sum);
+    QCOMPARE(result.average(), sum / (last - first));
+}
+
+void TestRangeAggregate::empty()
+{
+    RangeAggregate aggregate;
+    QVector<double> values;
+    QVERIFY(aggregate.total(values).isEmpty());
+    QCOMPARE(aggregate.total(values).average(), 0.0);
+    QVERIFY(aggregate.query(values, 0, 10).isEmpty());
+
+    values.append(5);
+    QCOMPARE(aggregate.total(values).count, 1);
+    values.clear();
+    aggregate.clear();
+    QVERIFY(aggregate.total(values).isEmpty());
+}
+
+void TestRangeAggregate::appendAndQuery()
+{
+    RangeAggregate aggregate;
+    QVector<double> values;
+    // Crosses several block boundaries, querying in between so appends are picked up incrementally
+    for (int i = 0; i < 200; i++) {
+        double value = (i * 37) % 23 - 11;
+        values.append(value);
+        verify(aggregate, values, 0, values.count());
+        verify(aggregate, values, values.count() / 2, values.count());
+    }
+    QCOMPARE(aggregate.total(values).count, 200);
+
+    verify(aggregate, values, 17, 18);
+    verify(aggregate, values, 3, 64);
+    verify(aggregate, values, 50, 50);
+    verify(aggregate, values, 60, 40);
+    // Out of bounds are clamped
+    verify(aggregate, values, -10, 20);
+    verify(aggregate, values, 190, 300);
+}
+
+void TestRangeAggregate::insert()
+{
+    RangeAggregate aggregate;
+    QVector<double> values({1, 2, 3, 4});
+    verify(aggregate, values, 0, 4);
+
+    // Older samples fetched later go in front, gaps are filled in the middle
+    values.insert(0, -4);
+    values.insert(0, -5);
+    aggregate.invalidate(0);
+    verify(aggregate, values, 0, values.count());
+    values.insert(3, 200);
+    values.insert(3, 100);
+    aggregate.invalidate(3);
+    verify(aggregate, values, 0, values.count());
+    verify(aggregate, values, 1, 4);
+    values.append(7);
+    aggregate.invalidate(values.count() - 1);
+    verify(aggregate, values, 0, values.count());
+    QCOMPARE(aggregate.query(values, 3, 4).sum, 100.0);
+
+    // Same behind the first block
+    for (int i = 0; i < 3 * RangeAggregate::BlockSize; i++) {
+        values.append(i % 17);
+    }
+    verify(aggregate, values, 0, values.count());
+    values.insert(RangeAggregate::BlockSize + 5, 1000);
+    aggregate.invalidate(RangeAggregate::BlockSize + 5);
+    verify(aggregate, values, 0, values.count());
+    verify(aggregate, values, RangeAggregate::BlockSize, 2 * RangeAggregate::BlockSize);
+    verify(aggregate, values, 2 * RangeAggregate::BlockSize, values.count());
+}
+
+void TestRangeAggregate::replace()
+{
+    RangeAggregate aggregate;
+    QVector<double> values;
+    for (int i = 0; i < 200; i++) {
+        values.append(i);
+    }
+    verify(aggregate, values, 0, 200);
+
+    // The running sample is updated while it's being recorded
+    values[199] = -100;
+    aggregate.invalidate(199);
+    verify(aggregate, values, 0, 200);
+    verify(aggregate, values, 100, 200);
+    values[0] = 1000;
+    aggregate.invalidate(0);
+    verify(aggregate, values, 0, 5);
+    verify(aggregate, values, 0, 200);
+}
+
+void TestRangeAggregate::blockEdges()
+{
+    // Every range starting and ending around the block boundaries, aligned or not
+    RangeAggregate aggregate;
+    QVector<double> values;
+    for (int i = 0; i < 3 * RangeAggregate::BlockSize + 5; i++) {
+        values.append((i * 53) % 31 - 15);
+    }
+    QVector<int> positions;
+    for (int block = 0; block <= 3; block++) {
+        for (int offset = -2; offset <= 2; offset++) {
+            positions.append(block * RangeAggregate::BlockSize + offset);
+        }
+    }
+    positions.append(values.count());
+    foreach (int first, positions) {
+        foreach (int last, positions) {
+            verify(aggregate, values, first, last);
+        }
+    }
+}
+
+void TestRangeAggregate::randomOperations()
+{
+    QRandomGenerator random(42);
+    RangeAggregate aggregate;
+    QVector<double> values;
+    for (int round = 0; round < 2000; round++) {
+        switch (random.bounded(4)) {
+        case 0:
+            values.append(random.bounded(2001) - 1000);
+            break;
+        case 1: {
+            QVector<double> block;
+            for (int i = random.bounded(1, 8); i > 0; i--) {
+                block.append(random.bounded(2001) - 1000);
+            }
+            int index = random.bounded(values.count() + 1);
+            for (int i = 0; i < block.count(); i++) {
+                values.insert(index + i, block.at(i));
+            }
+            aggregate.invalidate(index);
+            break;
+        }
+        case 2:
+            if (!values.isEmpty()) {
+                int index = random.bounded(values.count());
+                values[index] = random.bounded(2001) - 1000;
+                aggregate.invalidate(index);
+            }
+            break;
+        default: {
+            int first = random.bounded(values.count() + 1);
+            int last = random.bounded(values.count() + 1);
+            verify(aggregate, values, qMin(first, last), qMax(first, last));
+            break;
+        }
+        }
+    }
+    QCOMPARE(aggregate.total(values).count, values.count());
+    verify(aggregate, values, 0, values.count());
+}
+
+void TestRangeAggregate::benchmarkQuery_data()
+{
+    QTest::addColumn<bool>("scan");
+
+    QTest::newRow("full scan") << true;
+    QTest::newRow("aggregate") << false;
+}
+
+void TestRangeAggregate::benchmarkQuery()
+{
+    QFETCH(bool, scan);
+
+    // A year of 15 minute samples, while a live sample comes in and the visible window is panned
+    RangeAggregate aggregate;
+    QVector<double> values;
+    QRandomGenerator random(42);
+    for (int i = 0; i < 35040; i++) {
+        values.append(random.bounded(5000.0));
+    }
+    const int window = 96 * 30;
+
+    QBENCHMARK {
+        double maxValue = 0;
+        for (int first = 0; first + window < values.count(); first += 96) {
+            values[values.count() - 1] = first;
+            aggregate.invalidate(values.count() - 1);
+            if (scan) {
+                double windowMax = values.at(first);
+                for (int i = first; i < first + window; i++) {
+                    windowMax = qMax(windowMax, values.at(i));
+                }
+                maxValue = qMax(maxValue, windowMax);
+            } else {
+                maxValue = qMax(maxValue, aggregate.query(values, first, first + window).maxValue);
+            }
+        }
+        QVERIFY(maxValue > 0);
+    }
+}
+
+QTEST_GUILESS_MAIN(TestRangeAggregate)
+#include "tst_rangeaggregate.moc"
@@ -0,0 +1,5 @@
+TARGET = tst_reconnectscheduler
+
+include(../unittests.pri)
+
+SOURCES += tst_reconnectscheduler.cpp
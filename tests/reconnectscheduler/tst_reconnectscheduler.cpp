@@ -0,0 +1,288 @@
+#include <QtTest>
+#include <QGuiApplication>
+
+#include "connection/reconnectscheduler.h"
+#include "connection/nymeaconnection.h"
+#include "connection/nymeahost.h"
+#include "connection/nymeatransportinterface.h"
+
+// Stands in for a server which is down, or which accepts connections and drops them right away
+class StandInTransport: public NymeaTransportInterface
+{
+    Q_OBJECT
+public:
+    StandInTransport(bool accept, int *attempts, QObject *parent): NymeaTransportInterface(parent), m_accept(accept), m_attempts(attempts) {}
+
+    bool connect(const QUrl &url) override {
+        m_url = url;
+        (*m_attempts)++;
+        QTimer::singleShot(0, this, [this](){
+            if (!m_accept) {
+                emit error(QAbstractSocket::ConnectionRefusedError);
+                return;
+            }
+            m_state = ConnectionStateConnected;
+            emit connected();
+            QTimer::singleShot(0, this, [this](){
+                m_state = ConnectionStateDisconnected;
+                emit disconnected();
+            });
+        });
+        return true;
+    }
+    QUrl url() const override { return m_url; }
+    void disconnect() override { m_state = ConnectionStateDisconnected; }
+    ConnectionState connectionState() const override { return m_state; }
+    void sendData(const QByteArray &data) override { Q_UNUSED(data) }
+
+private:
+    bool m_accept = false;
+    int *m_attempts = nullptr;
+    QUrl m_url;
+    ConnectionState m_state = ConnectionStateDisconnected;
+};
+
+class StandInTransportFactory: public NymeaTransportInterfaceFactory
+{
+public:
+    StandInTransportFactory(bool accept, int *attempts): m_accept(accept), m_attempts(attempts) {}
+
+    NymeaTransportInterface *createTransport(QObject *parent = nullptr) const override {
+        return new StandInTransport(m_accept, m_attempts, parent);
+    }
+    QStringList supportedSchemes() const override { return {"standin"}; }
+
+private:
+    bool m_accept = false;
+    int *m_attempts = nullptr;
+};
+
+class TestReconnectScheduler: public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void firstRetry();
+    void exponentialBackoff();
+    void perBearer();
+    void jitter();
+    void stableConnection();
+    void reset();
+    void fleet();
+
+    void standInTransport_data();
+    void standInTransport();
+};
+
+void TestReconnectScheduler::initTestCase()
+{
+    // Connections keep their stats in the settings
+    QStandardPaths::setTestModeEnabled(true);
+    QCoreApplication::setOrganizationName("nymea-tests");
+    QCoreApplication::setApplicationName("tst_reconnectscheduler");
+    QLoggingCategory::setFilterRules("NymeaConnection.info=false\nNymeaConnection.warning=false");
+}
+
+void TestReconnectScheduler::firstRetry()
+{
+    ReconnectScheduler scheduler(1);
+    qint64 now = 100000;
+    QVERIFY(scheduler.isReady(Connection::BearerTypeLan, now));
+    QCOMPARE(scheduler.timeUntilReady(Connection::BearerTypeLan, now), Q_INT64_C(0));
+
+    scheduler.failed(Connection::BearerTypeLan, now);
+    QCOMPARE(scheduler.failureCount(Connection::BearerTypeLan), 1);
+    qint64 wait = scheduler.timeUntilReady(Connection::BearerTypeLan, now);
+    QVERIFY(wait >= 500);
+    QVERIFY(wait <= 1000);
+
+    // The clock is the caller's
+    QCOMPARE(scheduler.timeUntilReady(Connection::BearerTypeLan, now + 100), wait - 100);
+    QVERIFY(!scheduler.isReady(Connection::BearerTypeLan, now + wait - 1));
+    QVERIFY(scheduler.isReady(Connection::BearerTypeLan, now + wait));
+}
+
+void TestReconnectScheduler::exponentialBackoff()
+{
+    ReconnectScheduler scheduler(2);
+    scheduler.setBaseDelay(100);
+    scheduler.setMaximumDelay(10000);
+
+    qint64 now = 0;
+    for (int failure = 1; failure <= 15; failure++) {
+        scheduler.failed(Connection::BearerTypeCloud, now);
+        qint64 backoff = qMin(Q_INT64_C(100) << (failure - 1), Q_INT64_C(10000));
+        qint64 wait = scheduler.timeUntilReady(Connection::BearerTypeCloud, now);
+        QVERIFY2(wait >= backoff / 2 && wait <= backoff, qPrintable(QString("Failure %1 waits %2 ms").arg(failure).arg(wait)));
+        now += wait;
+    }
+    QCOMPARE(scheduler.failureCount(Connection::BearerTypeCloud), 15);
+}
+
+void TestReconnectScheduler::perBearer()
+{
+    ReconnectScheduler scheduler(3);
+    qint64 now = 0;
+    for (int i = 0; i < 10; i++) {
+        scheduler.failed(Connection::BearerTypeLan, now);
+    }
+    // A dead LAN endpoint doesn't hold back the cloud
+    QVERIFY(scheduler.timeUntilReady(Connection::BearerTypeLan, now) >= 30000);
+    QVERIFY(scheduler.isReady(Connection::BearerTypeCloud, now));
+    QCOMPARE(scheduler.failureCount(Connection::BearerTypeCloud), 0);
+
+    scheduler.failed(Connection::BearerTypeCloud, now);
+    QVERIFY(scheduler.timeUntilReady(Connection::BearerTypeCloud, now) <= 1000);
+}
+
+void TestReconnectScheduler::jitter()
+{
+    // Same seed, same delays
+    ReconnectScheduler first(42);
+    ReconnectScheduler second(42);
+    for (int i = 0; i < 10; i++) {
+        first.failed(Connection::BearerTypeWan, 0);
+        second.failed(Connection::BearerTypeWan, 0);
+        QCOMPARE(first.timeUntilReady(Connection::BearerTypeWan, 0), second.timeUntilReady(Connection::BearerTypeWan, 0));
+    }
+
+    // Clients failing at the same time don't all come back at the same time
+    QSet<qint64> waits;
+    for (quint32 seed = 0; seed < 100; seed++) {
+        ReconnectScheduler scheduler(seed);
+        for (int i = 0; i < 5; i++) {
+            scheduler.failed(Connection::BearerTypeWan, 0);
+        }
+        waits.insert(scheduler.timeUntilReady(Connection::BearerTypeWan, 0));
+    }
+    QVERIFY(waits.count() > 50);
+}
+
+void TestReconnectScheduler::stableConnection()
+{
+    ReconnectScheduler scheduler(4);
+    scheduler.setStableTime(30000);
+    qint64 now = 0;
+    for (int i = 0; i < 3; i++) {
+        scheduler.failed(Connection::BearerTypeLan, now);
+    }
+
+    // Dropped right away, that's just another failure
+    now += scheduler.timeUntilReady(Connection::BearerTypeLan, now);
+    scheduler.connected(Connection::BearerTypeLan, now);
+    now += 1000;
+    scheduler.disconnected(Connection::BearerTypeLan, now);
+    QCOMPARE(scheduler.failureCount(Connection::BearerTypeLan), 4);
+    QVERIFY(scheduler.timeUntilReady(Connection::BearerTypeLan, now) >= 4000);
+
+    // Up for long enough, reconnect right away
+    now += scheduler.timeUntilReady(Connection::BearerTypeLan, now);
+    scheduler.connected(Connection::BearerTypeLan, now);
+    now += 30000;
+    scheduler.disconnected(Connection::BearerTypeLan, now);
+    QCOMPARE(scheduler.failureCount(Connection::BearerTypeLan), 0);
+    QVERIFY(scheduler.isReady(Connection::BearerTypeLan, now));
+
+    // A stable connection which ends in an error starts over with the shortest delay
+    for (int i = 0; i < 5; i++) {
+        scheduler.failed(Connection::BearerTypeLan, now);
+    }
+    now += scheduler.timeUntilReady(Connection::BearerTypeLan, now);
+    scheduler.connected(Connection::BearerTypeLan, now);
+    now += 60000;
+    scheduler.failed(Connection::BearerTypeLan, now);
+    QCOMPARE(scheduler.failureCount(Connection::BearerTypeLan), 1);
+    QVERIFY(scheduler.timeUntilReady(Connection::BearerTypeLan, now) <= 1000);
+}
+
+void TestReconnectScheduler::reset()
+{
+    ReconnectScheduler scheduler(5);
+    for (int i = 0; i < 10; i++) {
+        scheduler.failed(Connection::BearerTypeLan, 0);
+        scheduler.failed(Connection::BearerTypeCloud, 0);
+    }
+    scheduler.reset();
+    QVERIFY(scheduler.isReady(Connection::BearerTypeLan, 0));
+    QVERIFY(scheduler.isReady(Connection::BearerTypeCloud, 0));
+    QCOMPARE(scheduler.failureCount(Connection::BearerTypeCloud), 0);
+}
+
+void TestReconnectScheduler::fleet()
+{
+    // 500 tablets losing their server at the same time, for 10 minutes. With the fixed 500 ms
+    // they'd hit the cloud proxy 1000 times a second.
+    const int clients = 500;
+    const qint64 outage = 10 * 60 * 1000;
+    QList<ReconnectScheduler*> schedulers;
+    QVector<qint64> nextAttempts(clients, 0);
+    for (int i = 0; i < clients; i++) {
+        schedulers.append(new ReconnectScheduler(static_cast<quint32>(i)));
+    }
+
+    QVector<int> attemptsPerSecond(static_cast<int>(outage / 1000), 0);
+    int attempts = 0;
+    for (int i = 0; i < clients; i++) {
+        while (nextAttempts.at(i) < outage) {
+            qint64 now = nextAttempts.at(i);
+            attempts++;
+            attemptsPerSecond[static_cast<int>(now / 1000)]++;
+            schedulers.at(i)->failed(Connection::BearerTypeCloud, now);
+            nextAttempts[i] = now + schedulers.at(i)->timeUntilReady(Connection::BearerTypeCloud, now);
+        }
+    }
+    qDeleteAll(schedulers);
+
+    // Backing off to 30 - 60 s after a couple of minutes, and spread out instead of in waves
+    QVERIFY2(attempts <= clients * 30, qPrintable(QString::number(attempts)));
+    int peak = 0;
+    for (int second = 120; second < attemptsPerSecond.count(); second++) {
+        peak = qMax(peak, attemptsPerSecond.at(second));
+    }
+    QVERIFY2(peak < 100, qPrintable(QString::number(peak)));
+}
+
+void TestReconnectScheduler::standInTransport_data()
+{
+    QTest::addColumn<bool>("accept");
+
+    QTest::newRow("refused") << false;
+    QTest::newRow("accepted and dropped") << true;
+}
+
+void TestReconnectScheduler::standInTransport()
+{
+    QFETCH(bool, accept);
+
+    int attempts = 0;
+    NymeaHost host;
+    host.setUuid(QUuid::createUuid());
+    host.setName("stand-in");
+    host.connections()->addConnection(QUrl("standin://localhost"), Connection::BearerTypeLoopback, false, "stand-in");
+
+    NymeaConnection connection;
+    // Owned by the connection
+    connection.registerTransport(new StandInTransportFactory(accept, &attempts));
+    connection.connectToHost(&host, host.connections()->get(0));
+    QTRY_COMPARE(attempts, 1);
+
+    // Attempts after 0, 0.5 - 1 and 1.5 - 3 seconds, the next one not before 3.5 s.
+    // Retrying every 500 ms would make that 7.
+    QTest::qWait(3200);
+    QVERIFY2(attempts >= 2 && attempts <= 3, qPrintable(QString::number(attempts)));
+}
+
+int main(int argc, char *argv[])
+{
+    // NymeaConnection wants a QGuiApplication
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QGuiApplication app(argc, argv);
+    TestReconnectScheduler test;
+    return QTest::qExec(&test, argc, argv);
+}
+
+#include "tst_reconnectscheduler.moc"
@@ -0,0 +1,5 @@
+TARGET = tst_sampledlogs
+
+include(../unittests.pri)
+
+SOURCES += tst_sampledlogs.cpp
@@ -0,0 +1,239 @@
+#include <QtTest>
+
+#include "models/sampledlogs.h"
+
+class TestSampledLogs: public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void unequalEdges();
+    void valueTypes();
+    void failedReply();
+    void staleReply();
+    void find();
+    void clearSources();
+
+    void benchmarkReply();
+
+private:
+    QVariantMap logEntry(qint64 timestamp, const QString &source, const QVariantMap &values);
+    void reply(SampledLogs *logs, const QVariantList &logEntries, int commandId = -1);
+
+    qint64 m_start = 0;
+};
+
+void TestSampledLogs::initTestCase()
+{
+    QLoggingCategory::setFilterRules("LogEngine.info=false");
+    m_start = QDateTime::currentDateTime().addDays(-1).toMSecsSinceEpoch() / 1000 * 1000;
+}
+
+QVariantMap TestSampledLogs::logEntry(qint64 timestamp, const QString &source, const QVariantMap &values)
+{
+    return QVariantMap({{"timestamp", timestamp}, {"source", source}, {"values", values}});
+}
+
+void TestSampledLogs::reply(SampledLogs *logs, const QVariantList &logEntries, int commandId)
+{
+    // Nothing has been sent without an engine, so the pending command is -1
+    QVariantMap data({{"logEntries", logEntries}, {"count", logEntries.count()}, {"offset", 0}});
+    QMetaObject::invokeMethod(logs, "logsReply", Q_ARG(int, commandId), Q_ARG(QVariantMap, data));
+}
+
+void TestSampledLogs::unequalEdges()
+{
+    SampledLogs logs;
+    QSignalSpy countSpy(&logs, &SampledLogs::countChanged);
+    QSignalSpy samplesSpy(&logs, &SampledLogs::samplesChanged);
+
+    // "a" has samples for the first three slots, "b" for the last three. Both share the ones in between.
+    qint64 step = 15 * 60 * 1000;
+    QVariantList entries;
+    for (int i = 0; i < 3; i++) {
+        entries.append(logEntry(m_start + i * step, "a", {{"temperature", 20 + i}}));
+    }
+    for (int i = 1; i < 4; i++) {
+        entries.append(logEntry(m_start + i * step, "b", {{"temperature", 30 + i}, {"humidity", 50 + i}}));
+    }
+    reply(&logs, entries);
+
+    QCOMPARE(logs.count(), 4);
+    QCOMPARE(countSpy.count(), 1);
+    QCOMPARE(samplesSpy.count(), 1);
+    for (int row = 0; row < logs.count(); row++) {
+        QCOMPARE(logs.timestampAt(row), m_start + row * step);
+    }
+
+    int aTemperature = logs.column("a", "temperature");
+    int bTemperature = logs.column("b", "temperature");
+    int bHumidity = logs.column("b", "humidity");
+    QVERIFY(aTemperature >= 0);
+    QVERIFY(bTemperature >= 0);
+    QVERIFY(bHumidity >= 0);
+    QCOMPARE(logs.column("a", "humidity"), -1);
+
+    // Missing at the edges
+    QVERIFY(qIsNaN(logs.valueAt(3, aTemperature)));
+    QVERIFY(qIsNaN(logs.valueAt(0, bTemperature)));
+    QVERIFY(qIsNaN(logs.valueAt(0, bHumidity)));
+    QVERIFY(!logs.value(3, "a", "temperature").isValid());
+    QVERIFY(!logs.value(0, "b", "humidity").isValid());
+    QVERIFY(!logs.value(0, "a", "humidity").isValid());
+    QVERIFY(!logs.value(4, "a", "temperature").isValid());
+    QVERIFY(qIsNaN(logs.valueAt(0, -1)));
+
+    // Present everywhere else
+    for (int row = 0; row < 3; row++) {
+        QCOMPARE(logs.valueAt(row, aTemperature), 20.0 + row);
+        QCOMPARE(logs.value(row, "a", "temperature").toDouble(), 20.0 + row);
+    }
+    for (int row = 1; row < 4; row++) {
+        QCOMPARE(logs.valueAt(row, bTemperature), 30.0 + row);
+        QCOMPARE(logs.valueAt(row, bHumidity), 50.0 + row);
+    }
+
+    // The same row count again doesn't signal a count change, but the samples are new
+    reply(&logs, entries);
+    QCOMPARE(countSpy.count(), 1);
+    QCOMPARE(samplesSpy.count(), 2);
+}
+
+void TestSampledLogs::valueTypes()
+{
+    SampledLogs logs;
+
+    // Out of order and with duplicate timestamps across sources
+    QVariantList entries;
+    entries.append(logEntry(m_start + 2000, "a", {{"power", true}, {"mode", "heat"}}));
+    entries.append(logEntry(m_start, "a", {{"power", false}, {"mode", "cool"}, {"target", 21.5}}));
+    entries.append(logEntry(m_start, "b", {{"power", true}, {"level", QVariantList({1, 2})}}));
+    entries.append(logEntry(m_start + 1000, "b", {{"power", false}, {"level", 3}}));
+    reply(&logs, entries);
+
+    QCOMPARE(logs.count(), 3);
+    QCOMPARE(logs.timestampAt(0), m_start);
+    QCOMPARE(logs.timestampAt(1), m_start + 1000);
+    QCOMPARE(logs.timestampAt(2), m_start + 2000);
+    QCOMPARE(logs.timestamp(1), QDateTime::fromMSecsSinceEpoch(m_start + 1000));
+    QVERIFY(!logs.timestamp(3).isValid());
+
+    // Strings and lists can't be plotted
+    QCOMPARE(logs.column("a", "mode"), -1);
+    QVERIFY(logs.column("b", "level") >= 0);
+    QVERIFY(qIsNaN(logs.valueAt(0, logs.column("b", "level"))));
+    QCOMPARE(logs.valueAt(1, logs.column("b", "level")), 3.0);
+
+    // Bools are plotted as 0 and 1
+    QCOMPARE(logs.valueAt(0, logs.column("a", "power")), 0.0);
+    QVERIFY(qIsNaN(logs.valueAt(1, logs.column("a", "power"))));
+    QCOMPARE(logs.valueAt(2, logs.column("a", "power")), 1.0);
+    QCOMPARE(logs.valueAt(0, logs.column("b", "power")), 1.0);
+    QCOMPARE(logs.valueAt(1, logs.column("b", "power")), 0.0);
+    QCOMPARE(logs.value(0, "a", "target").toDouble(), 21.5);
+    QVERIFY(!logs.value(2, "a", "target").isValid());
+}
+
+void TestSampledLogs::failedReply()
+{
+    SampledLogs logs;
+    reply(&logs, {logEntry(m_start, "a", {{"temperature", 20}}), logEntry(m_start + 1000, "a", {{"temperature", 21}})});
+    QCOMPARE(logs.count(), 2);
+
+    QSignalSpy countSpy(&logs, &SampledLogs::countChanged);
+    QSignalSpy samplesSpy(&logs, &SampledLogs::samplesChanged);
+    QSignalSpy busySpy(&logs, &SampledLogs::busyChanged);
+    QMetaObject::invokeMethod(&logs, "logsReply", Q_ARG(int, -1), Q_ARG(QVariantMap, QVariantMap({{"error", "lost"}})));
+
+    // The previous window stays
+    QCOMPARE(countSpy.count(), 0);
+    QCOMPARE(samplesSpy.count(), 0);
+    QCOMPARE(busySpy.count(), 1);
+    QVERIFY(!logs.busy());
+    QCOMPARE(logs.count(), 2);
+    QCOMPARE(logs.value(1, "a", "temperature").toDouble(), 21.0);
+
+    // An empty window is a valid reply though
+    reply(&logs, QVariantList());
+    QCOMPARE(logs.count(), 0);
+    QCOMPARE(countSpy.count(), 1);
+    QCOMPARE(logs.column("a", "temperature"), -1);
+    QCOMPARE(logs.find(QDateTime::fromMSecsSinceEpoch(m_start)), -1);
+}
+
+void TestSampledLogs::staleReply()
+{
+    SampledLogs logs;
+    reply(&logs, {logEntry(m_start, "a", {{"temperature", 20}})});
+
+    // Replies to anything but the latest request are dropped
+    QSignalSpy samplesSpy(&logs, &SampledLogs::samplesChanged);
+    reply(&logs, {logEntry(m_start, "a", {{"temperature", 25}}), logEntry(m_start + 1000, "a", {{"temperature", 26}})}, 42);
+    QCOMPARE(samplesSpy.count(), 0);
+    QCOMPARE(logs.count(), 1);
+    QCOMPARE(logs.value(0, "a", "temperature").toDouble(), 20.0);
+}
+
+void TestSampledLogs::find()
+{
+    SampledLogs logs;
+    QCOMPARE(logs.find(QDateTime::fromMSecsSinceEpoch(m_start)), -1);
+
+    reply(&logs, {
+              logEntry(m_start, "a", {{"temperature", 20}}),
+              logEntry(m_start + 1000, "a", {{"temperature", 21}}),
+              logEntry(m_start + 3000, "a", {{"temperature", 22}})
+          });
+
+    QCOMPARE(logs.find(QDateTime::fromMSecsSinceEpoch(m_start - 5000)), 0);
+    QCOMPARE(logs.find(QDateTime::fromMSecsSinceEpoch(m_start)), 0);
+    QCOMPARE(logs.find(QDateTime::fromMSecsSinceEpoch(m_start + 400)), 0);
+    QCOMPARE(logs.find(QDateTime::fromMSecsSinceEpoch(m_start + 600)), 1);
+    QCOMPARE(logs.find(QDateTime::fromMSecsSinceEpoch(m_start + 1900)), 1);
+    QCOMPARE(logs.find(QDateTime::fromMSecsSinceEpoch(m_start + 2100)), 2);
+    QCOMPARE(logs.find(QDateTime::fromMSecsSinceEpoch(m_start + 3000)), 2);
+    QCOMPARE(logs.find(QDateTime::fromMSecsSinceEpoch(m_start + 9000)), 2);
+}
+
+void TestSampledLogs::clearSources()
+{
+    SampledLogs logs;
+    logs.setSources({"a"});
+    reply(&logs, {logEntry(m_start, "a", {{"temperature", 20}})});
+    QCOMPARE(logs.count(), 1);
+
+    // Without any sources left there is nothing to show
+    QSignalSpy countSpy(&logs, &SampledLogs::countChanged);
+    logs.setSources({});
+    logs.fetchLogs();
+    QCOMPARE(countSpy.count(), 1);
+    QCOMPARE(logs.count(), 0);
+    QCOMPARE(logs.column("a", "temperature"), -1);
+}
+
+void TestSampledLogs::benchmarkReply()
+{
+    // Ten sources with three values each, a month in 15 minute samples
+    int rows = 30 * 24 * 4;
+    QVariantList entries;
+    entries.reserve(rows * 10);
+    for (int source = 0; source < 10; source++) {
+        for (int row = 0; row < rows; row++) {
+            entries.append(logEntry(m_start + row * 15 * 60 * 1000, QString("source%1").arg(source),
+                                    {{"temperature", 20 + row % 7}, {"humidity", 40 + row % 13}, {"power", row % 2 == 0}}));
+        }
+    }
+
+    SampledLogs logs;
+    QBENCHMARK {
+        reply(&logs, entries);
+    }
+    QCOMPARE(logs.count(), rows);
+    QCOMPARE(logs.valueAt(rows - 1, logs.column("source9", "humidity")), 40.0 + (rows - 1) % 13);
+}
+
+QTEST_GUILESS_MAIN(TestSampledLogs)
+
+#include "tst_sampledlogs.moc"
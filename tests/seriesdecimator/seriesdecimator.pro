@@ -0,0 +1,7 @@
+TARGET = tst_seriesdecimator
+
+include(../unittests.pri)
+
+QT += widgets
+
+SOURCES += tst_seriesdecimator.cpp
@@ -0,0 +1,334 @@
+#include <QtTest>
+#include <QApplication>
+#include <QLineSeries>
+
+#include "models/logsmodel.h"
+#include "models/seriesdecimator.h"
+#include "models/xyseriesadapter.h"
+
+QT_CHARTS_USE_NAMESPACE
+
+class TestSeriesDecimator: public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void lttbPassThrough_data();
+    void lttbPassThrough();
+    void lttbThreshold_data();
+    void lttbThreshold();
+    void lttbKeepsSpikes();
+
+    void adapterPointCount_data();
+    void adapterPointCount();
+    void minMaxEnvelope();
+    void window();
+
+    void benchmarkLttb_data();
+    void benchmarkLttb();
+    void benchmarkFrame_data();
+    void benchmarkFrame();
+
+private:
+    QVector<QPointF> wave(int count);
+    QVariantList logEntries(qint64 newest, int count, int interval, std::function<double(int)> value);
+    void deliver(LogsModel *model, const QVariantList &entries);
+    void flush(XYSeriesAdapter *adapter);
+
+    QUuid m_thingId;
+    QUuid m_stateTypeId;
+    qint64 m_now = 0;
+};
+
+void TestSeriesDecimator::initTestCase()
+{
+    QLoggingCategory::setFilterRules("LogEngine.info=false");
+    m_thingId = QUuid::createUuid();
+    m_stateTypeId = QUuid::createUuid();
+    m_now = QDateTime::currentSecsSinceEpoch();
+}
+
+QVector<QPointF> TestSeriesDecimator::wave(int count)
+{
+    QVector<QPointF> points;
+    points.reserve(count);
+    for (int i = 0; i < count; i++) {
+        points.append(QPointF(i * 60000.0, 20 + 5 * qSin(i / 100.0) + (i % 7) * 0.1));
+    }
+    return points;
+}
+
+QVariantList TestSeriesDecimator::logEntries(qint64 newest, int count, int interval, std::function<double(int)> value)
+{
+    // Newest first, like Logging.GetLogEntries returns them
+    QVariantList entries;
+    entries.reserve(count);
+    for (int i = 0; i < count; i++) {
+        QVariantMap entry;
+        entry.insert("timestamp", (newest - static_cast<qint64>(i) * interval) * 1000);
+        entry.insert("thingId", m_thingId);
+        entry.insert("typeId", m_stateTypeId);
+        entry.insert("value", value(i));
+        entry.insert("source", "LoggingSourceStates");
+        entry.insert("eventType", "LoggingEventTypeTrigger");
+        entries.append(entry);
+    }
+    return entries;
+}
+
+void TestSeriesDecimator::deliver(LogsModel *model, const QVariantList &entries)
+{
+    QVariantMap data({{"offset", 0}, {"count", entries.count()}, {"logEntries", entries}});
+    QMetaObject::invokeMethod(model, "logsReply", Q_ARG(int, 0), Q_ARG(QVariantMap, data));
+}
+
+void TestSeriesDecimator::flush(XYSeriesAdapter *adapter)
+{
+    // Otherwise happens with the next frame
+    QMetaObject::invokeMethod(adapter, "flush");
+}
+
+void TestSeriesDecimator::lttbPassThrough_data()
+{
+    QTest::addColumn<int>("count");
+    QTest::addColumn<int>("threshold");
+
+    QTest::newRow("empty") << 0 << 10;
+    QTest::newRow("fewer points") << 5 << 10;
+    QTest::newRow("as many points") << 10 << 10;
+    QTest::newRow("threshold too small") << 100 << 2;
+}
+
+void TestSeriesDecimator::lttbPassThrough()
+{
+    QFETCH(int, count);
+    QFETCH(int, threshold);
+
+    QVector<QPointF> points = wave(count);
+    QCOMPARE(SeriesDecimator::lttb(points, threshold), points);
+}
+
+void TestSeriesDecimator::lttbThreshold_data()
+{
+    QTest::addColumn<int>("count");
+    QTest::addColumn<int>("threshold");
+
+    QTest::newRow("one more") << 11 << 10;
+    QTest::newRow("uneven buckets") << 1001 << 37;
+    QTest::newRow("minimal") << 1000 << 3;
+    QTest::newRow("a month at 400 px") << 43200 << 800;
+}
+
+void TestSeriesDecimator::lttbThreshold()
+{
+    QFETCH(int, count);
+    QFETCH(int, threshold);
+
+    QVector<QPointF> points = wave(count);
+    QVector<QPointF> decimated = SeriesDecimator::lttb(points, threshold);
+    QCOMPARE(decimated.count(), threshold);
+    QCOMPARE(decimated.first(), points.first());
+    QCOMPARE(decimated.last(), points.last());
+
+    // Only original points, still sorted by x
+    int index = 0;
+    foreach (const QPointF &point, decimated) {
+        while (index < points.count() && points.at(index) != point) {
+            index++;
+        }
+        QVERIFY2(index < points.count(), "Point not in the original series or out of order");
+        index++;
+    }
+}
+
+void TestSeriesDecimator::lttbKeepsSpikes()
+{
+    // A flat line with single sample spikes, way more samples than buckets
+    QVector<QPointF> points;
+    for (int i = 0; i < 10000; i++) {
+        points.append(QPointF(i, 10));
+    }
+    points[2500].setY(100);
+    points[7777].setY(-50);
+
+    QVector<QPointF> decimated = SeriesDecimator::lttb(points, 100);
+    QVERIFY(decimated.contains(points.at(2500)));
+    QVERIFY(decimated.contains(points.at(7777)));
+}
+
+void TestSeriesDecimator::adapterPointCount_data()
+{
+    QTest::addColumn<int>("decimation");
+    QTest::addColumn<int>("plotWidth");
+    QTest::addColumn<int>("minimumPoints");
+    QTest::addColumn<int>("maximumPoints");
+
+    // A month of minute samples
+    QTest::newRow("exact") << static_cast<int>(XYSeriesAdapter::DecimationNone) << 400 << 30 * 24 * 60 << 30 * 24 * 60 + 5;
+    QTest::newRow("exact without width") << static_cast<int>(XYSeriesAdapter::DecimationMinMax) << 0 << 30 * 24 * 60 << 30 * 24 * 60 + 5;
+    QTest::newRow("min/max") << static_cast<int>(XYSeriesAdapter::DecimationMinMax) << 400 << 400 << 800;
+    QTest::newRow("lttb") << static_cast<int>(XYSeriesAdapter::DecimationLttb) << 400 << 800 << 800;
+}
+
+void TestSeriesDecimator::adapterPointCount()
+{
+    QFETCH(int, decimation);
+    QFETCH(int, plotWidth);
+    QFETCH(int, minimumPoints);
+    QFETCH(int, maximumPoints);
+
+    LogsModel model;
+    QLineSeries series;
+    XYSeriesAdapter adapter;
+    adapter.setSampleRate(XYSeriesAdapter::SampleRateMinute);
+    adapter.setDecimation(static_cast<XYSeriesAdapter::Decimation>(decimation));
+    adapter.setPlotWidth(plotWidth);
+    adapter.setLogsModel(&model);
+    adapter.setXySeries(&series);
+    deliver(&model, logEntries(m_now, 30 * 24 * 60, 60, [](int i) { return 20 + (i % 600) / 100.0; }));
+    flush(&adapter);
+
+    QVERIFY2(series.count() >= minimumPoints, qPrintable(QString::number(series.count())));
+    QVERIFY2(series.count() <= maximumPoints, qPrintable(QString::number(series.count())));
+    for (int i = 1; i < series.count(); i++) {
+        QVERIFY(series.at(i).x() >= series.at(i - 1).x());
+    }
+}
+
+void TestSeriesDecimator::minMaxEnvelope()
+{
+    LogsModel model;
+    QLineSeries series;
+    XYSeriesAdapter adapter;
+    adapter.setSampleRate(XYSeriesAdapter::SampleRateMinute);
+    adapter.setDecimation(XYSeriesAdapter::DecimationMinMax);
+    adapter.setPlotWidth(200);
+    adapter.setLogsModel(&model);
+    adapter.setXySeries(&series);
+
+    // Single sample spikes must not disappear between the pixels
+    deliver(&model, logEntries(m_now, 7 * 24 * 60, 60, [](int i) { return i == 1234 ? 500 : i == 4321 ? 1 : 20 + i % 10; }));
+    flush(&adapter);
+
+    QVERIFY(series.count() <= 400);
+    qreal maxY = 0;
+    qreal minY = 1000;
+    for (int i = 0; i < series.count(); i++) {
+        maxY = qMax(maxY, series.at(i).y());
+        minY = qMin(minY, series.at(i).y());
+    }
+    QCOMPARE(maxY, adapter.maxValue());
+    // The spike sample averages with the entry before
+    QVERIFY(maxY > 250);
+    QVERIFY(minY < 15);
+}
+
+void TestSeriesDecimator::window()
+{
+    LogsModel model;
+    QLineSeries series;
+    XYSeriesAdapter adapter;
+    adapter.setSampleRate(XYSeriesAdapter::SampleRateMinute);
+    adapter.setDecimation(XYSeriesAdapter::DecimationMinMax);
+    adapter.setPlotWidth(100);
+    adapter.setLogsModel(&model);
+    adapter.setXySeries(&series);
+    deliver(&model, logEntries(m_now, 7 * 24 * 60, 60, [](int i) { return i % 50; }));
+    flush(&adapter);
+
+    // Zooming into a day and panning through the week, only the window is decimated
+    for (int day = 1; day < 7; day++) {
+        QDateTime end = QDateTime::fromSecsSinceEpoch(m_now - (day - 1) * 24 * 60 * 60);
+        QDateTime start = end.addDays(-1);
+        adapter.setWindowStart(start);
+        adapter.setWindowEnd(end);
+        flush(&adapter);
+
+        QVERIFY(series.count() > 100);
+        QVERIFY(series.count() <= 200);
+        // Plus one sample on each side
+        QVERIFY(series.at(0).x() >= start.addSecs(-60).toMSecsSinceEpoch());
+        QVERIFY(series.at(0).x() <= start.addSecs(60).toMSecsSinceEpoch());
+        QVERIFY(series.at(series.count() - 1).x() >= end.addSecs(-60).toMSecsSinceEpoch());
+        QVERIFY(series.at(series.count() - 1).x() <= end.addSecs(60).toMSecsSinceEpoch());
+    }
+}
+
+void TestSeriesDecimator::benchmarkLttb_data()
+{
+    QTest::addColumn<int>("count");
+
+    QTest::newRow("a day of minutes") << 24 * 60;
+    QTest::newRow("a month of minutes") << 30 * 24 * 60;
+}
+
+void TestSeriesDecimator::benchmarkLttb()
+{
+    QFETCH(int, count);
+
+    QVector<QPointF> points = wave(count);
+    QBENCHMARK {
+        QVector<QPointF> decimated = SeriesDecimator::lttb(points, 800);
+        QVERIFY(decimated.count() <= 800);
+    }
+}
+
+void TestSeriesDecimator::benchmarkFrame_data()
+{
+    QTest::addColumn<int>("decimation");
+    QTest::addColumn<int>("days");
+
+    QList<QPair<QString, int>> decimations = {
+        {"exact", XYSeriesAdapter::DecimationNone},
+        {"min/max", XYSeriesAdapter::DecimationMinMax},
+        {"lttb", XYSeriesAdapter::DecimationLttb}
+    };
+    for (int i = 0; i < decimations.count(); i++) {
+        foreach (int days, QList<int>({1, 7, 30})) {
+            QTest::newRow(qPrintable(QString("%1, %2 days").arg(decimations.at(i).first).arg(days))) << decimations.at(i).second << days;
+        }
+    }
+}
+
+void TestSeriesDecimator::benchmarkFrame()
+{
+    QFETCH(int, decimation);
+    QFETCH(int, days);
+
+    // A month of minute samples in a 400 px wide chart, showing the given number of days
+    LogsModel model;
+    QLineSeries series;
+    XYSeriesAdapter adapter;
+    adapter.setSampleRate(XYSeriesAdapter::SampleRateMinute);
+    adapter.setDecimation(static_cast<XYSeriesAdapter::Decimation>(decimation));
+    adapter.setPlotWidth(400);
+    adapter.setLogsModel(&model);
+    adapter.setXySeries(&series);
+    deliver(&model, logEntries(m_now, 30 * 24 * 60, 60, [](int i) { return 20 + 5 * qSin(i / 100.0); }));
+    flush(&adapter);
+
+    // One frame while panning: move the window by an hour and update the series
+    int frame = 0;
+    QBENCHMARK {
+        QDateTime end = QDateTime::fromSecsSinceEpoch(m_now - (frame++ % 24) * 60 * 60);
+        adapter.setWindowStart(end.addDays(-days));
+        adapter.setWindowEnd(end);
+        flush(&adapter);
+    }
+    QVERIFY(series.count() > 0);
+}
+
+int main(int argc, char *argv[])
+{
+    // QtCharts series want a QApplication
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication app(argc, argv);
+    TestSeriesDecimator test;
+    return QTest::qExec(&test, argc, argv);
+}
+
+#include "tst_seriesdecimator.moc"
@@ -0,0 +1,5 @@
+TARGET = tst_states
+
+include(../unittests.pri)
+
+SOURCES += tst_states.cpp
@@ -0,0 +1,255 @@
+#include <QtTest>
+
+#include "types/states.h"
+#include "types/state.h"
+#include "types/statetype.h"
+#include "types/statetypes.h"
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+// What a state looked like before States kept the values in place: one QObject each, held in a QList
+class PlainState: public QObject
+{
+public:
+    PlainState(const QUuid &thingId, const QUuid &stateTypeId, const QVariant &value, QObject *parent):
+        QObject(parent), m_thingId(thingId), m_stateTypeId(stateTypeId), m_value(value) {}
+
+private:
+    QUuid m_thingId;
+    QUuid m_stateTypeId;
+    QVariant m_value;
+    QVariant m_minValue;
+    QVariant m_maxValue;
+};
+
+class TestStates: public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void typeCoercion_data();
+    void typeCoercion();
+    void scalarAndVariant();
+    void minMaxOverrides();
+
+    void benchmarkMemory_data();
+    void benchmarkMemory();
+
+private:
+    StateTypes *createStateTypes(const QStringList &types, QObject *parent);
+    QVariant fixtureValue(const QString &type, int i) const;
+    qint64 heapUsage() const;
+};
+
+StateTypes *TestStates::createStateTypes(const QStringList &types, QObject *parent)
+{
+    StateTypes *stateTypes = new StateTypes(parent);
+    for (int i = 0; i < types.count(); i++) {
+        StateType *stateType = new StateType(stateTypes);
+        stateType->setId(QUuid::createUuid());
+        stateType->setName(QString("state%1").arg(i));
+        stateType->setType(types.at(i));
+        stateType->setMinValue(0);
+        stateType->setMaxValue(100);
+        stateTypes->addStateType(stateType);
+    }
+    return stateTypes;
+}
+
+QVariant TestStates::fixtureValue(const QString &type, int i) const
+{
+    if (type == "Bool") {
+        return i % 2 == 0;
+    } else if (type == "Int") {
+        return i;
+    } else if (type == "Double") {
+        return i * 0.5;
+    }
+    return QString("value %1").arg(i);
+}
+
+qint64 TestStates::heapUsage() const
+{
+#if defined(__GLIBC__) && __GLIBC_PREREQ(2, 33)
+    return static_cast<qint64>(mallinfo2().uordblks);
+#elif defined(__GLIBC__)
+    return mallinfo().uordblks;
+#else
+    return -1;
+#endif
+}
+
+void TestStates::typeCoercion_data()
+{
+    QTest::addColumn<QString>("type");
+    QTest::addColumn<QVariant>("value");
+    QTest::addColumn<QVariant>("expected");
+
+    QTest::newRow("bool") << "Bool" << QVariant(true) << QVariant(true);
+    QTest::newRow("bool from string") << "Bool" << QVariant("false") << QVariant(false);
+    QTest::newRow("bool from int") << "Bool" << QVariant(1) << QVariant(true);
+    QTest::newRow("int") << "Int" << QVariant(-42) << QVariant(-42);
+    QTest::newRow("int from string") << "Int" << QVariant("42") << QVariant(42);
+    QTest::newRow("int from garbage") << "Int" << QVariant("n/a") << QVariant("n/a");
+    QTest::newRow("uint") << "UInt" << QVariant(7) << QVariant(7u);
+    QTest::newRow("double") << "Double" << QVariant(2.5) << QVariant(2.5);
+    QTest::newRow("double from int") << "Double" << QVariant(3) << QVariant(3.0);
+    QTest::newRow("double from string") << "Double" << QVariant("21.5") << QVariant(21.5);
+    QTest::newRow("double from garbage") << "Double" << QVariant("n/a") << QVariant("n/a");
+    QTest::newRow("string") << "QString" << QVariant("on") << QVariant("on");
+    QTest::newRow("color") << "QColor" << QVariant("#ff0000") << QVariant("#ff0000");
+    QTest::newRow("list") << "QVariantList" << QVariant(QVariantList({1, "two"})) << QVariant(QVariantList({1, "two"}));
+    QTest::newRow("invalid") << "Double" << QVariant() << QVariant();
+}
+
+void TestStates::typeCoercion()
+{
+    QFETCH(QString, type);
+    QFETCH(QVariant, value);
+    QFETCH(QVariant, expected);
+
+    QScopedPointer<StateTypes> stateTypes(createStateTypes({type}, nullptr));
+    States states(QUuid::createUuid(), stateTypes.data());
+    QVERIFY(states.addState(stateTypes->get(0)->id(), value));
+
+    // The value comes back converted to the type of the state, or as it was if it can't be converted
+    QVariant stored = states.valueAt(0);
+    QCOMPARE(stored.userType(), expected.userType());
+    QCOMPARE(stored, expected);
+    QCOMPARE(states.value(stateTypes->get(0)->id()), expected);
+    QCOMPARE(states.get(0)->value(), expected);
+}
+
+void TestStates::scalarAndVariant()
+{
+    QScopedPointer<StateTypes> stateTypes(createStateTypes({"Int"}, nullptr));
+    States states(QUuid::createUuid(), stateTypes.data());
+    QUuid stateTypeId = stateTypes->get(0)->id();
+    states.addState(stateTypeId, 5);
+    State *state = states.get(0);
+
+    QSignalSpy dataChangedSpy(&states, &States::dataChanged);
+    QSignalSpy valueChangedSpy(state, &State::valueChanged);
+
+    // The same value again is not a change, also when given as another type
+    states.setValue(stateTypeId, 5);
+    states.setValue(stateTypeId, "5");
+    QCOMPARE(dataChangedSpy.count(), 0);
+
+    // Scalar to variant and back, the slot switches each time
+    states.setValue(stateTypeId, "unknown");
+    QCOMPARE(states.valueAt(0), QVariant("unknown"));
+    states.setValue(stateTypeId, "unknown");
+    QCOMPARE(dataChangedSpy.count(), 1);
+    states.setValue(stateTypeId, 6);
+    QCOMPARE(states.valueAt(0), QVariant(6));
+    states.setValue(stateTypeId, "unavailable");
+    QCOMPARE(states.valueAt(0), QVariant("unavailable"));
+    states.setValue(stateTypeId, QVariant());
+    QVERIFY(!states.valueAt(0).isValid());
+    states.setValue(stateTypeId, 7);
+    QCOMPARE(states.valueAt(0), QVariant(7));
+    QCOMPARE(dataChangedSpy.count(), 5);
+    QCOMPARE(valueChangedSpy.count(), 5);
+    QCOMPARE(dataChangedSpy.last().at(2).value<QVector<int>>(), QVector<int>({States::ValueRole}));
+}
+
+void TestStates::minMaxOverrides()
+{
+    QScopedPointer<StateTypes> stateTypes(createStateTypes({"Double", "Double"}, nullptr));
+    States states(QUuid::createUuid(), stateTypes.data());
+    states.addState(stateTypes->get(0)->id(), 1);
+    states.addState(stateTypes->get(1)->id(), 1);
+    State *state = states.get(0);
+    QSignalSpy minSpy(state, &State::minValueChanged);
+    QSignalSpy maxSpy(state, &State::maxValueChanged);
+
+    // Defaults from the state type
+    QCOMPARE(states.minValueAt(0), QVariant(0));
+    QCOMPARE(states.maxValueAt(0), QVariant(100));
+
+    // Overrides only affect their own state
+    states.setMinValueAt(0, -20);
+    states.setMaxValueAt(0, 50);
+    QCOMPARE(states.minValueAt(0), QVariant(-20));
+    QCOMPARE(states.maxValueAt(0), QVariant(50));
+    QCOMPARE(state->minValue(), QVariant(-20));
+    QCOMPARE(state->maxValue(), QVariant(50));
+    QCOMPARE(states.minValueAt(1), QVariant(0));
+    QCOMPARE(states.maxValueAt(1), QVariant(100));
+    QCOMPARE(minSpy.count(), 1);
+    QCOMPARE(maxSpy.count(), 1);
+
+    // Setting the same override again doesn't notify
+    states.setMinValueAt(0, -20);
+    QCOMPARE(minSpy.count(), 1);
+
+    // Invalid values and the state type's own values reset to the defaults
+    states.setMinValueAt(0, QVariant());
+    states.setMaxValueAt(0, 100);
+    QCOMPARE(states.minValueAt(0), QVariant(0));
+    QCOMPARE(states.maxValueAt(0), QVariant(100));
+    QCOMPARE(minSpy.count(), 2);
+    QCOMPARE(maxSpy.count(), 2);
+
+    // Out of range indexes are ignored
+    states.setMinValueAt(5, 1);
+    QVERIFY(!states.minValueAt(5).isValid());
+}
+
+void TestStates::benchmarkMemory_data()
+{
+    QTest::addColumn<bool>("objects");
+
+    QTest::newRow("States") << false;
+    QTest::newRow("State objects") << true;
+}
+
+void TestStates::benchmarkMemory()
+{
+    QFETCH(bool, objects);
+
+    if (heapUsage() < 0) {
+        QSKIP("Heap usage can only be measured with glibc");
+    }
+
+    // Bytes for 500 things with 20 states each, mostly numbers and a few strings like a typical setup
+    QStringList types;
+    for (int i = 0; i < 20; i++) {
+        types.append(i % 10 == 9 ? "QString" : i % 3 == 0 ? "Bool" : i % 3 == 1 ? "Int" : "Double");
+    }
+    StateTypes *stateTypes = createStateTypes(types, nullptr);
+
+    qint64 before = heapUsage();
+    QList<States*> models;
+    QList<QList<PlainState*>> plainStates;
+    for (int thing = 0; thing < 500; thing++) {
+        QUuid thingId = QUuid::createUuid();
+        if (objects) {
+            QList<PlainState*> list;
+            for (int i = 0; i < types.count(); i++) {
+                list.append(new PlainState(thingId, stateTypes->get(i)->id(), fixtureValue(types.at(i), thing + i), nullptr));
+            }
+            plainStates.append(list);
+        } else {
+            States *states = new States(thingId, stateTypes);
+            for (int i = 0; i < types.count(); i++) {
+                states->addState(stateTypes->get(i)->id(), fixtureValue(types.at(i), thing + i));
+            }
+            models.append(states);
+        }
+    }
+    qint64 used = heapUsage() - before;
+    qDeleteAll(models);
+    for (int i = 0; i < plainStates.count(); i++) {
+        qDeleteAll(plainStates.at(i));
+    }
+    delete stateTypes;
+
+    QTest::setBenchmarkResult(used, QTest::BytesAllocated);
+}
+
+QTEST_GUILESS_MAIN(TestStates)
+#include "tst_states.moc"
@@ -1,3 +1,22 @@
 TEMPLATE = subdirs
 
-SUBDIRS = testrunner
+SUBDIRS = testrunner \
+    jsonrpcframer \
+    jsonrpccborcodec \
+    things \
+    thingmanager \
+    energylogsrouter \
+    energylogsdiskcache \
+    rangeaggregate \
+    xyseriesadapter \
+    seriesdecimator \
+    logentrystore \
+    connectionstats \
+    reconnectscheduler \
+    jsonrpcdiagnostics \
+    states \
+    energylogstore \
+    energylogspyramid \
+    newlogsmodel \
+    sampledlogs \
+    jsonrpcclient
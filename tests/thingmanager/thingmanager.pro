@@ -0,0 +1,5 @@
+TARGET = tst_thingmanager
+
+include(../unittests.pri)
+
+SOURCES += tst_thingmanager.cpp
@@ -0,0 +1,462 @@
+#include <QtTest>
+#include <QGuiApplication>
+
+#include "thingmanager.h"
+#include "things.h"
+#include "thingclasses.h"
+#include "jsonrpc/jsonrpcclient.h"
+#include "connection/nymeahost.h"
+#include "types/thing.h"
+#include "types/thingclass.h"
+
+class TestThingManager: public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void init();
+
+    void coldStart();
+    void warmStart();
+    void warmStartWithChangedThingClasses();
+    void warmStartWithLostReplies();
+    void refreshThings();
+    void actionReplyRouting();
+    void stateChangeCoalescing();
+
+    void benchmarkStartup_data();
+    void benchmarkStartup();
+    void benchmarkActionReplies();
+
+private:
+    void deliver(ThingManager *thingManager, const char *callback, const QVariantMap &params);
+    void notify(ThingManager *thingManager, const QUuid &thingId, const QUuid &stateTypeId, const QVariant &value);
+    QVariantMap getThingClassesReply(int thingClassCount);
+    QVariantMap getThingsReply(const QVariantMap &thingClassesReply, int thingCount);
+
+    JsonRpcClient *m_client = nullptr;
+    QVariantMap m_thingClasses;
+    QVariantMap m_things;
+};
+
+void TestThingManager::deliver(ThingManager *thingManager, const char *callback, const QVariantMap &params)
+{
+    // The replies as they would arrive from JsonRpcClient
+    QVERIFY(QMetaObject::invokeMethod(thingManager, callback, Q_ARG(int, 0), Q_ARG(QVariantMap, params)));
+}
+
+void TestThingManager::notify(ThingManager *thingManager, const QUuid &thingId, const QUuid &stateTypeId, const QVariant &value)
+{
+    QVariantMap params({{"thingId", thingId}, {"stateTypeId", stateTypeId}, {"value", value}});
+    QVariantMap notification({{"notification", "Integrations.StateChanged"}, {"params", params}});
+    QVERIFY(QMetaObject::invokeMethod(thingManager, "notificationReceived", Q_ARG(QVariantMap, notification)));
+}
+
+QVariantMap TestThingManager::getThingClassesReply(int thingClassCount)
+{
+    QVariantList thingClasses;
+    for (int i = 0; i < thingClassCount; i++) {
+        QVariantList stateTypes;
+        for (int j = 0; j < 10; j++) {
+            stateTypes.append(QVariantMap({{"id", QUuid::createUuid().toString()}, {"name", QString("state%1").arg(j)}, {"displayName", QString("State %1").arg(j)}, {"type", "Double"}, {"index", j}, {"defaultValue", 0}}));
+        }
+        QVariantList paramTypes({QVariantMap({{"id", QUuid::createUuid().toString()}, {"name", "host"}, {"displayName", "Host"}, {"type", "QString"}, {"index", 0}})});
+        QVariantMap thingClass;
+        thingClass.insert("id", QUuid::createUuid().toString());
+        thingClass.insert("vendorId", QUuid::createUuid().toString());
+        thingClass.insert("name", QString("thingClass%1").arg(i));
+        thingClass.insert("displayName", QString("Thing class %1").arg(i));
+        thingClass.insert("createMethods", QVariantList({"CreateMethodUser"}));
+        thingClass.insert("setupMethod", "SetupMethodJustAdd");
+        thingClass.insert("interfaces", QStringList({"sensor"}));
+        thingClass.insert("paramTypes", paramTypes);
+        thingClass.insert("stateTypes", stateTypes);
+        // Like a dimmer: the first state can be set by an action with the same id
+        QVariantMap stateType = stateTypes.first().toMap();
+        QVariantList actionParamTypes({QVariantMap({{"id", stateType.value("id")}, {"name", stateType.value("name")}, {"displayName", stateType.value("displayName")}, {"type", "Double"}, {"index", 0}})});
+        thingClass.insert("actionTypes", QVariantList({QVariantMap({{"id", stateType.value("id")}, {"name", stateType.value("name")}, {"displayName", stateType.value("displayName")}, {"index", 0}, {"paramTypes", actionParamTypes}})}));
+        thingClasses.append(thingClass);
+    }
+    return QVariantMap({{"thingClasses", thingClasses}});
+}
+
+QVariantMap TestThingManager::getThingsReply(const QVariantMap &thingClassesReply, int thingCount)
+{
+    QVariantList thingClasses = thingClassesReply.value("thingClasses").toList();
+    QVariantList things;
+    for (int i = 0; i < thingCount; i++) {
+        QVariantMap thingClass = thingClasses.at(i % thingClasses.count()).toMap();
+        QVariantList states;
+        foreach (const QVariant &stateType, thingClass.value("stateTypes").toList()) {
+            states.append(QVariantMap({{"stateTypeId", stateType.toMap().value("id")}, {"value", i * 0.5}}));
+        }
+        QVariantMap thing;
+        thing.insert("id", QUuid::createUuid().toString());
+        thing.insert("thingClassId", thingClass.value("id"));
+        thing.insert("name", QString("Thing %1").arg(i));
+        thing.insert("setupStatus", "ThingSetupStatusComplete");
+        thing.insert("params", QVariantList({QVariantMap({{"paramTypeId", thingClass.value("paramTypes").toList().first().toMap().value("id")}, {"value", "192.168.0.10"}})}));
+        thing.insert("states", states);
+        things.append(thing);
+    }
+    return QVariantMap({{"things", things}});
+}
+
+void TestThingManager::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+    // Without a connection every request ends up in a warning
+    QLoggingCategory::setFilterRules("NymeaConnection.warning=false");
+
+    // Snapshots are stored per server. A host without connections gives us a server uuid without connecting anywhere.
+    m_client = new JsonRpcClient(this);
+    NymeaHost *host = new NymeaHost(this);
+    host->setUuid(QUuid::createUuid());
+    host->setName("test");
+    m_client->connectToHost(host);
+    QVERIFY(!m_client->serverUuid().isEmpty());
+
+    m_thingClasses = getThingClassesReply(50);
+    m_things = getThingsReply(m_thingClasses, 500);
+}
+
+void TestThingManager::init()
+{
+    QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/snapshots").removeRecursively();
+}
+
+void TestThingManager::coldStart()
+{
+    ThingManager thingManager(m_client);
+    thingManager.init();
+    QVERIFY(thingManager.fetchingData());
+    QCOMPARE(thingManager.things()->rowCount(), 0);
+
+    // Things may arrive before their thing classes
+    deliver(&thingManager, "getThingsResponse", m_things);
+    QVERIFY(thingManager.fetchingData());
+    deliver(&thingManager, "getThingClassesResponse", m_thingClasses);
+    QVERIFY(!thingManager.fetchingData());
+    QCOMPARE(thingManager.things()->rowCount(), 500);
+    QCOMPARE(thingManager.thingClasses()->rowCount(), 50);
+}
+
+void TestThingManager::warmStart()
+{
+    {
+        ThingManager thingManager(m_client);
+        thingManager.init();
+        deliver(&thingManager, "getThingClassesResponse", m_thingClasses);
+        deliver(&thingManager, "getThingsResponse", m_things);
+    }
+
+    ThingManager thingManager(m_client);
+    thingManager.init();
+    QVERIFY(!thingManager.fetchingData());
+    QCOMPARE(thingManager.things()->rowCount(), 500);
+
+    // Live data updates the snapshot things in place, vanished ones go away
+    QVariantList liveThings = m_things.value("things").toList();
+    QVariantMap changedThing = liveThings.first().toMap();
+    QUuid thingId = changedThing.value("id").toUuid();
+    Thing *thing = thingManager.things()->getThing(thingId);
+    QVERIFY(thing);
+    changedThing.insert("name", "Renamed");
+    liveThings.replace(0, changedThing);
+    QUuid removedThingId = liveThings.takeLast().toMap().value("id").toUuid();
+
+    QSignalSpy removedSpy(&thingManager, &ThingManager::thingRemoved);
+    deliver(&thingManager, "getThingClassesResponse", m_thingClasses);
+    deliver(&thingManager, "getThingsResponse", QVariantMap({{"things", liveThings}}));
+    QVERIFY(!thingManager.fetchingData());
+    QCOMPARE(thingManager.things()->rowCount(), 499);
+    QCOMPARE(thingManager.things()->getThing(thingId), thing);
+    QCOMPARE(thing->name(), QString("Renamed"));
+    QCOMPARE(removedSpy.count(), 1);
+    QCOMPARE(thingManager.things()->getThing(removedThingId), static_cast<Thing*>(nullptr));
+}
+
+void TestThingManager::warmStartWithChangedThingClasses()
+{
+    {
+        ThingManager thingManager(m_client);
+        thingManager.init();
+        deliver(&thingManager, "getThingClassesResponse", m_thingClasses);
+        deliver(&thingManager, "getThingsResponse", m_things);
+    }
+
+    ThingManager thingManager(m_client);
+    thingManager.init();
+    QCOMPARE(thingManager.things()->rowCount(), 500);
+
+    // A plugin update changed a thing class. The snapshot is dropped and the live data used.
+    QVariantList thingClasses = m_thingClasses.value("thingClasses").toList();
+    QVariantMap thingClass = thingClasses.first().toMap();
+    thingClass.insert("displayName", "Updated");
+    thingClasses.replace(0, thingClass);
+
+    deliver(&thingManager, "getThingClassesResponse", QVariantMap({{"thingClasses", thingClasses}}));
+    QVERIFY(thingManager.fetchingData());
+    QCOMPARE(thingManager.things()->rowCount(), 0);
+    deliver(&thingManager, "getThingsResponse", m_things);
+    QVERIFY(!thingManager.fetchingData());
+    QCOMPARE(thingManager.things()->rowCount(), 500);
+    QCOMPARE(thingManager.thingClasses()->getThingClass(thingClass.value("id").toUuid())->displayName(), QString("Updated"));
+}
+
+void TestThingManager::warmStartWithLostReplies()
+{
+    {
+        ThingManager thingManager(m_client);
+        thingManager.init();
+        deliver(&thingManager, "getThingClassesResponse", m_thingClasses);
+        deliver(&thingManager, "getThingsResponse", m_things);
+    }
+
+    ThingManager thingManager(m_client);
+    thingManager.init();
+    QCOMPARE(thingManager.things()->rowCount(), 500);
+
+    // The connection went away before the replies arrived. Nothing to compare with, so the snapshot stays.
+    QSignalSpy removedSpy(&thingManager, &ThingManager::thingRemoved);
+    deliver(&thingManager, "getThingClassesResponse", QVariantMap({{"error", "lost"}}));
+    deliver(&thingManager, "getThingsResponse", QVariantMap({{"error", "lost"}}));
+    QVERIFY(!thingManager.fetchingData());
+    QCOMPARE(thingManager.things()->rowCount(), 500);
+    QCOMPARE(thingManager.thingClasses()->rowCount(), 50);
+    QCOMPARE(removedSpy.count(), 0);
+}
+
+void TestThingManager::refreshThings()
+{
+    ThingManager thingManager(m_client);
+    thingManager.init();
+    deliver(&thingManager, "getThingClassesResponse", m_thingClasses);
+    deliver(&thingManager, "getThingsResponse", m_things);
+    QCOMPARE(thingManager.things()->rowCount(), 500);
+
+    // A state changed and a thing went away while notifications didn't reach us
+    QVariantList liveThings = m_things.value("things").toList();
+    QVariantMap changedThing = liveThings.first().toMap();
+    QVariantList states = changedThing.value("states").toList();
+    QVariantMap state = states.first().toMap();
+    QUuid stateTypeId = state.value("stateTypeId").toUuid();
+    state.insert("value", 42.5);
+    states.replace(0, state);
+    changedThing.insert("states", states);
+    liveThings.replace(0, changedThing);
+    QUuid removedThingId = liveThings.takeLast().toMap().value("id").toUuid();
+
+    Thing *thing = thingManager.things()->getThing(changedThing.value("id").toUuid());
+    QVERIFY(thing);
+    QSignalSpy removedSpy(&thingManager, &ThingManager::thingRemoved);
+    QSignalSpy addedSpy(thingManager.things(), &Things::thingAdded);
+    thingManager.refreshThings();
+    deliver(&thingManager, "getThingsResponse", QVariantMap({{"things", liveThings}}));
+
+    // Updated in place, nothing is added again
+    QVERIFY(!thingManager.fetchingData());
+    QCOMPARE(thingManager.things()->rowCount(), 499);
+    QCOMPARE(thingManager.things()->getThing(thing->id()), thing);
+    QCOMPARE(thing->stateValue(stateTypeId).toDouble(), 42.5);
+    QCOMPARE(removedSpy.count(), 1);
+    QCOMPARE(addedSpy.count(), 0);
+    QCOMPARE(thingManager.things()->getThing(removedThingId), static_cast<Thing*>(nullptr));
+}
+
+void TestThingManager::actionReplyRouting()
+{
+    ThingManager thingManager(m_client);
+    thingManager.init();
+    deliver(&thingManager, "getThingClassesResponse", m_thingClasses);
+    deliver(&thingManager, "getThingsResponse", m_things);
+
+    Thing *first = thingManager.things()->get(0);
+    Thing *second = thingManager.things()->get(1);
+    QSignalSpy firstSpy(first, &Thing::executeActionReply);
+    QSignalSpy secondSpy(second, &Thing::executeActionReply);
+    QSignalSpy managerSpy(&thingManager, &ThingManager::executeActionReply);
+
+    QVariantList params({QVariantMap({{"paramName", "state0"}, {"value", 50}})});
+    int firstCommandId = first->executeAction("state0", params);
+    int secondCommandId = second->executeAction("state0", params);
+    int anonymousCommandId = thingManager.executeAction(first->id(), first->thingClass()->actionTypes()->get(0)->id(), params);
+    QVERIFY(firstCommandId != secondCommandId);
+
+    // Replies only go to the thing which executed the action, in whatever order they arrive
+    QMetaObject::invokeMethod(&thingManager, "executeActionResponse", Q_ARG(int, secondCommandId), Q_ARG(QVariantMap, QVariantMap({{"thingError", "ThingErrorHardwareFailure"}})));
+    QCOMPARE(firstSpy.count(), 0);
+    QCOMPARE(secondSpy.count(), 1);
+    QCOMPARE(secondSpy.first().at(0).toInt(), secondCommandId);
+    QCOMPARE(secondSpy.first().at(1).value<Thing::ThingError>(), Thing::ThingErrorHardwareFailure);
+
+    QMetaObject::invokeMethod(&thingManager, "executeActionResponse", Q_ARG(int, anonymousCommandId), Q_ARG(QVariantMap, QVariantMap({{"thingError", "ThingErrorNoError"}})));
+    QMetaObject::invokeMethod(&thingManager, "executeActionResponse", Q_ARG(int, firstCommandId), Q_ARG(QVariantMap, QVariantMap({{"thingError", "ThingErrorNoError"}})));
+    QCOMPARE(firstSpy.count(), 1);
+    QCOMPARE(firstSpy.first().at(0).toInt(), firstCommandId);
+    QCOMPARE(secondSpy.count(), 1);
+
+    // The manager's signal still sees all of them
+    QCOMPARE(managerSpy.count(), 3);
+
+    // A reply for a thing which is gone in the meantime is fine too
+    int removedCommandId = second->executeAction("state0", params);
+    QPointer<Thing> removedThing = second;
+    QVariantMap notification({{"notification", "Integrations.ThingRemoved"}, {"params", QVariantMap({{"thingId", second->id()}})}});
+    QVERIFY(QMetaObject::invokeMethod(&thingManager, "notificationReceived", Q_ARG(QVariantMap, notification)));
+    QTRY_VERIFY(removedThing.isNull());
+    QMetaObject::invokeMethod(&thingManager, "executeActionResponse", Q_ARG(int, removedCommandId), Q_ARG(QVariantMap, QVariantMap({{"thingError", "ThingErrorNoError"}})));
+    QCOMPARE(managerSpy.count(), 4);
+
+    // An action lost with the connection might or might not have been executed
+    int lostCommandId = first->executeAction("state0", params);
+    QMetaObject::invokeMethod(&thingManager, "executeActionResponse", Q_ARG(int, lostCommandId), Q_ARG(QVariantMap, QVariantMap({{"error", "lost"}})));
+    QCOMPARE(firstSpy.count(), 2);
+    QCOMPARE(firstSpy.last().at(0).toInt(), lostCommandId);
+    QCOMPARE(firstSpy.last().at(1).value<Thing::ThingError>(), Thing::ThingErrorTimeout);
+    QCOMPARE(managerSpy.count(), 5);
+}
+
+void TestThingManager::stateChangeCoalescing()
+{
+    ThingManager thingManager(m_client);
+    thingManager.init();
+    deliver(&thingManager, "getThingClassesResponse", m_thingClasses);
+    deliver(&thingManager, "getThingsResponse", m_things);
+
+    Thing *thing = thingManager.things()->get(0);
+    QUuid first = thing->thingClass()->stateTypes()->get(0)->id();
+    QUuid second = thing->thingClass()->stateTypes()->get(1)->id();
+
+    // Listeners see the value which has been applied already
+    QList<QVariant> seenValues;
+    connect(&thingManager, &ThingManager::thingStateChanged, this, [&](const QUuid &thingId, const QUuid &stateTypeId, const QVariant &value){
+        QCOMPARE(thingManager.things()->getThing(thingId)->stateValue(stateTypeId), value);
+        seenValues.append(value);
+    });
+    QSignalSpy spy(&thingManager, &ThingManager::thingStateChanged);
+
+    // Without an interval, each notification is applied right away
+    thingManager.setStateUpdateInterval(0);
+    thingManager.setBackgroundStateUpdateInterval(0);
+    notify(&thingManager, thing->id(), first, 1.0);
+    notify(&thingManager, thing->id(), first, 2.0);
+    QCOMPARE(spy.count(), 2);
+    QCOMPARE(thing->stateValue(first), QVariant(2.0));
+
+    // Unknown things and states are dropped without a signal
+    QTest::ignoreMessage(QtWarningMsg, "Thing state change notification received for an unknown thing");
+    notify(&thingManager, QUuid::createUuid(), first, 3.0);
+    QTest::ignoreMessage(QtWarningMsg, QRegularExpression("^Thing state change notification received for an unknown state"));
+    notify(&thingManager, thing->id(), QUuid::createUuid(), 3.0);
+    QCOMPARE(spy.count(), 2);
+
+    // With an interval, bursts collapse into the latest value per state
+    spy.clear();
+    seenValues.clear();
+    thingManager.setStateUpdateInterval(50);
+    thingManager.setBackgroundStateUpdateInterval(50);
+    for (int i = 0; i < 10; i++) {
+        notify(&thingManager, thing->id(), first, 10.0 + i);
+    }
+    notify(&thingManager, thing->id(), second, 42.0);
+    QCOMPARE(spy.count(), 0);
+    QCOMPARE(thing->stateValue(first), QVariant(2.0));
+    QTRY_COMPARE(spy.count(), 2);
+    QCOMPARE(seenValues, QList<QVariant>({19.0, 42.0}));
+    QCOMPARE(thing->stateValue(first), QVariant(19.0));
+    QCOMPARE(thing->stateValue(second), QVariant(42.0));
+
+    // Any other notification flushes what's queued so the order is kept
+    spy.clear();
+    notify(&thingManager, thing->id(), first, 20.0);
+    QVariantMap event({{"thingId", thing->id()}, {"eventTypeId", QUuid::createUuid()}});
+    QVariantMap notification({{"notification", "Integrations.EventTriggered"}, {"params", QVariantMap({{"event", event}})}});
+    QVERIFY(QMetaObject::invokeMethod(&thingManager, "notificationReceived", Q_ARG(QVariantMap, notification)));
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(thing->stateValue(first), QVariant(20.0));
+}
+
+void TestThingManager::benchmarkStartup_data()
+{
+    QTest::addColumn<bool>("warm");
+
+    QTest::newRow("cold") << false;
+    QTest::newRow("warm") << true;
+}
+
+void TestThingManager::benchmarkStartup()
+{
+    QFETCH(bool, warm);
+
+    if (warm) {
+        ThingManager thingManager(m_client);
+        thingManager.init();
+        deliver(&thingManager, "getThingClassesResponse", m_thingClasses);
+        deliver(&thingManager, "getThingsResponse", m_things);
+    }
+
+    // Time until the things can be shown. For the cold start this leaves out the round trip for the replies, which
+    // is what dominates on a real connection, so this is the lower bound of what the snapshot saves.
+    // A cold start writes the snapshot, so it needs to be removed again each time.
+    QBENCHMARK {
+        if (!warm) {
+            init();
+        }
+        ThingManager thingManager(m_client);
+        thingManager.init();
+        if (!warm) {
+            deliver(&thingManager, "getThingClassesResponse", m_thingClasses);
+            deliver(&thingManager, "getThingsResponse", m_things);
+        }
+        QVERIFY(!thingManager.fetchingData());
+        QCOMPARE(thingManager.things()->rowCount(), 500);
+    }
+}
+
+void TestThingManager::benchmarkActionReplies()
+{
+    ThingManager thingManager(m_client);
+    thingManager.init();
+    deliver(&thingManager, "getThingClassesResponse", m_thingClasses);
+    deliver(&thingManager, "getThingsResponse", getThingsReply(m_thingClasses, 1000));
+    QCOMPARE(thingManager.things()->rowCount(), 1000);
+
+    int replies = 0;
+    QList<Thing*> things;
+    for (int i = 0; i < thingManager.things()->rowCount(); i++) {
+        Thing *thing = thingManager.things()->get(i);
+        connect(thing, &Thing::executeActionReply, this, [&replies](){ replies++; });
+        things.append(thing);
+    }
+
+    // Every thing drags a slider a few steps, then the replies come in
+    QVariantMap reply({{"thingError", "ThingErrorNoError"}});
+    QBENCHMARK {
+        replies = 0;
+        QList<int> commandIds;
+        for (int step = 0; step < 5; step++) {
+            foreach (Thing *thing, things) {
+                commandIds.append(thing->executeAction("state0", {QVariantMap({{"paramName", "state0"}, {"value", step * 20}})}));
+            }
+        }
+        foreach (int commandId, commandIds) {
+            QMetaObject::invokeMethod(&thingManager, "executeActionResponse", Q_ARG(int, commandId), Q_ARG(QVariantMap, reply));
+        }
+        QCOMPARE(replies, commandIds.count());
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    // ThingManager and NymeaConnection want a QGuiApplication
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QGuiApplication app(argc, argv);
+    TestThingManager test;
+    return QTest::qExec(&test, argc, argv);
+}
+
+#include "tst_thingmanager.moc"
@@ -0,0 +1,5 @@
+TARGET = tst_things
+
+include(../unittests.pri)
+
+SOURCES += tst_things.cpp
@@ -0,0 +1,242 @@
+#include <QtTest>
+
+#include "things.h"
+#include "thingclasses.h"
+#include "types/thing.h"
+#include "types/thingclass.h"
+#include "types/statetype.h"
+#include "types/statetypes.h"
+#include "types/states.h"
+#include "types/state.h"
+#include "types/interfaces.h"
+#include "types/interfacebits.h"
+#include "models/interfacesproxy.h"
+
+class TestThings: public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void getThing();
+    void duplicateThingIds();
+    void duplicateThingClassIds();
+    void stateTypeLookups();
+    void interfaceInheritance();
+    void interfacesProxyFollowsThings();
+
+    void benchmarkLookups_data();
+    void benchmarkLookups();
+
+private:
+    ThingClass *createThingClass(const QUuid &id, int stateCount, QObject *parent);
+    Thing *createThing(const QUuid &id, ThingClass *thingClass);
+};
+
+ThingClass *TestThings::createThingClass(const QUuid &id, int stateCount, QObject *parent)
+{
+    ThingClass *thingClass = new ThingClass(parent);
+    thingClass->setId(id);
+    thingClass->setName("testThingClass");
+    StateTypes *stateTypes = new StateTypes(thingClass);
+    for (int i = 0; i < stateCount; i++) {
+        StateType *stateType = new StateType(stateTypes);
+        stateType->setId(QUuid::createUuid());
+        stateType->setName(QString("state%1").arg(i));
+        stateType->setType("Double");
+        stateTypes->addStateType(stateType);
+    }
+    thingClass->setStateTypes(stateTypes);
+    return thingClass;
+}
+
+Thing *TestThings::createThing(const QUuid &id, ThingClass *thingClass)
+{
+    Thing *thing = new Thing(nullptr, thingClass);
+    thing->setId(id);
+    thing->setName(id.toString());
+    States *states = new States(id, thingClass->stateTypes(), thing);
+    for (int i = 0; i < thingClass->stateTypes()->rowCount(); i++) {
+        states->addState(thingClass->stateTypes()->get(i)->id(), i * 1.5);
+    }
+    thing->setStates(states);
+    return thing;
+}
+
+void TestThings::getThing()
+{
+    Things things;
+    ThingClass *thingClass = createThingClass(QUuid::createUuid(), 2, &things);
+    QList<Thing*> list;
+    for (int i = 0; i < 10; i++) {
+        list.append(createThing(QUuid::createUuid(), thingClass));
+    }
+    things.addThings(list.mid(0, 5));
+    things.addThing(list.at(5));
+    things.addThings(list.mid(6));
+
+    foreach (Thing *thing, list) {
+        QCOMPARE(things.getThing(thing->id()), thing);
+    }
+    QCOMPARE(things.getThing(QUuid::createUuid()), static_cast<Thing*>(nullptr));
+
+    things.removeThing(list.at(3));
+    QCOMPARE(things.getThing(list.at(3)->id()), static_cast<Thing*>(nullptr));
+    QCOMPARE(things.getThing(list.at(4)->id()), list.at(4));
+
+    QUuid id = list.at(4)->id();
+    things.clearModel();
+    QCOMPARE(things.getThing(id), static_cast<Thing*>(nullptr));
+}
+
+void TestThings::duplicateThingIds()
+{
+    // The list lookup this replaces returned the first match
+    Things things;
+    ThingClass *thingClass = createThingClass(QUuid::createUuid(), 1, &things);
+    QUuid id = QUuid::createUuid();
+    Thing *first = createThing(id, thingClass);
+    Thing *second = createThing(id, thingClass);
+    Thing *third = createThing(id, thingClass);
+    things.addThings({first, second});
+    things.addThing(third);
+    QCOMPARE(things.getThing(id), first);
+
+    // The next one with the same id takes over
+    things.removeThing(first);
+    QCOMPARE(things.getThing(id), second);
+    things.removeThing(third);
+    QCOMPARE(things.getThing(id), second);
+    things.removeThing(second);
+    QCOMPARE(things.getThing(id), static_cast<Thing*>(nullptr));
+}
+
+void TestThings::duplicateThingClassIds()
+{
+    ThingClasses thingClasses;
+    QUuid id = QUuid::createUuid();
+    ThingClass *first = createThingClass(id, 0, nullptr);
+    ThingClass *second = createThingClass(id, 0, nullptr);
+    thingClasses.addThingClass(first);
+    thingClasses.addThingClass(second);
+    QCOMPARE(thingClasses.getThingClass(id), first);
+
+    thingClasses.clearModel();
+    QCOMPARE(thingClasses.getThingClass(id), static_cast<ThingClass*>(nullptr));
+}
+
+void TestThings::stateTypeLookups()
+{
+    StateTypes stateTypes;
+    StateType *power = new StateType(&stateTypes);
+    power->setId(QUuid::createUuid());
+    power->setName("power");
+    StateType *duplicate = new StateType(&stateTypes);
+    duplicate->setId(power->id());
+    duplicate->setName("power");
+    stateTypes.addStateType(power);
+    stateTypes.addStateType(duplicate);
+
+    QCOMPARE(stateTypes.getStateType(power->id()), power);
+    QCOMPARE(stateTypes.findByName("power"), power);
+    QCOMPARE(stateTypes.indexOf(power->id()), 0);
+    QCOMPARE(stateTypes.findByName("unknown"), static_cast<StateType*>(nullptr));
+}
+
+void TestThings::interfaceInheritance()
+{
+    InterfaceBits bits = InterfaceBits::withInherited({"colorlight"});
+    QVERIFY(bits.testBit(InterfaceBits::idOf("colorlight")));
+    QVERIFY(bits.testBit(InterfaceBits::idOf("colortemperaturelight")));
+    QVERIFY(bits.testBit(InterfaceBits::idOf("dimmablelight")));
+    QVERIFY(bits.testBit(InterfaceBits::idOf("light")));
+    QVERIFY(!bits.testBit(InterfaceBits::idOf("power")));
+
+    // Two levels up
+    bits = InterfaceBits::withInherited({"account"});
+    QVERIFY(bits.testBit(InterfaceBits::idOf("gateway")));
+    QVERIFY(bits.testBit(InterfaceBits::idOf("connectable")));
+
+    // Unknown interfaces only have themselves
+    bits = InterfaceBits::withInherited({"somethingnew"});
+    QVERIFY(bits.testBit(InterfaceBits::idOf("somethingnew")));
+    QVERIFY(!bits.testBit(InterfaceBits::idOf("sensor")));
+
+    // Asserts in debug builds if the table in InterfaceBits doesn't match the definitions
+    Interfaces interfaces;
+    QVERIFY(interfaces.rowCount() > 0);
+}
+
+void TestThings::interfacesProxyFollowsThings()
+{
+    ThingClass *thingClass = createThingClass(QUuid::createUuid(), 1, this);
+    thingClass->setInterfaces({"dimmablelight"});
+    Things things;
+    InterfacesProxy proxy;
+    proxy.setShowStates(true);
+    proxy.setThingsFilter(&things);
+    QCOMPARE(proxy.rowCount(), 0);
+
+    // Things added or removed later on change what's shown
+    Thing *thing = createThing(QUuid::createUuid(), thingClass);
+    things.addThing(thing);
+    QCOMPARE(proxy.rowCount(), 2);
+    QVERIFY(proxy.getInterface("light"));
+    QVERIFY(proxy.getInterface("dimmablelight"));
+
+    things.removeThing(thing);
+    QCOMPARE(proxy.rowCount(), 0);
+
+    things.addThing(createThing(QUuid::createUuid(), thingClass));
+    things.clearModel();
+    QCOMPARE(proxy.rowCount(), 0);
+}
+
+void TestThings::benchmarkLookups_data()
+{
+    QTest::addColumn<bool>("byName");
+
+    QTest::newRow("state by id") << false;
+    QTest::newRow("state by name") << true;
+}
+
+void TestThings::benchmarkLookups()
+{
+    QFETCH(bool, byName);
+
+    // A big setup: 2000 things of 20 classes with 30 states each
+    Things things;
+    QList<ThingClass*> thingClasses;
+    for (int i = 0; i < 20; i++) {
+        thingClasses.append(createThingClass(QUuid::createUuid(), 30, &things));
+    }
+    QList<Thing*> list;
+    for (int i = 0; i < 2000; i++) {
+        list.append(createThing(QUuid::createUuid(), thingClasses.at(i % thingClasses.count())));
+    }
+    things.addThings(list);
+
+    QList<QUuid> ids;
+    foreach (Thing *thing, list) {
+        ids.append(thing->id());
+    }
+    QStringList stateNames;
+    for (int i = 0; i < 30; i++) {
+        stateNames.append(QString("state%1").arg(i));
+    }
+
+    // What a state change notification does: find the thing, then the state
+    QBENCHMARK {
+        int found = 0;
+        for (int i = 0; i < ids.count(); i++) {
+            Thing *thing = things.getThing(ids.at(i));
+            State *state = byName ? thing->stateByName(stateNames.at(i % 30)) : thing->state(thing->thingClass()->stateTypes()->get(i % 30)->id());
+            if (state) {
+                found++;
+            }
+        }
+        QCOMPARE(found, ids.count());
+    }
+}
+
+QTEST_GUILESS_MAIN(TestThings)
+#include "tst_things.moc"
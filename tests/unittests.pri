@@ -0,0 +1,16 @@
+# Common settings for the C++ unit tests and benchmarks of libnymea-app.
+# Run them with "make check", benchmarks take "-- -iterations N" etc. through TESTARGS.
+
+include(../shared.pri)
+
+QT += testlib network websockets bluetooth charts quick
+CONFIG += testcase
+
+INCLUDEPATH += $$top_srcdir/libnymea-app
+
+LIBS += -L$$top_builddir/libnymea-app/ -lnymea-app
+win32:Debug:LIBS += -L$$top_builddir/libnymea-app/debug
+win32:Release:LIBS += -L$$top_builddir/libnymea-app/release
+
+linux:!android:!nozeroconf:LIBS += -lavahi-client -lavahi-common
+linux:!android:PRE_TARGETDEPS += $$top_builddir/libnymea-app/libnymea-app.a
@@ -0,0 +1,282 @@
+#include <QtTest>
+#include <QApplication>
+#include <QLineSeries>
+
+#include "models/logsmodel.h"
+#include "models/xyseriesadapter.h"
+
+QT_CHARTS_USE_NAMESPACE
+
+class TestXYSeriesAdapter: public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void constantValue();
+    void sampleValues();
+    void pagingOrder();
+    void batchedUpdates();
+    void windowMinMax();
+
+    void benchmarkLoad_data();
+    void benchmarkLoad();
+
+private:
+    QVariantList logEntries(qint64 newest, int count, int interval, std::function<double(int)> value);
+    void deliver(LogsModel *model, const QVariantList &entries, int blockSize, XYSeriesAdapter *adapter = nullptr);
+    void flush(XYSeriesAdapter *adapter);
+    double expectedValue(const QVariantList &entries, qint64 sampleEnd, int sampleRate);
+
+    QUuid m_thingId;
+    QUuid m_stateTypeId;
+    qint64 m_now = 0;
+};
+
+void TestXYSeriesAdapter::initTestCase()
+{
+    QLoggingCategory::setFilterRules("LogEngine.info=false");
+    m_thingId = QUuid::createUuid();
+    m_stateTypeId = QUuid::createUuid();
+    m_now = QDateTime::currentSecsSinceEpoch();
+}
+
+QVariantList TestXYSeriesAdapter::logEntries(qint64 newest, int count, int interval, std::function<double(int)> value)
+{
+    // Newest first, like Logging.GetLogEntries returns them
+    QVariantList entries;
+    entries.reserve(count);
+    for (int i = 0; i < count; i++) {
+        QVariantMap entry;
+        entry.insert("timestamp", (newest - static_cast<qint64>(i) * interval) * 1000);
+        entry.insert("thingId", m_thingId);
+        entry.insert("typeId", m_stateTypeId);
+        entry.insert("value", value(i));
+        entry.insert("source", "LoggingSourceStates");
+        entry.insert("eventType", "LoggingEventTypeTrigger");
+        entries.append(entry);
+    }
+    return entries;
+}
+
+void TestXYSeriesAdapter::deliver(LogsModel *model, const QVariantList &entries, int blockSize, XYSeriesAdapter *adapter)
+{
+    // One page after the other, as fetchMore() gets them. If an adapter is given, the chart is updated in between.
+    for (int offset = 0; offset < entries.count(); offset += blockSize) {
+        QVariantList page = entries.mid(offset, blockSize);
+        QVariantMap data({{"offset", offset}, {"count", page.count()}, {"logEntries", page}});
+        QMetaObject::invokeMethod(model, "logsReply", Q_ARG(int, 0), Q_ARG(QVariantMap, data));
+        if (adapter) {
+            flush(adapter);
+        }
+    }
+}
+
+void TestXYSeriesAdapter::flush(XYSeriesAdapter *adapter)
+{
+    // Otherwise happens with the next frame
+    QMetaObject::invokeMethod(adapter, "flush");
+}
+
+double TestXYSeriesAdapter::expectedValue(const QVariantList &entries, qint64 sampleEnd, int sampleRate)
+{
+    // A sample averages the entries in (end - sampleRate, end] and the newest entry before, where the line comes from
+    double sum = 0;
+    int count = 0;
+    qint64 startTimestamp = 0;
+    double start = 0;
+    foreach (const QVariant &entry, entries) {
+        qint64 timestamp = entry.toMap().value("timestamp").toLongLong() / 1000;
+        double value = entry.toMap().value("value").toDouble();
+        if (timestamp > sampleEnd - sampleRate && timestamp <= sampleEnd) {
+            sum += value;
+            count++;
+        } else if (timestamp <= sampleEnd - sampleRate && (startTimestamp == 0 || timestamp > startTimestamp)) {
+            startTimestamp = timestamp;
+            start = value;
+        }
+    }
+    if (startTimestamp != 0) {
+        sum += start;
+        count++;
+    }
+    return count > 0 ? sum / count : 0;
+}
+
+void TestXYSeriesAdapter::constantValue()
+{
+    LogsModel model;
+    QLineSeries series;
+    XYSeriesAdapter adapter;
+    adapter.setSampleRate(XYSeriesAdapter::SampleRateMinute);
+    adapter.setLogsModel(&model);
+    adapter.setXySeries(&series);
+
+    deliver(&model, logEntries(m_now, 3600, 1, [](int) { return 21.5; }), 1000);
+    flush(&adapter);
+
+    // An hour of samples, up to two minutes into the future
+    QVERIFY(series.count() >= 60);
+    QVERIFY(series.count() <= 66);
+    for (int i = 0; i < series.count(); i++) {
+        QCOMPARE(series.at(i).y(), 21.5);
+        if (i > 0) {
+            QCOMPARE(series.at(i).x() - series.at(i - 1).x(), 60000.0);
+        }
+    }
+    // The oldest sample holds the oldest entry
+    QVERIFY(series.at(0).x() >= (m_now - 3599) * 1000.0);
+    QVERIFY(series.at(0).x() < (m_now - 3599 + 60) * 1000.0);
+    QVERIFY(series.at(series.count() - 1).x() >= m_now * 1000.0);
+    QCOMPARE(adapter.maxValue(), 21.5);
+    QCOMPARE(adapter.minValue(), 0.0);
+}
+
+void TestXYSeriesAdapter::sampleValues()
+{
+    LogsModel model;
+    QLineSeries series;
+    XYSeriesAdapter adapter;
+    adapter.setSampleRate(XYSeriesAdapter::SampleRateMinute);
+    adapter.setDecimation(XYSeriesAdapter::DecimationNone);
+    adapter.setLogsModel(&model);
+    adapter.setXySeries(&series);
+
+    // Irregular entries, some samples get several, some none
+    QVariantList entries;
+    qint64 timestamp = m_now;
+    for (int i = 0; i < 500; i++) {
+        entries.append(logEntries(timestamp, 1, 1, [i](int) { return (i * 37) % 101 - 50; }));
+        timestamp -= (i * 13) % 150 + 1;
+    }
+    deliver(&model, entries, 100);
+    flush(&adapter);
+
+    QVERIFY(series.count() > 0);
+    for (int i = 0; i < series.count(); i++) {
+        qint64 sampleEnd = static_cast<qint64>(series.at(i).x() / 1000);
+        QCOMPARE(series.at(i).y(), expectedValue(entries, sampleEnd, 60));
+    }
+}
+
+void TestXYSeriesAdapter::pagingOrder()
+{
+    QVariantList entries = logEntries(m_now, 5000, 7, [](int i) { return (i * 37) % 101 - 50; });
+
+    // Samples are aligned to the time the series is set. Make sure that's the same second for both adapters.
+    while (QDateTime::currentMSecsSinceEpoch() % 1000 > 500) {
+        QThread::msleep(10);
+    }
+    LogsModel model;
+    QLineSeries series;
+    XYSeriesAdapter adapter;
+    adapter.setSampleRate(XYSeriesAdapter::SampleRateMinute);
+    adapter.setLogsModel(&model);
+    adapter.setXySeries(&series);
+
+    LogsModel pagedModel;
+    QLineSeries pagedSeries;
+    XYSeriesAdapter pagedAdapter;
+    pagedAdapter.setSampleRate(XYSeriesAdapter::SampleRateMinute);
+    pagedAdapter.setLogsModel(&pagedModel);
+    pagedAdapter.setXySeries(&pagedSeries);
+
+    // All at once vs. small pages with chart updates in between
+    deliver(&model, entries, entries.count());
+    flush(&adapter);
+    deliver(&pagedModel, entries, 300, &pagedAdapter);
+    QCOMPARE(pagedSeries.pointsVector(), series.pointsVector());
+}
+
+void TestXYSeriesAdapter::batchedUpdates()
+{
+    LogsModel model;
+    QLineSeries series;
+    XYSeriesAdapter adapter;
+    adapter.setSampleRate(XYSeriesAdapter::SampleRateMinute);
+    adapter.setLogsModel(&model);
+    adapter.setXySeries(&series);
+    flush(&adapter);
+
+    QSignalSpy pointReplacedSpy(&series, &QXYSeries::pointReplaced);
+    QSignalSpy pointAddedSpy(&series, &QXYSeries::pointAdded);
+    QSignalSpy pointsReplacedSpy(&series, &QXYSeries::pointsReplaced);
+    deliver(&model, logEntries(m_now, 5000, 10, [](int i) { return i % 100; }), 1000);
+    flush(&adapter);
+    QCOMPARE(pointReplacedSpy.count(), 0);
+    QCOMPARE(pointAddedSpy.count(), 0);
+    QCOMPARE(pointsReplacedSpy.count(), 1);
+}
+
+void TestXYSeriesAdapter::windowMinMax()
+{
+    LogsModel model;
+    QLineSeries series;
+    XYSeriesAdapter adapter;
+    adapter.setSampleRate(XYSeriesAdapter::SampleRateMinute);
+    adapter.setDecimation(XYSeriesAdapter::DecimationNone);
+    adapter.setLogsModel(&model);
+    adapter.setXySeries(&series);
+
+    // A peak of 1000 three hours ago, everything else between 10 and 20
+    QVariantList entries = logEntries(m_now, 6 * 60, 60, [](int i) { return i == 180 ? 1000 : 10 + i % 11; });
+    deliver(&model, entries, 1000);
+    flush(&adapter);
+    QVERIFY(adapter.maxValue() > 500);
+
+    QSignalSpy windowMaxSpy(&adapter, &XYSeriesAdapter::windowMaxValueChanged);
+    adapter.setWindowStart(QDateTime::fromSecsSinceEpoch(m_now - 60 * 60));
+    adapter.setWindowEnd(QDateTime::fromSecsSinceEpoch(m_now));
+    QVERIFY(windowMaxSpy.count() > 0);
+    QVERIFY(adapter.windowMaxValue() <= 20);
+    QVERIFY(adapter.windowMaxValue() >= 10);
+    QCOMPARE(adapter.windowMinValue(), 0.0);
+    QVERIFY(adapter.maxValue() > 500);
+
+    // Scrolling the peak into the window
+    adapter.setWindowStart(QDateTime::fromSecsSinceEpoch(m_now - 4 * 60 * 60));
+    QVERIFY(adapter.windowMaxValue() > 500);
+}
+
+void TestXYSeriesAdapter::benchmarkLoad_data()
+{
+    QTest::addColumn<int>("decimation");
+
+    QTest::newRow("exact") << static_cast<int>(XYSeriesAdapter::DecimationNone);
+    QTest::newRow("min/max, 400 px") << static_cast<int>(XYSeriesAdapter::DecimationMinMax);
+}
+
+void TestXYSeriesAdapter::benchmarkLoad()
+{
+    QFETCH(int, decimation);
+
+    // 100k per second temperature logs, fetched in pages and drawn after each page
+    QVariantList entries = logEntries(m_now, 100000, 1, [](int i) { return 20 + (i % 600) / 100.0; });
+
+    QBENCHMARK {
+        LogsModel model;
+        QLineSeries series;
+        XYSeriesAdapter adapter;
+        adapter.setSampleRate(XYSeriesAdapter::SampleRateSecond);
+        adapter.setDecimation(static_cast<XYSeriesAdapter::Decimation>(decimation));
+        adapter.setPlotWidth(400);
+        adapter.setLogsModel(&model);
+        adapter.setXySeries(&series);
+        deliver(&model, entries, 1000, &adapter);
+        QVERIFY(series.count() > 0);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    // QtCharts series want a QApplication
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication app(argc, argv);
+    TestXYSeriesAdapter test;
+    return QTest::qExec(&test, argc, argv);
+}
+
+#include "tst_xyseriesadapter.moc"
@@ -0,0 +1,7 @@
+TARGET = tst_xyseriesadapter
+
+include(../unittests.pri)
+
+QT += widgets
+
+SOURCES += tst_xyseriesadapter.cpp